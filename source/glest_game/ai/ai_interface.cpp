@@ -183,6 +183,15 @@ void AiInterfaceThread::execute() {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s] Line: %d\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
+// =====================================================
+// 	class AiInterfaceJob
+// =====================================================
+
+void AiInterfaceJob::run() {
+	MutexSafeWrapper safeMutex(aiIntf->getMutex(),string(__FILE__) + "_" + intToStr(__LINE__));
+	aiIntf->update();
+}
+
 AiInterface::AiInterface(Game &game, int factionIndex, int teamIndex,
 		int useStartLocation) : fp(NULL) {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
@@ -231,7 +240,10 @@ AiInterface::AiInterface(Game &game, int factionIndex, int teamIndex,
 	}
 
 
-	if( Config::getInstance().getBool("EnableAIWorkerThreads","true") == true) {
+	// AI updates normally run as jobs on the world's JobSystem, the dedicated
+	// thread is only needed by the master / slave controller
+	if( Config::getInstance().getBool("EnableAIWorkerThreads","true") == true &&
+		Config::getInstance().getBool("EnableNewThreadManager","false") == true) {
 		if(workerThread != NULL) {
 			workerThread->signalQuit();
 			if(workerThread->shutdownAndWait() == true) {
@@ -869,25 +881,24 @@ const Unit *AiInterface::getFirstOnSightEnemyUnit(Vec2i &pos, Field &field, int
                     // so make note of the position
                     int foundEnemies = 0;
                     std::map<int,bool> foundEnemyList;
-                	for(int aiX = pos.x-CHECK_RADIUS; aiX < pos.x + CHECK_RADIUS; ++aiX) {
-                		for(int aiY = pos.y-CHECK_RADIUS; aiY < pos.y + CHECK_RADIUS; ++aiY) {
-                			Vec2i checkPos(aiX,aiY);
-                			if(map->isInside(checkPos) && map->isInsideSurface(map->toSurfCoords(checkPos))) {
-                				Cell *cAI = map->getCell(checkPos);
-                				SurfaceCell *scAI = map->getSurfaceCell(Map::toSurfCoords(checkPos));
-                				if(scAI != NULL && cAI != NULL && cAI->getUnit(field) != NULL && sc->isVisible(teamIndex)) {
-                					const Unit *checkUnit = cAI->getUnit(field);
-                					if(foundEnemyList.find(checkUnit->getId()) == foundEnemyList.end()) {
-										bool cannotSeeUnitAI = (checkUnit->getType()->hasCellMap() == true &&
-															checkUnit->getType()->getAllowEmptyCellMap() == true &&
-															checkUnit->getType()->hasEmptyCellMap() == true);
-										if(cannotSeeUnitAI == false && isAlly(checkUnit) == false
-												&& checkUnit->isAlive() == true) {
-											foundEnemies++;
-											foundEnemyList[checkUnit->getId()] = true;
-										}
-                					}
-                				}
+                    vector<UnitCellHit> hits;
+                    for(int checkTeam = 0; checkTeam < UnitGrid::teamCount; ++checkTeam) {
+                    	if(checkTeam != teamIndex) {
+                    		map->findUnitCells(checkTeam, pos - Vec2i(CHECK_RADIUS), pos + Vec2i(CHECK_RADIUS - 1), hits);
+                    	}
+                    }
+                	for(unsigned int hitIndex = 0; hitIndex < hits.size(); ++hitIndex) {
+                		if(hits[hitIndex].field == field) {
+                			const Unit *checkUnit = hits[hitIndex].unit;
+                			if(foundEnemyList.find(checkUnit->getId()) == foundEnemyList.end()) {
+								bool cannotSeeUnitAI = (checkUnit->getType()->hasCellMap() == true &&
+													checkUnit->getType()->getAllowEmptyCellMap() == true &&
+													checkUnit->getType()->hasEmptyCellMap() == true);
+								if(cannotSeeUnitAI == false && isAlly(checkUnit) == false
+										&& checkUnit->isAlive() == true) {
+									foundEnemies++;
+									foundEnemyList[checkUnit->getId()] = true;
+								}
                 			}
                 		}
                 	}
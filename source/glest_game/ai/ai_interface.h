@@ -57,6 +57,23 @@ public:
 	virtual bool canShutdown(bool deleteSelfIfShutdownDelayed=false);
 };
 
+// =====================================================
+// 	class AiInterfaceJob
+//
+///	Runs one AI update on the world's JobSystem
+// =====================================================
+
+class AiInterfaceJob : public Job {
+private:
+	AiInterface *aiIntf;
+
+public:
+	explicit AiInterfaceJob(AiInterface *aiIntf) {
+		this->aiIntf = aiIntf;
+	}
+	virtual void run();
+};
+
 class AiInterface {
 private:
     World *world;
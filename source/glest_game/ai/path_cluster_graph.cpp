@@ -0,0 +1,658 @@
+// ==============================================================
+//	This file is part of Glest (www.glest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "path_cluster_graph.h"
+
+#include <algorithm>
+#include <queue>
+
+#include "map.h"
+#include "unit.h"
+#include "unit_type.h"
+#include "leak_dumper.h"
+
+using namespace std;
+using namespace Shared::Graphics;
+using namespace Shared::Util;
+using namespace Shared::PlatformCommon;
+
+namespace Glest{ namespace Game{
+
+// =====================================================
+// 	class PathClusterGraph
+// =====================================================
+
+const int PathClusterGraph::straightCost		= 10;
+const int PathClusterGraph::diagonalCost		= 14;
+const int PathClusterGraph::maxEntranceWidth	= 6;
+
+// border slots in Cluster::borders
+static const int borderNorth	= 0;
+static const int borderWest		= 1;
+static const int borderEast		= 2;
+static const int borderSouth	= 3;
+
+PathClusterGraph::PathClusterGraph() {
+	map = NULL;
+	clusterW = 0;
+	clusterH = 0;
+	clusterSize = Map::pathClusterSize;
+	layerMutex = new ReadWriteMutex();
+}
+
+PathClusterGraph::~PathClusterGraph() {
+	clear();
+	map = NULL;
+
+	delete layerMutex;
+	layerMutex = NULL;
+}
+
+void PathClusterGraph::init(const Map *map) {
+	ReadWriteMutexSafeWrapper safeWriteLock(layerMutex,false,CODE_AT_LINE);
+	clear();
+	this->map = map;
+}
+
+// Brings every layer up to date with the map, called from the main thread
+// at the start of a frame before the faction threads start searching
+void PathClusterGraph::update() {
+	ReadWriteMutexSafeWrapper safeWriteLock(layerMutex,false,CODE_AT_LINE);
+	if(map == NULL) {
+		return;
+	}
+	for(LayerMap::iterator iterMap = layers.begin(); iterMap != layers.end(); ++iterMap) {
+		updateLayer(iterMap->second);
+	}
+}
+
+void PathClusterGraph::clear() {
+	for(LayerMap::iterator iterMap = layers.begin(); iterMap != layers.end(); ++iterMap) {
+		delete iterMap->second;
+	}
+	layers.clear();
+
+	clusterW = 0;
+	clusterH = 0;
+	buildBuffers = SearchBuffers();
+}
+
+bool PathClusterGraph::isStaticFree(const Vec2i &pos, Field field, int unitSize) const {
+	for(int i = 0; i < unitSize; ++i) {
+		for(int j = 0; j < unitSize; ++j) {
+			Vec2i cellPos(pos.x + i, pos.y + j);
+			if(map->isInside(cellPos) == false ||
+				map->isInsideSurface(Map::toSurfCoords(cellPos)) == false) {
+				return false;
+			}
+
+			Cell *cell = map->getCell(cellPos);
+			if(field == fLand) {
+				if(map->getSurfaceCell(Map::toSurfCoords(cellPos))->isFree() == false ||
+					map->getDeepSubmerged(cell) == true) {
+					return false;
+				}
+			}
+
+			// Mobile units are ignored here, they are handled by the local search
+			Unit *unit = cell->getUnit(field);
+			if(unit != NULL && unit->getType()->isMobile() == false) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool PathClusterGraph::canStep(const Vec2i &pos1, const Vec2i &pos2, Field field, int unitSize) const {
+	if(isStaticFree(pos2, field, unitSize) == false) {
+		return false;
+	}
+	// same corner cutting rule as Map::aproxCanMoveSoon
+	if(unitSize == 1 && pos1.x != pos2.x && pos1.y != pos2.y) {
+		if(isStaticFree(Vec2i(pos1.x, pos2.y), field, unitSize) == false ||
+			isStaticFree(Vec2i(pos2.x, pos1.y), field, unitSize) == false) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int PathClusterGraph::getClusterIndex(const Vec2i &pos) const {
+	return (pos.y / clusterSize) * clusterW + (pos.x / clusterSize);
+}
+
+void PathClusterGraph::getClusterBounds(int clusterIndex, Vec2i &topLeft, Vec2i &bottomRight) const {
+	int cx = clusterIndex % clusterW;
+	int cy = clusterIndex / clusterW;
+
+	topLeft = Vec2i(cx * clusterSize, cy * clusterSize);
+	bottomRight = Vec2i(min((cx + 1) * clusterSize, map->getW()) - 1,
+						min((cy + 1) * clusterSize, map->getH()) - 1);
+}
+
+int PathClusterGraph::heuristic(const Vec2i &pos1, const Vec2i &pos2) {
+	int dx = abs(pos1.x - pos2.x);
+	int dy = abs(pos1.y - pos2.y);
+	return straightCost * max(dx, dy) + (diagonalCost - straightCost) * min(dx, dy);
+}
+
+PathClusterGraph::Layer * PathClusterGraph::findLayer(Field field, int unitSize) const {
+	int newClusterW = (map->getW() + clusterSize - 1) / clusterSize;
+	int newClusterH = (map->getH() + clusterSize - 1) / clusterSize;
+	if(newClusterW != clusterW || newClusterH != clusterH) {
+		return NULL;
+	}
+
+	LayerMap::const_iterator iterFind = layers.find(make_pair((int)field, unitSize));
+	if(iterFind != layers.end()) {
+		return iterFind->second;
+	}
+	return NULL;
+}
+
+PathClusterGraph::Layer * PathClusterGraph::getLayer(Field field, int unitSize) {
+	int newClusterW = (map->getW() + clusterSize - 1) / clusterSize;
+	int newClusterH = (map->getH() + clusterSize - 1) / clusterSize;
+	if(newClusterW != clusterW || newClusterH != clusterH) {
+		clear();
+		clusterW = newClusterW;
+		clusterH = newClusterH;
+	}
+
+	std::pair<int,int> key = make_pair((int)field, unitSize);
+	LayerMap::iterator iterFind = layers.find(key);
+	if(iterFind != layers.end()) {
+		return iterFind->second;
+	}
+
+	Layer *layer = new Layer();
+	layer->field = field;
+	layer->unitSize = unitSize;
+	initLayer(layer);
+	layers[key] = layer;
+	return layer;
+}
+
+void PathClusterGraph::initLayer(Layer *layer) {
+	layer->clusters.clear();
+	layer->borders.clear();
+	layer->nodes.clear();
+	layer->freeNodes.clear();
+	layer->clusters.resize(clusterW * clusterH);
+
+	for(int cy = 0; cy < clusterH; ++cy) {
+		for(int cx = 0; cx < clusterW; ++cx) {
+			int clusterIndex = cy * clusterW + cx;
+			if(cx + 1 < clusterW) {
+				Border border;
+				border.cluster1 = clusterIndex;
+				border.cluster2 = clusterIndex + 1;
+				border.vertical = true;
+				layer->borders.push_back(border);
+				layer->clusters[clusterIndex].borders[borderEast] = (int)layer->borders.size() - 1;
+				layer->clusters[clusterIndex + 1].borders[borderWest] = (int)layer->borders.size() - 1;
+			}
+			if(cy + 1 < clusterH) {
+				Border border;
+				border.cluster1 = clusterIndex;
+				border.cluster2 = clusterIndex + clusterW;
+				layer->borders.push_back(border);
+				layer->clusters[clusterIndex].borders[borderSouth] = (int)layer->borders.size() - 1;
+				layer->clusters[clusterIndex + clusterW].borders[borderNorth] = (int)layer->borders.size() - 1;
+			}
+		}
+	}
+}
+
+void PathClusterGraph::buildBorder(Layer *layer, int borderIndex) {
+	Border &border = layer->borders[borderIndex];
+	border.transitions.clear();
+
+	Vec2i topLeft, bottomRight;
+	getClusterBounds(border.cluster1, topLeft, bottomRight);
+
+	bool vertical = border.vertical;
+	int length = (vertical ? bottomRight.y - topLeft.y : bottomRight.x - topLeft.x) + 1;
+	Vec2i step = (vertical ? Vec2i(0, 1) : Vec2i(1, 0));
+	Vec2i start1 = (vertical ? Vec2i(bottomRight.x, topLeft.y) : Vec2i(topLeft.x, bottomRight.y));
+	Vec2i offset = (vertical ? Vec2i(1, 0) : Vec2i(0, 1));
+
+	int runStart = -1;
+	for(int index = 0; index <= length; ++index) {
+		bool open = false;
+		if(index < length) {
+			Vec2i pos1 = start1 + step * index;
+			open = (isStaticFree(pos1, layer->field, layer->unitSize) == true &&
+					isStaticFree(pos1 + offset, layer->field, layer->unitSize) == true);
+		}
+
+		if(open == true && runStart < 0) {
+			runStart = index;
+		}
+		else if(open == false && runStart >= 0) {
+			int runEnd = index - 1;
+			vector<int> entrances;
+			if(runEnd - runStart + 1 <= maxEntranceWidth) {
+				entrances.push_back((runStart + runEnd) / 2);
+			}
+			else {
+				entrances.push_back(runStart);
+				entrances.push_back(runEnd);
+			}
+			for(unsigned int entrance = 0; entrance < entrances.size(); ++entrance) {
+				Transition transition;
+				transition.pos1 = start1 + step * entrances[entrance];
+				transition.pos2 = transition.pos1 + offset;
+				transition.node1 = -1;
+				transition.node2 = -1;
+				border.transitions.push_back(transition);
+			}
+			runStart = -1;
+		}
+	}
+}
+
+int PathClusterGraph::addNode(Layer *layer, const Vec2i &pos, int clusterIndex) {
+	int nodeIndex = -1;
+	if(layer->freeNodes.empty() == false) {
+		nodeIndex = layer->freeNodes.back();
+		layer->freeNodes.pop_back();
+	}
+	else {
+		nodeIndex = (int)layer->nodes.size();
+		layer->nodes.push_back(Node());
+	}
+
+	Node &node = layer->nodes[nodeIndex];
+	node.pos = pos;
+	node.cluster = clusterIndex;
+	node.peer = -1;
+	node.edges.clear();
+	layer->clusters[clusterIndex].nodes.push_back(nodeIndex);
+	return nodeIndex;
+}
+
+void PathClusterGraph::nextCellGeneration(SearchBuffers &buffers) const {
+	int cellCount = map->getW() * map->getH();
+	if((int)buffers.cellStamp.size() != cellCount) {
+		buffers.cellCost.resize(cellCount);
+		buffers.cellStamp.assign(cellCount,0);
+		buffers.generation = 0;
+	}
+
+	buffers.generation++;
+	if(buffers.generation == 0) {
+		std::fill(buffers.cellStamp.begin(),buffers.cellStamp.end(),0);
+		buffers.generation = 1;
+	}
+}
+
+inline int PathClusterGraph::getCellCost(const SearchBuffers &buffers, const Vec2i &pos) const {
+	int cellIndex = pos.y * map->getW() + pos.x;
+	if(buffers.cellStamp[cellIndex] != buffers.generation) {
+		return -1;
+	}
+	return buffers.cellCost[cellIndex];
+}
+
+void PathClusterGraph::computeClusterCosts(SearchBuffers &buffers, const Layer *layer, int clusterIndex, const Vec2i &fromPos) const {
+	typedef std::pair<int,int> QueueItem;
+	std::priority_queue<QueueItem, vector<QueueItem>, std::greater<QueueItem> > queue;
+
+	Vec2i topLeft, bottomRight;
+	getClusterBounds(clusterIndex, topLeft, bottomRight);
+
+	nextCellGeneration(buffers);
+	vector<int> &cellCost = buffers.cellCost;
+	vector<uint32> &cellStamp = buffers.cellStamp;
+	const uint32 cellGeneration = buffers.generation;
+
+	int w = map->getW();
+	int fromIndex = fromPos.y * w + fromPos.x;
+	cellStamp[fromIndex] = cellGeneration;
+	cellCost[fromIndex] = 0;
+	queue.push(make_pair(0, fromIndex));
+
+	while(queue.empty() == false) {
+		QueueItem item = queue.top();
+		queue.pop();
+		if(item.first != cellCost[item.second]) {
+			continue;
+		}
+
+		Vec2i pos(item.second % w, item.second / w);
+		for(int i = -1; i <= 1; ++i) {
+			for(int j = -1; j <= 1; ++j) {
+				if(i == 0 && j == 0) {
+					continue;
+				}
+				Vec2i sucPos(pos.x + i, pos.y + j);
+				if(sucPos.x < topLeft.x || sucPos.y < topLeft.y ||
+					sucPos.x > bottomRight.x || sucPos.y > bottomRight.y) {
+					continue;
+				}
+
+				int cost = item.first + (i != 0 && j != 0 ? diagonalCost : straightCost);
+				int sucIndex = sucPos.y * w + sucPos.x;
+				if(cellStamp[sucIndex] == cellGeneration && cellCost[sucIndex] <= cost) {
+					continue;
+				}
+				if(canStep(pos, sucPos, layer->field, layer->unitSize) == false) {
+					continue;
+				}
+
+				cellStamp[sucIndex] = cellGeneration;
+				cellCost[sucIndex] = cost;
+				queue.push(make_pair(cost, sucIndex));
+			}
+		}
+	}
+}
+
+void PathClusterGraph::buildCluster(Layer *layer, int clusterIndex) {
+	Cluster &cluster = layer->clusters[clusterIndex];
+	for(unsigned int i = 0; i < cluster.nodes.size(); ++i) {
+		int nodeIndex = cluster.nodes[i];
+		computeClusterCosts(buildBuffers, layer, clusterIndex, layer->nodes[nodeIndex].pos);
+
+		for(unsigned int j = 0; j < cluster.nodes.size(); ++j) {
+			if(i == j) {
+				continue;
+			}
+			int otherIndex = cluster.nodes[j];
+			int cost = getCellCost(buildBuffers, layer->nodes[otherIndex].pos);
+			if(cost >= 0) {
+				layer->nodes[nodeIndex].edges.push_back(Edge(otherIndex, cost));
+			}
+		}
+	}
+}
+
+bool PathClusterGraph::isLayerCurrent(const Layer *layer) const {
+	return layer->built == true && layer->mapGeneration == map->getPathClusterGeneration();
+}
+
+void PathClusterGraph::updateLayer(Layer *layer) {
+	if(isLayerCurrent(layer) == true) {
+		return;
+	}
+	layer->built = true;
+	layer->mapGeneration = map->getPathClusterGeneration();
+
+	int clusterCount = (int)layer->clusters.size();
+
+	vector<bool> changed(clusterCount,false);
+	bool anyChanged = false;
+	for(int clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex) {
+		Cluster &cluster = layer->clusters[clusterIndex];
+		uint32 stamp = map->getPathClusterStamp(clusterIndex);
+		if(cluster.built == false || cluster.stamp != stamp) {
+			changed[clusterIndex] = true;
+			anyChanged = true;
+		}
+	}
+	if(anyChanged == false) {
+		return;
+	}
+
+	// Larger units overlap into the clusters to their right and bottom so
+	// their left, top and top-left neighbours are affected too
+	vector<bool> dirty = changed;
+	if(layer->unitSize > 1) {
+		for(int clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex) {
+			if(changed[clusterIndex] == true) {
+				int cx = clusterIndex % clusterW;
+				int cy = clusterIndex / clusterW;
+				if(cx > 0) {
+					dirty[clusterIndex - 1] = true;
+				}
+				if(cy > 0) {
+					dirty[clusterIndex - clusterW] = true;
+				}
+				if(cx > 0 && cy > 0) {
+					dirty[clusterIndex - clusterW - 1] = true;
+				}
+			}
+		}
+	}
+
+	// Clusters sharing a rebuilt border must renumber their entrance nodes
+	vector<bool> rebuild = dirty;
+	vector<bool> borderDirty(layer->borders.size(),false);
+	for(unsigned int borderIndex = 0; borderIndex < layer->borders.size(); ++borderIndex) {
+		Border &border = layer->borders[borderIndex];
+		if(dirty[border.cluster1] == true || dirty[border.cluster2] == true) {
+			borderDirty[borderIndex] = true;
+			rebuild[border.cluster1] = true;
+			rebuild[border.cluster2] = true;
+		}
+	}
+
+	for(int clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex) {
+		if(rebuild[clusterIndex] == true) {
+			Cluster &cluster = layer->clusters[clusterIndex];
+			for(unsigned int i = 0; i < cluster.nodes.size(); ++i) {
+				layer->nodes[cluster.nodes[i]].edges.clear();
+				layer->freeNodes.push_back(cluster.nodes[i]);
+			}
+			cluster.nodes.clear();
+		}
+	}
+
+	for(unsigned int borderIndex = 0; borderIndex < layer->borders.size(); ++borderIndex) {
+		if(borderDirty[borderIndex] == true) {
+			buildBorder(layer, borderIndex);
+		}
+	}
+
+	for(int clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex) {
+		if(rebuild[clusterIndex] == false) {
+			continue;
+		}
+		Cluster &cluster = layer->clusters[clusterIndex];
+		for(int slot = 0; slot < 4; ++slot) {
+			if(cluster.borders[slot] < 0) {
+				continue;
+			}
+			Border &border = layer->borders[cluster.borders[slot]];
+			bool firstSide = (border.cluster1 == clusterIndex);
+			for(unsigned int index = 0; index < border.transitions.size(); ++index) {
+				Transition &transition = border.transitions[index];
+				if(firstSide == true) {
+					transition.node1 = addNode(layer, transition.pos1, clusterIndex);
+				}
+				else {
+					transition.node2 = addNode(layer, transition.pos2, clusterIndex);
+				}
+			}
+		}
+	}
+
+	for(unsigned int borderIndex = 0; borderIndex < layer->borders.size(); ++borderIndex) {
+		Border &border = layer->borders[borderIndex];
+		if(rebuild[border.cluster1] == true || rebuild[border.cluster2] == true) {
+			for(unsigned int index = 0; index < border.transitions.size(); ++index) {
+				Transition &transition = border.transitions[index];
+				layer->nodes[transition.node1].peer = transition.node2;
+				layer->nodes[transition.node2].peer = transition.node1;
+			}
+		}
+	}
+
+	for(int clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex) {
+		if(rebuild[clusterIndex] == true) {
+			buildCluster(layer, clusterIndex);
+		}
+		if(changed[clusterIndex] == true) {
+			layer->clusters[clusterIndex].stamp = map->getPathClusterStamp(clusterIndex);
+			layer->clusters[clusterIndex].built = true;
+		}
+	}
+}
+
+bool PathClusterGraph::findWaypoint(Field field, int unitSize, const Vec2i &startPos, const Vec2i &finalPos,
+		int minWaypointDistance, Vec2i &waypoint, SearchBuffers &buffers,
+		uint32 *searchedNodeCount) {
+	ReadWriteMutexSafeWrapper safeReadLock(layerMutex,true,CODE_AT_LINE);
+
+	if(map == NULL || map->getW() <= 0 || map->getH() <= 0) {
+		return false;
+	}
+	if(map->isInside(startPos) == false || map->isInside(finalPos) == false) {
+		return false;
+	}
+
+	const Layer *layer = findLayer(field, unitSize);
+	if(layer == NULL || isLayerCurrent(layer) == false) {
+		// Only happens for a new field / unit size or when the map changed
+		// since update(), swap to the write lock to (re)build the layer
+		safeReadLock.ReleaseLock(true);
+		{
+			ReadWriteMutexSafeWrapper safeWriteLock(layerMutex,false,CODE_AT_LINE);
+			updateLayer(getLayer(field, unitSize));
+		}
+		safeReadLock.Lock();
+		layer = findLayer(field, unitSize);
+		if(layer == NULL) {
+			return false;
+		}
+	}
+
+	int startCluster = getClusterIndex(startPos);
+	int goalCluster = getClusterIndex(finalPos);
+	if(startCluster == goalCluster) {
+		return false;
+	}
+
+	int nodeCount = (int)layer->nodes.size();
+	int goalNode = nodeCount;
+	vector<int> &goalCost = buffers.goalCost;
+	goalCost.assign(nodeCount, -1);
+	bool goalReachable = false;
+
+	computeClusterCosts(buffers, layer, goalCluster, finalPos);
+	const vector<int> &goalNodes = layer->clusters[goalCluster].nodes;
+	for(unsigned int index = 0; index < goalNodes.size(); ++index) {
+		goalCost[goalNodes[index]] = getCellCost(buffers, layer->nodes[goalNodes[index]].pos);
+		if(goalCost[goalNodes[index]] >= 0) {
+			goalReachable = true;
+		}
+	}
+	if(goalReachable == false) {
+		return false;
+	}
+
+	// open list ordered by f, then by insertion order for determinism
+	// (a min heap kept with the std heap functions, as std::priority_queue does)
+	vector<QueueItem> &openList = buffers.openList;
+	openList.clear();
+	std::greater<QueueItem> openListOrder;
+	vector<int> &gScore = buffers.gScore;
+	gScore.assign(nodeCount + 1, -1);
+	vector<int> &cameFrom = buffers.cameFrom;
+	cameFrom.assign(nodeCount + 1, -1);
+	vector<char> &closed = buffers.closed;
+	closed.assign(nodeCount + 1, false);
+	uint32 sequence = 0;
+
+	computeClusterCosts(buffers, layer, startCluster, startPos);
+	const vector<int> &startNodes = layer->clusters[startCluster].nodes;
+	for(unsigned int index = 0; index < startNodes.size(); ++index) {
+		int nodeIndex = startNodes[index];
+		int cost = getCellCost(buffers, layer->nodes[nodeIndex].pos);
+		if(cost >= 0) {
+			gScore[nodeIndex] = cost;
+			openList.push_back(make_pair(make_pair(cost + heuristic(layer->nodes[nodeIndex].pos, finalPos), sequence++), nodeIndex));
+			std::push_heap(openList.begin(), openList.end(), openListOrder);
+		}
+	}
+
+	bool pathFound = false;
+	uint32 searched = 0;
+	while(openList.empty() == false) {
+		std::pop_heap(openList.begin(), openList.end(), openListOrder);
+		QueueItem item = openList.back();
+		openList.pop_back();
+
+		int nodeIndex = item.second;
+		if(closed[nodeIndex] != false) {
+			continue;
+		}
+		closed[nodeIndex] = true;
+		searched++;
+
+		if(nodeIndex == goalNode) {
+			pathFound = true;
+			break;
+		}
+
+		const Node &node = layer->nodes[nodeIndex];
+		int nodeScore = gScore[nodeIndex];
+
+		if(goalCost[nodeIndex] >= 0) {
+			int cost = nodeScore + goalCost[nodeIndex];
+			if(gScore[goalNode] < 0 || cost < gScore[goalNode]) {
+				gScore[goalNode] = cost;
+				cameFrom[goalNode] = nodeIndex;
+				openList.push_back(make_pair(make_pair(cost, sequence++), goalNode));
+				std::push_heap(openList.begin(), openList.end(), openListOrder);
+			}
+		}
+
+		for(unsigned int index = 0; index <= node.edges.size(); ++index) {
+			int sucIndex = -1;
+			int cost = nodeScore;
+			if(index < node.edges.size()) {
+				sucIndex = node.edges[index].node;
+				cost += node.edges[index].cost;
+			}
+			else {
+				sucIndex = node.peer;
+				cost += straightCost;
+			}
+			if(sucIndex < 0 || closed[sucIndex] != false) {
+				continue;
+			}
+			if(gScore[sucIndex] < 0 || cost < gScore[sucIndex]) {
+				gScore[sucIndex] = cost;
+				cameFrom[sucIndex] = nodeIndex;
+				openList.push_back(make_pair(make_pair(cost + heuristic(layer->nodes[sucIndex].pos, finalPos), sequence++), sucIndex));
+				std::push_heap(openList.begin(), openList.end(), openListOrder);
+			}
+		}
+	}
+
+	if(searchedNodeCount != NULL) {
+		*searchedNodeCount += searched;
+	}
+	if(pathFound == false) {
+		return false;
+	}
+
+	vector<int> &path = buffers.path;
+	path.clear();
+	for(int nodeIndex = cameFrom[goalNode]; nodeIndex >= 0; nodeIndex = cameFrom[nodeIndex]) {
+		path.push_back(nodeIndex);
+	}
+
+	int minCost = minWaypointDistance * straightCost;
+	for(int index = (int)path.size() - 1; index >= 0; --index) {
+		const Vec2i &pos = layer->nodes[path[index]].pos;
+		if(heuristic(startPos, pos) >= minCost) {
+			waypoint = pos;
+			return true;
+		}
+	}
+	return false;
+}
+
+}}//end namespace
@@ -0,0 +1,206 @@
+// ==============================================================
+//	This file is part of Glest (www.glest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _GLEST_GAME_PATHCLUSTERGRAPH_H_
+#define _GLEST_GAME_PATHCLUSTERGRAPH_H_
+
+#ifdef WIN32
+    #include <winsock2.h>
+    #include <winsock.h>
+#endif
+
+#include "vec.h"
+#include <vector>
+#include <map>
+#include "skill_type.h"
+#include "platform_common.h"
+#include "leak_dumper.h"
+
+using std::vector;
+using Shared::Graphics::Vec2i;
+using Shared::Platform::ReadWriteMutex;
+using Shared::Platform::uint32;
+
+namespace Glest { namespace Game {
+
+class Map;
+
+// =====================================================
+// 	class PathClusterGraph
+//
+///	Abstract (hierarchical) graph over the map used to plan long paths.
+///	The map is split into square clusters of Map::pathClusterSize cells, each
+///	pair of neighbouring clusters is linked through entrances on their shared
+///	border and each cluster stores the walking cost between its entrances.
+///	Only static obstacles are taken into account (terrain, objects and non
+///	mobile units) so a cluster is only rebuilt once Map reports it changed.
+///	Costs are integers (10 per straight step, 14 per diagonal) so results are
+///	identical on every client.
+///	Searches only take a read lock and use the caller's SearchBuffers, so the
+///	faction threads can plan concurrently once update() has refreshed the
+///	layers at the start of the frame.
+// =====================================================
+
+class PathClusterGraph {
+public:
+	static const int straightCost;
+	static const int diagonalCost;
+	static const int maxEntranceWidth;
+
+	// open list entry of the abstract search: (f, insertion order), node
+	typedef std::pair<std::pair<int,uint32>, int> QueueItem;
+
+	// Per caller scratch space for cell cost and waypoint searches (one per
+	// faction), kept between searches so they do not allocate
+	class SearchBuffers {
+	public:
+		SearchBuffers() {
+			generation = 0;
+		}
+		vector<int> cellCost;
+		vector<uint32> cellStamp;
+		uint32 generation;
+
+		vector<int> goalCost;
+		vector<int> gScore;
+		vector<int> cameFrom;
+		vector<char> closed;
+		vector<QueueItem> openList;
+		vector<int> path;
+	};
+
+private:
+	class Edge {
+	public:
+		Edge(int node, int cost) {
+			this->node = node;
+			this->cost = cost;
+		}
+		int node;
+		int cost;
+	};
+
+	// A cell on a cluster border and the matching cell in the neighbour
+	class Transition {
+	public:
+		Vec2i pos1;
+		Vec2i pos2;
+		int node1;
+		int node2;
+	};
+
+	class Border {
+	public:
+		Border() {
+			cluster1 = -1;
+			cluster2 = -1;
+			vertical = false;
+		}
+		int cluster1;
+		int cluster2;
+		bool vertical;
+		vector<Transition> transitions;
+	};
+
+	class Node {
+	public:
+		Vec2i pos;
+		int cluster;
+		int peer;
+		vector<Edge> edges;
+	};
+
+	class Cluster {
+	public:
+		Cluster() {
+			stamp = 0;
+			built = false;
+			for(int index = 0; index < 4; ++index) {
+				borders[index] = -1;
+			}
+		}
+		uint32 stamp;
+		bool built;
+		int borders[4];
+		vector<int> nodes;
+	};
+
+	// One graph per movement field and unit size
+	class Layer {
+	public:
+		Layer() {
+			field = fLand;
+			unitSize = 1;
+			built = false;
+			mapGeneration = 0;
+		}
+		Field field;
+		int unitSize;
+		// Map::getPathClusterGeneration() the layer was last brought up to date with
+		bool built;
+		uint32 mapGeneration;
+		vector<Cluster> clusters;
+		vector<Border> borders;
+		vector<Node> nodes;
+		vector<int> freeNodes;
+	};
+
+	typedef std::map<std::pair<int,int>, Layer *> LayerMap;
+
+	const Map *map;
+	int clusterW;
+	int clusterH;
+	int clusterSize;
+	LayerMap layers;
+	ReadWriteMutex *layerMutex;
+
+	// used while rebuilding layers, only while holding the write lock
+	SearchBuffers buildBuffers;
+
+public:
+	PathClusterGraph();
+	~PathClusterGraph();
+
+	void init(const Map *map);
+	void clear();
+	void update();
+
+	bool findWaypoint(Field field, int unitSize, const Vec2i &startPos, const Vec2i &finalPos,
+			int minWaypointDistance, Vec2i &waypoint, SearchBuffers &buffers,
+			uint32 *searchedNodeCount=NULL);
+
+private:
+	PathClusterGraph(const PathClusterGraph &obj);
+	PathClusterGraph &operator=(const PathClusterGraph &obj);
+
+	bool isStaticFree(const Vec2i &pos, Field field, int unitSize) const;
+	bool canStep(const Vec2i &pos1, const Vec2i &pos2, Field field, int unitSize) const;
+
+	Layer * findLayer(Field field, int unitSize) const;
+	Layer * getLayer(Field field, int unitSize);
+	bool isLayerCurrent(const Layer *layer) const;
+	void initLayer(Layer *layer);
+	void updateLayer(Layer *layer);
+	void buildBorder(Layer *layer, int borderIndex);
+	void buildCluster(Layer *layer, int clusterIndex);
+	int addNode(Layer *layer, const Vec2i &pos, int clusterIndex);
+
+	int getClusterIndex(const Vec2i &pos) const;
+	void getClusterBounds(int clusterIndex, Vec2i &topLeft, Vec2i &bottomRight) const;
+	void nextCellGeneration(SearchBuffers &buffers) const;
+	void computeClusterCosts(SearchBuffers &buffers, const Layer *layer, int clusterIndex, const Vec2i &fromPos) const;
+	inline int getCellCost(const SearchBuffers &buffers, const Vec2i &pos) const;
+	static int heuristic(const Vec2i &pos1, const Vec2i &pos2);
+};
+
+}}//end namespace
+
+#endif
@@ -44,6 +44,9 @@ const int PathFinder::pathFindBailoutRadius	= 20;
 const int PathFinder::pathFindExtendRefreshForNodeCount	= 25;
 const int PathFinder::pathFindExtendRefreshNodeCountMin	= 40;
 const int PathFinder::pathFindExtendRefreshNodeCountMax	= 40;
+const int PathFinder::pathFindHierarchicalMinDistance		= 48;
+const int PathFinder::pathFindHierarchicalWaypointDistance	= 24;
+const int PathFinder::pathFindMoveSoonCacheSize				= 16384;
 
 PathFinder::PathFinder() {
 	minorDebugPathfinder = false;
@@ -69,8 +72,62 @@ void PathFinder::init(const Map *map) {
 
 		faction.nodePool.resize(pathFindNodesAbsoluteMax);
 		faction.useMaxNodeCount = PathFinder::pathFindNodesMax;
+		faction.moveSoonCache.cachedCanMoveSoonList.setCapacity(pathFindMoveSoonCacheSize);
+		faction.moveSoonCache.unit = NULL;
 	}
 	this->map= map;
+	clusterGraph.init(map);
+
+	bool useFlatNodeLists = Config::getInstance().getBool("PathFinderFlatNodeLists","true");
+	for(int factionIndex = 0; factionIndex < GameConstants::maxPlayers; ++factionIndex) {
+		FactionState &faction = factions.getFactionState(factionIndex);
+
+		faction.useFlatNodeLists = useFlatNodeLists;
+		faction.openPosGrid.clear();
+		faction.openPosGridWidth = 0;
+		faction.openPosGridHeight = 0;
+		faction.openPosGeneration = 0;
+		if(faction.useFlatNodeLists == true) {
+			faction.openNodesHeap.reserve(pathFindNodesMax);
+		}
+	}
+}
+
+// Called from the main thread before the faction threads are signalled so
+// they only need read access to the cluster graph while the frame runs
+void PathFinder::prepareFrame() {
+	if(map == NULL) {
+		return;
+	}
+	clusterGraph.update();
+}
+
+// The searches of one findPath() call (A*, its retry with more nodes and
+// the bailout attempts) keep asking about the same cells around the unit.
+// aproxCanMoveSoon depends on the unit's position and command, which do not
+// change during the call, so its answers are cached for the unit until the
+// next findPath() of this faction. Synch logging of every lookup skips it.
+void PathFinder::beginMoveSoonCache(Unit *unit) {
+	FastAINodeCache &cache = factions.getFactionState(unit->getFactionIndex()).moveSoonCache;
+	cache.cachedCanMoveSoonList.nextGeneration();
+	cache.unit = unit;
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
+			SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
+		cache.unit = NULL;
+	}
+}
+
+void PathFinder::initFlatNodeLists(FactionState &faction) {
+	if(faction.useFlatNodeLists == false) {
+		return;
+	}
+	// The map may be loaded after init() so size the grid lazily
+	if(faction.openPosGridWidth != map->getW() || faction.openPosGridHeight != map->getH()) {
+		faction.openPosGridWidth = map->getW();
+		faction.openPosGridHeight = map->getH();
+		faction.openPosGrid.assign(faction.openPosGridWidth * faction.openPosGridHeight,0);
+		faction.openPosGeneration = 0;
+	}
 }
 
 void PathFinder::init() {
@@ -281,7 +338,8 @@ TravelState PathFinder::findPath(Unit *unit, const Vec2i &finalPos, bool *wasStu
 		unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__,szBuf);
 	}
 
-	ts = aStar(unit, finalPos, false, frameIndex, maxNodeCount,&searched_node_count);
+	beginMoveSoonCache(unit);
+	ts = aStar(unit, finalPos, false, frameIndex, maxNodeCount,&searched_node_count,true);
 	//post actions
 	switch(ts) {
 		case tsBlocked:
@@ -514,7 +572,8 @@ TravelState PathFinder::findPath(Unit *unit, const Vec2i &finalPos, bool *wasStu
 
 //route a unit using A* algorithm
 TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout,
-		int frameIndex, int maxNodeCount, uint32 *searched_node_count) {
+		int frameIndex, int maxNodeCount, uint32 *searched_node_count,
+		bool useHierarchicalWaypoint) {
 	TravelState ts = tsImpossible;
 
 	try {
@@ -552,9 +611,8 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 	UnitPathInterface *path= unit->getPath();
 
 	faction.nodePoolCount= 0;
-	faction.openNodesList.clear();
-	faction.openPosList.clear();
-	faction.closedNodesList.clear();
+	initFlatNodeLists(faction);
+	clearNodeLists(faction);
 
 	// check the pre-cache to see if we can re-use a cached path
 	if(frameIndex < 0) {
@@ -663,8 +721,13 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 		}
 	}
 
+	// Long paths are planned on the cluster graph first and A* only has to
+	// reach the next waypoint on that route
+	const Vec2i searchPos = (useHierarchicalWaypoint == true ?
+			computeHierarchicalWaypoint(unit, targetPos, searched_node_count) : targetPos);
+
 	const Vec2i unitPos = unit->getPos();
-	const Vec2i finalPos= computeNearestFreePos(unit, targetPos);
+	const Vec2i finalPos= computeNearestFreePos(unit, searchPos);
 
 	float dist = unitPos.dist(finalPos);
 
@@ -685,11 +748,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 	firstNode->pos= unitPos;
 	firstNode->heuristic= heuristic(unitPos, finalPos);
 	firstNode->exploredCell= true;
-	if(faction.openNodesList.find(firstNode->heuristic) == faction.openNodesList.end()) {
-		faction.openNodesList[firstNode->heuristic].clear();
-	}
-	faction.openNodesList[firstNode->heuristic].push_back(firstNode);
-	faction.openPosList[firstNode->pos] = true;
+	addOpenNode(firstNode, faction);
 
 	//b) loop
 	bool pathFound			= true;
@@ -817,7 +876,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 					unit->logSynchData(extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__,szBuf);
 				}
 
-				return aStar(unit, targetPos, false, frameIndex, pathFindNodesAbsoluteMax);
+				return aStar(unit, searchPos, false, frameIndex, pathFindNodesAbsoluteMax);
 			}
 		}
 	}
@@ -835,10 +894,11 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 	//if consumed all nodes find best node (to avoid strange behaviour)
 	if(nodeLimitReached == true) {
 
-		if(faction.closedNodesList.empty() == false) {
-			float bestHeuristic = truncateDecimal<float>(faction.closedNodesList.begin()->first,6);
+		Node *bestClosedNode = getBestClosedNode(faction);
+		if(bestClosedNode != NULL) {
+			float bestHeuristic = truncateDecimal<float>(bestClosedNode->heuristic,6);
 			if(lastNode != NULL && bestHeuristic < lastNode->heuristic) {
-				lastNode= faction.closedNodesList.begin()->second.front();
+				lastNode= bestClosedNode;
 			}
 		}
 	}
@@ -861,7 +921,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 			std::pair<Vec2i,int> lastHarvest = unit->getLastHarvestResourceTarget();
 
 			char szBuf[8096]="";
-			snprintf(szBuf,8096,"State: blocked, cmd [%s] pos: [%s], dest pos: [%s], lastHarvest = [%s - %d], reason A= %d, B= %d, C= %d, D= %d, E= %d, F = %d",commandDesc.c_str(),unit->getPos().getString().c_str(), targetPos.getString().c_str(),lastHarvest.first.getString().c_str(),lastHarvest.second, pathFound,(lastNode == firstNode),path->getBlockCount(), path->isBlocked(), nodeLimitReached,path->isStuck());
+			snprintf(szBuf,8096,"State: blocked, cmd [%s] pos: [%s], dest pos: [%s], lastHarvest = [%s - %d], reason A= %d, B= %d, C= %d, D= %d, E= %d, F = %d",commandDesc.c_str(),unit->getPos().getString().c_str(), searchPos.getString().c_str(),lastHarvest.first.getString().c_str(),lastHarvest.second, pathFound,(lastNode == firstNode),path->getBlockCount(), path->isBlocked(), nodeLimitReached,path->isStuck());
 			unit->setCurrentUnitTitle(szBuf);
 		}
 
@@ -971,7 +1031,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 			}
 
 			char szBuf[8096]="";
-			snprintf(szBuf,8096,"State: moving, cmd [%s] pos: %s dest pos: %s, Queue= %d",commandDesc.c_str(),unit->getPos().getString().c_str(), targetPos.getString().c_str(),path->getQueueCount());
+			snprintf(szBuf,8096,"State: moving, cmd [%s] pos: %s dest pos: %s, Queue= %d",commandDesc.c_str(),unit->getPos().getString().c_str(), searchPos.getString().c_str(),path->getQueueCount());
 			unit->setCurrentUnitTitle(szBuf);
 		}
 
@@ -979,9 +1039,7 @@ TravelState PathFinder::aStar(Unit *unit, const Vec2i &targetPos, bool inBailout
 	}
 
 
-	faction.openNodesList.clear();
-	faction.openPosList.clear();
-	faction.closedNodesList.clear();
+	clearNodeLists(faction);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled == true && chrono.getMillis() > 4) SystemFlags::OutputDebug(SystemFlags::debugPerformance,"In [%s::%s] Line: %d took msecs: %lld --------------------------- [END OF METHOD] ---------------------------\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chrono.getMillis());
 
@@ -1104,6 +1162,35 @@ Vec2i PathFinder::computeNearestFreePos(const Unit *unit, const Vec2i &finalPos)
 	return nearestPos;
 }
 
+Vec2i PathFinder::computeHierarchicalWaypoint(Unit *unit, const Vec2i &finalPos, uint32 *searched_node_count) {
+	const Vec2i unitPos = unit->getPos();
+	if(unitPos.dist(finalPos) < pathFindHierarchicalMinDistance) {
+		return finalPos;
+	}
+
+	FactionState &faction = factions.getFactionState(unit->getFactionIndex());
+	Vec2i waypoint;
+	if(clusterGraph.findWaypoint(unit->getCurrField(), unit->getType()->getSize(), unitPos, finalPos,
+			pathFindHierarchicalWaypointDistance, waypoint, faction.clusterSearchBuffers,
+			searched_node_count) == false) {
+		return finalPos;
+	}
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
+			SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
+		char szBuf[8096]="";
+		snprintf(szBuf,8096,"In computeHierarchicalWaypoint() unitPos = %s finalPos = %s waypoint = %s",
+				unitPos.getString().c_str(),finalPos.getString().c_str(),waypoint.getString().c_str());
+		if(Thread::isCurrentThreadMainThread() == false) {
+			unit->logSynchDataThreaded(__FILE__,__LINE__,szBuf);
+		}
+		else {
+			unit->logSynchData(__FILE__,__LINE__,szBuf);
+		}
+	}
+	return waypoint;
+}
+
 int PathFinder::findNodeIndex(Node *node, Nodes &nodeList) {
 	int index = -1;
 	if(node != NULL) {
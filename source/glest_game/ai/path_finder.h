@@ -20,10 +20,12 @@
 #include "vec.h"
 #include <vector>
 #include <map>
+#include <algorithm>
 #include "game_constants.h"
 #include "skill_type.h"
 #include "map.h"
 #include "unit.h"
+#include "path_cluster_graph.h"
 //#include "randomc.h"
 #include "leak_dumper.h"
 
@@ -86,13 +88,105 @@ public:
 	};
 	typedef vector<Node*> Nodes;
 
+	// Binary min-heap used in place of the std::map<float, Nodes> open list.
+	// Entries are ordered by heuristic and then by insertion sequence, so nodes
+	// are popped in exactly the same order as the map buckets (which are FIFO
+	// for equal heuristics). Keeping this order is required for network synch.
+	class NodeHeap {
+	protected:
+		class Entry {
+		public:
+			float heuristic;
+			uint32 sequence;
+			Node *node;
+		};
+
+		std::vector<Entry> heap;
+		uint32 nextSequence;
+
+		inline static bool lessThan(const Entry &a, const Entry &b) {
+			if(a.heuristic < b.heuristic) {
+				return true;
+			}
+			if(b.heuristic < a.heuristic) {
+				return false;
+			}
+			return a.sequence < b.sequence;
+		}
+
+	public:
+		NodeHeap() {
+			nextSequence = 0;
+		}
+
+		inline void clear() {
+			heap.clear();
+			nextSequence = 0;
+		}
+		inline void reserve(int count) {
+			heap.reserve(count);
+		}
+		inline bool empty() const {
+			return heap.empty();
+		}
+		inline size_t size() const {
+			return heap.size();
+		}
+
+		inline void push(Node *node) {
+			Entry entry;
+			entry.heuristic = node->heuristic;
+			entry.sequence 	= nextSequence++;
+			entry.node 		= node;
+
+			size_t index = heap.size();
+			heap.push_back(entry);
+			while(index > 0) {
+				size_t parent = (index - 1) / 2;
+				if(lessThan(entry, heap[parent]) == false) {
+					break;
+				}
+				heap[index] = heap[parent];
+				index = parent;
+			}
+			heap[index] = entry;
+		}
+
+		inline Node * pop() {
+			Node *result = heap.front().node;
+			Entry last = heap.back();
+			heap.pop_back();
+
+			size_t count = heap.size();
+			if(count > 0) {
+				size_t index = 0;
+				for(;;) {
+					size_t child = index * 2 + 1;
+					if(child >= count) {
+						break;
+					}
+					if(child + 1 < count && lessThan(heap[child + 1], heap[child]) == true) {
+						child++;
+					}
+					if(lessThan(heap[child], last) == false) {
+						break;
+					}
+					heap[index] = heap[child];
+					index = child;
+				}
+				heap[index] = last;
+			}
+			return result;
+		}
+	};
+
 	class FactionState {
 	protected:
 		Mutex *factionMutexPrecache;
 	public:
 		explicit FactionState(int factionIndex) :
 			//factionMutexPrecache(new Mutex) {
-			factionMutexPrecache(NULL) { //, random(factionIndex) {
+			factionMutexPrecache(NULL), moveSoonCache(NULL) { //, random(factionIndex) {
 
 			openPosList.clear();
 			openNodesList.clear();
@@ -104,6 +198,14 @@ public:
 
 			precachedTravelState.clear();
 			precachedPath.clear();
+
+			useFlatNodeLists = false;
+			openPosGeneration = 0;
+			openPosGridWidth = 0;
+			openPosGridHeight = 0;
+			openPosCount = 0;
+			closedNodeCount = 0;
+			bestClosedNode = NULL;
 		}
 		~FactionState() {
 
@@ -119,6 +221,25 @@ public:
 		std::map<float, Nodes> closedNodesList;
 		std::vector<Node> nodePool;
 
+		// Flat replacements for the lists above (see PathFinderFlatNodeLists).
+		// openPosGrid holds one generation stamp per map cell, a cell is open
+		// when its stamp matches openPosGeneration so clearing is O(1).
+		bool useFlatNodeLists;
+		NodeHeap openNodesHeap;
+		std::vector<uint32> openPosGrid;
+		uint32 openPosGeneration;
+		int openPosGridWidth;
+		int openPosGridHeight;
+		int openPosCount;
+		int closedNodeCount;
+		Node *bestClosedNode;
+
+		// scratch space for PathClusterGraph searches run by this faction
+		PathClusterGraph::SearchBuffers clusterSearchBuffers;
+
+		// canUnitMoveSoon results of the unit currently in findPath()
+		FastAINodeCache moveSoonCache;
+
 		int nodePoolCount;
 		int factionIndex;
 		RandomGen random;
@@ -171,6 +292,9 @@ public:
 	static const int pathFindExtendRefreshForNodeCount;
 	static const int pathFindExtendRefreshNodeCountMin;
 	static const int pathFindExtendRefreshNodeCountMax;
+	static const int pathFindHierarchicalMinDistance;
+	static const int pathFindHierarchicalWaypointDistance;
+	static const int pathFindMoveSoonCacheSize;
 
 private:
 
@@ -179,6 +303,7 @@ private:
 
 
 	FactionStateManager factions;
+	PathClusterGraph clusterGraph;
 	const Map *map;
 	bool minorDebugPathfinder;
 
@@ -197,6 +322,7 @@ public:
 	}
 
 	void init(const Map *map);
+	void prepareFrame();
 	TravelState findPath(Unit *unit, const Vec2i &finalPos, bool *wasStuck=NULL,int frameIndex=-1);
 	void clearUnitPrecache(Unit *unit);
 	void removeUnitPrecache(Unit *unit);
@@ -214,7 +340,8 @@ private:
 	void init();
 
 	TravelState aStar(Unit *unit, const Vec2i &finalPos, bool inBailout,
-			int frameIndex, int maxNodeCount=-1,uint32 *searched_node_count=NULL);
+			int frameIndex, int maxNodeCount=-1,uint32 *searched_node_count=NULL,
+			bool useHierarchicalWaypoint=false);
 	inline static Node *newNode(FactionState &faction, int maxNodeCount) {
 		if( faction.nodePoolCount < (int)faction.nodePool.size() &&
 			faction.nodePoolCount < maxNodeCount) {
@@ -227,23 +354,134 @@ private:
 	}
 
 	Vec2i computeNearestFreePos(const Unit *unit, const Vec2i &targetPos);
+	Vec2i computeHierarchicalWaypoint(Unit *unit, const Vec2i &finalPos, uint32 *searched_node_count);
 
 	inline static float heuristic(const Vec2i &pos, const Vec2i &finalPos) {
 		return pos.dist(finalPos);
 	}
 
+	void initFlatNodeLists(FactionState &faction);
+
+	inline static void clearNodeLists(FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			faction.openNodesHeap.clear();
+			faction.openPosCount = 0;
+			faction.closedNodeCount = 0;
+			faction.bestClosedNode = NULL;
+
+			faction.openPosGeneration++;
+			if(faction.openPosGeneration == 0) {
+				std::fill(faction.openPosGrid.begin(),faction.openPosGrid.end(),0);
+				faction.openPosGeneration = 1;
+			}
+		}
+		else {
+			faction.openNodesList.clear();
+			faction.openPosList.clear();
+			faction.closedNodesList.clear();
+		}
+	}
+
 	inline static bool openPos(const Vec2i &sucPos, FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			if(sucPos.x < 0 || sucPos.y < 0 ||
+				sucPos.x >= faction.openPosGridWidth || sucPos.y >= faction.openPosGridHeight) {
+				return false;
+			}
+			return faction.openPosGrid[sucPos.y * faction.openPosGridWidth + sucPos.x] == faction.openPosGeneration;
+		}
+
 		if(faction.openPosList.find(sucPos) == faction.openPosList.end()) {
 			return false;
 		}
 		return true;
 	}
 
+	inline static void setOpenPos(const Vec2i &pos, FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			uint32 &stamp = faction.openPosGrid[pos.y * faction.openPosGridWidth + pos.x];
+			if(stamp != faction.openPosGeneration) {
+				stamp = faction.openPosGeneration;
+				faction.openPosCount++;
+			}
+		}
+		else {
+			faction.openPosList[pos] = true;
+		}
+	}
+
+	inline static void addOpenNode(Node *node, FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			faction.openNodesHeap.push(node);
+		}
+		else {
+			if(faction.openNodesList.find(node->heuristic) == faction.openNodesList.end()) {
+				faction.openNodesList[node->heuristic].clear();
+			}
+			faction.openNodesList[node->heuristic].push_back(node);
+		}
+		setOpenPos(node->pos, faction);
+	}
+
+	inline static void addClosedNode(Node *node, FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			// Mirrors closedNodesList.begin()->second.front(): the first node
+			// closed with the lowest heuristic wins.
+			if(faction.bestClosedNode == NULL ||
+				node->heuristic < faction.bestClosedNode->heuristic) {
+				faction.bestClosedNode = node;
+			}
+			faction.closedNodeCount++;
+		}
+		else {
+			if(faction.closedNodesList.find(node->heuristic) == faction.closedNodesList.end()) {
+				faction.closedNodesList[node->heuristic].clear();
+			}
+			faction.closedNodesList[node->heuristic].push_back(node);
+		}
+		setOpenPos(node->pos, faction);
+	}
+
+	inline static Node * getBestClosedNode(FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			return faction.bestClosedNode;
+		}
+		if(faction.closedNodesList.empty() == true) {
+			return NULL;
+		}
+		return faction.closedNodesList.begin()->second.front();
+	}
+
+	inline static bool openNodesEmpty(FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			return faction.openNodesHeap.empty();
+		}
+		return faction.openNodesList.empty();
+	}
+
+	inline static unsigned long openPosCount(FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			return (unsigned long)faction.openPosCount;
+		}
+		return (unsigned long)faction.openPosList.size();
+	}
+
+	inline static unsigned long closedNodesCount(FactionState &faction) {
+		if(faction.useFlatNodeLists == true) {
+			return (unsigned long)faction.closedNodeCount;
+		}
+		return (unsigned long)faction.closedNodesList.size();
+	}
+
 	inline static Node * minHeuristicFastLookup(FactionState &faction) {
-		if(faction.openNodesList.empty() == true) {
+		if(openNodesEmpty(faction) == true) {
 			throw megaglest_runtime_error("openNodesList.empty() == true");
 		}
 
+		if(faction.useFlatNodeLists == true) {
+			return faction.openNodesHeap.pop();
+		}
+
 		Node *result = faction.openNodesList.begin()->second.front();
 		faction.openNodesList.begin()->second.erase(faction.openNodesList.begin()->second.begin());
 		if(faction.openNodesList.begin()->second.empty()) {
@@ -266,7 +504,7 @@ private:
 				SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
 			char szBuf[8096]="";
 			snprintf(szBuf,8096,"In processNode() nodeLimitReached %d unitFactionIndex %d foundOpenPosForPos %d allowUnitMoveSoon %d maxNodeCount %d node->pos = %s finalPos = %s sucPos = %s faction.openPosList.size() %lu closedNodesList.size() %lu",
-					nodeLimitReached,unitFactionIndex,foundOpenPosForPos, allowUnitMoveSoon, maxNodeCount,node->pos.getString().c_str(),finalPos.getString().c_str(),sucPos.getString().c_str(),faction.openPosList.size(),faction.closedNodesList.size());
+					nodeLimitReached,unitFactionIndex,foundOpenPosForPos, allowUnitMoveSoon, maxNodeCount,node->pos.getString().c_str(),finalPos.getString().c_str(),sucPos.getString().c_str(),openPosCount(faction),closedNodesCount(faction));
 
 			if(Thread::isCurrentThreadMainThread() == false) {
 				unit->logSynchDataThreaded(__FILE__,__LINE__,szBuf);
@@ -286,11 +524,7 @@ private:
 				sucNode->next= NULL;
 				sucNode->exploredCell = map->getSurfaceCell(
 						Map::toSurfCoords(sucPos))->isExplored(unit->getTeam());
-				if(faction.openNodesList.find(sucNode->heuristic) == faction.openNodesList.end()) {
-					faction.openNodesList[sucNode->heuristic].clear();
-				}
-				faction.openNodesList[sucNode->heuristic].push_back(sucNode);
-				faction.openPosList[sucNode->pos] = true;
+				addOpenNode(sucNode, faction);
 
 				result = true;
 
@@ -320,8 +554,24 @@ private:
 			Field field, int teamIndex,Vec2i unitPos, Vec2i &nearestPos, float &nearestDist);
 	int getPathFindExtendRefreshNodeCount(FactionState &faction);
 
+	void beginMoveSoonCache(Unit *unit);
+
 	inline bool canUnitMoveSoon(Unit *unit, const Vec2i &pos1, const Vec2i &pos2) {
-		bool result = map->aproxCanMoveSoon(unit, pos1, pos2);
+		FastAINodeCache &cache = factions.getFactionState(unit->getFactionIndex()).moveSoonCache;
+
+		uint64 cacheKey = 0;
+		bool useCache = (cache.unit == unit &&
+				Map::getMoveLookupKey(pos1, pos2, unit->getTeam(), unit->getType()->getSize(),
+						unit->getCurrField(), true, cacheKey) == true);
+		bool result = false;
+		if(useCache == true && cache.cachedCanMoveSoonList.find(cacheKey, result) == true) {
+			return result;
+		}
+
+		result = map->aproxCanMoveSoon(unit, pos1, pos2);
+		if(useCache == true) {
+			cache.cachedCanMoveSoonList.insert(cacheKey, result);
+		}
 		return result;
 	}
 
@@ -349,7 +599,7 @@ private:
 
 		while(nodeLimitReached == false) {
 			whileLoopCount++;
-			if(faction.openNodesList.empty() == true) {
+			if(openNodesEmpty(faction) == true) {
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
 						SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
 					char szBuf[8096]="";
@@ -388,11 +638,7 @@ private:
 				break;
 			}
 
-			if(faction.closedNodesList.find(node->heuristic) == faction.closedNodesList.end()) {
-				faction.closedNodesList[node->heuristic].clear();
-			}
-			faction.closedNodesList[node->heuristic].push_back(node);
-			faction.openPosList[node->pos] = true;
+			addClosedNode(node, faction);
 
 			int failureCount 	= 0;
 			int cellCount 		= 0;
@@ -597,6 +597,7 @@ void Commander::giveNetworkCommand(NetworkCommand* networkCommand) const {
         		Faction *faction = world->getFaction(factionIndex);
         		int oldTeam = faction->getTeam();
         		faction->setTeam(newTeam);
+        		world->getMapPtr()->updateUnitGridTeam(faction);
         		GameSettings *settings = world->getGameSettingsPtr();
         		settings->setTeam(factionIndex,newTeam);
         		world->getStats()->setTeam(factionIndex, newTeam);
@@ -691,6 +692,7 @@ void Commander::giveNetworkCommand(NetworkCommand* networkCommand) const {
         		Faction *faction = world->getFaction(factionIndex);
         		int oldTeam = faction->getTeam();
         		faction->setTeam(vote->newTeam);
+        		world->getMapPtr()->updateUnitGridTeam(faction);
         		GameSettings *settings = world->getGameSettingsPtr();
         		settings->setTeam(factionIndex,vote->newTeam);
         		world->getStats()->setTeam(factionIndex, vote->newTeam);
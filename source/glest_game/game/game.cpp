@@ -57,6 +57,7 @@ const int CANCEL_SWITCH_TEAM = -1;
 const int CANCEL_DISCONNECT_PLAYER = -1;
 
 const float Game::highlightTime= 0.5f;
+bool Game::benchmarkReplay = false;
 
 int fadeMusicMilliseconds = 3500;
 
@@ -170,6 +171,7 @@ Game::Game() : ProgramState(NULL) {
 
 	loadGameNode = NULL;
 	lastworldFrameCountForReplay = -1;
+	benchmarkStartFrame = -1;
 	lastNetworkPlayerConnectionCheck = time(NULL);
 	inJoinGameLoading = false;
 	quitGameCalled = false;
@@ -290,6 +292,7 @@ void Game::resetMembers() {
 
 	loadGameNode = NULL;
 	lastworldFrameCountForReplay = -1;
+	benchmarkStartFrame = -1;
 
 	lastNetworkPlayerConnectionCheck = time(NULL);
 
@@ -1107,6 +1110,17 @@ void Game::load(int loadTypes) {
 
     if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
+	// models of the last game stay loaded when it used the same techtree and tileset
+	if((loadTypes & (lgt_TileSet | lgt_TechTree)) == (lgt_TileSet | lgt_TechTree)) {
+		uint32 tilesetCRC = getFolderTreeContentsCheckSumRecursively(config.getPathListForType(ptTilesets,scenarioDir), "/" + tilesetName + "/*", ".xml", NULL);
+		uint32 techCRC = getFolderTreeContentsCheckSumRecursively(config.getPathListForType(ptTechs,scenarioDir), "/" + techName + "/*", ".xml", NULL);
+		string assetsKey = "";
+		if(tilesetCRC != 0 && techCRC != 0) {
+			assetsKey = techName + "_" + uIntToStr(techCRC) + "_" + tilesetName + "_" + uIntToStr(tilesetCRC);
+		}
+		Renderer::getInstance().beginGameAssets(assetsKey);
+	}
+
 	//tileset
 	if((loadTypes & lgt_TileSet) == lgt_TileSet) {
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
@@ -1784,7 +1798,7 @@ void Game::update() {
 			currentUIState->update();
 		}
 
-		bool showPerfStats = Config::getInstance().getBool("ShowPerfStats","false");
+		bool showPerfStats = CachedConfig::showPerfStats.get();
 		Chrono chronoPerf;
 		char perfBuf[8096]="";
 		std::vector<string> perfList;
@@ -2019,6 +2033,10 @@ void Game::update() {
 			if(replayTotal > 0) {
 				chronoReplay.start();
 			}
+			if(benchmarkReplay == true && benchmarkStartFrame < 0) {
+				benchmarkStartFrame = world.getFrameCount();
+				benchmarkChrono.start();
+			}
 
 			do {
 				if(replayTotal > 0) {
@@ -2032,14 +2050,14 @@ void Game::update() {
 					}
 
 					//AiInterface
-					if(commander.hasReplayCommandListForFrame() == false) {
+					if(isReplayRunning() == false) {
 						chronoGamePerformanceCounts.start();
 
 						processNetworkSynchChecksIfRequired();
 
 						addPerformanceCount("CalculateNetworkCRCSynchChecks",chronoGamePerformanceCounts.getMillis());
 
-						const bool newThreadManager = Config::getInstance().getBool("EnableNewThreadManager","false");
+						const bool newThreadManager = CachedConfig::enableNewThreadManager.get();
 						if(newThreadManager == true) {
 							int currentFrameCount = world.getFrameCount();
 							masterController.signalSlaves(&currentFrameCount);
@@ -2050,7 +2068,7 @@ void Game::update() {
 							// Signal the faction threads to do any pre-processing
 							chronoGamePerformanceCounts.start();
 
-							bool hasAIPlayer = false;
+							std::vector<AiInterfaceJob> aiJobs;
 							for(int j = 0; j < world.getFactionCount(); ++j) {
 								Faction *faction = world.getFaction(j);
 
@@ -2060,8 +2078,7 @@ void Game::update() {
 									scriptManager.getPlayerModifiers(j)->getAiEnabled() == true) {
 
 									if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance,"In [%s::%s Line: %d] [i = %d] faction = %d, factionCount = %d, took msecs: %lld [before AI updates]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,i,j,world.getFactionCount(),chrono.getMillis());
-									aiInterfaces[j]->signalWorkerThread(world.getFrameCount());
-									hasAIPlayer = true;
+									aiJobs.push_back(AiInterfaceJob(aiInterfaces[j]));
 								}
 							}
 
@@ -2070,34 +2087,16 @@ void Game::update() {
 								perfList.push_back(perfBuf);
 							}
 
-							if(hasAIPlayer == true) {
-								//sleep(0);
-
-								Chrono chronoAI;
-								chronoAI.start();
-
-								const int MAX_FACTION_THREAD_WAIT_MILLISECONDS = 20000;
-								for(;chronoAI.getMillis() < MAX_FACTION_THREAD_WAIT_MILLISECONDS;) {
-									bool workThreadsFinished = true;
-									for(int j = 0; j < world.getFactionCount(); ++j) {
-										Faction *faction = world.getFaction(j);
-										if(faction == NULL) {
-											throw megaglest_runtime_error("faction == NULL");
-										}
-										if(	faction->getCpuControl(enableServerControlledAI,isNetworkGame,role) == true &&
-											scriptManager.getPlayerModifiers(j)->getAiEnabled() == true) {
-											if(aiInterfaces[j]->isWorkerThreadSignalCompleted(world.getFrameCount()) == false) {
-												workThreadsFinished = false;
-												break;
-											}
-										}
-									}
-									if(workThreadsFinished == false) {
-										//sleep(0);
-									}
-									else {
-										break;
-									}
+							std::vector<Job *> aiJobList;
+							for(unsigned int j = 0; j < aiJobs.size(); ++j) {
+								aiJobList.push_back(&aiJobs[j]);
+							}
+							if(CachedConfig::enableAIWorkerThreads.get() == true) {
+								world.getJobSystem()->run(aiJobList);
+							}
+							else {
+								for(unsigned int j = 0; j < aiJobList.size(); ++j) {
+									aiJobList[j]->run();
 								}
 							}
 
@@ -2110,7 +2109,7 @@ void Game::update() {
 						}
 
 					}
-					else {
+					else if(benchmarkReplay == false) {
 						// Simply show a progress message while replaying commands
 						if(lastReplaySecond < chronoReplay.getSeconds()) {
 							lastReplaySecond = chronoReplay.getSeconds();
@@ -2266,7 +2265,13 @@ void Game::update() {
 					//good_fpu_control_registers(NULL,extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 				}
 			}
-			while (commander.hasReplayCommandListForFrame() == true);
+			while (isReplayRunning() == true);
+
+			if(benchmarkReplay == true) {
+				printBenchmarkReport();
+				quitTriggeredIndicator = true;
+				return;
+			}
 		}
 		//else if(role == nrClient) {
 		else {
@@ -2500,8 +2505,10 @@ void Game::update() {
 						resumeRequestSent = true;
 					}
 				}
-				else if(server->getStartInGameConnectionLaunch() == true) {
-					bool saveNetworkGame = false;
+				else if(server->getStartInGameConnectionLaunch() == true &&
+						server->isSavedGameSnapshotInProgress() == false) {
+					vector<int> joiningSlotIndexes;
+					vector<int> legacySlotIndexes;
 
 					ServerInterface *server = NetworkManager::getInstance().getServerInterface();
 					for(int i = 0; i < world.getFactionCount(); ++i) {
@@ -2514,12 +2521,18 @@ void Game::update() {
 							slot->getSentSavedGameInfo() == false) {
 							slot->setStartInGameConnectionLaunch(false);
 
-							saveNetworkGame = true;
-							break;
+							// Clients older than the varint command lists do not
+							// know the snapshot messages and download the zip
+							if(slot->getCommandListProtocol() >= nclpVarint) {
+								joiningSlotIndexes.push_back(faction->getStartLocationIndex());
+							}
+							else {
+								legacySlotIndexes.push_back(faction->getStartLocationIndex());
+							}
 						}
 					}
 
-					if(saveNetworkGame == true) {
+					if(legacySlotIndexes.empty() == false) {
 						//printf("Saved network game to disk\n");
 
 						string file = this->saveGame(GameConstants::saveNetworkGameFileServer,"temp/");
@@ -2548,11 +2561,11 @@ void Game::update() {
 						snprintf(szBuf,8096,lang.getString("GameSaved","",true).c_str(),file.c_str());
 						console.addLine(szBuf);
 
-						for(int i = 0; i < world.getFactionCount(); ++i) {
-							Faction *faction = world.getFaction(i);
+						for(unsigned int i = 0; i < legacySlotIndexes.size(); ++i) {
+							int slotIndex = legacySlotIndexes[i];
 
-							MutexSafeWrapper safeMutex(server->getSlotMutex(faction->getStartLocationIndex()),CODE_AT_LINE);
-							ConnectionSlot *slot =  server->getSlot(faction->getStartLocationIndex(),false);
+							MutexSafeWrapper safeMutex(server->getSlotMutex(slotIndex),CODE_AT_LINE);
+							ConnectionSlot *slot =  server->getSlot(slotIndex,false);
 							if(slot != NULL && slot->getJoinGameInProgress() == true &&
 									slot->getSentSavedGameInfo() == false) {
 
@@ -2560,13 +2573,24 @@ void Game::update() {
 							    NetworkMessageReady networkMessageReady(0);
 								slot->sendMessage(&networkMessageReady);
 
-								slot =  server->getSlot(faction->getStartLocationIndex(),false);
+								slot =  server->getSlot(slotIndex,false);
 								if(slot != NULL) {
 									slot->setSentSavedGameInfo(true);
 								}
 							}
 						}
 					}
+
+					if(joiningSlotIndexes.empty() == false) {
+						// Only the xml tree is built on the game thread, the
+						// snapshot thread serializes, compresses and streams it
+						// to the joining clients while the game keeps running
+						Chrono chrono(true);
+						XmlTree *savedGameTree = new XmlTree();
+						buildSaveGameTree(*savedGameTree);
+						server->startSavedGameSnapshot(savedGameTree, world.getFrameCount(), joiningSlotIndexes);
+						if(SystemFlags::VERBOSE_MODE_ENABLED) printf("Built network game snapshot tree in " MG_I64_SPECIFIER " msecs\n",(long long int)chrono.getMillis());
+					}
 				}
 			}
 			//else {
@@ -2803,6 +2827,9 @@ void Game::update() {
 
 void Game::addPerformanceCount(string key,int64 value) {
 	gamePerformanceCounts[key] = value + gamePerformanceCounts[key] / 2;
+	if(benchmarkReplay == true) {
+		benchmarkPerformanceTotals[key] += value;
+	}
 }
 
 string Game::getGamePerformanceCounts(bool displayWarnings) const {
@@ -2811,9 +2838,9 @@ string Game::getGamePerformanceCounts(bool displayWarnings) const {
 	}
 
 	bool displayWarningHeader 	= true;
-	bool WARN_TO_CONSOLE 		= Config::getInstance().getBool("PerformanceWarningEnabled","false");
-	int WARNING_MILLIS 			= Config::getInstance().getInt("PerformanceWarningMillis","7");
-	int WARNING_RENDER_MILLIS 	= Config::getInstance().getInt("PerformanceWarningRenderMillis","40");
+	bool WARN_TO_CONSOLE 		= CachedConfig::performanceWarningEnabled.get();
+	int WARNING_MILLIS 			= CachedConfig::performanceWarningMillis.get();
+	int WARNING_RENDER_MILLIS 	= CachedConfig::performanceWarningRenderMillis.get();
 
 	string result = "";
 	for(std::map<string,int64>::const_iterator iterMap = gamePerformanceCounts.begin();
@@ -5545,7 +5572,7 @@ string Game::getDebugStats(std::map<int,string> &factionDebugInfo) {
 		str+= "Log buffer count: " + intToStr(SystemFlags::getLogEntryBufferCount())+"\n";
 	}
 
-	str+= "UnitRangeCellsLookupItemCache: " + world.getUnitUpdater()->getUnitRangeCellsLookupItemCacheStats()+"\n";
+	str+= "UnitGrid: " + world.getMap()->getUnitGridStats()+"\n";
 	str+= "ExploredCellsLookupItemCache: " 	+ world.getExploredCellsLookupItemCacheStats()+"\n";
 	str+= "FowAlphaCellsLookupItemCache: "  + world.getFowAlphaCellsLookupItemCacheStats()+"\n";
 
@@ -6384,7 +6411,7 @@ bool Game::getPaused()
 }
 
 int Game::getUpdateLoops() {
-	if(commander.hasReplayCommandListForFrame() == true) {
+	if(isReplayRunning() == true) {
 		return 1;
 	}
 
@@ -6398,6 +6425,38 @@ int Game::getUpdateLoops() {
 		return this->speed;
 }
 
+bool Game::isReplayRunning() const {
+	if(commander.hasReplayCommandListForFrame() == true) {
+		return true;
+	}
+	// A benchmark keeps simulating (without AI, whose commands are part of
+	// the replay) up to the frame the replay was recorded until
+	return (benchmarkReplay == true && world.getFrameCount() < lastworldFrameCountForReplay);
+}
+
+void Game::printBenchmarkReport() {
+	int64 elapsedMillis = benchmarkChrono.getMillis();
+	int frameCount = world.getFrameCount() - benchmarkStartFrame;
+
+	printf("\n======================== Benchmark replay results ========================\n");
+	printf("World frames: %d in " MG_I64_SPECIFIER " msecs (%.2f frames/sec)\n",
+			frameCount,elapsedMillis,(elapsedMillis > 0 ? frameCount * 1000.0 / elapsedMillis : 0.0));
+	printf("Peak memory: " MG_I64_SPECIFIER " KB\n",getPeakMemoryUsage() / 1024);
+
+	printf("Subsystem times (total msecs):\n");
+	for(std::map<string,int64>::const_iterator iterMap = benchmarkPerformanceTotals.begin();
+			iterMap != benchmarkPerformanceTotals.end(); ++iterMap) {
+		printf("  %s = " MG_I64_SPECIFIER "\n",iterMap->first.c_str(),iterMap->second);
+	}
+
+	printf("Faction checksums at world frame %d:\n",world.getFrameCount());
+	for(int index = 0; index < world.getFactionCount(); ++index) {
+		Faction *faction = world.getFaction(index);
+		printf("  Faction %d [%s] = %u\n",index,faction->getType()->getName(false).c_str(),faction->getCRC().getSum());
+	}
+	printf("==========================================================================\n");
+}
+
 void Game::showLoseMessageBox() {
 	Lang &lang= Lang::getInstance();
 
@@ -6695,6 +6754,22 @@ string Game::saveGame(string name, const string &path) {
 	}
 
 	XmlTree xmlTree;
+	buildSaveGameTree(xmlTree);
+	xmlTree.save(saveGameFile);
+
+	if(masterserverMode == false) {
+		// take Screenshot
+		string jpgFileName=saveGameFile+".jpg";
+		// menu is already disabled, last rendered screen is still with enabled one. Lets render again:
+		render3d();
+		render2d();
+		Renderer::getInstance().saveScreen(jpgFileName,config.getInt("SaveGameScreenshotWidth","800"),config.getInt("SaveGameScreenshotHeight","600"));
+	}
+
+	return saveGameFile;
+}
+
+void Game::buildSaveGameTree(XmlTree &xmlTree) {
 	xmlTree.init("megaglest-saved-game");
 	XmlNode *rootNode = xmlTree.getRootNode();
 
@@ -6853,19 +6928,6 @@ string Game::saveGame(string name, const string &path) {
 	}
 
 	gameNode->addAttribute("disableSpeedChange",intToStr(disableSpeedChange), mapTagReplacements);
-
-	xmlTree.save(saveGameFile);
-
-	if(masterserverMode == false) {
-		// take Screenshot
-		string jpgFileName=saveGameFile+".jpg";
-		// menu is already disabled, last rendered screen is still with enabled one. Lets render again:
-		render3d();
-		render2d();
-		Renderer::getInstance().saveScreen(jpgFileName,config.getInt("SaveGameScreenshotWidth","800"),config.getInt("SaveGameScreenshotHeight","600"));
-	}
-
-	return saveGameFile;
 }
 
 void Game::loadGame(string name,Program *programPtr,bool isMasterserverMode,const GameSettings *joinGameSettings) {
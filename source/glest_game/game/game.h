@@ -216,6 +216,12 @@ private:
 	std::map<int,FowAlphaCellsLookupItem> teamFowAlphaCellsLookupItem;
 	std::map<string,int64> gamePerformanceCounts;
 
+	// --benchmark-replay: run the replay headless and report when it ends
+	static bool benchmarkReplay;
+	Chrono benchmarkChrono;
+	int benchmarkStartFrame;
+	std::map<string,int64> benchmarkPerformanceTotals;
+
 	bool networkPauseGameForLaggedClientsRequested;
 	bool networkResumeGameForLaggedClientsRequested;
 
@@ -333,6 +339,7 @@ public:
 	void stopAllVideo();
 
 	string saveGame(string name, const string &path="saved/");
+	void buildSaveGameTree(XmlTree &xmlTree);
 	static void loadGame(string name,Program *programPtr,bool isMasterserverMode, const GameSettings *joinGameSettings=NULL);
 
 	void addNetworkCommandToReplayList(NetworkCommand* networkCommand,int worldFrameCount);
@@ -357,6 +364,9 @@ public:
 	virtual void addPerformanceCount(string key,int64 value);
 	bool getRenderInGamePerformance() const { return renderInGamePerformance; }
 
+	static void setBenchmarkReplay(bool value) { benchmarkReplay = value; }
+	static bool getBenchmarkReplay() { return benchmarkReplay; }
+
 private:
 	//render
     void render3d();
@@ -373,6 +383,8 @@ private:
 	void incSpeed();
 	void decSpeed();
 	int getUpdateLoops();
+	bool isReplayRunning() const;
+	void printBenchmarkReport();
 
 	void showLoseMessageBox();
 	void showWinMessageBox();
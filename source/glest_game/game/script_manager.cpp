@@ -16,6 +16,7 @@
 #include "game_camera.h"
 #include "game.h"
 #include "config.h"
+#include <algorithm>
 
 #include "leak_dumper.h"
 
@@ -138,11 +139,168 @@ void CellTriggerEvent::loadGame(const XmlNode *rootNode) {
 	}
 }
 
+// =====================================================
+//	class CellTriggerEventIndex
+// =====================================================
+
+const int CellTriggerEventIndex::gridCellSize = 8;
+
+void CellTriggerEventIndex::clear() {
+	unitEvents.clear();
+	factionEvents.clear();
+	gridEvents.clear();
+	areaUnitEvents.clear();
+}
+
+void CellTriggerEventIndex::add(int eventId, const CellTriggerEvent &event) {
+	switch(event.type) {
+		case ctet_Unit:
+			addToBucket(unitEvents, event.sourceId, eventId);
+			break;
+		case ctet_Faction:
+			addToBucket(factionEvents, event.sourceId, eventId);
+			break;
+		default:
+		{
+			Vec2i destPosEnd = (event.type == ctet_UnitPos || event.type == ctet_FactionPos ? event.destPos : event.destPosEnd);
+			Vec2i gridPos1, gridPos2;
+			if(getGridBounds(event.destPos, destPosEnd, gridPos1, gridPos2) == true) {
+				for(int y = gridPos1.y; y <= gridPos2.y; ++y) {
+					for(int x = gridPos1.x; x <= gridPos2.x; ++x) {
+						addToBucket(gridEvents, getGridKey(x, y), eventId);
+					}
+				}
+			}
+			for(std::map<int,string>::const_iterator iterMap = event.eventStateInfo.begin();
+				iterMap != event.eventStateInfo.end(); ++iterMap) {
+				addAreaUnit(eventId, iterMap->first);
+			}
+		}
+			break;
+	}
+}
+
+void CellTriggerEventIndex::remove(int eventId, const CellTriggerEvent &event) {
+	switch(event.type) {
+		case ctet_Unit:
+			removeFromBucket(unitEvents, event.sourceId, eventId);
+			break;
+		case ctet_Faction:
+			removeFromBucket(factionEvents, event.sourceId, eventId);
+			break;
+		default:
+		{
+			Vec2i destPosEnd = (event.type == ctet_UnitPos || event.type == ctet_FactionPos ? event.destPos : event.destPosEnd);
+			Vec2i gridPos1, gridPos2;
+			if(getGridBounds(event.destPos, destPosEnd, gridPos1, gridPos2) == true) {
+				for(int y = gridPos1.y; y <= gridPos2.y; ++y) {
+					for(int x = gridPos1.x; x <= gridPos2.x; ++x) {
+						removeFromBucket(gridEvents, getGridKey(x, y), eventId);
+					}
+				}
+			}
+			for(std::map<int,string>::const_iterator iterMap = event.eventStateInfo.begin();
+				iterMap != event.eventStateInfo.end(); ++iterMap) {
+				removeAreaUnit(eventId, iterMap->first);
+			}
+		}
+			break;
+	}
+}
+
+void CellTriggerEventIndex::addAreaUnit(int eventId, int unitId) {
+	areaUnitEvents[unitId].insert(eventId);
+}
+
+void CellTriggerEventIndex::removeAreaUnit(int eventId, int unitId) {
+	std::map<int, std::set<int> >::iterator iterFind = areaUnitEvents.find(unitId);
+	if(iterFind != areaUnitEvents.end()) {
+		iterFind->second.erase(eventId);
+		if(iterFind->second.empty() == true) {
+			areaUnitEvents.erase(iterFind);
+		}
+	}
+}
+
+void CellTriggerEventIndex::findCandidates(Unit *unit, int minEventId, vector<int> &result) const {
+	result.clear();
+
+	appendBucket(unitEvents, unit->getId(), minEventId, result);
+	appendBucket(factionEvents, unit->getFactionIndex(), minEventId, result);
+
+	// A location matches when it lies under the unit, the unit covers the
+	// cells from its position to its position + size - 1
+	int unitSize = unit->getType()->getSize();
+	Vec2i gridPos1, gridPos2;
+	if(getGridBounds(unit->getPos() - Vec2i(unitSize - 1), unit->getPos(), gridPos1, gridPos2) == true) {
+		for(int y = gridPos1.y; y <= gridPos2.y; ++y) {
+			for(int x = gridPos1.x; x <= gridPos2.x; ++x) {
+				appendBucket(gridEvents, getGridKey(x, y), minEventId, result);
+			}
+		}
+	}
+
+	std::map<int, std::set<int> >::const_iterator iterFind = areaUnitEvents.find(unit->getId());
+	if(iterFind != areaUnitEvents.end()) {
+		for(std::set<int>::const_iterator iterSet = iterFind->second.lower_bound(minEventId);
+			iterSet != iterFind->second.end(); ++iterSet) {
+			result.push_back(*iterSet);
+		}
+	}
+
+	// events are always fired in order of their id
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+}
+
+bool CellTriggerEventIndex::getGridBounds(const Vec2i &pos1, const Vec2i &pos2, Vec2i &gridPos1, Vec2i &gridPos2) {
+	if(pos2.x < pos1.x || pos2.y < pos1.y || pos2.x < 0 || pos2.y < 0) {
+		return false;
+	}
+	gridPos1.x = max(pos1.x, 0) / gridCellSize;
+	gridPos1.y = max(pos1.y, 0) / gridCellSize;
+	gridPos2.x = pos2.x / gridCellSize;
+	gridPos2.y = pos2.y / gridCellSize;
+	return true;
+}
+
+int CellTriggerEventIndex::getGridKey(int gridX, int gridY) {
+	return (gridY << 16) | (gridX & 0xffff);
+}
+
+void CellTriggerEventIndex::addToBucket(BucketMap &buckets, int key, int eventId) {
+	buckets[key].push_back(eventId);
+}
+
+void CellTriggerEventIndex::removeFromBucket(BucketMap &buckets, int key, int eventId) {
+	BucketMap::iterator iterFind = buckets.find(key);
+	if(iterFind != buckets.end()) {
+		vector<int> &bucket = iterFind->second;
+		bucket.erase(std::remove(bucket.begin(), bucket.end(), eventId), bucket.end());
+		if(bucket.empty() == true) {
+			buckets.erase(iterFind);
+		}
+	}
+}
+
+void CellTriggerEventIndex::appendBucket(const BucketMap &buckets, int key, int minEventId, vector<int> &result) {
+	BucketMap::const_iterator iterFind = buckets.find(key);
+	if(iterFind != buckets.end()) {
+		const vector<int> &bucket = iterFind->second;
+		for(unsigned int index = 0; index < bucket.size(); ++index) {
+			if(bucket[index] >= minEventId) {
+				result.push_back(bucket[index]);
+			}
+		}
+	}
+}
+
 TimerTriggerEvent::TimerTriggerEvent() {
 	running = false;
 	startFrame = 0;
 	endFrame = 0;
 	triggerSecondsElapsed = 0;
+	queuedFrame = -1;
 }
 
 void TimerTriggerEvent::saveGame(XmlNode *rootNode) {
@@ -174,6 +332,29 @@ void TimerTriggerEvent::loadGame(const XmlNode *rootNode) {
 	}
 }
 
+// =====================================================
+//	class TimerTriggerEventQueue
+// =====================================================
+
+void TimerTriggerEventQueue::push(int frame, int eventId) {
+	Entry entry;
+	entry.frame = frame;
+	entry.eventId = eventId;
+	heap.push_back(entry);
+	std::push_heap(heap.begin(),heap.end());
+}
+
+bool TimerTriggerEventQueue::popDue(int frame, int &entryFrame, int &eventId) {
+	if(heap.empty() == true || heap.front().frame > frame) {
+		return false;
+	}
+	entryFrame = heap.front().frame;
+	eventId = heap.front().eventId;
+	std::pop_heap(heap.begin(),heap.end());
+	heap.pop_back();
+	return true;
+}
+
 // =====================================================
 //	class ScriptManager
 // =====================================================
@@ -181,6 +362,19 @@ ScriptManager* ScriptManager::thisScriptManager		= NULL;
 const int ScriptManager::messageWrapCount			= 35;
 const int ScriptManager::displayTextWrapCount		= 64;
 
+const char *ScriptManager::callbackNames[sctCount] = {
+	"resourceHarvested",
+	"unitCreated",
+	"unitDied",
+	"unitAttacked",
+	"unitAttacking",
+	"gameOver",
+	"timerTriggerEvent",
+	"cellTriggerEvent",
+	"unitTriggerEvent",
+	"dayNightTriggerEvent"
+};
+
 ScriptManager::ScriptManager() {
 	world = NULL;
 	gameCamera = NULL;
@@ -206,12 +400,60 @@ ScriptManager::ScriptManager() {
 
 	lastUnitTriggerEventUnitId = -1;
 	lastUnitTriggerEventType = utet_None;
+
+	for(int index = 0; index < sctCount; ++index) {
+		callbackRefs[index] = LuaScript::noFunctionRef;
+	}
 }
 
 ScriptManager::~ScriptManager() {
 
 }
 
+// Looks up every event callback the scenario defines once, so events
+// without a lua handler do not cost a global lookup when they fire
+void ScriptManager::resolveLuaCallbacks() {
+	releaseLuaCallbacks();
+
+	for(int index = 0; index < sctCount; ++index) {
+		callbackRefs[index] = luaScript.getFunctionRef(callbackNames[index]);
+	}
+}
+
+void ScriptManager::releaseLuaCallbacks() {
+	for(int index = 0; index < sctCount; ++index) {
+		luaScript.releaseFunctionRef(callbackRefs[index]);
+		callbackRefs[index] = LuaScript::noFunctionRef;
+	}
+	for(std::map<const UnitType *, int>::iterator iterMap = unitCreatedOfTypeRefs.begin();
+		iterMap != unitCreatedOfTypeRefs.end(); ++iterMap) {
+		luaScript.releaseFunctionRef(iterMap->second);
+	}
+	unitCreatedOfTypeRefs.clear();
+}
+
+void ScriptManager::callLuaCallback(ScriptCallbackType type) {
+	if(callbackRefs[type] == LuaScript::noFunctionRef) {
+		return;
+	}
+	luaScript.beginCall(callbackRefs[type], callbackNames[type]);
+	luaScript.endCall();
+}
+
+void ScriptManager::callUnitCreatedOfType(const UnitType *unitType) {
+	std::map<const UnitType *, int>::iterator iterFind = unitCreatedOfTypeRefs.find(unitType);
+	if(iterFind == unitCreatedOfTypeRefs.end()) {
+		// first unit of this type, the name is only built here
+		int functionRef = luaScript.getFunctionRef("unitCreatedOfType_" + unitType->getName());
+		iterFind = unitCreatedOfTypeRefs.insert(std::make_pair(unitType, functionRef)).first;
+	}
+	if(iterFind->second == LuaScript::noFunctionRef) {
+		return;
+	}
+	luaScript.beginCall(iterFind->second, "unitCreatedOfType_" + unitType->getName());
+	luaScript.endCall();
+}
+
 void ScriptManager::init(World* world, GameCamera *gameCamera, const XmlNode *rootNode) {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
@@ -228,7 +470,10 @@ void ScriptManager::init(World* world, GameCamera *gameCamera, const XmlNode *ro
 	//printf("In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 	currentEventId = 1;
 	CellTriggerEventList.clear();
+	cellTriggerEventIndex.clear();
 	TimerTriggerEventList.clear();
+	timerTriggerEventQueue.clear();
+	releaseLuaCallbacks();
 
 	//printf("In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
@@ -450,6 +695,7 @@ void ScriptManager::init(World* world, GameCamera *gameCamera, const XmlNode *ro
 		// Setup global functions and vars here
 		luaScript.beginCall("global");
 		luaScript.endCall();
+		resolveLuaCallbacks();
 
 		//call startup function
 		if(this->rootNode == NULL) {
@@ -465,6 +711,8 @@ void ScriptManager::init(World* world, GameCamera *gameCamera, const XmlNode *ro
 			luaScript.beginCall("onLoad");
 			luaScript.endCall();
 		}
+		// pick up callbacks defined while starting up
+		resolveLuaCallbacks();
 	}
 	catch(const megaglest_runtime_error &ex) {
 		//string sErrBuf = "";
@@ -526,8 +774,7 @@ void ScriptManager::onResourceHarvested(){
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
 	if(this->rootNode == NULL) {
-		luaScript.beginCall("resourceHarvested");
-		luaScript.endCall();
+		callLuaCallback(sctResourceHarvested);
 	}
 }
 
@@ -537,10 +784,8 @@ void ScriptManager::onUnitCreated(const Unit* unit){
 	if(this->rootNode == NULL) {
 		lastCreatedUnitName= unit->getType()->getName(false);
 		lastCreatedUnitId= unit->getId();
-		luaScript.beginCall("unitCreated");
-		luaScript.endCall();
-		luaScript.beginCall("unitCreatedOfType_"+unit->getType()->getName());
-		luaScript.endCall();
+		callLuaCallback(sctUnitCreated);
+		callUnitCreatedOfType(unit->getType());
 	}
 }
 
@@ -571,8 +816,7 @@ void ScriptManager::onUnitDied(const Unit* unit){
 		lastDeadUnitId= unit->getId();
 		lastDeadUnitCauseOfDeath = unit->getCauseOfDeath();
 
-		luaScript.beginCall("unitDied");
-		luaScript.endCall();
+		callLuaCallback(sctUnitDied);
 	}
 }
 
@@ -582,8 +826,7 @@ void ScriptManager::onUnitAttacked(const Unit* unit) {
 	if(this->rootNode == NULL) {
 		lastAttackedUnitName= unit->getType()->getName(false);
 		lastAttackedUnitId= unit->getId();
-		luaScript.beginCall("unitAttacked");
-		luaScript.endCall();
+		callLuaCallback(sctUnitAttacked);
 	}
 }
 
@@ -593,8 +836,7 @@ void ScriptManager::onUnitAttacking(const Unit* unit) {
 	if(this->rootNode == NULL) {
 		lastAttackingUnitName= unit->getType()->getName(false);
 		lastAttackingUnitId= unit->getId();
-		luaScript.beginCall("unitAttacking");
-		luaScript.endCall();
+		callLuaCallback(sctUnitAttacking);
 	}
 }
 
@@ -602,12 +844,11 @@ void ScriptManager::onGameOver(bool won) {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
 	gameWon = won;
-	luaScript.beginCall("gameOver");
-	luaScript.endCall();
+	callLuaCallback(sctGameOver);
 }
 
 void ScriptManager::onTimerTriggerEvent() {
-	if(TimerTriggerEventList.empty() == true) {
+	if(timerTriggerEventQueue.empty() == true) {
 		return;
 	}
 	if(this->rootNode != NULL) {
@@ -615,34 +856,93 @@ void ScriptManager::onTimerTriggerEvent() {
 	}
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] TimerTriggerEventList.size() = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,TimerTriggerEventList.size());
 
-	for(std::map<int,TimerTriggerEvent>::iterator iterMap = TimerTriggerEventList.begin();
-		iterMap != TimerTriggerEventList.end(); ++iterMap) {
+	// Due timers fire in event id order. Timers a lua callback starts with a
+	// higher id still fire in this pass, the others wait for the next frame.
+	int frame = world->getFrameCount();
+	int lastEventId = -1;
+	std::set<int> dueEventIds;
+	collectDueTimerEvents(frame, lastEventId, dueEventIds);
 
-		TimerTriggerEvent &event = iterMap->second;
+	for(;dueEventIds.empty() == false;) {
+		int eventId = *dueEventIds.begin();
+		dueEventIds.erase(dueEventIds.begin());
+
+		std::map<int,TimerTriggerEvent>::iterator iterFind = TimerTriggerEventList.find(eventId);
+		if(iterFind == TimerTriggerEventList.end()) {
+			continue;
+		}
+		TimerTriggerEvent &event = iterFind->second;
 
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] event.running = %d, event.startTime = %lld, event.endTime = %lld, diff = %f\n",
 													__FILE__,__FUNCTION__,__LINE__,event.running,(long long int)event.startFrame,(long long int)event.endFrame,(event.endFrame - event.startFrame));
 
-		if(event.running == true) {
-			if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
+		if(event.running == false) {
+			continue;
+		}
+		// An efficient timer restarted since it was queued
+		if(event.triggerSecondsElapsed > 0 && getTimerEventDueFrame(event) > frame) {
+			queueTimerEvent(eventId, getTimerEventDueFrame(event));
+			continue;
+		}
 
-			// If using an efficient timer, check if its time to trigger
-			// on the elapsed check
-			if(event.triggerSecondsElapsed > 0) {
-				int elapsed = (world->getFrameCount()-event.startFrame) / GameConstants::updateFps;
-				if(elapsed < event.triggerSecondsElapsed) {
-					continue;
-				}
-			}
-			currentTimerTriggeredEventId = iterMap->first;
-			luaScript.beginCall("timerTriggerEvent");
-			luaScript.endCall();
+		lastEventId = eventId;
+		currentTimerTriggeredEventId = eventId;
+		callLuaCallback(sctTimerTriggerEvent);
 
-			if(event.triggerSecondsElapsed > 0) {
-				int timerId = iterMap->first;
-				stopTimerEvent(timerId);
-			}
+		if(event.triggerSecondsElapsed > 0) {
+			stopTimerEvent(eventId);
+		}
+		else if(event.running == true) {
+			queueTimerEvent(eventId, frame + 1);
 		}
+
+		collectDueTimerEvents(frame, lastEventId, dueEventIds);
+	}
+}
+
+int ScriptManager::getTimerEventDueFrame(const TimerTriggerEvent &trigger) const {
+	if(trigger.triggerSecondsElapsed > 0) {
+		return trigger.startFrame + trigger.triggerSecondsElapsed * GameConstants::updateFps;
+	}
+	// plain timers fire on every frame they are running
+	return world->getFrameCount();
+}
+
+void ScriptManager::queueTimerEvent(int eventId, int frame) {
+	TimerTriggerEvent &trigger = TimerTriggerEventList[eventId];
+	if(trigger.queuedFrame == frame) {
+		return;
+	}
+	trigger.queuedFrame = frame;
+	timerTriggerEventQueue.push(frame, eventId);
+}
+
+// Moves every live queue entry due by frame into dueEventIds. Events at or
+// below lastEventId already had their turn this frame and are requeued
+void ScriptManager::collectDueTimerEvents(int frame, int lastEventId, std::set<int> &dueEventIds) {
+	int entryFrame = 0;
+	int eventId = 0;
+	vector<int> nextFrameEventIds;
+	for(;timerTriggerEventQueue.popDue(frame, entryFrame, eventId) == true;) {
+		std::map<int,TimerTriggerEvent>::iterator iterFind = TimerTriggerEventList.find(eventId);
+		if(iterFind == TimerTriggerEventList.end() ||
+			iterFind->second.queuedFrame != entryFrame) {
+			continue;
+		}
+		iterFind->second.queuedFrame = -1;
+		if(iterFind->second.running == false) {
+			continue;
+		}
+
+		if(eventId > lastEventId) {
+			dueEventIds.insert(eventId);
+		}
+		else {
+			nextFrameEventIds.push_back(eventId);
+		}
+	}
+	for(unsigned int index = 0; index < nextFrameEventIds.size(); ++index) {
+		queueTimerEvent(nextFrameEventIds[index], frame + 1);
 	}
 }
 
@@ -663,8 +963,32 @@ void ScriptManager::onCellTriggerEvent(Unit *movingUnit) {
 	if(movingUnit != NULL) {
 		//ScenarioInfo scenarioInfoStart = world->getScenario()->getInfo();
 
-		for(std::map<int,CellTriggerEvent>::iterator iterMap = CellTriggerEventList.begin();
-				iterMap != CellTriggerEventList.end(); ++iterMap) {
+		// Only test the events that can fire for this unit and position. Events
+		// registered by a lua callback are picked up in another pass, as they
+		// were when walking the whole list in id order.
+		vector<int> candidateEventIds;
+		int minEventId = 0;
+		int endEventId = currentEventId;
+		cellTriggerEventIndex.findCandidates(movingUnit, minEventId, candidateEventIds);
+
+		for(unsigned int candidateIndex = 0; ; ++candidateIndex) {
+			if(candidateIndex >= candidateEventIds.size()) {
+				if(endEventId == currentEventId) {
+					break;
+				}
+				minEventId = endEventId;
+				endEventId = currentEventId;
+				cellTriggerEventIndex.findCandidates(movingUnit, minEventId, candidateEventIds);
+				candidateIndex = 0;
+				if(candidateEventIds.empty() == true) {
+					continue;
+				}
+			}
+
+			std::map<int,CellTriggerEvent>::iterator iterMap = CellTriggerEventList.find(candidateEventIds[candidateIndex]);
+			if(iterMap == CellTriggerEventList.end()) {
+				continue;
+			}
 			CellTriggerEvent &event = iterMap->second;
 
 			if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] movingUnit = %d, event.type = %d, movingUnit->getPos() = %s, event.sourceId = %d, event.destId = %d, event.destPos = %s\n",
@@ -858,6 +1182,7 @@ void ScriptManager::onCellTriggerEvent(Unit *movingUnit) {
 
 								currentCellTriggeredEventAreaEntryUnitId = movingUnit->getId();
 								event.eventStateInfo[movingUnit->getId()] = Vec2i(x,y).getString();
+								cellTriggerEventIndex.addAreaUnit(iterMap->first, movingUnit->getId());
 							}
 						}
 					}
@@ -889,6 +1214,7 @@ void ScriptManager::onCellTriggerEvent(Unit *movingUnit) {
 						currentCellTriggeredEventAreaExitUnitId = movingUnit->getId();
 
 						event.eventStateInfo.erase(movingUnit->getId());
+						cellTriggerEventIndex.removeAreaUnit(iterMap->first, movingUnit->getId());
 					}
 				}
 			}
@@ -902,8 +1228,7 @@ void ScriptManager::onCellTriggerEvent(Unit *movingUnit) {
 				currentCellTriggeredEventId = iterMap->first;
 				event.triggerCount++;
 
-				luaScript.beginCall("cellTriggerEvent");
-				luaScript.endCall();
+				callLuaCallback(sctCellTriggerEvent);
 			}
 
 //			ScenarioInfo scenarioInfoEnd = world->getScenario()->getInfo();
@@ -1233,8 +1558,7 @@ int ScriptManager::registerCellTriggerEventForUnitToUnit(int sourceUnitId, int d
 	trigger.sourceId = sourceUnitId;
 	trigger.destId = destUnitId;
 
-	int eventId = currentEventId++;
-	CellTriggerEventList[eventId] = trigger;
+	int eventId = addCellTriggerEvent(trigger);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] Unit: %d will trigger cell event when reaching unit: %d, eventId = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,sourceUnitId,destUnitId,eventId);
 
@@ -1247,8 +1571,7 @@ int ScriptManager::registerCellTriggerEventForUnitToLocation(int sourceUnitId, c
 	trigger.sourceId = sourceUnitId;
 	trigger.destPos = pos;
 
-	int eventId = currentEventId++;
-	CellTriggerEventList[eventId] = trigger;
+	int eventId = addCellTriggerEvent(trigger);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] Unit: %d will trigger cell event when reaching pos: %s, eventId = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,sourceUnitId,pos.getString().c_str(),eventId);
 
@@ -1264,8 +1587,7 @@ int ScriptManager::registerCellAreaTriggerEventForUnitToLocation(int sourceUnitI
 	trigger.destPosEnd.x = pos.z;
 	trigger.destPosEnd.y = pos.w;
 
-	int eventId = currentEventId++;
-	CellTriggerEventList[eventId] = trigger;
+	int eventId = addCellTriggerEvent(trigger);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] Unit: %d will trigger cell event when reaching pos: %s, eventId = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,sourceUnitId,pos.getString().c_str(),eventId);
 
@@ -1278,8 +1600,7 @@ int ScriptManager::registerCellTriggerEventForFactionToUnit(int sourceFactionId,
 	trigger.sourceId = sourceFactionId;
 	trigger.destId = destUnitId;
 
-	int eventId = currentEventId++;
-	CellTriggerEventList[eventId] = trigger;
+	int eventId = addCellTriggerEvent(trigger);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] Faction: %d will trigger cell event when reaching unit: %d, eventId = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,sourceFactionId,destUnitId,eventId);
 
@@ -1292,8 +1613,7 @@ int ScriptManager::registerCellTriggerEventForFactionToLocation(int sourceFactio
 	trigger.sourceId = sourceFactionId;
 	trigger.destPos = pos;
 
-	int eventId = currentEventId++;
-	CellTriggerEventList[eventId] = trigger;
+	int eventId = addCellTriggerEvent(trigger);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d]Faction: %d will trigger cell event when reaching pos: %s, eventId = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,sourceFactionId,pos.getString().c_str(),eventId);
 
@@ -1309,8 +1629,7 @@ int ScriptManager::registerCellAreaTriggerEventForFactionToLocation(int sourceFa
 	trigger.destPosEnd.x = pos.z;
 	trigger.destPosEnd.y = pos.w;
 
-	int eventId = currentEventId++;
-	CellTriggerEventList[eventId] = trigger;
+	int eventId = addCellTriggerEvent(trigger);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d]Faction: %d will trigger cell event when reaching pos: %s, eventId = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,sourceFactionId,pos.getString().c_str(),eventId);
 
@@ -1326,8 +1645,7 @@ int ScriptManager::registerCellAreaTriggerEvent(const Vec4i &pos) {
 	trigger.destPosEnd.x = pos.z;
 	trigger.destPosEnd.y = pos.w;
 
-	int eventId = currentEventId++;
-	CellTriggerEventList[eventId] = trigger;
+	int eventId = addCellTriggerEvent(trigger);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] trigger cell event when reaching pos: %s, eventId = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,pos.getString().c_str(),eventId);
 
@@ -1343,10 +1661,26 @@ int ScriptManager::getCellTriggerEventCount(int eventId) {
 	return result;
 }
 
+int ScriptManager::addCellTriggerEvent(const CellTriggerEvent &trigger) {
+	int eventId = currentEventId++;
+	CellTriggerEventList[eventId] = trigger;
+	cellTriggerEventIndex.add(eventId, trigger);
+
+	return eventId;
+}
+
+void ScriptManager::removeCellTriggerEvent(int eventId) {
+	std::map<int,CellTriggerEvent>::iterator iterFind = CellTriggerEventList.find(eventId);
+	if(iterFind != CellTriggerEventList.end()) {
+		cellTriggerEventIndex.remove(eventId, iterFind->second);
+		CellTriggerEventList.erase(iterFind);
+	}
+}
+
 void ScriptManager::unregisterCellTriggerEvent(int eventId) {
 	if(CellTriggerEventList.find(eventId) != CellTriggerEventList.end()) {
 		if(inCellTriggerEvent == false) {
-			CellTriggerEventList.erase(eventId);
+			removeCellTriggerEvent(eventId);
 		}
 		else {
 			unRegisterCellTriggerEventList.push_back(eventId);
@@ -1357,7 +1691,7 @@ void ScriptManager::unregisterCellTriggerEvent(int eventId) {
 		if(unRegisterCellTriggerEventList.empty() == false) {
 			for(int i = 0; i < (int)unRegisterCellTriggerEventList.size(); ++i) {
 				int delayedEventId = unRegisterCellTriggerEventList[i];
-				CellTriggerEventList.erase(delayedEventId);
+				removeCellTriggerEvent(delayedEventId);
 			}
 			unRegisterCellTriggerEventList.clear();
 		}
@@ -1374,6 +1708,7 @@ int ScriptManager::startTimerEvent() {
 
 	int eventId = currentEventId++;
 	TimerTriggerEventList[eventId] = trigger;
+	queueTimerEvent(eventId, getTimerEventDueFrame(trigger));
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] TimerTriggerEventList.size() = %d, eventId = %d, trigger.startTime = %lld, trigger.endTime = %lld\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,TimerTriggerEventList.size(),eventId,(long long int)trigger.startFrame,(long long int)trigger.endFrame);
 
@@ -1391,6 +1726,7 @@ int ScriptManager::startEfficientTimerEvent(int triggerSecondsElapsed) {
 
 	int eventId = currentEventId++;
 	TimerTriggerEventList[eventId] = trigger;
+	queueTimerEvent(eventId, getTimerEventDueFrame(trigger));
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] TimerTriggerEventList.size() = %d, eventId = %d, trigger.startTime = %lld, trigger.endTime = %lld\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,TimerTriggerEventList.size(),eventId,(long long int)trigger.startFrame,(long long int)trigger.endFrame);
 
@@ -1408,6 +1744,7 @@ int ScriptManager::resetTimerEvent(int eventId) {
 		//trigger.endTime = 0;
 		trigger.endFrame = 0;
 		trigger.running = true;
+		queueTimerEvent(eventId, getTimerEventDueFrame(trigger));
 
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] TimerTriggerEventList.size() = %d, eventId = %d, trigger.startTime = %lld, trigger.endTime = %lld, result = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,TimerTriggerEventList.size(),eventId,(long long int)trigger.startFrame,(long long int)trigger.endFrame,result);
 	}
@@ -1927,8 +2264,7 @@ void ScriptManager::onUnitTriggerEvent(const Unit *unit, UnitTriggerEventType ev
 
 			//printf("File: %s line: %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__);
 
-			luaScript.beginCall("unitTriggerEvent");
-			luaScript.endCall();
+			callLuaCallback(sctUnitTriggerEvent);
 
 			//printf("File: %s line: %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__);
 		}
@@ -1959,8 +2295,7 @@ void ScriptManager::onDayNightTriggerEvent() {
 
 			printf("Triggering daynight event isDay: %d [%f]\n",isDay,getTimeOfDay());
 
-			luaScript.beginCall("dayNightTriggerEvent");
-			luaScript.endCall();
+			callLuaCallback(sctDayNightTriggerEvent);
 		}
 	}
 }
@@ -4269,7 +4604,9 @@ void ScriptManager::loadGame(const XmlNode *rootNode) {
 		XmlNode *node = cellTriggerEventListNodeList[i];
 		CellTriggerEvent event;
 		event.loadGame(node);
-		CellTriggerEventList[node->getAttribute("key")->getIntValue()] = event;
+		int eventId = node->getAttribute("key")->getIntValue();
+		CellTriggerEventList[eventId] = event;
+		cellTriggerEventIndex.add(eventId, event);
 	}
 
 //	std::map<int,TimerTriggerEvent> TimerTriggerEventList;
@@ -4279,7 +4616,11 @@ void ScriptManager::loadGame(const XmlNode *rootNode) {
 
 		TimerTriggerEvent event;
 		event.loadGame(node);
-		TimerTriggerEventList[node->getAttribute("key")->getIntValue()] = event;
+		int eventId = node->getAttribute("key")->getIntValue();
+		TimerTriggerEventList[eventId] = event;
+		if(event.running == true) {
+			queueTimerEvent(eventId, getTimerEventDueFrame(event));
+		}
 	}
 
 //	bool inCellTriggerEvent;
@@ -23,6 +23,7 @@
 #include "components.h"
 #include "game_constants.h"
 #include <map>
+#include <set>
 #include "xml_parser.h"
 #include "randomgen.h"
 #include "leak_dumper.h"
@@ -41,6 +42,7 @@ namespace Glest{ namespace Game{
 
 class World;
 class Unit;
+class UnitType;
 class GameCamera;
 
 // =====================================================
@@ -108,6 +110,22 @@ enum UnitTriggerEventType {
 	utet_SkillChanged
 };
 
+// Lua event callbacks resolved once per scenario
+enum ScriptCallbackType {
+	sctResourceHarvested,
+	sctUnitCreated,
+	sctUnitDied,
+	sctUnitAttacked,
+	sctUnitAttacking,
+	sctGameOver,
+	sctTimerTriggerEvent,
+	sctCellTriggerEvent,
+	sctUnitTriggerEvent,
+	sctDayNightTriggerEvent,
+
+	sctCount
+};
+
 enum CellTriggerEventType {
 	ctet_Unit,
 	ctet_UnitPos,
@@ -137,6 +155,47 @@ public:
 	void loadGame(const XmlNode *rootNode);
 };
 
+// =====================================================
+//	class CellTriggerEventIndex
+//
+///	Buckets cell trigger events so a moving unit only tests the events that
+///	could fire for it: unit to unit events by source unit, faction to unit
+///	events by source faction and every location or area event in a uniform
+///	grid over its destination cells. Area events also remember which units
+///	are inside so the exit of a unit is still seen once it left the area.
+// =====================================================
+
+class CellTriggerEventIndex {
+public:
+	static const int gridCellSize;
+
+private:
+	typedef std::map<int, vector<int> > BucketMap;
+
+	BucketMap unitEvents;
+	BucketMap factionEvents;
+	BucketMap gridEvents;
+	std::map<int, std::set<int> > areaUnitEvents;
+
+public:
+	void clear();
+	void add(int eventId, const CellTriggerEvent &event);
+	void remove(int eventId, const CellTriggerEvent &event);
+
+	void addAreaUnit(int eventId, int unitId);
+	void removeAreaUnit(int eventId, int unitId);
+
+	// Sorted by event id, only events with an id >= minEventId
+	void findCandidates(Unit *unit, int minEventId, vector<int> &result) const;
+
+private:
+	static bool getGridBounds(const Vec2i &pos1, const Vec2i &pos2, Vec2i &gridPos1, Vec2i &gridPos2);
+	static int getGridKey(int gridX, int gridY);
+	static void addToBucket(BucketMap &buckets, int key, int eventId);
+	static void removeFromBucket(BucketMap &buckets, int key, int eventId);
+	static void appendBucket(const BucketMap &buckets, int key, int minEventId, vector<int> &result);
+};
+
 class TimerTriggerEvent {
 public:
 	TimerTriggerEvent();
@@ -148,10 +207,49 @@ public:
 
 	int triggerSecondsElapsed;
 
+	// frame of this event's live entry in the TimerTriggerEventQueue, -1 if none
+	int queuedFrame;
+
 	void saveGame(XmlNode *rootNode);
 	void loadGame(const XmlNode *rootNode);
 };
 
+// =====================================================
+//	class TimerTriggerEventQueue
+//
+///	Min heap of timer event ids ordered by the frame they are next due on,
+///	ties broken by event id. Entries are never removed in place, a timer
+///	that was reset or stopped leaves a stale entry behind that is dropped
+///	once it reaches the top (see TimerTriggerEvent::queuedFrame).
+// =====================================================
+
+class TimerTriggerEventQueue {
+private:
+	class Entry {
+	public:
+		int frame;
+		int eventId;
+
+		bool operator<(const Entry &other) const {
+			// reversed so the std heap functions keep the earliest entry on top
+			if(frame != other.frame) {
+				return frame > other.frame;
+			}
+			return eventId > other.eventId;
+		}
+	};
+
+	std::vector<Entry> heap;
+
+public:
+	void clear()		{ heap.clear(); }
+	bool empty() const	{ return heap.empty(); }
+
+	void push(int frame, int eventId);
+	// Pops the earliest entry if it is due on or before frame
+	bool popDue(int frame, int &entryFrame, int &eventId);
+};
+
 class ScriptManager {
 private:
 	typedef list<ScriptManagerMessage> MessageQueue;
@@ -207,7 +305,9 @@ private:
 
 	int currentEventId;
 	std::map<int,CellTriggerEvent> CellTriggerEventList;
+	CellTriggerEventIndex cellTriggerEventIndex;
 	std::map<int,TimerTriggerEvent> TimerTriggerEventList;
+	TimerTriggerEventQueue timerTriggerEventQueue;
 	bool inCellTriggerEvent;
 	std::vector<int> unRegisterCellTriggerEventList;
 
@@ -223,8 +323,12 @@ private:
 
 	std::map<string, string> luaSavedGameData;
 
+	int callbackRefs[sctCount];
+	std::map<const UnitType *, int> unitCreatedOfTypeRefs;
+
 private:
 	static ScriptManager* thisScriptManager;
+	static const char *callbackNames[sctCount];
 
 private:
 	static const int messageWrapCount;
@@ -266,6 +370,18 @@ public:
 private:
 	string wrapString(const string &str, int wrapCount);
 
+	void resolveLuaCallbacks();
+	void releaseLuaCallbacks();
+	void callLuaCallback(ScriptCallbackType type);
+	void callUnitCreatedOfType(const UnitType *unitType);
+
+	int getTimerEventDueFrame(const TimerTriggerEvent &trigger) const;
+	void queueTimerEvent(int eventId, int frame);
+	void collectDueTimerEvents(int frame, int lastEventId, std::set<int> &dueEventIds);
+
+	int addCellTriggerEvent(const CellTriggerEvent &trigger);
+	void removeCellTriggerEvent(int eventId);
+
 	//wrappers, commands
 	void networkShowMessageForFaction(const string &text, const string &header,int factionIndex);
 	void networkShowMessageForTeam(const string &text, const string &header,int teamIndex);
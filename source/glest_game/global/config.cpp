@@ -96,6 +96,15 @@ const char *Config::ACTIVE_MOD_PROPERTY_NAME			= "current_mod_name";
  const char *Config::frustumPicking = "frustum";
 
 map<string,string> Config::customRuntimeProperties;
+int Config::changeVersion = 0;
+
+const ConfigValue<bool> CachedConfig::showPerfStats("ShowPerfStats","false");
+const ConfigValue<bool> CachedConfig::enableNewThreadManager("EnableNewThreadManager","false");
+const ConfigValue<bool> CachedConfig::enableAIWorkerThreads("EnableAIWorkerThreads","true");
+const ConfigValue<bool> CachedConfig::disableWaterSounds("DisableWaterSounds","false");
+const ConfigValue<bool> CachedConfig::performanceWarningEnabled("PerformanceWarningEnabled","false");
+const ConfigValue<int> CachedConfig::performanceWarningMillis("PerformanceWarningMillis","7");
+const ConfigValue<int> CachedConfig::performanceWarningRenderMillis("PerformanceWarningRenderMillis","40");
 
 // =====================================================
 // 	class Config
@@ -350,11 +359,13 @@ void Config::reload() {
 
 	Config &oldconfig = configList.find(type.first)->second;
 	CopyAll(&newconfig, &oldconfig);
+	notifyChanged();
 
 	if(SystemFlags::VERBOSE_MODE_ENABLED) if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
 void Config::save(const string &path){
+	notifyChanged();
 	if(fileLoaded.second == true) {
 		if(path != "") {
 			fileName.second = path;
@@ -600,6 +611,7 @@ SDL_Keycode Config::getSDLKey(const char *key) const {
 //}
 
 void Config::setInt(const string &key, int value, bool tempBuffer) {
+	notifyChanged();
 	if(tempBuffer == true) {
 		tempProperties.setInt(key, value);
 		return;
@@ -612,6 +624,7 @@ void Config::setInt(const string &key, int value, bool tempBuffer) {
 }
 
 void Config::setBool(const string &key, bool value, bool tempBuffer) {
+	notifyChanged();
 	if(tempBuffer == true) {
 		tempProperties.setBool(key, value);
 		return;
@@ -626,6 +639,7 @@ void Config::setBool(const string &key, bool value, bool tempBuffer) {
 }
 
 void Config::setFloat(const string &key, float value, bool tempBuffer) {
+	notifyChanged();
 	if(tempBuffer == true) {
 		tempProperties.setFloat(key, value);
 		return;
@@ -640,6 +654,7 @@ void Config::setFloat(const string &key, float value, bool tempBuffer) {
 }
 
 void Config::setString(const string &key, const string &value, bool tempBuffer) {
+	notifyChanged();
 	if(tempBuffer == true) {
 		tempProperties.setString(key, value);
 		return;
@@ -699,6 +714,7 @@ vector<pair<string,string> > Config::getUserProperties() const {
 }
 
 void Config::setUserProperties(const vector<pair<string,string> > &valueList) {
+	notifyChanged();
 	Properties &propertiesObj = properties.second;
 
 	for(unsigned int idx = 0; idx < valueList.size(); ++ idx) {
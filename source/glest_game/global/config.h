@@ -60,6 +60,8 @@ private:
 
     static map<string,string> customRuntimeProperties;
 
+    static int changeVersion;
+
 public:
 
     static const char *glestkeys_ini_filename;
@@ -124,6 +126,64 @@ public:
 	static string findValidLocalFileFromPath(string fileName);
 
 	static string getMapPath(const string &mapName, string scenarioDir="", bool errorOnNotFound=true);
+
+	// bumped whenever any config is set, saved or reloaded
+	static int getChangeVersion()	{ return changeVersion; }
+	static void notifyChanged()		{ ++changeVersion; }
+};
+
+// =====================================================
+// 	class ConfigValue
+//
+///	A main game config key that is looked up once and then kept as a plain
+///	value. It only goes back to Config after the change version moved, so
+///	per frame code can read settings without any string key searches.
+// =====================================================
+
+template<typename T>
+class ConfigValue {
+private:
+	const char *key;
+	const char *defaultValue;
+	mutable T value;
+	mutable int version;
+
+	static void read(const char *key, const char *defaultValue, bool &value)	{ value = Config::getInstance().getBool(key,defaultValue); }
+	static void read(const char *key, const char *defaultValue, int &value)		{ value = Config::getInstance().getInt(key,defaultValue); }
+	static void read(const char *key, const char *defaultValue, float &value)	{ value = Config::getInstance().getFloat(key,defaultValue); }
+
+public:
+	ConfigValue(const char *key, const char *defaultValue) : value() {
+		this->key = key;
+		this->defaultValue = defaultValue;
+		this->version = -1;
+	}
+
+	const T &get() const {
+		if(version != Config::getChangeVersion()) {
+			version = Config::getChangeVersion();
+			read(key, defaultValue, value);
+		}
+		return value;
+	}
+	const char * getKey() const { return key; }
+};
+
+// =====================================================
+// 	class CachedConfig
+//
+///	Settings read every frame, resolved through ConfigValue
+// =====================================================
+
+class CachedConfig {
+public:
+	static const ConfigValue<bool> showPerfStats;
+	static const ConfigValue<bool> enableNewThreadManager;
+	static const ConfigValue<bool> enableAIWorkerThreads;
+	static const ConfigValue<bool> disableWaterSounds;
+	static const ConfigValue<bool> performanceWarningEnabled;
+	static const ConfigValue<int> performanceWarningMillis;
+	static const ConfigValue<int> performanceWarningRenderMillis;
 };
 
 }}//end namespace
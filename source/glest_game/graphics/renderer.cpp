@@ -224,6 +224,7 @@ Renderer::Renderer() : BaseRenderer(), saveScreenShotThreadAccessor(new Mutex(CO
 		particleManager[i] = NULL;
 		fontManager[i] = NULL;
 	}
+	residentGameAssetsKey = "";
 
 	Config &config= Config::getInstance();
 
@@ -255,6 +256,8 @@ Renderer::Renderer() : BaseRenderer(), saveScreenShotThreadAccessor(new Mutex(CO
 		}
 		particleManager[i]= graphicsFactory->newParticleManager();
 	}
+	// -1 uses one update thread per extra core, 0 updates on the main thread
+	particleManager[rsGame]->setUpdateThreadCount(config.getInt("ParticleUpdateThreads","-1"));
 
 	if(GlobalStaticFlags::getIsNonGraphicalModeEnabled() == false) {
 		static string mutexOwnerId = string(extractFileFromDirectoryPath(__FILE__).c_str()) + string("_") + intToStr(__LINE__);
@@ -778,11 +781,33 @@ void Renderer::endGame(bool isFinalEnd) {
 
 	if(isFinalEnd) {
 		//delete resources
-		if(modelManager[rsGame] != NULL) {
-			modelManager[rsGame]->end();
+		bool keepModels = (residentGameAssetsKey != "" &&
+							config.getBool("KeepGameAssetsResident","true") == true &&
+							modelManager[rsGame] != NULL && textureManager[rsGame] != NULL);
+		if(keepModels == true) {
+			// keep the models and their textures for a following game on the
+			// same techtree and tileset, everything else goes as before
+			modelManager[rsGame]->releaseReferences();
+
+			std::set<Texture *> modelTextures;
+			modelManager[rsGame]->collectTextures(modelTextures);
+			std::set<Texture *> endList;
+			const TextureContainer &textures = textureManager[rsGame]->getTextures();
+			for(unsigned int i = 0; i < textures.size(); ++i) {
+				if(modelTextures.find(textures[i]) == modelTextures.end()) {
+					endList.insert(textures[i]);
+				}
+			}
+			textureManager[rsGame]->endTextures(endList);
 		}
-		if(textureManager[rsGame] != NULL) {
-			textureManager[rsGame]->end();
+		else {
+			residentGameAssetsKey = "";
+			if(modelManager[rsGame] != NULL) {
+				modelManager[rsGame]->end();
+			}
+			if(textureManager[rsGame] != NULL) {
+				textureManager[rsGame]->end();
+			}
 		}
 		if(fontManager[rsGame] != NULL) {
 			fontManager[rsGame]->end();
@@ -813,6 +838,28 @@ void Renderer::endGame(bool isFinalEnd) {
 	mapSurfaceData.clear();
 }
 
+// Called before a game loads its techtree and tileset. Models left resident
+// by the previous game are dropped unless they were loaded for the same key
+void Renderer::beginGameAssets(const string &assetsKey) {
+	if(GlobalStaticFlags::getIsNonGraphicalModeEnabled() == true) {
+		return;
+	}
+
+	string key = assetsKey;
+	if(key != "" && textureManager[rsGame] != NULL) {
+		// resident textures were initialized with the filter of their game
+		key += "_" + intToStr(textureManager[rsGame]->getTextureFilter()) +
+			   "_" + intToStr(textureManager[rsGame]->getMaxAnisotropy());
+	}
+	if(key != residentGameAssetsKey || key == "") {
+		if(modelManager[rsGame] != NULL) {
+			// owned mesh textures are ended along with their models
+			modelManager[rsGame]->end();
+		}
+	}
+	residentGameAssetsKey = key;
+}
+
 void Renderer::endMenu() {
 	this->menu = NULL;
 
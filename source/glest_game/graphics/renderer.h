@@ -290,6 +290,9 @@ private:
 	FontManager *fontManager[rsCount];
 	ParticleManager *particleManager[rsCount];
 
+	// techtree and tileset the models kept in rsGame after the last game belong to
+	string residentGameAssetsKey;
+
 	//state lists
 	//GLuint list3d;
 	//bool list3dValid;
@@ -458,6 +461,7 @@ public:
 	void endScenario();
 	void endMenu();
 	void endGame(bool isFinalEnd);
+	void beginGameAssets(const string &assetsKey);
 
 	//get
 	inline int getTriangleCount() const	{return triangleCount;}
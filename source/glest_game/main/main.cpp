@@ -202,6 +202,8 @@ void cleanupCRCThread() {
 		preCacheThread = NULL;
 		if(SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 	}
+	// keep the file CRCs the lobby computed since the last precache run
+	Checksum::saveFileCacheIfChanged();
 	if(SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
@@ -4169,6 +4171,31 @@ int handleListDataCommand(int argc, char** argv) {
 	return return_value;
 }
 
+string findSavedGameFile(string fileName, const string &userData) {
+	if(fileExists(fileName) == false) {
+		// Save the file now
+		string saveGameFile = "saved/" + fileName;
+		if(getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) != "") {
+			saveGameFile = getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) + saveGameFile;
+		}
+		else {
+			saveGameFile = userData + saveGameFile;
+		}
+		if(fileExists(saveGameFile) == true) {
+			fileName = saveGameFile;
+		}
+	}
+
+	if(fileExists(fileName) == false) {
+		char szBuf[8096]="";
+		snprintf(szBuf,8096,"File specified for loading a saved game cannot be found: [%s]",fileName.c_str());
+		printf("\n\n======================================================================================\n%s\n======================================================================================\n\n\n",szBuf);
+
+		throw megaglest_runtime_error(szBuf);
+	}
+	return fileName;
+}
+
 int glestMain(int argc, char** argv) {
 #ifdef SL_LEAK_DUMP
 	//AllocInfo::set_application_binary(executable_path(argv[0],true));
@@ -4280,6 +4307,14 @@ int glestMain(int argc, char** argv) {
 		}
     }
 
+    if( hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY])) == true) {
+    	// the replay runs without window, renderer, sound or console input
+    	// and the application quits once the report has been printed
+    	GlobalStaticFlags::setIsNonGraphicalModeEnabled(true);
+    	Program::setWantShutdownApplicationAfterGame(true);
+    	disableheadless_console = true;
+    }
+
 	if(hasCommandArgument(argc, argv,GAME_ARGS[GAME_ARG_SERVER_TITLE]) == true) {
 		int foundParamIndIndex = -1;
 		hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_SERVER_TITLE]) + string("="),&foundParamIndIndex);
@@ -4751,7 +4786,8 @@ int glestMain(int argc, char** argv) {
         }
 
 	    if( hasCommandArgument(argc, argv,GAME_ARGS[GAME_ARG_DISABLE_SOUND]) == true ||
-	    	hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_MODE])) == true) {
+	    	hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_MODE])) == true ||
+	    	hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY])) == true) {
 	    	config.setString("FactorySound","None",true);
 	    	if(hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_MASTERSERVER_MODE])) == true) {
 	    		//Logger::getInstance().setMasterserverMode(true);
@@ -5234,6 +5270,30 @@ int glestMain(int argc, char** argv) {
 			program->initServer(mainWindow,false,true,true);
 			gameInitialized = true;
 		}
+		else if(hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY])) == true) {
+			int foundParamIndIndex = -1;
+			hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY]) + string("="),&foundParamIndIndex);
+			if(foundParamIndIndex < 0) {
+				hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY]),&foundParamIndIndex);
+			}
+			string loadfileName = argv[foundParamIndIndex];
+			vector<string> paramPartTokens;
+			Tokenize(loadfileName,paramPartTokens,"=");
+			if(paramPartTokens.size() < 2 || paramPartTokens[1].length() == 0) {
+				printf("\nInvalid missing saved game specified on commandline [%s]\n\n",argv[foundParamIndIndex]);
+				printParameterHelp(argv[0],false);
+				return 1;
+			}
+			string fileName = findSavedGameFile(paramPartTokens[1],userData);
+
+			// the command list is only loaded when replays are enabled
+			config.setBool("SaveCommandsForReplay",true,true);
+			Game::setBenchmarkReplay(true);
+
+			printf("Benchmarking replay of saved game [%s]\n",fileName.c_str());
+			program->initSavedGame(mainWindow,true,fileName);
+			gameInitialized = true;
+		}
 		else if(hasCommandArgument(argc, argv,string(GAME_ARGS[GAME_ARG_AUTOSTART_LASTGAME])) == true) {
 			program->initServer(mainWindow,true,false);
 			gameInitialized = true;
@@ -5247,29 +5307,7 @@ int glestMain(int argc, char** argv) {
 				vector<string> paramPartTokens;
 				Tokenize(loadfileName,paramPartTokens,"=");
 				if(paramPartTokens.size() >= 2 && paramPartTokens[1].length() > 0) {
-					fileName = paramPartTokens[1];
-
-					if(fileExists(fileName) == false) {
-						// Save the file now
-						string saveGameFile = "saved/" + fileName;
-						if(getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) != "") {
-							saveGameFile = getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) + saveGameFile;
-						}
-						else {
-							saveGameFile = userData + saveGameFile;
-						}
-						if(fileExists(saveGameFile) == true) {
-							fileName = saveGameFile;
-						}
-					}
-
-					if(fileExists(fileName) == false) {
-						char szBuf[8096]="";
-						snprintf(szBuf,8096,"File specified for loading a saved game cannot be found: [%s]",fileName.c_str());
-						printf("\n\n======================================================================================\n%s\n======================================================================================\n\n\n",szBuf);
-
-						throw megaglest_runtime_error(szBuf);
-					}
+					fileName = findSavedGameFile(paramPartTokens[1],userData);
 				}
 			}
 			program->initSavedGame(mainWindow,false,fileName);
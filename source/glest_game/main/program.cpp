@@ -409,7 +409,7 @@ void Program::loopWorker() {
 
 	Chrono chronoPerformanceCounts;
 
-	bool showPerfStats = Config::getInstance().getBool("ShowPerfStats","false");
+	bool showPerfStats = CachedConfig::showPerfStats.get();
 	Chrono chronoPerf;
 	char perfBuf[8096]="";
 	std::vector<string> perfList;
@@ -3780,6 +3780,18 @@ void MenuStateConnectedGame::update() {
 			if( clientInterface->getJoinGameInProgress() == true &&
 				clientInterface->getJoinGameInProgressLaunch() == true &&
 			    clientInterface->getReadyForInGameJoin() == true &&
+			    clientInterface->getSavedGameSnapshotFile() != "") {
+
+				// the server streamed the saved game over the game connection
+				GameSettings gameSettings = *clientInterface->getGameSettings();
+				copyToGameSettings(&gameSettings);
+
+				Game::loadGame(clientInterface->getSavedGameSnapshotFile(),program,false,&gameSettings);
+				return;
+			}
+			else if( clientInterface->getJoinGameInProgress() == true &&
+				clientInterface->getJoinGameInProgressLaunch() == true &&
+			    clientInterface->getReadyForInGameJoin() == true &&
 			   ftpClientThread != NULL) {
 
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled && chrono.getMillis() > 0) SystemFlags::OutputDebug(SystemFlags::debugPerformance,"In [%s::%s Line: %d] took msecs: %lld\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chrono.getMillis());
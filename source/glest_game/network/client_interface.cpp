@@ -188,6 +188,8 @@ ClientInterface::ClientInterface() : GameNetworkInterface() {
 	cachedPendingCommandsIndex 			= 0;
 	cachedLastPendingFrameCount 		= 0;
 	timeClientWaitedForLastMessage 		= 0;
+	socketPoller						= new SocketPoller();
+	commandListReceivedSignal			= new Semaphore();
 
 	flagAccessor 						= new Mutex(CODE_AT_LINE);
 
@@ -200,6 +202,7 @@ ClientInterface::ClientInterface() : GameNetworkInterface() {
 	this->joinGameInProgressLaunch 		= false;
 	this->readyForInGameJoin 			= false;
 	this->resumeInGameJoin 				= false;
+	this->savedGameSnapshotFile			= "";
 
 	quitThreadAccessor 					= new Mutex(CODE_AT_LINE);
 	setQuitThread(false);
@@ -342,6 +345,12 @@ ClientInterface::~ClientInterface() {
 	delete quitThreadAccessor;
 	quitThreadAccessor = NULL;
 
+	delete socketPoller;
+	socketPoller = NULL;
+
+	delete commandListReceivedSignal;
+	commandListReceivedSignal = NULL;
+
 	if(SystemFlags::VERBOSE_MODE_ENABLED) printf("%s Line: %d\n",__FUNCTION__,__LINE__);
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 }
@@ -353,6 +362,11 @@ bool ClientInterface::getQuitThread() {
 void ClientInterface::setQuitThread(bool value) {
 	MutexSafeWrapper safeMutex(quitThreadAccessor,CODE_AT_LINE);
 	this->quitThread = value;
+	safeMutex.ReleaseLock();
+
+	if(value == true) {
+		wakeupWaitingThreads();
+	}
 }
 
 bool ClientInterface::getQuit() {
@@ -362,6 +376,20 @@ bool ClientInterface::getQuit() {
 void ClientInterface::setQuit(bool value) {
 	MutexSafeWrapper safeMutex(quitThreadAccessor,CODE_AT_LINE);
 	this->quit = value;
+	safeMutex.ReleaseLock();
+
+	if(value == true) {
+		wakeupWaitingThreads();
+	}
+}
+
+void ClientInterface::wakeupWaitingThreads() {
+	if(socketPoller != NULL) {
+		socketPoller->wakeup();
+	}
+	if(commandListReceivedSignal != NULL) {
+		commandListReceivedSignal->signal();
+	}
 }
 
 bool ClientInterface::getJoinGameInProgress() {
@@ -378,6 +406,65 @@ bool ClientInterface::getReadyForInGameJoin() {
 	return readyForInGameJoin;
 }
 
+string ClientInterface::getSavedGameSnapshotFile() {
+	MutexSafeWrapper safeMutex(flagAccessor,CODE_AT_LINE);
+	return savedGameSnapshotFile;
+}
+
+void ClientInterface::receiveSavedGameChunk(const NetworkMessageSavedGameChunk &networkMessageChunk) {
+	if(networkMessageChunk.getOffset() == 0) {
+		savedGameSnapshotData.clear();
+		savedGameSnapshotData.reserve(networkMessageChunk.getTotalSize());
+
+		MutexSafeWrapper safeMutexFlags(flagAccessor,CODE_AT_LINE);
+		savedGameSnapshotFile = "";
+	}
+	if(networkMessageChunk.getOffset() != savedGameSnapshotData.size()) {
+		throw megaglest_runtime_error("Saved game chunk out of order, offset: " + uIntToStr(networkMessageChunk.getOffset()) +
+				" expected: " + uIntToStr((uint32)savedGameSnapshotData.size()));
+	}
+	const unsigned char *chunkData = networkMessageChunk.getChunkData();
+	savedGameSnapshotData.insert(savedGameSnapshotData.end(), chunkData, chunkData + networkMessageChunk.getChunkSize());
+
+	if(savedGameSnapshotData.size() < networkMessageChunk.getTotalSize()) {
+		return;
+	}
+
+	int32 worldFrame = 0;
+	string savedGameXml = NetworkMessageSavedGameChunk::extractSnapshot(
+			&savedGameSnapshotData[0], (uint32)savedGameSnapshotData.size(), worldFrame);
+	savedGameSnapshotData.clear();
+
+	string saveGameFilePath = "temp/";
+	if(getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) != "") {
+		saveGameFilePath = getGameReadWritePath(GameConstants::path_logs_CacheLookupKey) + saveGameFilePath;
+	}
+	else {
+		string userData = Config::getInstance().getString("UserData_Root","");
+		if(userData != "") {
+			endPathWithSlash(userData);
+		}
+		saveGameFilePath = userData + saveGameFilePath;
+	}
+	createDirectoryPaths(saveGameFilePath);
+	string saveGameFile = saveGameFilePath + string(GameConstants::saveNetworkGameFileClient);
+
+	FILE *fp = fopen(saveGameFile.c_str(),"wb");
+	if(fp == NULL) {
+		throw megaglest_runtime_error("Cannot write saved game snapshot to: " + saveGameFile);
+	}
+	size_t bytesWritten = fwrite(savedGameXml.c_str(), 1, savedGameXml.size(), fp);
+	fclose(fp);
+	if(bytesWritten != savedGameXml.size()) {
+		throw megaglest_runtime_error("Cannot write saved game snapshot to: " + saveGameFile);
+	}
+
+	if(SystemFlags::VERBOSE_MODE_ENABLED) printf("Received saved game snapshot for frame %d, wrote %d bytes to [%s]\n",worldFrame,(int)savedGameXml.size(),saveGameFile.c_str());
+
+	MutexSafeWrapper safeMutexFlags(flagAccessor,CODE_AT_LINE);
+	savedGameSnapshotFile = saveGameFile;
+}
+
 bool ClientInterface::getResumeInGameJoin() {
 	MutexSafeWrapper safeMutex(flagAccessor,CODE_AT_LINE);
 	return resumeInGameJoin;
@@ -392,15 +479,20 @@ void ClientInterface::connect(const Ip &ip, int port) {
 	MutexSafeWrapper safeMutex(networkCommandListThreadAccessor,CODE_AT_LINE);
 	shutdownNetworkCommandListThread(safeMutex);
 
+	if(clientSocket != NULL) {
+		socketPoller->removeSocket(clientSocket->getSocketId());
+	}
 	delete clientSocket;
 	clientSocket = NULL;
 
 	safeMutex.ReleaseLock();
 
+	commandListProtocol = nclpFixedSize;
 	clientSocket = new ClientSocket();
 	clientSocket->setBlock(false);
 	clientSocket->connect(ip, port);
 	connectedTime = time(NULL);
+	socketPoller->addSocket(clientSocket->getSocketId());
 	//clientSocket->setBlock(true);
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] END - socket = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,clientSocket->getSocketId());
@@ -554,6 +646,7 @@ void ClientInterface::updateLobby() {
 				serverUUID 		= networkMessageIntro.getPlayerUUID();
 				serverPlatform 	= networkMessageIntro.getPlayerPlatform();
 				serverFTPPort 	= networkMessageIntro.getFtpPort();
+				commandListProtocol = networkMessageIntro.getCommandListProtocol();
 
 				if(playerIndex < 0 || playerIndex >= GameConstants::maxPlayers) {
 					throw megaglest_runtime_error("playerIndex < 0 || playerIndex >= GameConstants::maxPlayers");
@@ -1010,6 +1103,16 @@ void ClientInterface::updateLobby() {
 		}
 		break;
 
+		case nmtSavedGameChunk:
+		{
+			NetworkMessageSavedGameChunk networkMessageChunk;
+			if(receiveMessage(&networkMessageChunk)) {
+				this->setLastPingInfoToNow();
+				receiveSavedGameChunk(networkMessageChunk);
+			}
+		}
+		break;
+
 		case nmtCommandList:
 			{
 
@@ -1198,6 +1301,7 @@ void ClientInterface::updateFrame(int *checkFrame) {
 						}
 					}
 					safeMutex.ReleaseLock();
+					commandListReceivedSignal->signal();
 
 					done = true;
 				}
@@ -1413,6 +1517,10 @@ bool ClientInterface::getNetworkCommand(int frameCount, int currentCachedPending
 	//printf("In getNetworkCommand: %d [%d]\n",frameCount,currentCachedPendingCommandsIndex);
 
 	if(getQuit() == false && getQuitThread() == false) {
+		// signals for command lists cached before this call are stale,
+		// the lookup below sees those frames anyway
+		while(commandListReceivedSignal->tryDecrement() == true) {
+		}
 
 		Chrono chrono;
 		MutexSafeWrapper safeMutex(NULL,CODE_AT_LINE);
@@ -1482,10 +1590,9 @@ bool ClientInterface::getNetworkCommand(int frameCount, int currentCachedPending
 					break;
 				}
 
-				if(waitForData == false) {
-					waitForData = true;
-					sleep(0);
-				}
+				// sleep until the network thread caches the next command list
+				waitForData = true;
+				commandListReceivedSignal->waitTillSignalled(waitSleepTime);
 
 				waitCount++;
 				//printf("Client waiting for packet for frame: %d, currentCachedPendingCommandsIndex = %d, cachedPendingCommandsIndex = %lld\n",frameCount,currentCachedPendingCommandsIndex,(long long int)cachedPendingCommandsIndex);
@@ -1955,13 +2062,20 @@ NetworkMessageType ClientInterface::waitForMessage(int waitMicroseconds)
 	Chrono chrono;
 	chrono.start();
 
+	int64 lastConnectionCheck = -250;
+	bool socketReadyWithoutMessage = false;
 	NetworkMessageType msg = nmtInvalid;
 	while(	msg == nmtInvalid &&
 			getQuitThread() == false) {
 
 		msg = getNextMessageType(waitMicroseconds);
 		if(msg == nmtInvalid) {
-			if(getSocket() == NULL || (chrono.getMillis() % 250 == 0 && isConnected() == false)) {
+			bool checkConnection = false;
+			if(chrono.getMillis() - lastConnectionCheck >= 250) {
+				lastConnectionCheck = chrono.getMillis();
+				checkConnection = true;
+			}
+			if(getSocket() == NULL || (checkConnection == true && isConnected() == false)) {
 				if(getQuit() == false) {
 					//throw megaglest_runtime_error("Disconnected");
 					//sendTextMessage("Server has Disconnected.",-1);
@@ -1995,12 +2109,15 @@ NetworkMessageType ClientInterface::waitForMessage(int waitMicroseconds)
 				close();
 				return msg;
 			}
-			// Sleep every x milli-seconds we wait to let other threads work
-			else if(chrono.getMillis() % 2 == 0) {
+			// A socket that stays readable without delivering a message
+			// (e.g. closed by the server) backs off like before
+			else if(socketReadyWithoutMessage == true) {
+				socketReadyWithoutMessage = false;
 				sleep(1);
 			}
+			// Block until the server sends data or we are woken up to quit
 			else {
-				sleep(0);
+				socketReadyWithoutMessage = socketPoller->wait(waitSleepTime);
 			}
 		}
 
@@ -2054,6 +2171,9 @@ void ClientInterface::close(bool lockMutex) {
 	}
 	shutdownNetworkCommandListThread(safeMutex);
 
+	if(clientSocket != NULL) {
+		socketPoller->removeSocket(clientSocket->getSocketId());
+	}
 	delete clientSocket;
 	clientSocket = NULL;
 
@@ -2066,6 +2186,8 @@ void ClientInterface::close(bool lockMutex) {
 	this->joinGameInProgress 		= false;
 	this->joinGameInProgressLaunch 	= false;
 	this->readyForInGameJoin 		= false;
+	this->savedGameSnapshotFile		= "";
+	this->savedGameSnapshotData.clear();
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] END\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 }
@@ -24,6 +24,8 @@
 
 using Shared::Platform::Ip;
 using Shared::Platform::ClientSocket;
+using Shared::Platform::SocketPoller;
+using Shared::Platform::Semaphore;
 using std::vector;
 
 namespace Glest{ namespace Game{
@@ -93,12 +95,21 @@ private:
 	uint64 cachedLastPendingFrameCount;
 	int64 timeClientWaitedForLastMessage;
 
+	// wakes the network thread when the server sends data or on quit
+	SocketPoller *socketPoller;
+	// wakes the game thread when a command list has been cached or on quit
+	Semaphore *commandListReceivedSignal;
+
 	Mutex *flagAccessor;
 	bool joinGameInProgress;
 	bool joinGameInProgressLaunch;
 	bool readyForInGameJoin;
 	bool resumeInGameJoin;
 
+	// join in progress snapshot streamed by the server in chunks
+	std::vector<unsigned char> savedGameSnapshotData;
+	string savedGameSnapshotFile;
+
 	Mutex *quitThreadAccessor;
 	bool quitThread;
 
@@ -106,6 +117,8 @@ private:
 	void setQuitThread(bool value);
 	bool getQuit();
 	void setQuit(bool value);
+	void wakeupWaitingThreads();
+	void receiveSavedGameChunk(const NetworkMessageSavedGameChunk &networkMessageChunk);
 
 public:
 	ClientInterface();
@@ -119,6 +132,7 @@ public:
 	bool getJoinGameInProgressLaunch();
 
 	bool getReadyForInGameJoin();
+	string getSavedGameSnapshotFile();
 
 	bool getResumeInGameJoin();
 	void sendResumeGameMessage();
@@ -41,6 +41,10 @@ ConnectionSlotThread::ConnectionSlotThread(int slotIndex) : BaseThread() {
 
 	triggerGameStarted 		= new Mutex(CODE_AT_LINE);
 	gameStarted 			= false;
+
+	socketPoller 			= new SocketPoller();
+	polledSocket 			= NULL;
+	polledSocketId 			= 0;
 }
 
 ConnectionSlotThread::ConnectionSlotThread(ConnectionSlotCallbackInterface *slotInterface,int slotIndex) : BaseThread() {
@@ -53,6 +57,10 @@ ConnectionSlotThread::ConnectionSlotThread(ConnectionSlotCallbackInterface *slot
 
 	triggerGameStarted 		= new Mutex(CODE_AT_LINE);
 	gameStarted 			= false;
+
+	socketPoller 			= new SocketPoller();
+	polledSocket 			= NULL;
+	polledSocketId 			= 0;
 }
 
 ConnectionSlotThread::~ConnectionSlotThread() {
@@ -61,6 +69,9 @@ ConnectionSlotThread::~ConnectionSlotThread() {
 
 	delete triggerGameStarted;
 	triggerGameStarted = NULL;
+
+	delete socketPoller;
+	socketPoller = NULL;
 }
 
 void ConnectionSlotThread::setQuitStatus(bool value) {
@@ -69,11 +80,31 @@ void ConnectionSlotThread::setQuitStatus(bool value) {
 	BaseThread::setQuitStatus(value);
 	if(value == true) {
 		signalUpdate(NULL);
+
+		if(socketPoller != NULL) {
+			socketPoller->wakeup();
+		}
 	}
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] Line: %d\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
+bool ConnectionSlotThread::waitForSocketData(Socket *socket, PLATFORM_SOCKET socketId, int waitMilliseconds) {
+	if(SocketPoller::isEventDriven() == false) {
+		return Socket::hasDataToReadWithWait(socketId,waitMilliseconds * 1000);
+	}
+
+	// a new connection may reuse the number of the closed one, so the
+	// socket object is compared as well
+	if(socket != polledSocket || socketId != polledSocketId) {
+		socketPoller->clearSockets();
+		socketPoller->addSocket(socketId);
+		polledSocket 	= socket;
+		polledSocketId 	= socketId;
+	}
+	return socketPoller->wait(waitMilliseconds);
+}
+
 void ConnectionSlotThread::signalUpdate(ConnectionSlotEvent *event) {
 	if(event != NULL) {
 		MutexSafeWrapper safeMutex(triggerIdMutex,CODE_AT_LINE);
@@ -248,7 +279,7 @@ void ConnectionSlotThread::execute() {
 
 					// Avoid mutex locking
 					//bool socketHasReadData = Socket::hasDataToRead(socket->getSocketId());
-					bool socketHasReadData = Socket::hasDataToReadWithWait(socketId,150000);
+					bool socketHasReadData = waitForSocketData(socket,socketId,150);
 
 					if(getQuitStatus() == true) {
 						if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
@@ -592,6 +623,7 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 						this->lastReceiveCommandListTime = 0;
 						this->gotLagCountWarning = false;
 						this->versionString = "";
+						this->commandListProtocol = nclpFixedSize;
 
 						serverInterface->updateListen();
 						if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] playerIndex = %d\n",__FILE__,__FUNCTION__,__LINE__,playerIndex);
@@ -856,6 +888,7 @@ void ConnectionSlot::update(bool checkForNewClients,int lockedSlotIndex) {
 								this->playerLanguage = networkMessageIntro.getPlayerLanguage();
 								this->playerUUID	  = networkMessageIntro.getPlayerUUID();
 								this->platform		  = networkMessageIntro.getPlayerPlatform();
+								this->commandListProtocol = networkMessageIntro.getCommandListProtocol();
 
 								//printf("Got uuid from client [%s]\n",this->playerUUID.c_str());
 								if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] got name [%s] versionString [%s], msgSessionId = %d\n",__FILE__,__FUNCTION__,name.c_str(),versionString.c_str(),msgSessionId);
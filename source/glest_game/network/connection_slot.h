@@ -22,6 +22,7 @@
 
 using Shared::Platform::ServerSocket;
 using Shared::Platform::Socket;
+using Shared::Platform::SocketPoller;
 using std::vector;
 
 namespace Glest{ namespace Game{
@@ -90,7 +91,13 @@ protected:
 	Mutex *triggerGameStarted;
 	bool gameStarted;
 
+	// waits for the slot socket once the game runs, quit wakes it up
+	SocketPoller *socketPoller;
+	Socket *polledSocket;
+	PLATFORM_SOCKET polledSocketId;
+
 	virtual void setQuitStatus(bool value);
+	bool waitForSocketData(Socket *socket, PLATFORM_SOCKET socketId, int waitMilliseconds);
 	virtual void setTaskCompleted(int eventId);
 
 	void slotUpdateTask(ConnectionSlotEvent *event);
@@ -52,6 +52,7 @@ NetworkInterface::NetworkInterface() {
 	for(unsigned int index = 0; index < (unsigned int)GameConstants::maxPlayers; ++index) {
 		networkPlayerFactionCRC[index] = 0;
 	}
+	commandListProtocol = nclpFixedSize;
 }
 
 void NetworkInterface::init() {
@@ -68,6 +69,7 @@ void NetworkInterface::init() {
 	for(unsigned int index = 0; index < (unsigned int)GameConstants::maxPlayers; ++index) {
 		networkPlayerFactionCRC[index] = 0;
 	}
+	commandListProtocol = nclpFixedSize;
 }
 
 NetworkInterface::~NetworkInterface() {
@@ -114,7 +116,12 @@ void NetworkInterface::addUnMarkedCell(const UnMarkedCell &msg) {
 void NetworkInterface::sendMessage(NetworkMessage* networkMessage){
 	Socket* socket= getSocket(false);
 
-	networkMessage->send(socket);
+	if(networkMessage->getNetworkMessageType() == nmtCommandList) {
+		static_cast<NetworkMessageCommandList *>(networkMessage)->send(socket,commandListProtocol);
+	}
+	else {
+		networkMessage->send(socket);
+	}
 }
 
 NetworkMessageType NetworkInterface::getNextMessageType(int waitMilliseconds) {
@@ -207,6 +214,9 @@ bool NetworkInterface::receiveMessage(NetworkMessage* networkMessage){
 
 	Socket* socket= getSocket(false);
 
+	if(networkMessage->getNetworkMessageType() == nmtCommandList) {
+		return static_cast<NetworkMessageCommandList *>(networkMessage)->receive(socket,commandListProtocol);
+	}
 	return networkMessage->receive(socket);
 }
 
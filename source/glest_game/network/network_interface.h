@@ -202,6 +202,9 @@ protected:
 	Mutex *networkPlayerFactionCRCMutex;
 	uint32 networkPlayerFactionCRC[GameConstants::maxPlayers];
 
+	// negotiated with the peer through NetworkMessageIntro
+	NetworkCommandListProtocol commandListProtocol;
+
 public:
 	static const int readyWaitTimeout;
 	GameSettings gameSettings;
@@ -222,6 +225,9 @@ public:
 	uint32 getNetworkPlayerFactionCRC(int index);
 	void setNetworkPlayerFactionCRC(int index, uint32 crc);
 
+	NetworkCommandListProtocol getCommandListProtocol() const				{ return commandListProtocol; }
+	void setCommandListProtocol(NetworkCommandListProtocol protocol)		{ commandListProtocol = protocol; }
+
 	virtual Socket* getSocket(bool mutexLock=true)= 0;
 
 	virtual void close()= 0;
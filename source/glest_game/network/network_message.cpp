@@ -23,6 +23,7 @@
 #include <cassert>
 #include <stdexcept>
 #include "common_scoped_ptr.h"
+#include "varint_stream.h"
 
 #include "leak_dumper.h"
 
@@ -92,50 +93,35 @@ void NetworkMessage::send(Socket* socket, const void* data, int dataSize) {
 void NetworkMessage::send(Socket* socket, const void* data, int dataSize, int8 messageType) {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] socket = %p, data = %p, dataSize = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,socket,data,dataSize);
 
-	if(socket != NULL) {
-		int msgTypeSize = sizeof(messageType);
-		int fullMsgSize = msgTypeSize + dataSize;
-
-		char *out_buffer = new char[fullMsgSize];
-		memcpy(out_buffer,&messageType,msgTypeSize);
-		memcpy(&out_buffer[msgTypeSize],(const char *)data,dataSize);
-
-		dump_packet("\nOUTGOING PACKET:\n",out_buffer, fullMsgSize, true);
-		int sendResult = socket->send(out_buffer, fullMsgSize);
-		if(sendResult != fullMsgSize) {
-			delete [] out_buffer;
-			if(socket != NULL && socket->isSocketValid() == true) {
-				char szBuf[8096]="";
-				snprintf(szBuf,8096,"Error sending NetworkMessage, sendResult = %d, dataSize = %d",sendResult,fullMsgSize);
-				throw megaglest_runtime_error(szBuf);
-			}
-			else {
-				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] Line: %d socket has been disconnected\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
-			}
-		}
-		else {
-			delete [] out_buffer;
-		}
-	}
+	const void *dataList[] = { &messageType, data };
+	const int dataSizeList[] = { (int)sizeof(messageType), dataSize };
+	send(socket, dataList, dataSizeList, 2);
 }
 
 void NetworkMessage::send(Socket* socket, const void* data, int dataSize, int8 messageType, uint32 compressedLength) {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] socket = %p, data = %p, dataSize = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,socket,data,dataSize);
 
+	const void *dataList[] = { &messageType, &compressedLength, data };
+	const int dataSizeList[] = { (int)sizeof(messageType), (int)sizeof(compressedLength), dataSize };
+	send(socket, dataList, dataSizeList, 3);
+}
+
+void NetworkMessage::send(Socket* socket, const void * const *dataList, const int *dataSizeList, int dataCount) {
 	if(socket != NULL) {
-		int msgTypeSize = sizeof(messageType);
-		int compressedSize = sizeof(compressedLength);
-		int fullMsgSize = msgTypeSize + compressedSize + dataSize;
+		int fullMsgSize = 0;
+		for(int index = 0; index < dataCount; ++index) {
+			fullMsgSize += dataSizeList[index];
+		}
 
-		char *out_buffer = new char[fullMsgSize];
-		memcpy(out_buffer,&messageType,msgTypeSize);
-		memcpy(&out_buffer[msgTypeSize],&compressedLength,compressedSize);
-		memcpy(&out_buffer[msgTypeSize+compressedSize],(const char *)data,dataSize);
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled == true) {
+			for(int index = 0; index < dataCount; ++index) {
+				dump_packet("\nOUTGOING PACKET:\n",dataList[index], dataSizeList[index], true);
+			}
+		}
 
-		dump_packet("\nOUTGOING PACKET:\n",out_buffer, fullMsgSize, true);
-		int sendResult = socket->send(out_buffer, fullMsgSize);
+		// header and payload go out in one call without being copied together
+		int sendResult = socket->send(dataList, dataSizeList, dataCount);
 		if(sendResult != fullMsgSize) {
-			delete [] out_buffer;
 			if(socket != NULL && socket->isSocketValid() == true) {
 				char szBuf[8096]="";
 				snprintf(szBuf,8096,"Error sending NetworkMessage, sendResult = %d, dataSize = %d",sendResult,fullMsgSize);
@@ -145,9 +131,6 @@ void NetworkMessage::send(Socket* socket, const void* data, int dataSize, int8 m
 				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s] Line: %d socket has been disconnected\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 			}
 		}
-		else {
-			delete [] out_buffer;
-		}
 	}
 }
 
@@ -340,6 +323,7 @@ NetworkMessageIntro::NetworkMessageIntro(int32 sessionId,const string &versionSt
 	data.gameInProgress = gameInProgress;
 	data.playerUUID		= playerUUID;
 	data.platform		= platform;
+	data.platform.setSpareValue(nclpCount - 1);
 }
 
 const char * NetworkMessageIntro::getPackedMessageFormat() const {
@@ -427,6 +411,7 @@ string NetworkMessageIntro::toString() const {
 	result += " gameInProgress = " + uIntToStr(data.gameInProgress);
 	result += " playerUUID = " + data.playerUUID.getString();
 	result += " platform = " + data.platform.getString();
+	result += " commandListProtocol = " + intToStr(getCommandListProtocol());
 
 	return result;
 }
@@ -1908,19 +1893,25 @@ void NetworkMessageCommandList::send(Socket* socket) {
 		//NetworkMessage::send(socket, &data.messageType, sizeof(data.messageType));
 
 		//NetworkMessage::send(socket, &data.header, commandListHeaderSize, data.messageType);
-		unsigned char *send_buffer = getData();
-		int headerSize = sizeof(data.header);
-		uint16 totalCommand = data.header.commandCount;
-		int detailSize = (sizeof(NetworkCommand) * totalCommand);
-		int fullBufferSize = headerSize + detailSize;
-		NetworkMessage::send(socket, send_buffer, fullBufferSize, data.messageType);
-		delete [] send_buffer;
+		const void *dataList[] = { &data.messageType, &data.header, (totalCommand > 0 ? &data.commands[0] : NULL) };
+		const int dataSizeList[] = { (int)sizeof(data.messageType), (int)sizeof(data.header), (int)(sizeof(NetworkCommand) * totalCommand) };
+		NetworkMessage::send(socket, dataList, dataSizeList, (totalCommand > 0 ? 3 : 2));
 	}
 	else {
 		//NetworkMessage::send(socket, &data.header, commandListHeaderSize);
 		buf = packMessageHeader();
 		//if(totalCommand) printf("\n\nSend packet size = %u data.messageType = %d\n%s\ncommandcount [%u] framecount [%d]\n",getPackedSizeHeader(),data.header.messageType,buf,totalCommand,data.header.frameCount);
-		NetworkMessage::send(socket, buf, getPackedSizeHeader());
+		if(totalCommand > 0) {
+			// header and detail are written with one gather send
+			unsigned char *detailBuf = packMessageDetail(totalCommand);
+			const void *dataList[] = { buf, detailBuf };
+			const int dataSizeList[] = { (int)getPackedSizeHeader(), (int)getPackedSizeDetail(totalCommand) };
+			NetworkMessage::send(socket, dataList, dataSizeList, 2);
+			delete [] detailBuf;
+		}
+		else {
+			NetworkMessage::send(socket, buf, getPackedSizeHeader());
+		}
 		delete [] buf;
 	}
 
@@ -1937,13 +1928,7 @@ void NetworkMessageCommandList::send(Socket* socket) {
 			//NetworkMessage::send(socket, &data.commands[0], (sizeof(NetworkCommand) * totalCommand));
 		}
 		else {
-			buf = packMessageDetail(totalCommand);
-			//printf("\n#4 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
-			//printf("Send packet size = %u data.messageType = %d\n[%s]\n",getPackedSize(),data.messageType,buf);
-			NetworkMessage::send(socket, buf, getPackedSizeDetail(totalCommand));
-			//printf("\n#5 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
-			delete [] buf;
-			//printf("\n#6 Send packet commandcount [%u] framecount [%d]\n",totalCommand,data.header.frameCount);
+			// already sent together with the header above
 
 	//        for(int idx = 0 ; idx < totalCommand; ++idx) {
 	//            const NetworkCommand &cmd = data.commands[idx];
@@ -1969,6 +1954,203 @@ void NetworkMessageCommandList::send(Socket* socket) {
 	}
 }
 
+// Field order used by the nclpVarint format, a command is written as a bit
+// mask of the fields that differ from the previous command in the list
+// followed by the zigzag encoded difference of each of those fields
+static const int networkCommandFieldCount = 14;
+
+static void getNetworkCommandFields(const NetworkCommand &command, int64 *fields) {
+	fields[0]	= command.networkCommandType;
+	fields[1]	= command.unitId;
+	fields[2]	= command.unitTypeId;
+	fields[3]	= command.commandTypeId;
+	fields[4]	= command.positionX;
+	fields[5]	= command.positionY;
+	fields[6]	= command.targetId;
+	fields[7]	= command.wantQueue;
+	fields[8]	= command.fromFactionIndex;
+	fields[9]	= command.unitFactionUnitCount;
+	fields[10]	= command.unitFactionIndex;
+	fields[11]	= command.commandStateType;
+	fields[12]	= command.commandStateValue;
+	fields[13]	= command.unitCommandGroupId;
+}
+
+static void setNetworkCommandFields(NetworkCommand &command, const int64 *fields) {
+	command.networkCommandType		= static_cast<int16>(fields[0]);
+	command.unitId					= static_cast<int32>(fields[1]);
+	command.unitTypeId				= static_cast<int16>(fields[2]);
+	command.commandTypeId			= static_cast<int16>(fields[3]);
+	command.positionX				= static_cast<int16>(fields[4]);
+	command.positionY				= static_cast<int16>(fields[5]);
+	command.targetId				= static_cast<int32>(fields[6]);
+	command.wantQueue				= static_cast<int8>(fields[7]);
+	command.fromFactionIndex		= static_cast<int8>(fields[8]);
+	command.unitFactionUnitCount	= static_cast<uint16>(fields[9]);
+	command.unitFactionIndex		= static_cast<int8>(fields[10]);
+	command.commandStateType		= static_cast<int8>(fields[11]);
+	command.commandStateValue		= static_cast<int32>(fields[12]);
+	command.unitCommandGroupId		= static_cast<int32>(fields[13]);
+}
+
+bool NetworkMessageCommandList::hasNetworkPlayerFactionCRCs() const {
+	// CRCs are only filled in when network synch checks are enabled
+	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+		if(data.header.networkPlayerFactionCRC[index] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void NetworkMessageCommandList::send(Socket* socket, NetworkCommandListProtocol protocol) {
+	if(protocol == nclpVarint) {
+		sendVarint(socket);
+	}
+	else {
+		send(socket);
+	}
+}
+
+bool NetworkMessageCommandList::receive(Socket* socket, NetworkCommandListProtocol protocol) {
+	if(protocol == nclpVarint) {
+		return receiveVarint(socket);
+	}
+	return receive(socket);
+}
+
+void NetworkMessageCommandList::sendVarint(Socket* socket) {
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] nmtCommandList, frameCount = %d, data.header.commandCount = %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,data.header.frameCount,data.header.commandCount);
+
+	assert(data.messageType == nmtCommandList);
+	uint16 totalCommand = data.header.commandCount;
+	bool sendFactionCRCs = hasNetworkPlayerFactionCRCs();
+
+	VarintWriter writer;
+	writer.reserve(16 + (sendFactionCRCs == true ? 4 * GameConstants::maxPlayers : 0) + 8 * totalCommand);
+	writer.writeSigned(data.header.frameCount);
+	writer.writeUnsigned(totalCommand);
+	writer.writeByte(sendFactionCRCs == true ? varintFlagFactionCRCs : 0);
+	if(sendFactionCRCs == true) {
+		for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+			writer.writeFixed32(data.header.networkPlayerFactionCRC[index]);
+		}
+	}
+
+	// the first command is compared against a default constructed one
+	int64 previousFields[networkCommandFieldCount];
+	int64 fields[networkCommandFieldCount];
+	getNetworkCommandFields(NetworkCommand(), previousFields);
+	for(unsigned int commandIndex = 0; commandIndex < totalCommand; ++commandIndex) {
+		getNetworkCommandFields(data.commands[commandIndex], fields);
+
+		uint32 changedMask = 0;
+		for(int fieldIndex = 0; fieldIndex < networkCommandFieldCount; ++fieldIndex) {
+			if(fields[fieldIndex] != previousFields[fieldIndex]) {
+				changedMask |= (1 << fieldIndex);
+			}
+		}
+		writer.writeUnsigned(changedMask);
+		for(int fieldIndex = 0; fieldIndex < networkCommandFieldCount; ++fieldIndex) {
+			if((changedMask & (1 << fieldIndex)) != 0) {
+				writer.writeSigned(fields[fieldIndex] - previousFields[fieldIndex]);
+			}
+			previousFields[fieldIndex] = fields[fieldIndex];
+		}
+	}
+
+	uint32 payloadSize = Shared::PlatformByteOrder::toCommonEndian((uint32)writer.getSize());
+	const void *dataList[] = { &data.messageType, &payloadSize, writer.getData() };
+	const int dataSizeList[] = { (int)sizeof(data.messageType), (int)sizeof(payloadSize), writer.getSize() };
+	NetworkMessage::send(socket, dataList, dataSizeList, 3);
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] sent %d commands in %d bytes (fixed size format: %d bytes)\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,totalCommand,writer.getSize(),(int)(commandListHeaderSize + sizeof(NetworkCommand) * totalCommand));
+}
+
+bool NetworkMessageCommandList::receiveVarint(Socket* socket) {
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
+
+	uint32 payloadSize = 0;
+	bool result = NetworkMessage::receive(socket, &payloadSize, sizeof(payloadSize), true);
+	if(result == false) {
+		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] ERROR header not received as expected\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
+		return false;
+	}
+	payloadSize = Shared::PlatformByteOrder::fromCommonEndian(payloadSize);
+	if(payloadSize == 0 || payloadSize > maxVarintPayloadSize) {
+		char szBuf[8096]="";
+		snprintf(szBuf,8096,"Invalid command list payload size: %u",payloadSize);
+		throw megaglest_runtime_error(szBuf);
+	}
+
+	std::vector<unsigned char> payload(payloadSize);
+	result = NetworkMessage::receive(socket, &payload[0], payloadSize, true);
+	if(result == true) {
+		data.messageType = this->getNetworkMessageType();
+		decodeVarint(&payload[0], payloadSize);
+
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled == true) {
+			for(int idx = 0 ; idx < data.header.commandCount; ++idx) {
+				const NetworkCommand &cmd = data.commands[idx];
+
+				SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] index = %d, received networkCommand [%s]\n",
+						extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,idx, cmd.toString().c_str());
+			}
+		}
+	}
+	return result;
+}
+
+void NetworkMessageCommandList::decodeVarint(const unsigned char *buf, int bufSize) {
+	VarintReader reader(buf, bufSize);
+
+	int64 frameCount = 0;
+	uint64 commandCount = 0;
+	uint8 flags = 0;
+	reader.readSigned(frameCount);
+	reader.readUnsigned(commandCount);
+	reader.readByte(flags);
+	// every command takes at least its one byte field mask
+	if(reader.isFailed() == true || commandCount > (uint64)reader.getRemaining() ||
+		commandCount > 0xffff) {
+		throw megaglest_runtime_error("Invalid command list header");
+	}
+
+	data.header.frameCount = static_cast<int32>(frameCount);
+	data.header.commandCount = static_cast<uint16>(commandCount);
+	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+		data.header.networkPlayerFactionCRC[index] = 0;
+		if((flags & varintFlagFactionCRCs) != 0) {
+			reader.readFixed32(data.header.networkPlayerFactionCRC[index]);
+		}
+	}
+
+	data.commands.clear();
+	data.commands.resize(data.header.commandCount);
+
+	int64 fields[networkCommandFieldCount];
+	getNetworkCommandFields(NetworkCommand(), fields);
+	for(unsigned int commandIndex = 0; commandIndex < data.header.commandCount; ++commandIndex) {
+		uint64 changedMask = 0;
+		reader.readUnsigned(changedMask);
+		if(changedMask >= ((uint64)1 << networkCommandFieldCount)) {
+			throw megaglest_runtime_error("Invalid command list field mask");
+		}
+		for(int fieldIndex = 0; fieldIndex < networkCommandFieldCount; ++fieldIndex) {
+			if((changedMask & ((uint64)1 << fieldIndex)) != 0) {
+				int64 delta = 0;
+				reader.readSigned(delta);
+				fields[fieldIndex] += delta;
+			}
+		}
+		setNetworkCommandFields(data.commands[commandIndex], fields);
+	}
+
+	if(reader.isFailed() == true || reader.isAtEnd() == false) {
+		throw megaglest_runtime_error("Invalid command list data, size = " + intToStr(bufSize));
+	}
+}
+
 void NetworkMessageCommandList::toEndianHeader() {
 	static bool bigEndianSystem = Shared::PlatformByteOrder::isBigEndian();
 	if(bigEndianSystem == true) {
@@ -3697,4 +3879,141 @@ void NetworkMessageHighlightCell::fromEndian() {
 	}
 }
 
+// =====================================================
+//	class NetworkMessageSavedGameChunk
+// =====================================================
+
+static const char savedGameSnapshotMagic[4] = { 'M', 'G', 'S', 'S' };
+
+NetworkMessageSavedGameChunk::NetworkMessageSavedGameChunk() {
+	messageType			= nmtSavedGameChunk;
+	header.totalSize	= 0;
+	header.offset		= 0;
+	header.chunkSize	= 0;
+}
+
+NetworkMessageSavedGameChunk::NetworkMessageSavedGameChunk(uint32 totalSize, uint32 offset,
+		const unsigned char *chunkData, uint32 chunkSize) {
+	messageType			= nmtSavedGameChunk;
+	header.totalSize	= totalSize;
+	header.offset		= offset;
+	header.chunkSize	= chunkSize;
+	chunk.assign(chunkData, chunkData + chunkSize);
+}
+
+void NetworkMessageSavedGameChunk::buildSnapshot(const string &savedGameXml, int32 worldFrame,
+		std::vector<unsigned char> &snapshot) {
+	Checksum checksum;
+	checksum.addString(savedGameXml);
+
+	std::pair<unsigned char *,unsigned long> compressed =
+			Shared::CompressionUtil::compressMemoryToMemory(
+					(unsigned char *)savedGameXml.c_str(), (unsigned long)savedGameXml.size());
+
+	VarintWriter writer;
+	writer.reserve((int)compressed.second + 32);
+	writer.writeBytes(savedGameSnapshotMagic, sizeof(savedGameSnapshotMagic));
+	writer.writeUnsigned(snapshotFormatVersion);
+	writer.writeSigned(worldFrame);
+	writer.writeUnsigned(savedGameXml.size());
+	writer.writeFixed32(checksum.getSum());
+	writer.writeBytes(compressed.first, (int)compressed.second);
+	delete [] compressed.first;
+
+	snapshot.assign(writer.getData(), writer.getData() + writer.getSize());
+}
+
+string NetworkMessageSavedGameChunk::extractSnapshot(const unsigned char *snapshot, uint32 snapshotSize,
+		int32 &worldFrame) {
+	VarintReader reader(snapshot, snapshotSize);
+
+	char magic[sizeof(savedGameSnapshotMagic)];
+	uint64 formatVersion = 0;
+	int64 frame = 0;
+	uint64 xmlSize = 0;
+	uint32 xmlChecksum = 0;
+	reader.readBytes(magic, sizeof(magic));
+	reader.readUnsigned(formatVersion);
+	if(reader.isFailed() == true || memcmp(magic, savedGameSnapshotMagic, sizeof(magic)) != 0) {
+		throw megaglest_runtime_error("Invalid saved game snapshot received");
+	}
+	if(formatVersion != snapshotFormatVersion) {
+		throw megaglest_runtime_error("Unsupported saved game snapshot version: " + intToStr((int)formatVersion));
+	}
+	reader.readSigned(frame);
+	reader.readUnsigned(xmlSize);
+	reader.readFixed32(xmlChecksum);
+	// the xml compresses well but an absurd size means a corrupt header
+	if(reader.isFailed() == true || xmlSize == 0 || xmlSize > (uint64)maxSnapshotSize * 16) {
+		throw megaglest_runtime_error("Invalid saved game snapshot header received");
+	}
+
+	std::pair<unsigned char *,unsigned long> decompressed =
+			Shared::CompressionUtil::extractMemoryToMemory(
+					(unsigned char *)&snapshot[reader.getPosition()], reader.getRemaining(), (unsigned long)xmlSize);
+	string savedGameXml((const char *)decompressed.first, decompressed.second);
+	delete [] decompressed.first;
+
+	Checksum checksum;
+	checksum.addString(savedGameXml);
+	if(savedGameXml.size() != xmlSize || checksum.getSum() != xmlChecksum) {
+		throw megaglest_runtime_error("Saved game snapshot checksum mismatch");
+	}
+
+	worldFrame = static_cast<int32>(frame);
+	return savedGameXml;
+}
+
+bool NetworkMessageSavedGameChunk::receive(Socket* socket) {
+	bool result = NetworkMessage::receive(socket, &header, sizeof(header), true);
+	if(result == true) {
+		messageType = nmtSavedGameChunk;
+		fromEndian();
+
+		if(header.chunkSize > maxChunkSize || header.totalSize > maxSnapshotSize ||
+			header.offset > header.totalSize || header.chunkSize > header.totalSize - header.offset) {
+			char szBuf[8096]="";
+			snprintf(szBuf,8096,"Invalid saved game chunk, totalSize = %u, offset = %u, chunkSize = %u",header.totalSize,header.offset,header.chunkSize);
+			throw megaglest_runtime_error(szBuf);
+		}
+
+		chunk.resize(header.chunkSize);
+		if(header.chunkSize > 0) {
+			result = NetworkMessage::receive(socket, &chunk[0], header.chunkSize, true);
+		}
+	}
+	return result;
+}
+
+void NetworkMessageSavedGameChunk::send(Socket* socket) {
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] nmtSavedGameChunk offset = %u, chunkSize = %u, totalSize = %u\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,header.offset,header.chunkSize,header.totalSize);
+
+	assert(messageType == nmtSavedGameChunk);
+	uint32 chunkSize = header.chunkSize;
+	toEndian();
+
+	const void *dataList[] = { &messageType, &header, getChunkData() };
+	const int dataSizeList[] = { (int)sizeof(messageType), (int)sizeof(header), (int)chunkSize };
+	NetworkMessage::send(socket, dataList, dataSizeList, (chunkSize > 0 ? 3 : 2));
+
+	fromEndian();
+}
+
+void NetworkMessageSavedGameChunk::toEndian() {
+	static bool bigEndianSystem = Shared::PlatformByteOrder::isBigEndian();
+	if(bigEndianSystem == true) {
+		header.totalSize = Shared::PlatformByteOrder::toCommonEndian(header.totalSize);
+		header.offset = Shared::PlatformByteOrder::toCommonEndian(header.offset);
+		header.chunkSize = Shared::PlatformByteOrder::toCommonEndian(header.chunkSize);
+	}
+}
+void NetworkMessageSavedGameChunk::fromEndian() {
+	static bool bigEndianSystem = Shared::PlatformByteOrder::isBigEndian();
+	if(bigEndianSystem == true) {
+		header.totalSize = Shared::PlatformByteOrder::fromCommonEndian(header.totalSize);
+		header.offset = Shared::PlatformByteOrder::fromCommonEndian(header.offset);
+		header.chunkSize = Shared::PlatformByteOrder::fromCommonEndian(header.chunkSize);
+	}
+}
+
 }}//end namespace
@@ -49,6 +49,7 @@ enum NetworkMessageType {
 	nmtMarkCell,
 	nmtUnMarkCell,
 	nmtHighlightCell,
+	nmtSavedGameChunk,
 //	nmtCompressedPacket,
 
 	nmtCount
@@ -62,6 +63,17 @@ enum NetworkGameStateType {
 	nmgstCount
 };
 
+// Wire format used for NetworkMessageCommandList on a connection, both sides
+// advertise the newest one they know in NetworkMessageIntro and use the lower.
+// It is sent in the spare byte of the platform name so the intro keeps the
+// layout older builds expect, those always send zero there (nclpFixedSize)
+enum NetworkCommandListProtocol {
+	nclpFixedSize,
+	nclpVarint,
+
+	nclpCount
+};
+
 static const int maxLanguageStringSize= 60;
 static const int maxNetworkMessageSize= 20000;
 
@@ -127,6 +139,7 @@ protected:
 	void send(Socket* socket, const void* data, int dataSize);
 	void send(Socket* socket, const void* data, int dataSize, int8 messageType);
 	void send(Socket* socket, const void* data, int dataSize, int8 messageType, uint32 compressedLength);
+	void send(Socket* socket, const void * const *dataList, const int *dataSizeList, int dataCount);
 
 	virtual const char * getPackedMessageFormat() const = 0;
 	virtual unsigned int getPackedSize() = 0;
@@ -203,6 +216,18 @@ public:
 
 	string getPlayerUUID() const				{ return data.playerUUID.getString();}
 	string getPlayerPlatform() const			{ return data.platform.getString();}
+	NetworkCommandListProtocol getCommandListProtocol() const { return toCommandListProtocol(data.platform.getSpareValue()); }
+
+	// a newer peer falls back to the newest format we understand
+	static NetworkCommandListProtocol toCommandListProtocol(int value) {
+		if(value < nclpFixedSize) {
+			return nclpFixedSize;
+		}
+		else if(value >= nclpCount) {
+			return static_cast<NetworkCommandListProtocol>(nclpCount - 1);
+		}
+		return static_cast<NetworkCommandListProtocol>(value);
+	}
 
 	virtual bool receive(Socket* socket);
 	virtual void send(Socket* socket);
@@ -426,6 +451,10 @@ private:
 
 	static const int32 commandListHeaderSize = sizeof(DataHeader);
 
+	// nclpVarint flags
+	static const uint8 varintFlagFactionCRCs = 0x01;
+	static const uint32 maxVarintPayloadSize = 0x1000000;
+
 	struct Data {
 		int8 messageType;
 		DataHeader header;
@@ -444,6 +473,11 @@ private:
 	void toEndianDetail(uint16 totalCommand);
 	void fromEndianDetail();
 
+	bool hasNetworkPlayerFactionCRCs() const;
+	void sendVarint(Socket* socket);
+	bool receiveVarint(Socket* socket);
+	void decodeVarint(const unsigned char *buf, int bufSize);
+
 private:
 	Data data;
 
@@ -485,6 +519,9 @@ public:
 
 	virtual bool receive(Socket* socket);
 	virtual void send(Socket* socket);
+
+	bool receive(Socket* socket, NetworkCommandListProtocol protocol);
+	void send(Socket* socket, NetworkCommandListProtocol protocol);
 };
 #pragma pack(pop)
 
@@ -1211,6 +1248,66 @@ public:
 };
 #pragma pack(pop)
 
+// =====================================================
+//	class NetworkMessageSavedGameChunk
+//
+//	Part of the game snapshot streamed over the game socket
+//	to a player joining a game in progress
+// =====================================================
+
+#pragma pack(push, 1)
+class NetworkMessageSavedGameChunk: public NetworkMessage {
+public:
+	static const uint32 maxChunkSize = 16384;
+	static const uint32 maxSnapshotSize = 0x8000000;
+	static const uint32 snapshotFormatVersion = 1;
+
+private:
+	int8 messageType;
+	struct DataHeader {
+		uint32 totalSize;
+		uint32 offset;
+		uint32 chunkSize;
+	};
+
+	void toEndian();
+	void fromEndian();
+
+private:
+	DataHeader header;
+	std::vector<unsigned char> chunk;
+
+protected:
+	virtual const char * getPackedMessageFormat() const { return NULL; }
+	virtual unsigned int getPackedSize() { return 0; }
+	virtual void unpackMessage(unsigned char *buf) { };
+	virtual unsigned char * packMessage() { return NULL; }
+
+public:
+	NetworkMessageSavedGameChunk();
+	NetworkMessageSavedGameChunk(uint32 totalSize, uint32 offset, const unsigned char *chunkData, uint32 chunkSize);
+
+	virtual size_t getDataSize() const { return sizeof(DataHeader) + chunk.size(); }
+
+	virtual NetworkMessageType getNetworkMessageType() const {
+		return nmtSavedGameChunk;
+	}
+
+	uint32 getTotalSize() const						{ return header.totalSize; }
+	uint32 getOffset() const						{ return header.offset; }
+	uint32 getChunkSize() const						{ return header.chunkSize; }
+	const unsigned char * getChunkData() const		{ return (chunk.empty() == true ? NULL : &chunk[0]); }
+
+	// Snapshot layout: magic, format version, world frame, xml size and
+	// checksum followed by the zlib compressed saved game xml
+	static void buildSnapshot(const string &savedGameXml, int32 worldFrame, std::vector<unsigned char> &snapshot);
+	static string extractSnapshot(const unsigned char *snapshot, uint32 snapshotSize, int32 &worldFrame);
+
+	virtual bool receive(Socket* socket);
+	virtual void send(Socket* socket);
+};
+#pragma pack(pop)
+
 }}//end namespace
 
 #endif
@@ -18,6 +18,7 @@
 #endif
 
 #include <string>
+#include <cstring>
 #include "data_types.h"
 #include "vec.h"
 #include "command.h"
@@ -61,6 +62,18 @@ public:
 		buffer[maxBufferSize-1] = '\0';
 	}
 
+	// The byte before the terminating one is always sent (the packed protocol
+	// leaves out the last byte) and is zero unless the string fills the
+	// buffer. It can carry a small value that older builds never look at.
+	int8 getSpareValue() const {
+		return (memchr(buffer, '\0', S-2) != NULL ? buffer[S-2] : 0);
+	}
+	void setSpareValue(int8 value) {
+		if(memchr(buffer, '\0', S-2) != NULL) {
+			buffer[S-2] = value;
+		}
+	}
+
 	char *getBuffer() { return &buffer[0]; }
 	string getString() const { return (buffer[0] != '\0' ? buffer : ""); }
 };
@@ -25,6 +25,7 @@
 #include "miniftpserver.h"
 #include "map_preview.h"
 #include "stats.h"
+#include "xml_parser.h"
 #include <time.h>
 #include <set>
 #include <iostream>
@@ -55,6 +56,85 @@ const int MASTERSERVER_HEARTBEAT_GAME_STATUS_SECONDS 		= 30;
 
 const int MAX_EMPTY_NETWORK_COMMAND_LIST_BROADCAST_INTERVAL_MILLISECONDS = 4000;
 
+// =====================================================
+//	class SavedGameSnapshotThread
+// =====================================================
+
+SavedGameSnapshotThread::SavedGameSnapshotThread(ServerInterface *serverInterface,
+		XmlTree *savedGameTree, int worldFrame, const vector<int> &slotIndexes) : BaseThread() {
+	uniqueID				= "SavedGameSnapshotThread";
+	this->serverInterface	= serverInterface;
+	this->savedGameTree		= savedGameTree;
+	this->worldFrame		= worldFrame;
+	this->slotIndexes		= slotIndexes;
+}
+
+SavedGameSnapshotThread::~SavedGameSnapshotThread() {
+	delete savedGameTree;
+	savedGameTree = NULL;
+}
+
+void SavedGameSnapshotThread::execute() {
+	RunningStatusSafeWrapper runningStatus(this);
+	try {
+		if(getQuitStatus() == true) {
+			return;
+		}
+
+		Chrono chrono(true);
+		vector<unsigned char> snapshot;
+		NetworkMessageSavedGameChunk::buildSnapshot(savedGameTree->saveToString(), worldFrame, snapshot);
+		delete savedGameTree;
+		savedGameTree = NULL;
+
+		if(SystemFlags::VERBOSE_MODE_ENABLED) printf("Built saved game snapshot for frame %d, %d bytes in " MG_I64_SPECIFIER " msecs\n",worldFrame,(int)snapshot.size(),(long long int)chrono.getMillis());
+		if(snapshot.size() > NetworkMessageSavedGameChunk::maxSnapshotSize) {
+			throw megaglest_runtime_error("Saved game snapshot too large: " + intToStr((int)snapshot.size()));
+		}
+
+		for(unsigned int index = 0; index < slotIndexes.size() && getQuitStatus() == false; ++index) {
+			int slotIndex = slotIndexes[index];
+			if(sendSnapshot(snapshot, slotIndex) == true) {
+				MutexSafeWrapper safeMutex(serverInterface->getSlotMutex(slotIndex),CODE_AT_LINE);
+				ConnectionSlot *slot = serverInterface->getSlot(slotIndex,false);
+				if(slot != NULL && slot->isConnected() == true) {
+					NetworkMessageReady networkMessageReady(0);
+					slot->sendMessage(&networkMessageReady);
+					slot->setSentSavedGameInfo(true);
+				}
+			}
+		}
+	}
+	catch(const exception &ex) {
+		SystemFlags::OutputDebug(SystemFlags::debugError,"In [%s::%s Line: %d] Error [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] ERROR [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,ex.what());
+	}
+}
+
+bool SavedGameSnapshotThread::sendSnapshot(const vector<unsigned char> &snapshot, int slotIndex) {
+	uint32 totalSize = (uint32)snapshot.size();
+	for(uint32 offset = 0; offset < totalSize; offset += NetworkMessageSavedGameChunk::maxChunkSize) {
+		if(getQuitStatus() == true) {
+			return false;
+		}
+		uint32 chunkSize = min(totalSize - offset, (uint32)NetworkMessageSavedGameChunk::maxChunkSize);
+		NetworkMessageSavedGameChunk networkMessageChunk(totalSize, offset, &snapshot[offset], chunkSize);
+
+		// the slot lock is only held per chunk so the game keeps its turn
+		MutexSafeWrapper safeMutex(serverInterface->getSlotMutex(slotIndex),CODE_AT_LINE);
+		ConnectionSlot *slot = serverInterface->getSlot(slotIndex,false);
+		if(slot == NULL || slot->isConnected() == false) {
+			return false;
+		}
+		slot->sendMessage(&networkMessageChunk);
+	}
+	return true;
+}
+
+// =====================================================
+//	class ServerInterface
+// =====================================================
+
 ServerInterface::ServerInterface(bool publishEnabled, ClientLagCallbackInterface *clientLagCallbackInterface) : GameNetworkInterface() {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
@@ -69,7 +149,10 @@ ServerInterface::ServerInterface(bool publishEnabled, ClientLagCallbackInterface
 
 	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
 		slotAccessorMutexes[index] 		= new Mutex(CODE_AT_LINE);
+		slotPolledSockets[index]		= NULL;
+		slotPolledSocketIds[index]		= 0;
 	}
+	slotSocketPoller					= new SocketPoller();
 	masterServerThreadAccessor 			= new Mutex(CODE_AT_LINE);
 	textMessageQueueThreadAccessor 		= new Mutex(CODE_AT_LINE);
 	broadcastMessageQueueThreadAccessor = new Mutex(CODE_AT_LINE);
@@ -84,6 +167,7 @@ ServerInterface::ServerInterface(bool publishEnabled, ClientLagCallbackInterface
 	gameStartTime 					= 0;
 	resumeGameStartTime				= 0;
 	publishToMasterserverThread 	= NULL;
+	savedGameSnapshotThread			= NULL;
 	lastMasterserverHeartbeatTime 	= 0;
 	needToRepublishToMasterserver 	= false;
 	ftpServer 						= NULL;
@@ -276,6 +360,32 @@ void ServerInterface::shutdownMasterserverPublishThread() {
 	}
 }
 
+void ServerInterface::startSavedGameSnapshot(XmlTree *savedGameTree, int worldFrame, const vector<int> &slotIndexes) {
+	shutdownSavedGameSnapshotThread();
+
+	savedGameSnapshotThread = new SavedGameSnapshotThread(this, savedGameTree, worldFrame, slotIndexes);
+	savedGameSnapshotThread->setUniqueID(CODE_AT_LINE);
+	savedGameSnapshotThread->start();
+}
+
+bool ServerInterface::isSavedGameSnapshotInProgress() {
+	return (savedGameSnapshotThread != NULL &&
+			(savedGameSnapshotThread->getHasBeginExecution() == false ||
+			 savedGameSnapshotThread->getRunningStatus() == true));
+}
+
+void ServerInterface::shutdownSavedGameSnapshotThread() {
+	if(savedGameSnapshotThread != NULL) {
+		if(savedGameSnapshotThread->shutdownAndWait() == true) {
+			delete savedGameSnapshotThread;
+		}
+		else {
+			savedGameSnapshotThread->setDeleteSelfOnExecutionDone(true);
+		}
+		savedGameSnapshotThread = NULL;
+	}
+}
+
 ServerInterface::~ServerInterface() {
 	//printf("===> Destructor for ServerInterface\n");
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
@@ -299,6 +409,7 @@ ServerInterface::~ServerInterface() {
 	close();
 	shutdownFTPServer();
 	shutdownMasterserverPublishThread();
+	shutdownSavedGameSnapshotThread();
 
 	lastMasterserverHeartbeatTime = 0;
 	if(needToRepublishToMasterserver == true) {
@@ -310,6 +421,9 @@ ServerInterface::~ServerInterface() {
 		slotAccessorMutexes[index] = NULL;
 	}
 
+	delete slotSocketPoller;
+	slotSocketPoller = NULL;
+
 	delete textMessageQueueThreadAccessor;
 	textMessageQueueThreadAccessor = NULL;
 
@@ -856,6 +970,13 @@ std::pair<bool,bool> ServerInterface::clientLagCheck(ConnectionSlot *connectionS
 }
 
 void ServerInterface::updateSocketTriggeredList(std::map<PLATFORM_SOCKET,bool> & socketTriggeredList) {
+	Socket *slotSockets[GameConstants::maxPlayers];
+	PLATFORM_SOCKET slotSocketIds[GameConstants::maxPlayers];
+	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+		slotSockets[index]		= NULL;
+		slotSocketIds[index]	= 0;
+	}
+
 	for(int index = 0; exitServer == false && index < GameConstants::maxPlayers; ++index) {
 		MutexSafeWrapper safeMutexSlot(slotAccessorMutexes[index],CODE_AT_LINE_X(index));
 		ConnectionSlot *connectionSlot = slots[index];
@@ -863,9 +984,63 @@ void ServerInterface::updateSocketTriggeredList(std::map<PLATFORM_SOCKET,bool> &
 			PLATFORM_SOCKET clientSocket = connectionSlot->getSocketId();
 			if(Socket::isSocketValid(&clientSocket) == true) {
 				socketTriggeredList[clientSocket] = false;
+
+				slotSockets[index]		= connectionSlot->getSocket();
+				slotSocketIds[index]	= clientSocket;
 			}
 		}
 	}
+
+	updateSlotSocketPoller(slotSockets, slotSocketIds, socketTriggeredList);
+}
+
+void ServerInterface::updateSlotSocketPoller(Socket **slotSockets, PLATFORM_SOCKET *slotSocketIds,
+		const std::map<PLATFORM_SOCKET,bool> &socketTriggeredList) {
+	if(SocketPoller::isEventDriven() == false) {
+		return;
+	}
+
+	for(int index = 0; index < GameConstants::maxPlayers; ++index) {
+		if(slotSockets[index] == slotPolledSockets[index] &&
+			slotSocketIds[index] == slotPolledSocketIds[index]) {
+			continue;
+		}
+
+		// Only drop the old number when no slot uses it now, a closed socket's
+		// number may already belong to the connection another slot accepted
+		PLATFORM_SOCKET oldSocketId = slotPolledSocketIds[index];
+		if(Socket::isSocketValid(&oldSocketId) == true &&
+			socketTriggeredList.find(oldSocketId) == socketTriggeredList.end()) {
+			slotSocketPoller->removeSocket(oldSocketId);
+		}
+		if(slotSockets[index] != NULL) {
+			slotSocketPoller->addSocket(slotSocketIds[index]);
+		}
+
+		slotPolledSockets[index]	= slotSockets[index];
+		slotPolledSocketIds[index]	= slotSocketIds[index];
+	}
+}
+
+bool ServerInterface::hasSlotDataToRead(std::map<PLATFORM_SOCKET,bool> &socketTriggeredList) {
+	if(SocketPoller::isEventDriven() == false) {
+		return Socket::hasDataToRead(socketTriggeredList);
+	}
+
+	std::vector<PLATFORM_SOCKET> readySockets;
+	if(slotSocketPoller->wait(0, &readySockets) == false) {
+		return false;
+	}
+
+	bool result = false;
+	for(unsigned int index = 0; index < readySockets.size(); ++index) {
+		std::map<PLATFORM_SOCKET,bool>::iterator iterFind = socketTriggeredList.find(readySockets[index]);
+		if(iterFind != socketTriggeredList.end()) {
+			iterFind->second = true;
+			result = true;
+		}
+	}
+	return result;
 }
 
 void ServerInterface::validateConnectedClients() {
@@ -1511,7 +1686,7 @@ void ServerInterface::update() {
 
 			bool hasData = false;
 			if(gameHasBeenInitiated == false) {
-				hasData = Socket::hasDataToRead(socketTriggeredList);
+				hasData = hasSlotDataToRead(socketTriggeredList);
 			}
 			else {
 				hasData = true;
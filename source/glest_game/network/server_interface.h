@@ -26,12 +26,44 @@
 
 using std::vector;
 using Shared::Platform::ServerSocket;
+using Shared::Platform::SocketPoller;
 
 namespace Shared {  namespace PlatformCommon {  class FTPServerThread;  }}
+namespace Shared {  namespace Xml {  class XmlTree;  }}
+
+using Shared::Xml::XmlTree;
 
 namespace Glest{ namespace Game{
 
 class Stats;
+class ServerInterface;
+
+// =====================================================
+//	class SavedGameSnapshotThread
+//
+///	Turns the saved game tree captured by the game thread into a
+///	compressed snapshot and streams it over the game socket to the slots
+///	joining the game in progress, followed by the ready message that
+///	tells them to load it. The game thread only pays for building the tree.
+// =====================================================
+
+class SavedGameSnapshotThread : public BaseThread {
+protected:
+	ServerInterface *serverInterface;
+	XmlTree *savedGameTree;
+	int worldFrame;
+	vector<int> slotIndexes;
+
+	bool sendSnapshot(const vector<unsigned char> &snapshot, int slotIndex);
+
+public:
+	SavedGameSnapshotThread(ServerInterface *serverInterface, XmlTree *savedGameTree,
+			int worldFrame, const vector<int> &slotIndexes);
+	virtual ~SavedGameSnapshotThread();
+
+	virtual void execute();
+};
+
 // =====================================================
 //	class ServerInterface
 // =====================================================
@@ -54,6 +86,12 @@ private:
 	ConnectionSlot* slots[GameConstants::maxPlayers];
 	Mutex *slotAccessorMutexes[GameConstants::maxPlayers];
 
+	// holds the socket of every slot so update() reads which slots have
+	// data from the poller's ready events instead of select()ing them all
+	SocketPoller *slotSocketPoller;
+	Socket *slotPolledSockets[GameConstants::maxPlayers];
+	PLATFORM_SOCKET slotPolledSocketIds[GameConstants::maxPlayers];
+
 	ServerSocket serverSocket;
 
 	Mutex *switchSetupRequestsSynchAccessor;
@@ -67,6 +105,7 @@ private:
 	time_t lastGlobalLagCheckTime;
 
 	SimpleTaskThread *publishToMasterserverThread;
+	SavedGameSnapshotThread *savedGameSnapshotThread;
 	Mutex *masterServerThreadAccessor;
 	time_t lastMasterserverHeartbeatTime;
 	bool needToRepublishToMasterserver;
@@ -135,6 +174,11 @@ public:
 
 	void shutdownFTPServer();
 
+	// takes ownership of savedGameTree
+	void startSavedGameSnapshot(XmlTree *savedGameTree, int worldFrame, const vector<int> &slotIndexes);
+	bool isSavedGameSnapshotInProgress();
+	void shutdownSavedGameSnapshotThread();
+
     virtual void close();
     virtual void update();
     virtual void updateLobby()  { };
@@ -256,6 +300,9 @@ private:
     bool shouldDiscardNetworkMessage(NetworkMessageType networkMessageType, ConnectionSlot *connectionSlot);
     void updateSlot(ConnectionSlotEvent *event);
     void validateConnectedClients();
+    void updateSlotSocketPoller(Socket **slotSockets, PLATFORM_SOCKET *slotSocketIds,
+    		const std::map<PLATFORM_SOCKET,bool> &socketTriggeredList);
+    bool hasSlotDataToRead(std::map<PLATFORM_SOCKET,bool> &socketTriggeredList);
 
     std::map<string,string> publishToMasterserver();
     std::map<string,string> publishToMasterserverStats();
@@ -294,9 +294,6 @@ void FactionThread::execute() {
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 		if(SystemFlags::VERBOSE_MODE_ENABLED) printf("In [%s::%s Line: %d] ****************** STARTING worker thread this = %p\n",__FILE__,__FUNCTION__,__LINE__,this);
 
-		bool minorDebugPerformance = false;
-		Chrono chrono;
-
 		codeLocation = "2";
 		//unsigned int idx = 0;
 		for(;this->faction != NULL;) {
@@ -337,99 +334,8 @@ void FactionThread::execute() {
 				if(this->faction == NULL) {
 					throw megaglest_runtime_error("this->faction == NULL");
 				}
-				World *world = this->faction->getWorld();
-				if(world == NULL) {
-					throw megaglest_runtime_error("world == NULL");
-				}
-
 				codeLocation = "7";
-				//Config &config= Config::getInstance();
-				//bool sortedUnitsAllowed = config.getBool("AllowGroupedUnitCommands","true");
-				//bool sortedUnitsAllowed = false;
-				//if(sortedUnitsAllowed == true) {
-				
-				/// TODO: Why does this cause an OOS?
-				//this->faction->sortUnitsByCommandGroups();
-                
-				//}
-
-				codeLocation = "8";
-				static string mutexOwnerId2 = string(__FILE__) + string("_") + intToStr(__LINE__);
-				MutexSafeWrapper safeMutex(faction->getUnitMutex(),mutexOwnerId2);
-
-				//if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
-				if(minorDebugPerformance) chrono.start();
-
-				//printf("In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
-
-				codeLocation = "9";
-				int unitCount = this->faction->getUnitCount();
-				for(int j = 0; j < unitCount; ++j) {
-					codeLocation = "10";
-					Unit *unit = this->faction->getUnit(j);
-					if(unit == NULL) {
-						throw megaglest_runtime_error("unit == NULL");
-					}
-
-					codeLocation = "11";
-					int64 elapsed1 = 0;
-					if(minorDebugPerformance) elapsed1 = chrono.getMillis();
-
-					bool update = unit->needToUpdate();
-
-					codeLocation = "12";
-					if(minorDebugPerformance && (chrono.getMillis() - elapsed1) >= 1) printf("Faction [%d - %s] #1-unit threaded updates on frame: %d for [%d] unit # %d, unitCount = %d, took [%lld] msecs\n",faction->getStartLocationIndex(),faction->getType()->getName(false).c_str(),currentTriggeredFrameIndex,faction->getUnitPathfindingListCount(),j,unitCount,(long long int)chrono.getMillis() - elapsed1);
-
-					//update = true;
-					if(update == true)
-					{
-						codeLocation = "13";
-						if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true) {
-							int64 updateProgressValue = unit->getUpdateProgress();
-							int64 speed = unit->getCurrSkill()->getTotalSpeed(unit->getTotalUpgrade());
-							int64 df = unit->getDiagonalFactor();
-							int64 hf = unit->getHeightFactor();
-							bool changedActiveCommand = unit->isChangedActiveCommand();
-
-							char szBuf[8096]="";
-							snprintf(szBuf,8096,"unit->needToUpdate() returned: %d updateProgressValue: %lld speed: %lld changedActiveCommand: %d df: %lld hf: %lld",update,(long long int)updateProgressValue,(long long int)speed,changedActiveCommand,(long long int)df,(long long int)hf);
-							unit->logSynchDataThreaded(__FILE__,__LINE__,szBuf);
-						}
-
-						int64 elapsed2 = 0;
-						if(minorDebugPerformance) elapsed2 = chrono.getMillis();
-
-						if(world->getUnitUpdater() == NULL) {
-							throw megaglest_runtime_error("world->getUnitUpdater() == NULL");
-						}
-
-						world->getUnitUpdater()->updateUnitCommand(unit,currentTriggeredFrameIndex);
-
-						codeLocation = "15";
-						if(minorDebugPerformance && (chrono.getMillis() - elapsed2) >= 1) printf("Faction [%d - %s] #2-unit threaded updates on frame: %d for [%d] unit # %d, unitCount = %d, took [%lld] msecs\n",faction->getStartLocationIndex(),faction->getType()->getName(false).c_str(),currentTriggeredFrameIndex,faction->getUnitPathfindingListCount(),j,unitCount,(long long int)chrono.getMillis() - elapsed2);
-					}
-					else {
-						codeLocation = "16";
-						if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true) {
-							int64 updateProgressValue = unit->getUpdateProgress();
-							int64 speed = unit->getCurrSkill()->getTotalSpeed(unit->getTotalUpgrade());
-							int64 df = unit->getDiagonalFactor();
-							int64 hf = unit->getHeightFactor();
-							bool changedActiveCommand = unit->isChangedActiveCommand();
-
-							char szBuf[8096]="";
-							snprintf(szBuf,8096,"unit->needToUpdate() returned: %d updateProgressValue: %lld speed: %lld changedActiveCommand: %d df: %lld hf: %lld",update,(long long int)updateProgressValue,(long long int)speed,changedActiveCommand,(long long int)df,(long long int)hf);
-							unit->logSynchDataThreaded(__FILE__,__LINE__,szBuf);
-						}
-					}
-				}
-
-				codeLocation = "17";
-				if(minorDebugPerformance && chrono.getMillis() >= 1) printf("Faction [%d - %s] threaded updates on frame: %d for [%d] units took [%lld] msecs\n",faction->getStartLocationIndex(),faction->getType()->getName(false).c_str(),currentTriggeredFrameIndex,faction->getUnitPathfindingListCount(),(long long int)chrono.getMillis());
-
-				//printf("In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
-
-				safeMutex.ReleaseLock();
+				this->faction->updateUnitCommands(currentTriggeredFrameIndex);
 
 				codeLocation = "18";
 				//printf("In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
@@ -470,6 +376,14 @@ void FactionThread::execute() {
 }
 
 
+// =====================================================
+// 	class FactionUnitCommandJob
+// =====================================================
+
+void FactionUnitCommandJob::run() {
+	faction->updateUnitCommands(frameIndex);
+}
+
 // =====================================================
 // 	class Faction
 // =====================================================
@@ -485,6 +399,7 @@ void Faction::init() {
 	cachingDisabled=false;
 	factionDisconnectHandled=false;
 	workerThread = NULL;
+	threadedUnitCommandUpdates = false;
 
 	world=NULL;
 	scriptManager=NULL;
@@ -702,6 +617,44 @@ bool Faction::isWorkerThreadSignalCompleted(int frameIndex) {
 	return true;
 }
 
+void Faction::updateUnitCommands(int frameIndex) {
+	if(world == NULL) {
+		throw megaglest_runtime_error("world == NULL");
+	}
+	if(world->getUnitUpdater() == NULL) {
+		throw megaglest_runtime_error("world->getUnitUpdater() == NULL");
+	}
+
+	static string mutexOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
+	MutexSafeWrapper safeMutex(getUnitMutex(),mutexOwnerId);
+
+	int unitCount = getUnitCount();
+	for(int j = 0; j < unitCount; ++j) {
+		Unit *unit = getUnit(j);
+		if(unit == NULL) {
+			throw megaglest_runtime_error("unit == NULL");
+		}
+
+		bool update = unit->needToUpdate();
+
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true) {
+			int64 updateProgressValue = unit->getUpdateProgress();
+			int64 speed = unit->getCurrSkill()->getTotalSpeed(unit->getTotalUpgrade());
+			int64 df = unit->getDiagonalFactor();
+			int64 hf = unit->getHeightFactor();
+			bool changedActiveCommand = unit->isChangedActiveCommand();
+
+			char szBuf[8096]="";
+			snprintf(szBuf,8096,"unit->needToUpdate() returned: %d updateProgressValue: %lld speed: %lld changedActiveCommand: %d df: %lld hf: %lld",update,(long long int)updateProgressValue,(long long int)speed,changedActiveCommand,(long long int)df,(long long int)hf);
+			unit->logSynchDataThreaded(__FILE__,__LINE__,szBuf);
+		}
+
+		if(update == true) {
+			world->getUnitUpdater()->updateUnitCommand(unit,frameIndex);
+		}
+	}
+}
+
 
 void Faction::init(
 	FactionType *factionType, ControlType control, TechTree *techTree, Game *game,
@@ -753,7 +706,11 @@ void Faction::init(
 		loadGame(loadWorldNode, this->index,game->getGameSettings(),game->getWorld());
 	}
 
-	if( game->getGameSettings()->getPathFinderType() == pfBasic) {
+	// unit command updates normally run as jobs on the world's JobSystem,
+	// the dedicated thread is only needed by the master / slave controller
+	threadedUnitCommandUpdates = (game->getGameSettings()->getPathFinderType() == pfBasic);
+	if( threadedUnitCommandUpdates == true &&
+		Config::getInstance().getBool("EnableNewThreadManager","false") == true) {
 		if(workerThread != NULL) {
 			workerThread->signalQuit();
 			if(workerThread->shutdownAndWait() == true) {
@@ -2460,6 +2417,15 @@ void Faction::loadGame(const XmlNode *rootNode, int factionIndex,GameSettings *s
 	}
 }
 
+uint32 Faction::mixUnitCRC(uint32 crc) {
+	crc ^= crc >> 16;
+	crc *= 0x85ebca6b;
+	crc ^= crc >> 13;
+	crc *= 0xc2b2ae35;
+	crc ^= crc >> 16;
+	return crc;
+}
+
 Checksum Faction::getCRC() {
 	const bool consoleDebug = false;
 
@@ -2493,12 +2459,15 @@ Checksum Faction::getCRC() {
 		}
 	}
 
+	// Units are combined with a sum of mixed unit crcs so the result does not
+	// depend on the order of the unit list, each unit crc includes its id
+	uint32 unitsCRC = 0;
 	for(unsigned int i = 0; i < units.size(); ++i) {
 		Unit *unit = units[i];
-		//crcForFaction.addSum(unit->getCRC().getSum());
-		uint32 crc = unit->getCRC().getSum();
-		crcForFaction.addBytes(&crc,sizeof(uint32));
+		unitsCRC += mixUnitCRC(unit->getCRC().getSum());
 	}
+	crcForFaction.addInt((int)units.size());
+	crcForFaction.addUInt(unitsCRC);
 
 	if(consoleDebug) {
 		if(getWorld()->getFrameCount() % 40 == 0) {
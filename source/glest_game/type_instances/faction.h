@@ -25,6 +25,7 @@
 #include "game_constants.h"
 #include "command_type.h"
 #include "base_thread.h"
+#include "job_system.h"
 #include <set>
 #include "faction_type.h"
 #include "leak_dumper.h"
@@ -58,6 +59,19 @@ public:
 	std::map<Vec2i,float> surfPosAlphaList;
 };
 
+// A run of surface cells x1..x2 (inclusive) on surface row y
+class SurfaceCellSpan {
+public:
+	SurfaceCellSpan(int y, int x1, int x2) {
+		this->y = y;
+		this->x1 = x1;
+		this->x2 = x2;
+	}
+	int y;
+	int x1;
+	int x2;
+};
+
 class ExploredCellsLookupItem {
 public:
 
@@ -65,8 +79,8 @@ public:
 		ExploredCellsLookupItemCacheTimerCountIndex = 0;
 	}
 	int ExploredCellsLookupItemCacheTimerCountIndex;
-	std::vector<SurfaceCell *> exploredCellList;
-	std::vector<SurfaceCell *> visibleCellList;
+	std::vector<SurfaceCellSpan> exploredSpanList;
+	std::vector<SurfaceCellSpan> visibleSpanList;
 
 	static time_t lastDebug;
 };
@@ -112,6 +126,27 @@ public:
     bool isSignalPathfinderCompleted(int frameIndex);
 };
 
+// =====================================================
+// 	class FactionUnitCommandJob
+//
+///	Runs the threaded unit command updates of one faction on the world's
+///	JobSystem. The units of a faction share its pathfinder state and
+///	pathfinding quota, so a faction is never split over several jobs.
+// =====================================================
+
+class FactionUnitCommandJob : public Job {
+private:
+	Faction *faction;
+	int frameIndex;
+
+public:
+	FactionUnitCommandJob(Faction *faction, int frameIndex) {
+		this->faction = faction;
+		this->frameIndex = frameIndex;
+	}
+	virtual void run();
+};
+
 class SwitchTeamVote {
 public:
 
@@ -163,6 +198,7 @@ private:
 
 	RandomGen random;
 	FactionThread *workerThread;
+	bool threadedUnitCommandUpdates;
 
 	std::map<int,SwitchTeamVote> switchTeamVotes;
 	int currentSwitchTeamVoteFactionIndex;
@@ -360,6 +396,8 @@ public:
 	void signalWorkerThread(int frameIndex);
 	bool isWorkerThreadSignalCompleted(int frameIndex);
 	FactionThread *getWorkerThread() { return workerThread; }
+	bool getThreadedUnitCommandUpdates() const { return threadedUnitCommandUpdates; }
+	void updateUnitCommands(int frameIndex);
 
 	void limitResourcesToStore();
 
@@ -378,6 +416,7 @@ public:
 	void clearCaches();
 
 	Checksum getCRC();
+	static uint32 mixUnitCRC(uint32 crc);
 	void addCRC_DetailsForWorldFrame(int worldFrameCount,bool isNetworkServer);
 	string getCRC_DetailsForWorldFrame(int worldFrameCount);
 	std::pair<int,string> getCRC_DetailsForWorldFrameIndex(int worldFrameIndex) const;
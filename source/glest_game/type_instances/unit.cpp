@@ -27,6 +27,7 @@
 #include "socket.h"
 #include "sound_renderer.h"
 
+#include "byte_order.h"
 #include "leak_dumper.h"
 
 using namespace Shared::Graphics;
@@ -538,6 +539,8 @@ Unit::Unit(int id, UnitPathInterface *unitpath, const Vec2i &pos,
 	modelFacing = CardinalDir(CardinalDir::NORTH);
 	lastStuckFrame = 0;
 	lastStuckPos = Vec2i(0,0);
+	totalUpgradeCRC = 0;
+	totalUpgradeCRCValid = false;
 	lastPathfindFailedFrame = 0;
 	lastPathfindFailedPos = Vec2i(0,0);
 	usePathfinderExtendedMaxNodes = false;
@@ -546,6 +549,7 @@ Unit::Unit(int id, UnitPathInterface *unitpath, const Vec2i &pos,
 	lastAttackedUnitId = -1;
 	causeOfDeath = ucodNone;
 	pathfindFailedConsecutiveFrameCount = 0;
+	visibleCellsCountedTeam = -1;
 
 	lastSynchDataString = "";
 	lastFile = "";
@@ -670,6 +674,9 @@ Unit::~Unit() {
 
 	this->faction->deleteLivingUnits(id);
 	this->faction->deleteLivingUnitsp(this);
+	if(map != NULL) {
+		map->removeUnitFromGrid(this);
+	}
 
 	//remove commands
 	static string mutexOwnerId = string(__FILE__) + string("_") + intToStr(__LINE__);
@@ -2130,6 +2137,12 @@ void Unit::undertake() {
 
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
+		if(visibleCellsCountedTeam >= 0) {
+			game->getWorld()->updateVisibleCellCounts(visibleCellsCountedTeam, visibleCellsCounted,
+													  -1, std::vector<SurfaceCellSpan>());
+			clearVisibleCellCounts();
+		}
+
 		this->faction->deleteLivingUnits(id);
 		this->faction->deleteLivingUnitsp(this);
 
@@ -2984,6 +2997,7 @@ bool Unit::applyAttackBoost(const AttackBoost *boost, const Unit *source) {
 		//printf("#1 wasAlive = %d hp = %d boosthp = %d\n",wasAlive,hp,boost->boostUpgrade.getMaxHp());
 
 		totalUpgrade.apply(source->getId(),&boost->boostUpgrade, this);
+		totalUpgradeCRCValid = false;
 
 		checkItemInVault(&this->hp,this->hp);
 		//hp += boost->boostUpgrade.getMaxHp();
@@ -3104,6 +3118,7 @@ void Unit::deapplyAttackBoost(const AttackBoost *boost, const Unit *source) {
 	int prevMaxHp = totalUpgrade.getMaxHp();
 	int prevMaxHpRegen = totalUpgrade.getMaxHpRegeneration();
 	totalUpgrade.deapply(source->getId(),&boost->boostUpgrade, this->getId());
+	totalUpgradeCRCValid = false;
 
 	checkItemInVault(&this->hp,this->hp);
 	int original_hp = this->hp;
@@ -3575,6 +3590,7 @@ void Unit::applyUpgrade(const UpgradeType *upgradeType){
 
 	if(upgradeType->isAffected(type)){
 		totalUpgrade.sum(upgradeType, this);
+		totalUpgradeCRCValid = false;
 
 		checkItemInVault(&this->hp,this->hp);
 		int original_hp = this->hp;
@@ -3611,6 +3627,7 @@ void Unit::checkUnitLevel() {
 
 		int maxHp= this->totalUpgrade.getMaxHp();
 		totalUpgrade.incLevel(type);
+		totalUpgradeCRCValid = false;
 		//printf("File: %s line: %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__);
 		game->getScriptManager()->onUnitTriggerEvent(this,utet_LevelChanged);
 		//printf("File: %s line: %d\n",extractFileFromDirectoryPath(__FILE__).c_str(),__LINE__);
@@ -4481,23 +4498,51 @@ void Unit::exploreCells(bool forceRefresh) {
 			throw megaglest_runtime_error("game->getWorld() == NULL");
 		}
 
+		World *world = game->getWorld();
+		bool countVisibility = world->isFowVisibilityCounted();
+
 		// Try the local unit exploration cache
 		if( !forceRefresh &&
 			cacheExploredCellsKey.first == newPos &&
 			cacheExploredCellsKey.second == sightRange) {
-			game->getWorld()->exploreCells(teamIndex, cacheExploredCells);
+			// Nothing changed, explored cells stay explored and our
+			// visible cells are still counted for the team
+			if(countVisibility == true && visibleCellsCountedTeam == teamIndex) {
+				return;
+			}
+			world->exploreCells(teamIndex, cacheExploredCells);
 		}
 		else {
 			// Try the world exploration scan or possible cache
-			cacheExploredCells = game->getWorld()->exploreCells(newPos, sightRange, teamIndex, this);
+			cacheExploredCells = world->exploreCells(newPos, sightRange, teamIndex, this);
 
 			// Cache the result for this unit
 			cacheExploredCellsKey.first = newPos;
 			cacheExploredCellsKey.second = sightRange;
 		}
+
+		if(countVisibility == true) {
+			world->updateVisibleCellCounts(visibleCellsCountedTeam, visibleCellsCounted,
+										   teamIndex, cacheExploredCells.visibleSpanList);
+			visibleCellsCounted = cacheExploredCells.visibleSpanList;
+			visibleCellsCountedTeam = teamIndex;
+		}
+	}
+	else if(visibleCellsCountedTeam >= 0 && game != NULL && game->getWorld() != NULL) {
+		// Dead or not yet built units do not see anything
+		game->getWorld()->updateVisibleCellCounts(visibleCellsCountedTeam, visibleCellsCounted,
+												  -1, std::vector<SurfaceCellSpan>());
+		clearVisibleCellCounts();
 	}
 }
 
+// Forgets the counted footprint without touching the counts, used when the
+// world rebuilds all visibility counts
+void Unit::clearVisibleCellCounts() {
+	visibleCellsCounted.clear();
+	visibleCellsCountedTeam = -1;
+}
+
 void Unit::logSynchData(string file,int line,string source) {
 	logSynchDataCommon(file,line,source,false);
 }
@@ -4717,8 +4762,8 @@ void Unit::clearCaches() {
 	cachedFow.surfPosAlphaList.clear();
 	cachedFowPos = Vec2i(0,0);
 
-	cacheExploredCells.exploredCellList.clear();
-	cacheExploredCells.visibleCellList.clear();
+	cacheExploredCells.exploredSpanList.clear();
+	cacheExploredCells.visibleSpanList.clear();
 	cacheExploredCellsKey.first = Vec2i(-1,-1);
 	cacheExploredCellsKey.second = -1;
 
@@ -5378,6 +5423,7 @@ Unit * Unit::loadGame(const XmlNode *rootNode, GameSettings *settings, Faction *
 
 //	TotalUpgrade totalUpgrade;
 	result->totalUpgrade.loadGame(unitNode);
+	result->totalUpgradeCRCValid = false;
 //	Map *map;
 //
 //	UnitPathInterface *unitPath;
@@ -5672,240 +5718,111 @@ Checksum Unit::getCRC() {
 
 	Checksum crcForUnit;
 
-	crcForUnit.addInt(id);
-	crcForUnit.addInt(hp);
-	crcForUnit.addInt(ep);
-	crcForUnit.addInt(loadCount);
-	crcForUnit.addInt(deadCount);
+	// Everything that changes from frame to frame is hashed as one block in
+	// common byte order, the names are only hashed again when the type,
+	// level or skill pointers change.
+	int32 unitState[] = {
+		id, hp, ep, loadCount, deadCount,
+		(int32)progress, (int32)(progress >> 32),
+		(int32)lastAnimProgress, (int32)(lastAnimProgress >> 32),
+		(int32)animProgress, (int32)(animProgress >> 32),
+		progress2, kills, enemyKills, morphFieldsBlocked,
+		currField, targetField,
+		pos.x, pos.y, lastPos.x, lastPos.y, targetPos.x, targetPos.y,
+		meetingPos.x, meetingPos.y,
+		toBeUndertaken, alive,
+		(fire != NULL ? fire->getActive() : -1),
+		(int32)damageParticleSystems.size(),
+		modelFacing,
+		inBailOutAttempt,
+		(int32)badHarvestPosList.size(),
+		(int32)lastStuckFrame, lastStuckPos.x, lastStuckPos.y,
+		(int32)currentAttackBoostOriginatorEffect.currentAttackBoostUnits.size(),
+		currentPathFinderDesiredFinalPos.x, currentPathFinderDesiredFinalPos.y,
+		random.getLastNumber(),
+		lastHarvestedResourcePos.x, lastHarvestedResourcePos.y,
+		(int32)attackParticleSystems.size(),
+		(int32)commands.size()
+	};
+	const size_t unitStateCount = sizeof(unitState) / sizeof(unitState[0]);
+	::Shared::PlatformByteOrder::toEndianTypeArray<int32>(unitState, unitStateCount);
+	crcForUnit.addBytes(unitState,sizeof(unitState));
 
 	if(consoleDebug) printf("#1 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
 
-	crcForUnit.addInt64(progress);
-	crcForUnit.addInt64(lastAnimProgress);
-	crcForUnit.addInt64(animProgress);
-
-	if(consoleDebug) printf("#2 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//float highlight;
-	crcForUnit.addInt(progress2);
-	crcForUnit.addInt(kills);
-	crcForUnit.addInt(enemyKills);
-	crcForUnit.addInt(morphFieldsBlocked);
-
-	if(consoleDebug) printf("#3 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//UnitReference targetRef;
-
-	crcForUnit.addInt(currField);
-	crcForUnit.addInt(targetField);
-
-	if(consoleDebug) printf("#4 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
 	//const Level *level;
 	if(level != NULL) {
-		crcForUnit.addString(level->getName(false));
+		if(levelNameCRC.isCurrent(level) == false) {
+			levelNameCRC.set(level,level->getName(false));
+		}
+		crcForUnit.addUInt(levelNameCRC.getSum());
 	}
-
-	if(consoleDebug) printf("#5 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	crcForUnit.addInt(pos.x);
-	crcForUnit.addInt(pos.y);
-	crcForUnit.addInt(lastPos.x);
-	crcForUnit.addInt(lastPos.y);
-	crcForUnit.addInt(targetPos.x);
-	crcForUnit.addInt(targetPos.y);
-
-	if(consoleDebug) printf("#6 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//Vec3f targetVec;
-
-	crcForUnit.addInt(meetingPos.x);
-	crcForUnit.addInt(meetingPos.y);
-
-	if(consoleDebug) printf("#7 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//float lastRotation;
-	//float targetRotation;
-	//float rotation;
-	//float targetRotationZ;
-	//float targetRotationX;
-	//float rotationZ;
-	//float rotationX;
-
 	//const UnitType *preMorph_type;
 	if(preMorph_type != NULL) {
-		crcForUnit.addString(preMorph_type->getName(false));
+		if(preMorphTypeNameCRC.isCurrent(preMorph_type) == false) {
+			preMorphTypeNameCRC.set(preMorph_type,preMorph_type->getName(false));
+		}
+		crcForUnit.addUInt(preMorphTypeNameCRC.getSum());
 	}
-
-	if(consoleDebug) printf("#8 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-    //const UnitType *type;
+	//const UnitType *type;
 	if(type != NULL) {
-		crcForUnit.addString(type->getName(false));
+		if(typeNameCRC.isCurrent(type) == false) {
+			typeNameCRC.set(type,type->getName(false));
+		}
+		crcForUnit.addUInt(typeNameCRC.getSum());
 	}
-
-    //const ResourceType *loadType;
+	//const ResourceType *loadType;
 	if(loadType != NULL) {
-		crcForUnit.addString(loadType->getName(false));
+		if(loadTypeNameCRC.isCurrent(loadType) == false) {
+			loadTypeNameCRC.set(loadType,loadType->getName(false));
+		}
+		crcForUnit.addUInt(loadTypeNameCRC.getSum());
 	}
-
-    //const SkillType *currSkill;
+	//const SkillType *currSkill;
 	if(currSkill != NULL) {
-		crcForUnit.addString(currSkill->getName());
+		if(currSkillNameCRC.isCurrent(currSkill) == false) {
+			currSkillNameCRC.set(currSkill,currSkill->getName());
+		}
+		crcForUnit.addUInt(currSkillNameCRC.getSum());
 	}
 
-	//printf("#9 Unit: %d CRC: %u lastModelIndexForCurrSkillType: %d\n",id,crcForUnit.getSum(),lastModelIndexForCurrSkillType);
-	//printf("#9a Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-	//crcForUnit.addInt(lastModelIndexForCurrSkillType);
-
-	if(consoleDebug) printf("#9 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//crcForUnit.addInt(animationRandomCycleCount);
-	//printf("#9b Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	crcForUnit.addInt(toBeUndertaken);
-
-	if(consoleDebug) printf("#9c Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	crcForUnit.addInt(alive);
-	//bool showUnitParticles;
-
-	if(consoleDebug) printf("#10 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-    //Faction *faction;
-	//ParticleSystem *fire;
-	if(fire != NULL) {
-		crcForUnit.addInt(fire->getActive());
-	}
+	if(consoleDebug) printf("#2 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
 
 	//TotalUpgrade totalUpgrade;
-	uint32 crc = totalUpgrade.getCRC().getSum();
-	crcForUnit.addBytes(&crc,sizeof(uint32));
+	if(totalUpgradeCRCValid == false) {
+		totalUpgradeCRC = totalUpgrade.getCRC().getSum();
+		totalUpgradeCRCValid = true;
+	}
+	crcForUnit.addUInt(totalUpgradeCRC);
 
-	//Map *map;
 	//UnitPathInterface *unitPath;
 	if(unitPath != NULL) {
-		uint32 crc = unitPath->getCRC().getSum();
-		crcForUnit.addBytes(&crc,sizeof(uint32));
+		crcForUnit.addUInt(unitPath->getCRC().getSum());
 	}
-	//WaypointPath waypointPath;
 
-	if(consoleDebug) printf("#11 Unit: %d CRC: %u commands.size(): " MG_SIZE_T_SPECIFIER "\n",id,crcForUnit.getSum(),commands.size());
+	if(consoleDebug) printf("#3 Unit: %d CRC: %u commands.size(): " MG_SIZE_T_SPECIFIER "\n",id,crcForUnit.getSum(),commands.size());
 
     //Commands commands;
-	if(commands.empty() == false) {
-		crcForUnit.addInt((int)commands.size());
-		for(Commands::const_iterator it= commands.begin(); it != commands.end(); ++it) {
-			uint32 crc = (*it)->getCRC().getSum();
-			crcForUnit.addBytes(&crc,sizeof(uint32));
-		}
+	for(Commands::const_iterator it= commands.begin(); it != commands.end(); ++it) {
+		crcForUnit.addUInt((*it)->getCRC().getSum());
 	}
 
-	//printf("#11 Unit: %d CRC: %u observers.size(): %ld\n",id,crcForUnit.getSum(),observers.size());
-
-	//Observers observers;
-	//crcForUnit.addInt64((int64)observers.size());
-
-	if(consoleDebug) printf("#11 Unit: %d CRC: %u damageParticleSystems.size(): " MG_SIZE_T_SPECIFIER "\n",id,crcForUnit.getSum(),damageParticleSystems.size());
-
-	//vector<UnitParticleSystem*> unitParticleSystems;
-	//vector<UnitParticleSystemType*> queuedUnitParticleSystemTypes;
-
-	//UnitParticleSystems damageParticleSystems;
-	crcForUnit.addInt((int)damageParticleSystems.size());
-
-	if(consoleDebug) printf("#12 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//std::map<int, UnitParticleSystem *> damageParticleSystemsInUse;
-
-	//vector<ParticleSystem*> fireParticleSystems;
-	//vector<UnitParticleSystem*> smokeParticleSystems;
-
-	//CardinalDir modelFacing;
-	crcForUnit.addInt(modelFacing);
-
-	//std::string lastSynchDataString;
-	//std::string lastFile;
-	//int lastLine;
-	//std::string lastSource;
-	//int lastRenderFrame;
-	//bool visible;
-
-	//int retryCurrCommandCount;
-
-	//Vec3f screenPos;
-	//string currentUnitTitle;
-
-	if(consoleDebug) printf("#13 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	crcForUnit.addInt(inBailOutAttempt);
-
-	crcForUnit.addInt((int)badHarvestPosList.size());
-	//crcForUnit.addInt(lastHarvestResourceTarget.first());
-
-	if(consoleDebug) printf("#14 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//static Game *game;
-	//bool ignoreCheckCommand;
-
-	//uint32 lastStuckFrame;
-	crcForUnit.addUInt(lastStuckFrame);
-	//Vec2i lastStuckPos;
-	crcForUnit.addInt(lastStuckPos.x);
-	crcForUnit.addInt(lastStuckPos.y);
-
-	//uint32 lastPathfindFailedFrame;
-	//Vec2i lastPathfindFailedPos;
-	//bool usePathfinderExtendedMaxNodes;
-	//int maxQueuedCommandDisplayCount;
-
-	//UnitAttackBoostEffectOriginator currentAttackBoostOriginatorEffect;
-	crcForUnit.addInt((int)currentAttackBoostOriginatorEffect.currentAttackBoostUnits.size());
-
-	if(consoleDebug) printf("#15 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//std::vector<UnitAttackBoostEffect *> currentAttackBoostEffects;
-
-	//Mutex *mutexCommands;
-
-	//bool changedActiveCommand;
-
-	//int lastAttackerUnitId;
-	//int lastAttackedUnitId;
-	//CauseOfDeathType causeOfDeath;
-
-	//uint32 pathfindFailedConsecutiveFrameCount;
-	crcForUnit.addString(this->currentPathFinderDesiredFinalPos.getString());
+	if(consoleDebug) printf("#4 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
 
-	crcForUnit.addInt(random.getLastNumber());
+	// debug details, these are only filled in while synch logging is enabled
 	if(this->random.getLastCaller() != "") {
 		crcForUnit.addString(this->random.getLastCaller());
 	}
-
-	if(consoleDebug) printf("#16 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
-	//int pathFindRefreshCellCount;
-
-	//FowAlphaCellsLookupItem cachedFow;
-	//Vec2i cachedFowPos;
-
-	crcForUnit.addInt(lastHarvestedResourcePos.x);
-	crcForUnit.addInt(lastHarvestedResourcePos.y);
-
-	if(consoleDebug) printf("#17 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
-
 	if(this->getParticleInfo() != "") {
 		crcForUnit.addString(this->getParticleInfo());
 	}
 
-	crcForUnit.addInt((int)attackParticleSystems.size());
 	if(isNetworkCRCEnabled() == true) {
 		for(unsigned int index = 0; index < attackParticleSystems.size(); ++index) {
 			ParticleSystem *ps = attackParticleSystems[index];
 			if(ps != NULL &&
 					Renderer::getInstance().validateParticleSystemStillExists(ps,rsGame) == true) {
-				uint32 crc = ps->getCRC().getSum();
-				crcForUnit.addBytes(&crc,sizeof(uint32));
+				crcForUnit.addUInt(ps->getCRC().getSum());
 			}
 		}
 	}
@@ -5914,6 +5831,8 @@ Checksum Unit::getCRC() {
 		crcForUnit.addString(this->networkCRCParticleLogInfo);
 	}
 
+	if(consoleDebug) printf("#5 Unit: %d CRC: %u\n",id,crcForUnit.getSum());
+
 	return crcForUnit;
 }
 
@@ -332,6 +332,34 @@ public:
 	virtual void loadGame(const XmlNode *rootNode, Unit *unit, World *world);
 };
 
+// =====================================================
+// 	class CachedNameCRC
+//
+///	CRC of the name of a type object, only recomputed when the object changes
+// =====================================================
+
+class CachedNameCRC {
+private:
+	const void *owner;
+	uint32 sum;
+
+public:
+	CachedNameCRC() {
+		owner = NULL;
+		sum = 0;
+	}
+
+	inline bool isCurrent(const void *owner) const	{ return this->owner == owner; }
+	inline uint32 getSum() const					{ return sum; }
+
+	void set(const void *owner, const string &name) {
+		Checksum crc;
+		crc.addString(name);
+		this->owner = owner;
+		this->sum = crc.getSum();
+	}
+};
+
 class Unit : public BaseColorPickEntity, ValueCheckerVault, public ParticleOwner {
 private:
     typedef list<Command*> Commands;
@@ -491,10 +519,23 @@ private:
 	ExploredCellsLookupItem cacheExploredCells;
 	std::pair<Vec2i, int> cacheExploredCellsKey;
 
+	// sight footprint this unit currently adds to its team's visibility counts
+	std::vector<SurfaceCellSpan> visibleCellsCounted;
+	int visibleCellsCountedTeam;
+
 	Vec2i lastHarvestedResourcePos;
 
 	string networkCRCLogInfo;
 	string networkCRCParticleLogInfo;
+
+	// parts of getCRC that rarely change, refreshed when they do
+	CachedNameCRC levelNameCRC;
+	CachedNameCRC preMorphTypeNameCRC;
+	CachedNameCRC typeNameCRC;
+	CachedNameCRC loadTypeNameCRC;
+	CachedNameCRC currSkillNameCRC;
+	uint32 totalUpgradeCRC;
+	bool totalUpgradeCRCValid;
 	vector<string> networkCRCDecHpList;
 	vector<string> networkCRCParticleInfoList;
 
@@ -713,6 +754,7 @@ public:
 	void setCurrentUnitTitle(string value) { currentUnitTitle = value;}
 
 	void exploreCells(bool forceRefresh=false);
+	void clearVisibleCellCounts();
 
 	inline bool getInBailOutAttempt() const { return inBailOutAttempt; }
 	inline void setInBailOutAttempt(bool value) { inBailOutAttempt = value; }
@@ -20,13 +20,157 @@
 #include "platform_util.h"
 #include "game_util.h"
 #include "conversion.h"
+#include "base_thread.h"
 #include "leak_dumper.h"
 
 using namespace Shared::Util;
 using namespace Shared::Xml;
+using namespace Shared::PlatformCommon;
 
 namespace Glest{ namespace Game{
 
+// ======================================================
+//          Class FactionXmlPreloader
+// ======================================================
+
+// Parses the unit and upgrade XML files of a faction on worker threads
+// before the types are loaded one by one on the main thread. Only parsing
+// runs in parallel, checksums and everything else stay with the loaders so
+// the result is identical. A file that fails to parse is left to its loader
+// which then reports the error as before.
+class FactionXmlPreloader {
+public:
+	static const int maxWorkerThreads;
+
+private:
+	class Job {
+	public:
+		Job() {
+			tagReplacementValues = NULL;
+			xmlTree = NULL;
+		}
+		string path;
+		const std::map<string,string> *tagReplacementValues;
+		XmlTree *xmlTree;
+	};
+
+	class WorkerThread : public BaseThread {
+	private:
+		FactionXmlPreloader *preloader;
+
+	public:
+		WorkerThread(FactionXmlPreloader *preloader) {
+			this->preloader = preloader;
+			setUniqueID(string(__FILE__) + "_WorkerThread");
+		}
+
+		virtual void execute() {
+			{
+				RunningStatusSafeWrapper runningStatus(this);
+				int jobIndex = 0;
+				while(getQuitStatus() == false && preloader->takeJob(jobIndex) == true) {
+					preloader->parseJob(jobIndex);
+				}
+			}
+			preloader->workerDone();
+		}
+	};
+
+	vector<Job> jobs;
+	Mutex mutex;
+	int nextJob;
+	int finishedWorkers;
+
+public:
+	FactionXmlPreloader() : mutex(CODE_AT_LINE) {
+		nextJob = 0;
+		finishedWorkers = 0;
+	}
+
+	~FactionXmlPreloader() {
+		for(unsigned int index = 0; index < jobs.size(); ++index) {
+			delete jobs[index].xmlTree;
+			jobs[index].xmlTree = NULL;
+		}
+	}
+
+	int add(const string &path, const std::map<string,string> *tagReplacementValues) {
+		Job job;
+		job.path = path;
+		job.tagReplacementValues = tagReplacementValues;
+		jobs.push_back(job);
+		return (int)jobs.size() - 1;
+	}
+
+	const XmlNode * getRootNode(int jobIndex) const {
+		if(jobIndex < 0 || jobIndex >= (int)jobs.size() || jobs[jobIndex].xmlTree == NULL) {
+			return NULL;
+		}
+		return jobs[jobIndex].xmlTree->getRootNode();
+	}
+
+	void run() {
+		int workerCount = min((int)jobs.size(), maxWorkerThreads);
+		if(workerCount < 2) {
+			return;
+		}
+
+		vector<WorkerThread *> workers;
+		for(int index = 0; index < workerCount; ++index) {
+			WorkerThread *worker = new WorkerThread(this);
+			workers.push_back(worker);
+			worker->start();
+		}
+
+		// keep the window responsive while the workers parse
+		for(;;) {
+			MutexSafeWrapper safeMutex(&mutex,CODE_AT_LINE);
+			bool done = (finishedWorkers >= workerCount);
+			safeMutex.ReleaseLock();
+			if(done == true) {
+				break;
+			}
+			SDL_PumpEvents();
+			sleep(1);
+		}
+
+		for(unsigned int index = 0; index < workers.size(); ++index) {
+			delete workers[index];
+		}
+	}
+
+private:
+	bool takeJob(int &jobIndex) {
+		MutexSafeWrapper safeMutex(&mutex,CODE_AT_LINE);
+		if(nextJob >= (int)jobs.size()) {
+			return false;
+		}
+		jobIndex = nextJob++;
+		return true;
+	}
+
+	void parseJob(int jobIndex) {
+		Job &job = jobs[jobIndex];
+		XmlTree *xmlTree = new XmlTree();
+		try {
+			xmlTree->load(job.path, *job.tagReplacementValues, false, true, true);
+		}
+		catch(const exception &ex) {
+			if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] preload of [%s] failed [%s]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,job.path.c_str(),ex.what());
+			delete xmlTree;
+			xmlTree = NULL;
+		}
+		job.xmlTree = xmlTree;
+	}
+
+	void workerDone() {
+		MutexSafeWrapper safeMutex(&mutex,CODE_AT_LINE);
+		finishedWorkers++;
+	}
+};
+
+const int FactionXmlPreloader::maxWorkerThreads = 4;
+
 // ======================================================
 //          Class FactionType
 // ======================================================
@@ -168,6 +312,29 @@ void FactionType::load(const string &factionName, const TechTree *techTree, Chec
 			SDL_PumpEvents();
 		}
 
+		// a3) parse the unit and upgrade xml files in parallel, using the
+		// same tag replacements the loaders below would use
+		std::map<string,string> mapUnitTagReplacementValues;
+		mapUnitTagReplacementValues["$COMMONDATAPATH"] = techTreePath + "/commondata/";
+		std::map<string,string> unitTagReplacementValues = Properties::getTagReplacementValues(&mapUnitTagReplacementValues);
+
+		std::map<string,string> mapUpgradeTagReplacementValues;
+		mapUpgradeTagReplacementValues["$COMMONDATAPATH"] = techTree->getPath() + "/commondata/";
+		std::map<string,string> upgradeTagReplacementValues = Properties::getTagReplacementValues(&mapUpgradeTagReplacementValues);
+
+		FactionXmlPreloader xmlPreloader;
+		vector<int> unitXmlJobs;
+		for(int i = 0; i < (int)unitTypes.size(); ++i) {
+			string unitPath = currentPath + "units/" + unitTypes[i].getName() + "/" + unitTypes[i].getName() + ".xml";
+			unitXmlJobs.push_back(xmlPreloader.add(unitPath, &unitTagReplacementValues));
+		}
+		vector<int> upgradeXmlJobs;
+		for(int i = 0; i < (int)upgradeTypes.size(); ++i) {
+			string upgradePath = currentPath + "upgrades/" + upgradeTypes[i].getName() + "/" + upgradeTypes[i].getName() + ".xml";
+			upgradeXmlJobs.push_back(xmlPreloader.add(upgradePath, &upgradeTagReplacementValues));
+		}
+		xmlPreloader.run();
+
 		// b1) load units
 		try {
 			Logger &logger= Logger::getInstance();
@@ -177,7 +344,7 @@ void FactionType::load(const string &factionName, const TechTree *techTree, Chec
 
 				try {
 					unitTypes[i].loaddd(i, str, techTree,techTreePath, this, checksum,techtreeChecksum,
-						loadedFileList,validationMode);
+						loadedFileList,validationMode,xmlPreloader.getRootNode(unitXmlJobs[i]));
 					logger.setProgress(progressBaseValue+(int)((((double)i + 1.0) / (double)unitTypes.size()) * 100.0/techTree->getTypeCount()));
 					SDL_PumpEvents();
 				}
@@ -207,7 +374,8 @@ void FactionType::load(const string &factionName, const TechTree *techTree, Chec
 
 				try {
 					upgradeTypes[i].load(str, techTree, this, checksum,
-							techtreeChecksum,loadedFileList,validationMode);
+							techtreeChecksum,loadedFileList,validationMode,
+							xmlPreloader.getRootNode(upgradeXmlJobs[i]));
 				}
 				catch(megaglest_runtime_error& ex) {
 					if(validationMode == false) {
@@ -184,7 +184,7 @@ void UnitType::loaddd(int id,const string &dir, const TechTree *techTree,
 		const string &techTreePath, const FactionType *factionType,
 		Checksum* checksum, Checksum* techtreeChecksum,
 		std::map<string,vector<pair<string, string> > > &loadedFileList,
-		bool validationMode) {
+		bool validationMode, const XmlNode *preloadedUnitNode) {
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
@@ -207,13 +207,15 @@ void UnitType::loaddd(int id,const string &dir, const TechTree *techTree,
 		techtreeChecksum->addFile(path);
 
 		XmlTree xmlTree;
-		std::map<string,string> mapExtraTagReplacementValues;
-		mapExtraTagReplacementValues["$COMMONDATAPATH"] = techTreePath + "/commondata/";
-		xmlTree.load(path, Properties::getTagReplacementValues(&mapExtraTagReplacementValues));
+		const XmlNode *unitNode= preloadedUnitNode;
+		if(unitNode == NULL) {
+			std::map<string,string> mapExtraTagReplacementValues;
+			mapExtraTagReplacementValues["$COMMONDATAPATH"] = techTreePath + "/commondata/";
+			xmlTree.load(path, Properties::getTagReplacementValues(&mapExtraTagReplacementValues));
+			unitNode= xmlTree.getRootNode();
+		}
 		loadedFileList[path].push_back(make_pair(dir,dir));
 
-		const XmlNode *unitNode= xmlTree.getRootNode();
-
 		const XmlNode *parametersNode= unitNode->getChild("parameters");
 
 		if(parametersNode->hasChild("count-in-victory-conditions") == true) {
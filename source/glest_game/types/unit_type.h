@@ -248,7 +248,7 @@ public:
     		const FactionType *factionType, Checksum* checksum,
     		Checksum* techtreeChecksum,
     		std::map<string,vector<pair<string, string> > > &loadedFileList,
-    		bool validationMode=false);
+    		bool validationMode=false, const XmlNode *preloadedUnitNode=NULL);
 
     virtual string getName(bool translatedValue=false) const;
 
@@ -905,7 +905,7 @@ void UpgradeType::load(const string &dir, const TechTree *techTree,
 		const FactionType *factionType, Checksum* checksum,
 		Checksum* techtreeChecksum, std::map<string,
 		vector<pair<string, string> > > &loadedFileList,
-		bool validationMode) {
+		bool validationMode, const XmlNode *preloadedUpgradeNode) {
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 
 	char szBuf[8096]="";
@@ -922,11 +922,14 @@ void UpgradeType::load(const string &dir, const TechTree *techTree,
 		techtreeChecksum->addFile(path);
 
 		XmlTree xmlTree;
-		std::map<string,string> mapExtraTagReplacementValues;
-		mapExtraTagReplacementValues["$COMMONDATAPATH"] = techTree->getPath() + "/commondata/";
-		xmlTree.load(path, Properties::getTagReplacementValues(&mapExtraTagReplacementValues));
+		const XmlNode *upgradeNode= preloadedUpgradeNode;
+		if(upgradeNode == NULL) {
+			std::map<string,string> mapExtraTagReplacementValues;
+			mapExtraTagReplacementValues["$COMMONDATAPATH"] = techTree->getPath() + "/commondata/";
+			xmlTree.load(path, Properties::getTagReplacementValues(&mapExtraTagReplacementValues));
+			upgradeNode= xmlTree.getRootNode();
+		}
 		loadedFileList[path].push_back(make_pair(currentPath,currentPath));
-		const XmlNode *upgradeNode= xmlTree.getRootNode();
 
 		//image
 		image = NULL; // Not used for upgrade types
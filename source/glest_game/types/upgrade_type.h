@@ -312,12 +312,14 @@ public:
 	 * as the `techtreeChecksum`).
 	 * @param techtreeChecksum Cumulative checksum for the techtree. The path of loaded upgrades
 	 * is added to this checksum.
+	 * @param preloadedUpgradeNode Root node of the upgrade XML when it was already parsed,
+	 * otherwise NULL and the file is loaded here.
 	 */
     void load(const string &dir, const TechTree *techTree,
     		const FactionType *factionType, Checksum* checksum,
     		Checksum* techtreeChecksum,
     		std::map<string,vector<pair<string, string> > > &loadedFileList,
-    		bool validationMode=false);
+    		bool validationMode=false, const XmlNode *preloadedUpgradeNode=NULL);
 	
 	/**
 	 * Obtains the upgrade name.
@@ -13,6 +13,7 @@
 #include "map.h"
 
 #include <cassert>
+#include <algorithm>
 
 #include "tileset.h"
 #include "unit.h"
@@ -119,6 +120,274 @@ void Cell::loadGame(const XmlNode *rootNode, int index, World *world) {
 	}
 }
 
+// =====================================================
+// 	class VisibilityPlanes
+// =====================================================
+
+VisibilityPlanes::VisibilityPlanes() {
+	surfaceW = 0;
+	surfaceH = 0;
+	wordsPerRow = 0;
+}
+
+void VisibilityPlanes::init(int surfaceW, int surfaceH) {
+	this->surfaceW = surfaceW;
+	this->surfaceH = surfaceH;
+	this->wordsPerRow = (surfaceW + 63) / 64;
+
+	for(int teamIndex = 0; teamIndex < teamCount; ++teamIndex) {
+		visible[teamIndex].assign(wordsPerRow * surfaceH, 0);
+		explored[teamIndex].assign(wordsPerRow * surfaceH, 0);
+		visibleCount[teamIndex].assign(wordsPerRow * 64 * surfaceH, 0);
+	}
+}
+
+void VisibilityPlanes::setVisible(int teamIndex, int bitIndex, bool value) {
+	uint64 mask = (uint64)1 << (bitIndex & 63);
+	if(value == true) {
+		visible[teamIndex][bitIndex >> 6] |= mask;
+	}
+	else {
+		visible[teamIndex][bitIndex >> 6] &= ~mask;
+	}
+}
+
+void VisibilityPlanes::setExplored(int teamIndex, int bitIndex, bool value) {
+	uint64 mask = (uint64)1 << (bitIndex & 63);
+	if(value == true) {
+		explored[teamIndex][bitIndex >> 6] |= mask;
+	}
+	else {
+		explored[teamIndex][bitIndex >> 6] &= ~mask;
+	}
+}
+
+void VisibilityPlanes::setSpan(std::vector<uint64> &plane, int rowOffset, int x1, int x2) {
+	int word1 = x1 >> 6;
+	int word2 = x2 >> 6;
+	uint64 mask1 = ~(uint64)0 << (x1 & 63);
+	uint64 mask2 = ~(uint64)0 >> (63 - (x2 & 63));
+
+	if(word1 == word2) {
+		plane[rowOffset + word1] |= (mask1 & mask2);
+		return;
+	}
+	plane[rowOffset + word1] |= mask1;
+	for(int word = word1 + 1; word < word2; ++word) {
+		plane[rowOffset + word] = ~(uint64)0;
+	}
+	plane[rowOffset + word2] |= mask2;
+}
+
+void VisibilityPlanes::setVisibleSpan(int teamIndex, int sy, int x1, int x2) {
+	setSpan(visible[teamIndex], sy * wordsPerRow, x1, x2);
+}
+
+void VisibilityPlanes::setExploredSpan(int teamIndex, int sy, int x1, int x2) {
+	setSpan(explored[teamIndex], sy * wordsPerRow, x1, x2);
+}
+
+void VisibilityPlanes::resetVisible(int teamIndex) {
+	std::fill(visible[teamIndex].begin(), visible[teamIndex].end(), 0);
+	std::fill(visibleCount[teamIndex].begin(), visibleCount[teamIndex].end(), 0);
+}
+
+void VisibilityPlanes::addVisibleSpan(int teamIndex, int sy, int x1, int x2) {
+	std::vector<uint64> &plane = visible[teamIndex];
+	uint16 *counts = &visibleCount[teamIndex][0];
+	for(int bitIndex = getBitIndex(x1, sy); bitIndex <= getBitIndex(x2, sy); ++bitIndex) {
+		if(counts[bitIndex]++ == 0) {
+			plane[bitIndex >> 6] |= (uint64)1 << (bitIndex & 63);
+		}
+	}
+}
+
+void VisibilityPlanes::removeVisibleSpan(int teamIndex, int sy, int x1, int x2) {
+	std::vector<uint64> &plane = visible[teamIndex];
+	uint16 *counts = &visibleCount[teamIndex][0];
+	for(int bitIndex = getBitIndex(x1, sy); bitIndex <= getBitIndex(x2, sy); ++bitIndex) {
+		if(counts[bitIndex] > 0 && --counts[bitIndex] == 0) {
+			plane[bitIndex >> 6] &= ~((uint64)1 << (bitIndex & 63));
+		}
+	}
+}
+
+// =====================================================
+// 	class UnitGrid
+// =====================================================
+
+const int UnitGrid::bucketSize = 8;
+
+UnitGrid::UnitGrid() {
+	w = 0;
+	h = 0;
+	bucketW = 0;
+	bucketH = 0;
+}
+
+void UnitGrid::init(int w, int h) {
+	this->w = w;
+	this->h = h;
+	this->bucketW = (w + bucketSize - 1) / bucketSize;
+	this->bucketH = (h + bucketSize - 1) / bucketSize;
+
+	entries.clear();
+	freeEntries.clear();
+	entryByUnitId.clear();
+	for(int teamIndex = 0; teamIndex < teamCount; ++teamIndex) {
+		buckets[teamIndex].clear();
+		buckets[teamIndex].resize(bucketW * bucketH);
+	}
+}
+
+void UnitGrid::link(int entryIndex) {
+	const Entry &entry = entries[entryIndex];
+	std::vector<std::vector<int> > &teamBuckets = buckets[entry.teamIndex];
+	for(int by = entry.topLeft.y / bucketSize; by <= entry.bottomRight.y / bucketSize; ++by) {
+		for(int bx = entry.topLeft.x / bucketSize; bx <= entry.bottomRight.x / bucketSize; ++bx) {
+			teamBuckets[by * bucketW + bx].push_back(entryIndex);
+		}
+	}
+}
+
+void UnitGrid::unlink(int entryIndex) {
+	const Entry &entry = entries[entryIndex];
+	std::vector<std::vector<int> > &teamBuckets = buckets[entry.teamIndex];
+	for(int by = entry.topLeft.y / bucketSize; by <= entry.bottomRight.y / bucketSize; ++by) {
+		for(int bx = entry.topLeft.x / bucketSize; bx <= entry.bottomRight.x / bucketSize; ++bx) {
+			std::vector<int> &bucket = teamBuckets[by * bucketW + bx];
+			for(unsigned int index = 0; index < bucket.size(); ++index) {
+				if(bucket[index] == entryIndex) {
+					bucket[index] = bucket.back();
+					bucket.pop_back();
+					break;
+				}
+			}
+		}
+	}
+}
+
+void UnitGrid::add(Unit *unit, int teamIndex, const Vec2i &topLeft, const Vec2i &bottomRight) {
+	if(teamIndex < 0 || teamIndex >= teamCount) {
+		throw megaglest_runtime_error("Invalid unit grid team index: " + intToStr(teamIndex));
+	}
+	if(topLeft.x < 0 || topLeft.y < 0 || bottomRight.x >= w || bottomRight.y >= h) {
+		throw megaglest_runtime_error("Unit cells outside of unit grid: " + topLeft.getString() + " " + bottomRight.getString());
+	}
+
+	std::map<int,int>::iterator iterFind = entryByUnitId.find(unit->getId());
+	if(iterFind != entryByUnitId.end()) {
+		Entry &entry = entries[iterFind->second];
+		if(entry.teamIndex == teamIndex &&
+			entry.topLeft.x <= topLeft.x && entry.topLeft.y <= topLeft.y &&
+			entry.bottomRight.x >= bottomRight.x && entry.bottomRight.y >= bottomRight.y) {
+			return;
+		}
+
+		unlink(iterFind->second);
+		entry.teamIndex = teamIndex;
+		entry.topLeft = Vec2i(std::min(entry.topLeft.x, topLeft.x), std::min(entry.topLeft.y, topLeft.y));
+		entry.bottomRight = Vec2i(std::max(entry.bottomRight.x, bottomRight.x), std::max(entry.bottomRight.y, bottomRight.y));
+		link(iterFind->second);
+		return;
+	}
+
+	int entryIndex = 0;
+	if(freeEntries.empty() == false) {
+		entryIndex = freeEntries.back();
+		freeEntries.pop_back();
+	}
+	else {
+		entryIndex = (int)entries.size();
+		entries.push_back(Entry());
+	}
+
+	Entry &entry = entries[entryIndex];
+	entry.unit = unit;
+	entry.unitId = unit->getId();
+	entry.teamIndex = teamIndex;
+	entry.topLeft = topLeft;
+	entry.bottomRight = bottomRight;
+	entryByUnitId[entry.unitId] = entryIndex;
+	link(entryIndex);
+}
+
+void UnitGrid::remove(int unitId) {
+	std::map<int,int>::iterator iterFind = entryByUnitId.find(unitId);
+	if(iterFind == entryByUnitId.end()) {
+		return;
+	}
+	int entryIndex = iterFind->second;
+	unlink(entryIndex);
+	entries[entryIndex] = Entry();
+	freeEntries.push_back(entryIndex);
+	entryByUnitId.erase(iterFind);
+}
+
+void UnitGrid::changeTeam(int unitId, int teamIndex) {
+	if(teamIndex < 0 || teamIndex >= teamCount) {
+		throw megaglest_runtime_error("Invalid unit grid team index: " + intToStr(teamIndex));
+	}
+	std::map<int,int>::iterator iterFind = entryByUnitId.find(unitId);
+	if(iterFind == entryByUnitId.end() || entries[iterFind->second].teamIndex == teamIndex) {
+		return;
+	}
+	unlink(iterFind->second);
+	entries[iterFind->second].teamIndex = teamIndex;
+	link(iterFind->second);
+}
+
+const UnitGrid::Entry *UnitGrid::findEntry(int unitId) const {
+	std::map<int,int>::const_iterator iterFind = entryByUnitId.find(unitId);
+	if(iterFind == entryByUnitId.end()) {
+		return NULL;
+	}
+	return &entries[iterFind->second];
+}
+
+static bool compareUnitGridEntryById(const UnitGrid::Entry *entry1, const UnitGrid::Entry *entry2) {
+	return entry1->unitId < entry2->unitId;
+}
+
+void UnitGrid::findEntries(int teamIndex, const Vec2i &topLeft, const Vec2i &bottomRight,
+		std::vector<const Entry *> &result) const {
+	if(teamIndex < 0 || teamIndex >= teamCount || buckets[teamIndex].empty() == true) {
+		return;
+	}
+	int minX = std::max(topLeft.x, 0);
+	int minY = std::max(topLeft.y, 0);
+	int maxX = std::min(bottomRight.x, w - 1);
+	int maxY = std::min(bottomRight.y, h - 1);
+	if(minX > maxX || minY > maxY) {
+		return;
+	}
+
+	size_t firstResult = result.size();
+	const std::vector<std::vector<int> > &teamBuckets = buckets[teamIndex];
+	int minBucketX = minX / bucketSize;
+	int minBucketY = minY / bucketSize;
+	for(int by = minBucketY; by <= maxY / bucketSize; ++by) {
+		for(int bx = minBucketX; bx <= maxX / bucketSize; ++bx) {
+			const std::vector<int> &bucket = teamBuckets[by * bucketW + bx];
+			for(unsigned int index = 0; index < bucket.size(); ++index) {
+				const Entry &entry = entries[bucket[index]];
+				if(entry.topLeft.x > maxX || entry.bottomRight.x < minX ||
+					entry.topLeft.y > maxY || entry.bottomRight.y < minY) {
+					continue;
+				}
+				// units spanning several buckets are only reported from the
+				// first bucket they share with the query
+				if(std::max(entry.topLeft.x / bucketSize, minBucketX) != bx ||
+					std::max(entry.topLeft.y / bucketSize, minBucketY) != by) {
+					continue;
+				}
+				result.push_back(&entry);
+			}
+		}
+	}
+	std::sort(result.begin() + firstResult, result.end(), compareUnitGridEntryById);
+}
+
 // =====================================================
 // 	class SurfaceCell
 // =====================================================
@@ -131,11 +400,8 @@ SurfaceCell::SurfaceCell() {
 	surfaceTexture= NULL;
 	nearSubmerged = false;
 	cellChangedFromOriginalMapLoad = false;
-
-	for(int index = 0; index < GameConstants::maxPlayers + GameConstants::specialFactions; ++index) {
-		setVisible(index,false);
-		setExplored(index,false);
-	}
+	visibilityPlanes = NULL;
+	visibilityIndex = 0;
 }
 
 SurfaceCell::~SurfaceCell() {
@@ -177,7 +443,9 @@ void SurfaceCell::setExplored(int teamIndex, bool explored) {
 		throw megaglest_runtime_error(szBuf);
 	}
 
-	this->explored[teamIndex]= explored;
+	if(visibilityPlanes != NULL) {
+		visibilityPlanes->setExplored(teamIndex, visibilityIndex, explored);
+	}
 	//printf("Setting explored to %d for teamIndex %d\n",explored,teamIndex);
 }
 
@@ -189,7 +457,9 @@ void SurfaceCell::setVisible(int teamIndex, bool visible) {
 		throw megaglest_runtime_error(szBuf);
 	}
 
-    this->visible[teamIndex]= visible;
+	if(visibilityPlanes != NULL) {
+		visibilityPlanes->setVisible(teamIndex, visibilityIndex, visible);
+	}
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynch).enabled == true &&
 			SystemFlags::getSystemSettingType(SystemFlags::debugWorldSynchMax).enabled == true) {
@@ -216,17 +486,22 @@ void SurfaceCell::setVisible(int teamIndex, bool visible) {
 
 }
 
+void SurfaceCell::setVisibilityPlanes(VisibilityPlanes *planes, int bitIndex) {
+	this->visibilityPlanes = planes;
+	this->visibilityIndex = bitIndex;
+}
+
 string SurfaceCell::isVisibleString() const	{
 	string result = "isVisibleList = ";
 	for(int index = 0; index < GameConstants::maxPlayers + GameConstants::specialFactions; ++index) {
-		result += string(visible[index] ? "true" : "false");
+		result += string(isVisible(index) ? "true" : "false");
 	}
 	return result;
 }
 string SurfaceCell::isExploredString() const {
 	string result = "isExploredList = ";
 	for(int index = 0; index < GameConstants::maxPlayers + GameConstants::specialFactions; ++index) {
-		result += string(explored[index] ? "true" : "false");
+		result += string(isExplored(index) ? "true" : "false");
 	}
 	return result;
 }
@@ -337,6 +612,7 @@ void SurfaceCell::loadGame(const XmlNode *rootNode, int index, World *world) {
 
 const int Map::cellScale= 2;
 const int Map::mapScale= 2;
+const int Map::pathClusterSize= 16;
 
 Map::Map() {
 	cells= NULL;
@@ -355,6 +631,9 @@ Map::Map() {
 	surfaceSize=(surfaceW * surfaceH);
 	maxPlayers=0;
 	maxMapHeight=0;
+	pathClusterW=0;
+	pathClusterH=0;
+	pathClusterGeneration=0;
 }
 
 Map::~Map() {
@@ -440,6 +719,12 @@ Checksum Map::load(const string &path, TechTree *techTree, Tileset *tileset) {
 
 			w= surfaceW*cellScale;
 			h= surfaceH*cellScale;
+
+			pathClusterW= (w + pathClusterSize - 1) / pathClusterSize;
+			pathClusterH= (h + pathClusterSize - 1) / pathClusterSize;
+			pathClusterStamps.assign(pathClusterW * pathClusterH, 0);
+			pathClusterGeneration++;
+			unitGrid.init(w, h);
 			cliffLevel = 0;
 			cameraHeight = 0;
 			if(header.version==1){
@@ -483,6 +768,13 @@ Checksum Map::load(const string &path, TechTree *techTree, Tileset *tileset) {
 			cells= new Cell[getCellArraySize()];
 			surfaceCells= new SurfaceCell[getSurfaceCellArraySize()];
 
+			visibilityPlanes.init(surfaceW, surfaceH);
+			for(int j = 0; j < surfaceH; ++j) {
+				for(int i = 0; i < surfaceW; ++i) {
+					surfaceCells[j * surfaceW + i].setVisibilityPlanes(&visibilityPlanes, visibilityPlanes.getBitIndex(i, j));
+				}
+			}
+
 			//read heightmap
 			for(int j = 0; j < surfaceH; ++j) {
 				for(int i = 0; i < surfaceW; ++i) {
@@ -932,25 +1224,42 @@ bool Map::canMorph(const Vec2i &pos,const Unit *currentUnit,const UnitType *targ
 
 // ==================== unit placement ====================
 
+// packs the arguments of canMove / aproxCanMove into a MoveLookupCache key,
+// returns false if they do not fit (the lookup should then bypass the cache)
+bool Map::getMoveLookupKey(const Vec2i &pos1, const Vec2i &pos2, int teamIndex, int size, Field field, bool aprox, uint64 &key) {
+	const int posLimit = 1 << 12;
+	if(pos1.x < 0 || pos1.x >= posLimit || pos1.y < 0 || pos1.y >= posLimit ||
+	   pos2.x < 0 || pos2.x >= posLimit || pos2.y < 0 || pos2.y >= posLimit ||
+	   teamIndex < 0 || teamIndex >= (1 << 4) || size < 0 || size >= (1 << 6) ||
+	   field < 0 || field >= (1 << 2)) {
+		return false;
+	}
+
+	key = (uint64)pos1.x;
+	key = (key << 12) | (uint64)pos1.y;
+	key = (key << 12) | (uint64)pos2.x;
+	key = (key << 12) | (uint64)pos2.y;
+	key = (key << 4) | (uint64)teamIndex;
+	key = (key << 6) | (uint64)size;
+	key = (key << 2) | (uint64)field;
+	key = (key << 1) | (aprox == true ? 1 : 0);
+	return true;
+}
+
 //checks if a unit can move from between 2 cells
-bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field,bool> > > > *lookupCache) const {
+bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, MoveLookupCache *lookupCache) const {
 	int size= unit->getType()->getSize();
 	Field field= unit->getCurrField();
 
+	uint64 cacheKey = 0;
+	if(lookupCache != NULL && getMoveLookupKey(pos1, pos2, 0, size, field, false, cacheKey) == false) {
+		lookupCache = NULL;
+	}
 	if(lookupCache != NULL) {
-		std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field,bool> > > >::const_iterator iterFind1 = lookupCache->find(pos1);
-		if(iterFind1 != lookupCache->end()) {
-			std::map<Vec2i, std::map<int, std::map<Field,bool> > >::const_iterator iterFind2 = iterFind1->second.find(pos2);
-			if(iterFind2 != iterFind1->second.end()) {
-				std::map<int, std::map<Field,bool> >::const_iterator iterFind3 = iterFind2->second.find(size);
-				if(iterFind3 != iterFind2->second.end()) {
-					std::map<Field,bool>::const_iterator iterFind4 = iterFind3->second.find(field);
-					if(iterFind4 != iterFind3->second.end()) {
-						// Found this result in the cache
-						return iterFind4->second;
-					}
-				}
-			}
+		bool cachedResult = false;
+		if(lookupCache->find(cacheKey, cachedResult) == true) {
+			// Found this result in the cache
+			return cachedResult;
 		}
 	}
 
@@ -960,7 +1269,7 @@ bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::m
 				if(getCell(i, j)->getUnit(field) != unit) {
 					if(isFreeCell(Vec2i(i, j), field) == false) {
 						if(lookupCache != NULL) {
-							(*lookupCache)[pos1][pos2][size][field]=false;
+							lookupCache->insert(cacheKey,false);
 						}
 
 						return false;
@@ -969,7 +1278,7 @@ bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::m
 			}
 			else {
 				if(lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][size][field]=false;
+					lookupCache->insert(cacheKey,false);
 				}
 
 				return false;
@@ -990,21 +1299,21 @@ bool Map::canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::m
 
 	if(isBadHarvestPos == true) {
 		if(lookupCache != NULL) {
-			(*lookupCache)[pos1][pos2][size][field]=false;
+			lookupCache->insert(cacheKey,false);
 		}
 
 		return false;
 	}
 
 	if(lookupCache != NULL) {
-		(*lookupCache)[pos1][pos2][size][field]=true;
+		lookupCache->insert(cacheKey,true);
 	}
 
     return true;
 }
 
 //checks if a unit can move from between 2 cells using only visible cells (for pathfinding)
-bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field,bool> > > > > *lookupCache) const {
+bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, MoveLookupCache *lookupCache) const {
 	if(isInside(pos1) == false || isInsideSurface(toSurfCoords(pos1)) == false ||
 	   isInside(pos2) == false || isInsideSurface(toSurfCoords(pos2)) == false) {
 
@@ -1019,26 +1328,15 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 	int teamIndex= unit->getTeam();
 	Field field= unit->getCurrField();
 
+	uint64 cacheKey = 0;
+	if(lookupCache != NULL && getMoveLookupKey(pos1, pos2, teamIndex, size, field, true, cacheKey) == false) {
+		lookupCache = NULL;
+	}
 	if(lookupCache != NULL) {
-		std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field,bool> > > > >::const_iterator iterFind1 = lookupCache->find(pos1);
-		if(iterFind1 != lookupCache->end()) {
-			std::map<Vec2i, std::map<int, std::map<int, std::map<Field,bool> > > >::const_iterator iterFind2 = iterFind1->second.find(pos2);
-			if(iterFind2 != iterFind1->second.end()) {
-				std::map<int, std::map<int, std::map<Field,bool> > >::const_iterator iterFind3 = iterFind2->second.find(teamIndex);
-				if(iterFind3 != iterFind2->second.end()) {
-					std::map<int, std::map<Field,bool> >::const_iterator iterFind4 = iterFind3->second.find(size);
-					if(iterFind4 != iterFind3->second.end()) {
-						std::map<Field,bool>::const_iterator iterFind5 = iterFind4->second.find(field);
-						if(iterFind5 != iterFind4->second.end()) {
-							// Found this result in the cache
-							if(iterFind5->second == false) {
-								//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
-							}
-							return iterFind5->second;
-						}
-					}
-				}
-			}
+		bool cachedResult = false;
+		if(lookupCache->find(cacheKey, cachedResult) == true) {
+			// Found this result in the cache
+			return cachedResult;
 		}
 	}
 
@@ -1046,7 +1344,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 	if(size == 1) {
 		if(isAproxFreeCell(pos2, field, teamIndex) == false) {
 			if(lookupCache != NULL) {
-				(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
+				lookupCache->insert(cacheKey,false);
 			}
 
 			//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
@@ -1055,7 +1353,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 		if(pos1.x != pos2.x && pos1.y != pos2.y) {
 			if(isAproxFreeCell(Vec2i(pos1.x, pos2.y), field, teamIndex) == false) {
 				if(lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
+					lookupCache->insert(cacheKey,false);
 				}
 
 				//Unit *cellUnit = getCell(Vec2i(pos1.x, pos2.y))->getUnit(field);
@@ -1067,7 +1365,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 			}
 			if(isAproxFreeCell(Vec2i(pos2.x, pos1.y), field, teamIndex) == false) {
 				if(lookupCache != NULL) {
-					(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
+					lookupCache->insert(cacheKey,false);
 				}
 
 				//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
@@ -1088,7 +1386,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 
 		if(unit == NULL || isBadHarvestPos == true) {
 			if(lookupCache != NULL) {
-				(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
+				lookupCache->insert(cacheKey,false);
 			}
 
 			//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
@@ -1096,7 +1394,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 		}
 
 		if(lookupCache != NULL) {
-			(*lookupCache)[pos1][pos2][teamIndex][size][field]=true;
+			lookupCache->insert(cacheKey,true);
 		}
 
 		return true;
@@ -1111,7 +1409,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 					if(getCell(cellPos)->getUnit(unit->getCurrField()) != unit) {
 						if(isAproxFreeCell(cellPos, field, teamIndex) == false) {
 							if(lookupCache != NULL) {
-								(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
+								lookupCache->insert(cacheKey,false);
 							}
 
 							//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
@@ -1122,7 +1420,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 				else {
 
 					if(lookupCache != NULL) {
-						(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
+						lookupCache->insert(cacheKey,false);
 					}
 
 					//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
@@ -1142,7 +1440,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 
 		if(isBadHarvestPos == true) {
 			if(lookupCache != NULL) {
-				(*lookupCache)[pos1][pos2][teamIndex][size][field]=false;
+				lookupCache->insert(cacheKey,false);
 			}
 
 			//printf("[%s] Line: %d returning false\n",__FUNCTION__,__LINE__);
@@ -1150,7 +1448,7 @@ bool Map::aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, s
 		}
 
 		if(lookupCache != NULL) {
-			(*lookupCache)[pos1][pos2][teamIndex][size][field]=true;
+			lookupCache->insert(cacheKey,true);
 		}
 	}
 	return true;
@@ -1375,6 +1673,7 @@ void Map::putUnitCellsPrivate(Unit *unit, const Vec2i &pos, const UnitType *ut,
 	}
 
     bool canPutInCell = true;
+	bool occupiedCell = false;
 	Field field=ut->getField();
 	for(int i = 0; i < ut->getSize(); ++i) {
 		for(int j = 0; j < ut->getSize(); ++j) {
@@ -1424,9 +1723,11 @@ void Map::putUnitCellsPrivate(Unit *unit, const Vec2i &pos, const UnitType *ut,
 						// unit is beeing morphed to another unit with maybe other field.
 						getCell(currPos)->setUnit(field, unit);
 						canPutInCell = false;
+						occupiedCell = true;
 					}
 					if(canPutInCell == true) {
 						getCell(currPos)->setUnit(unit->getCurrField(), unit);
+						occupiedCell = true;
 					}
 				}
 				else if(canPutInCell == true) {
@@ -1447,9 +1748,15 @@ void Map::putUnitCellsPrivate(Unit *unit, const Vec2i &pos, const UnitType *ut,
 			}
 		}
 	}
+	if(occupiedCell == true) {
+		unitGrid.add(unit, unit->getTeam(), pos, pos + Vec2i(ut->getSize() - 1));
+	}
 	if(canPutInCell == true) {
         unit->setPos(pos, false, threaded);
 	}
+	if(ut->isMobile() == false) {
+		invalidatePathClusters(pos, ut->getSize());
+	}
 }
 
 //removes a unit from cells
@@ -1515,6 +1822,92 @@ void Map::clearUnitCells(Unit *unit, const Vec2i &pos, bool ignoreSkill) {
 			}
 		}
 	}
+	updateUnitGrid(unit);
+	if(ut->isMobile() == false) {
+		invalidatePathClusters(pos, ut->getSize());
+	}
+}
+
+//drops the unit from the unit grid once no cell it was put into holds it
+void Map::updateUnitGrid(const Unit *unit) {
+	const UnitGrid::Entry *entry = unitGrid.findEntry(unit->getId());
+	if(entry == NULL) {
+		return;
+	}
+	for(int i = entry->topLeft.x; i <= entry->bottomRight.x; ++i) {
+		for(int j = entry->topLeft.y; j <= entry->bottomRight.y; ++j) {
+			const Cell *cell = getCell(i, j);
+			for(int field = 0; field < fieldCount; ++field) {
+				if(cell->getUnit(field) == unit) {
+					return;
+				}
+			}
+		}
+	}
+	unitGrid.remove(unit->getId());
+}
+
+void Map::removeUnitFromGrid(const Unit *unit) {
+	unitGrid.remove(unit->getId());
+}
+
+//moves the units of a faction that switched teams to their new team
+void Map::updateUnitGridTeam(const Faction *faction) {
+	for(int index = 0; index < faction->getUnitCount(); ++index) {
+		unitGrid.changeTeam(faction->getUnit(index)->getId(), faction->getTeam());
+	}
+}
+
+void Map::findUnitCells(int teamIndex, const Vec2i &topLeft, const Vec2i &bottomRight,
+		std::vector<UnitCellHit> &result) const {
+	std::vector<const UnitGrid::Entry *> entries;
+	unitGrid.findEntries(teamIndex, topLeft, bottomRight, entries);
+	for(unsigned int index = 0; index < entries.size(); ++index) {
+		const UnitGrid::Entry *entry = entries[index];
+		int minX = std::max(topLeft.x, entry->topLeft.x);
+		int minY = std::max(topLeft.y, entry->topLeft.y);
+		int maxX = std::min(bottomRight.x, entry->bottomRight.x);
+		int maxY = std::min(bottomRight.y, entry->bottomRight.y);
+		for(int i = minX; i <= maxX; ++i) {
+			for(int j = minY; j <= maxY; ++j) {
+				const Cell *cell = getCell(i, j);
+				for(int field = 0; field < fieldCount; ++field) {
+					if(cell->getUnit(field) == entry->unit) {
+						result.push_back(UnitCellHit(Vec2i(i, j), field, entry->unit));
+					}
+				}
+			}
+		}
+	}
+}
+
+string Map::getUnitGridStats() const {
+	char szBuf[8096]="";
+	snprintf(szBuf,8096,"units [%d] buckets [%d] bucket size [%d]",unitGrid.getUnitCount(),unitGrid.getBucketCount(),UnitGrid::bucketSize);
+	return szBuf;
+}
+
+//marks the pathfinder clusters covering the area as changed
+void Map::invalidatePathClusters(const Vec2i &pos, int size) {
+	if(pathClusterStamps.empty() == true) {
+		return;
+	}
+	int minX = std::max(pos.x, 0) / pathClusterSize;
+	int minY = std::max(pos.y, 0) / pathClusterSize;
+	int maxX = std::min(pos.x + size - 1, w - 1) / pathClusterSize;
+	int maxY = std::min(pos.y + size - 1, h - 1) / pathClusterSize;
+	for(int clusterY = minY; clusterY <= maxY; ++clusterY) {
+		for(int clusterX = minX; clusterX <= maxX; ++clusterX) {
+			pathClusterStamps[clusterY * pathClusterW + clusterX]++;
+		}
+	}
+	pathClusterGeneration++;
+}
+
+//removes the object / resource of a surface cell, it no longer blocks paths
+void Map::deleteResource(const Vec2i &surfacePos) {
+	getSurfaceCell(surfacePos)->deleteResource();
+	invalidatePathClusters(toUnitCoords(surfacePos), cellScale);
 }
 
 // ==================== misc ====================
@@ -1897,6 +2290,8 @@ void Map::loadGame(const XmlNode *rootNode, World *world) {
 		SurfaceCell &surfaceCell = surfaceCells[i];
 		surfaceCell.loadGame(mapNode,i,world);
 	}
+	// saved games may have removed objects the clusters were built with
+	invalidatePathClusters(Vec2i(0,0), std::max(w,h));
 
 	int surfaceCellIndexExplored = 0;
 	int surfaceCellIndexVisible = 0;
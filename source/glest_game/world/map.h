@@ -25,9 +25,11 @@
 #include "game_constants.h"
 #include "selection.h"
 #include <cassert>
+#include <map>
 #include "unit_type.h"
 #include "command.h"
 #include "checksum.h"
+#include "lookup_cache.h"
 #include "leak_dumper.h"
 
 
@@ -40,9 +42,11 @@ using Shared::Graphics::Vec4f;
 using Shared::Graphics::Vec2f;
 using Shared::Graphics::Vec2i;
 using Shared::Graphics::Texture2D;
+using Shared::Util::LookupCache;
 
 class Tileset;
 class Unit;
+class Faction;
 class Resource;
 class TechTree;
 class GameSettings;
@@ -106,6 +110,132 @@ public:
 	void loadGame(const XmlNode *rootNode, int index, World *world);
 };
 
+// =====================================================
+// 	class VisibilityPlanes
+//
+///	Visible and explored flags of every surface cell, one bit plane per
+///	team. Planes are row major and each row is padded to whole 64 bit words
+///	so resets and row stamps work on a word at a time.
+///	With fog of war the visible bit is driven by a per cell count of the
+///	units that see the cell, so only units that moved need to be re-stamped.
+// =====================================================
+
+class VisibilityPlanes {
+public:
+	static const int teamCount = GameConstants::maxPlayers + GameConstants::specialFactions;
+
+private:
+	int surfaceW;
+	int surfaceH;
+	int wordsPerRow;
+	std::vector<uint64> visible[teamCount];
+	std::vector<uint64> explored[teamCount];
+	std::vector<uint16> visibleCount[teamCount];
+
+	static void setSpan(std::vector<uint64> &plane, int rowOffset, int x1, int x2);
+
+public:
+	VisibilityPlanes();
+	void init(int surfaceW, int surfaceH);
+
+	inline int getBitIndex(int sx, int sy) const {
+		return sy * wordsPerRow * 64 + sx;
+	}
+	inline bool isVisible(int teamIndex, int bitIndex) const {
+		return ((visible[teamIndex][bitIndex >> 6] >> (bitIndex & 63)) & 1) != 0;
+	}
+	inline bool isExplored(int teamIndex, int bitIndex) const {
+		return ((explored[teamIndex][bitIndex >> 6] >> (bitIndex & 63)) & 1) != 0;
+	}
+	void setVisible(int teamIndex, int bitIndex, bool value);
+	void setExplored(int teamIndex, int bitIndex, bool value);
+
+	// sets cells x1..x2 (inclusive) of surface row sy
+	void setVisibleSpan(int teamIndex, int sy, int x1, int x2);
+	void setExploredSpan(int teamIndex, int sy, int x1, int x2);
+	void resetVisible(int teamIndex);
+
+	// counted visibility, a cell stays visible while its count is above 0
+	void addVisibleSpan(int teamIndex, int sy, int x1, int x2);
+	void removeVisibleSpan(int teamIndex, int sy, int x1, int x2);
+};
+
+// =====================================================
+// 	class UnitGrid
+//
+///	Spatial index of the units placed on the map. The map is split into
+///	square buckets of bucketSize cells and each team keeps a compact list
+///	of entry indices per bucket, so range queries only visit units that
+///	are close by instead of every cell in range.
+///	A unit is registered with the rectangle of cells it was put into and
+///	stays registered until none of those cells hold it anymore, see
+///	Map::putUnitCells and Map::clearUnitCells.
+// =====================================================
+
+class UnitGrid {
+public:
+	static const int teamCount = VisibilityPlanes::teamCount;
+	static const int bucketSize;
+
+	class Entry {
+	public:
+		Entry() {
+			unit = NULL;
+			unitId = -1;
+			teamIndex = -1;
+		}
+		Unit *unit;
+		int unitId;
+		int teamIndex;
+		Vec2i topLeft;
+		Vec2i bottomRight;
+	};
+
+private:
+	int w;
+	int h;
+	int bucketW;
+	int bucketH;
+	std::vector<Entry> entries;
+	std::vector<int> freeEntries;
+	std::map<int,int> entryByUnitId;
+	std::vector<std::vector<int> > buckets[teamCount];
+
+	void link(int entryIndex);
+	void unlink(int entryIndex);
+
+public:
+	UnitGrid();
+	void init(int w, int h);
+
+	// registers the cells of the unit, growing the rectangle if it is already known
+	void add(Unit *unit, int teamIndex, const Vec2i &topLeft, const Vec2i &bottomRight);
+	void remove(int unitId);
+	void changeTeam(int unitId, int teamIndex);
+	const Entry *findEntry(int unitId) const;
+
+	// entries of the team overlapping the cell rectangle (inclusive) sorted
+	// by unit id, the pointers stay valid until the next add()
+	void findEntries(int teamIndex, const Vec2i &topLeft, const Vec2i &bottomRight,
+			std::vector<const Entry *> &result) const;
+
+	inline int getUnitCount() const		{ return (int)entryByUnitId.size(); }
+	inline int getBucketCount() const	{ return bucketW * bucketH; }
+};
+
+// A cell and field of the map holding a unit, see Map::findUnitCells
+class UnitCellHit {
+public:
+	UnitCellHit(const Vec2i &pos, int field, Unit *unit) {
+		this->pos = pos;
+		this->field = field;
+		this->unit = unit;
+	}
+	Vec2i pos;
+	int field;
+	Unit *unit;
+};
+
 // =====================================================
 // 	class SurfaceCell
 //
@@ -130,9 +260,9 @@ private:
 	//object & resource
 	Object *object;
 
-	//visibility
-	bool visible[GameConstants::maxPlayers + GameConstants::specialFactions];
-    bool explored[GameConstants::maxPlayers + GameConstants::specialFactions];
+	//visibility, stored in the bit planes of the owning map
+	VisibilityPlanes *visibilityPlanes;
+	int visibilityIndex;
 
 	//cache
 	bool nearSubmerged;
@@ -156,8 +286,8 @@ public:
 	inline const Vec2f &getSurfTexCoord() const		{return surfTexCoord;}
 	inline bool getNearSubmerged() const				{return nearSubmerged;}
 
-	inline bool isVisible(int teamIndex) const		{return visible[teamIndex];}
-	inline bool isExplored(int teamIndex) const		{return explored[teamIndex];}
+	inline bool isVisible(int teamIndex) const		{return visibilityPlanes != NULL && visibilityPlanes->isVisible(teamIndex, visibilityIndex);}
+	inline bool isExplored(int teamIndex) const		{return visibilityPlanes != NULL && visibilityPlanes->isExplored(teamIndex, visibilityIndex);}
 	string isVisibleString() const;
 	string isExploredString() const;
 
@@ -173,6 +303,7 @@ public:
 	inline void setSurfTexCoord(const Vec2f &stc)		{this->surfTexCoord= stc;}
 	void setExplored(int teamIndex, bool explored);
     void setVisible(int teamIndex, bool visible);
+    void setVisibilityPlanes(VisibilityPlanes *planes, int bitIndex);
     inline void setNearSubmerged(bool nearSubmerged)	{this->nearSubmerged= nearSubmerged;}
 
 	//misc
@@ -199,19 +330,23 @@ public:
 ///	Represents the game map (and loads it from a gbm file)
 // =====================================================
 
+// Results of Map::canMove / Map::aproxCanMove keyed by Map::getMoveLookupKey()
+typedef LookupCache<bool> MoveLookupCache;
+
 class FastAINodeCache {
 public:
-	explicit FastAINodeCache(Unit *unit) {
+	explicit FastAINodeCache(Unit *unit) : cachedCanMoveSoonList(1024) {
 		this->unit = unit;
 	}
 	Unit *unit;
-	std::map<Vec2i,std::map<Vec2i,bool> > cachedCanMoveSoonList;
+	MoveLookupCache cachedCanMoveSoonList;
 };
 
 class Map {
 public:
 	static const int cellScale;	//number of cells per surfaceCell
 	static const int mapScale;	//horizontal scale of surface
+	static const int pathClusterSize;	//cells per side of a pathfinder cluster
 
 private:
 	string title;
@@ -233,6 +368,15 @@ private:
 	float maxMapHeight;
 	string mapFile;
 
+	//change stamps per pathfinder cluster, bumped when static obstacles change
+	int pathClusterW;
+	int pathClusterH;
+	std::vector<uint32> pathClusterStamps;
+	uint32 pathClusterGeneration;
+
+	VisibilityPlanes visibilityPlanes;
+	UnitGrid unitGrid;
+
 private:
 	Map(Map&);
 	void operator=(Map&);
@@ -292,6 +436,9 @@ public:
 	inline SurfaceCell *getSurfaceCell(const Vec2i &sPos) const {
 		return getSurfaceCell(sPos.x, sPos.y);
 	}
+	inline VisibilityPlanes *getVisibilityPlanes() {
+		return &visibilityPlanes;
+	}
 
 	inline int getW() const											{return w;}
 	inline int getH() const											{return h;}
@@ -335,11 +482,30 @@ public:
 	//bool canOccupy(const Vec2i &pos, Field field, const UnitType *ut, CardinalDir facing);
 
 	//unit placement
-	bool aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<int, std::map<Field,bool> > > > > *lookupCache=NULL) const;
-	bool canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2,std::map<Vec2i, std::map<Vec2i, std::map<int, std::map<Field,bool> > > > *lookupCache=NULL) const;
+	bool aproxCanMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, MoveLookupCache *lookupCache=NULL) const;
+	bool canMove(const Unit *unit, const Vec2i &pos1, const Vec2i &pos2, MoveLookupCache *lookupCache=NULL) const;
+	static bool getMoveLookupKey(const Vec2i &pos1, const Vec2i &pos2, int teamIndex, int size, Field field, bool aprox, uint64 &key);
     void putUnitCells(Unit *unit, const Vec2i &pos,bool ignoreSkill = false, bool threaded = false);
 	void clearUnitCells(Unit *unit, const Vec2i &pos,bool ignoreSkill = false);
 
+	//unit grid queries, appends every cell and field of the rectangle
+	//(inclusive) holding a unit of the team
+	void findUnitCells(int teamIndex, const Vec2i &topLeft, const Vec2i &bottomRight,
+			std::vector<UnitCellHit> &result) const;
+	void removeUnitFromGrid(const Unit *unit);
+	void updateUnitGridTeam(const Faction *faction);
+	string getUnitGridStats() const;
+
+	void invalidatePathClusters(const Vec2i &pos, int size);
+	void deleteResource(const Vec2i &surfacePos);
+	inline uint32 getPathClusterGeneration() const { return pathClusterGeneration; }
+	inline uint32 getPathClusterStamp(int clusterIndex) const {
+		if(clusterIndex < 0 || clusterIndex >= (int)pathClusterStamps.size()) {
+			return 0;
+		}
+		return pathClusterStamps[clusterIndex];
+	}
+
 	Vec2i computeRefPos(const Selection *selection) const;
 	Vec2i computeDestPos(	const Vec2i &refUnitPos, const Vec2i &unitPos,
 							const Vec2i &commandPos) const;
@@ -625,6 +791,7 @@ private:
 	void computeNearSubmerged();
 	void computeCellColors();
     void putUnitCellsPrivate(Unit *unit, const Vec2i &pos, const UnitType *ut, bool isMorph, bool threaded);
+    void updateUnitGrid(const Unit *unit);
 };
 
 
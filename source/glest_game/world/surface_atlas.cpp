@@ -13,6 +13,7 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <functional>
 
 #include "renderer.h"
 #include "util.h"
@@ -22,6 +23,7 @@
 using namespace std;
 using namespace Shared::Util;
 using namespace Shared::Graphics;
+using namespace Shared::PlatformCommon;
 
 namespace Glest{ namespace Game{
 
@@ -58,6 +60,42 @@ bool SurfaceInfo::operator==(const SurfaceInfo &si) const {
 		this->rightUp == si.getRightUp();
 }
 
+bool SurfaceInfo::operator<(const SurfaceInfo &si) const {
+	const Pixmap2D *pixmaps[]= { center, leftUp, rightUp, leftDown, rightDown };
+	const Pixmap2D *otherPixmaps[]= { si.getCenter(), si.getLeftUp(), si.getRightUp(), si.getLeftDown(), si.getRightDown() };
+
+	std::less<const Pixmap2D *> pixmapLess;
+	for(int i= 0; i < 5; ++i) {
+		if(pixmaps[i] != otherPixmaps[i]) {
+			return pixmapLess(pixmaps[i], otherPixmaps[i]);
+		}
+	}
+	return false;
+}
+
+// =====================================================
+//	class SplatJob
+// =====================================================
+
+class SplatJob : public Job {
+private:
+	Pixmap2D *pixmap;
+	const SurfaceInfo *surfaceInfo;
+	const SplatWeights *weights;
+
+public:
+	SplatJob(Pixmap2D *pixmap, const SurfaceInfo *surfaceInfo, const SplatWeights *weights) {
+		this->pixmap= pixmap;
+		this->surfaceInfo= surfaceInfo;
+		this->weights= weights;
+	}
+
+	virtual void run() {
+		pixmap->splat(surfaceInfo->getLeftUp(), surfaceInfo->getRightUp(),
+				surfaceInfo->getLeftDown(), surfaceInfo->getRightDown(), *weights);
+	}
+};
+
 // ===============================
 // 	class SurfaceAtlas
 // ===============================
@@ -83,8 +121,8 @@ void SurfaceAtlas::addSurface(SurfaceInfo *si) {
 	}
 
 	//add info
-	SurfaceInfos::iterator it = find(surfaceInfos.begin(), surfaceInfos.end(), *si);
-	if(it == surfaceInfos.end()) {
+	SurfaceInfoIndexes::iterator it = surfaceInfoIndexes.find(*si);
+	if(it == surfaceInfoIndexes.end()) {
 		//add new texture
 		Texture2D *t= Renderer::getInstance().newTexture2D(rsGame);
 		if(t) {
@@ -97,9 +135,10 @@ void SurfaceAtlas::addSurface(SurfaceInfo *si) {
 		
 		si->setCoord(Vec2f(0.f, 0.f));
 		si->setTexture(t);
+		surfaceInfoIndexes[*si]= (int)surfaceInfos.size();
 		surfaceInfos.push_back(*si);
 		
-		//copy texture to pixmap
+		//copy texture to pixmap, splats are generated in one batch later
 		if(si->getCenter() != NULL) {
 			if(t) {
 				t->getPixmap()->copy(si->getCenter());
@@ -107,13 +146,45 @@ void SurfaceAtlas::addSurface(SurfaceInfo *si) {
 		}
 		else {
 			if(t) {
-				t->getPixmap()->splat(si->getLeftUp(), si->getRightUp(), si->getLeftDown(), si->getRightDown());
+				pendingSplats.push_back(std::make_pair(t, (int)surfaceInfos.size() - 1));
 			}
 		}
 	}
 	else{
-		si->setCoord(it->getCoord());
-		si->setTexture(it->getTexture());
+		const SurfaceInfo &existing= surfaceInfos[it->second];
+		si->setCoord(existing.getCoord());
+		si->setTexture(existing.getTexture());
+	}
+}
+
+// Splats only depend on their four source pixmaps, so the whole batch runs
+// in parallel sharing one weight table for the surface size
+void SurfaceAtlas::buildPendingSplats(JobSystem *jobSystem) {
+	if(pendingSplats.empty() == true) {
+		return;
+	}
+
+	SplatWeights weights(surfaceSize, surfaceSize);
+
+	vector<SplatJob> jobs;
+	jobs.reserve(pendingSplats.size());
+	for(unsigned int i= 0; i < pendingSplats.size(); ++i) {
+		Texture2D *texture= pendingSplats[i].first;
+		jobs.push_back(SplatJob(texture->getPixmap(), &surfaceInfos[pendingSplats[i].second], &weights));
+	}
+	pendingSplats.clear();
+
+	vector<Job *> jobList;
+	for(unsigned int i= 0; i < jobs.size(); ++i) {
+		jobList.push_back(&jobs[i]);
+	}
+	if(jobSystem != NULL) {
+		jobSystem->run(jobList);
+	}
+	else {
+		for(unsigned int i= 0; i < jobList.size(); ++i) {
+			jobList[i]->run();
+		}
 	}
 }
 
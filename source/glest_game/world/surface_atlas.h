@@ -19,16 +19,20 @@
 
 #include <vector>
 #include <set>
+#include <map>
 #include "texture.h"
 #include "vec.h"
+#include "job_system.h"
 #include "leak_dumper.h"
 
 using std::vector;
 using std::set;
+using std::map;
 using Shared::Graphics::Pixmap2D;
 using Shared::Graphics::Texture2D;
 using Shared::Graphics::Vec2i;
 using Shared::Graphics::Vec2f;
+using Shared::PlatformCommon::JobSystem;
 
 namespace Glest{ namespace Game{
 
@@ -50,6 +54,7 @@ public:
 	explicit SurfaceInfo(const Pixmap2D *center);
 	SurfaceInfo(const Pixmap2D *lu, const Pixmap2D *ru, const Pixmap2D *ld, const Pixmap2D *rd);
 	bool operator==(const SurfaceInfo &si) const;
+	bool operator<(const SurfaceInfo &si) const;
 
 	inline const Pixmap2D *getCenter() const		{return center;}
 	inline const Pixmap2D *getLeftUp() const		{return leftUp;}
@@ -72,15 +77,20 @@ public:
 class SurfaceAtlas{
 private:
 	typedef vector<SurfaceInfo> SurfaceInfos;
+	typedef map<SurfaceInfo, int> SurfaceInfoIndexes;
 
 private:
 	SurfaceInfos surfaceInfos;
+	SurfaceInfoIndexes surfaceInfoIndexes;
+	// splatted surfaces whose texture pixmap is not generated yet
+	vector<std::pair<Texture2D *, int> > pendingSplats;
 	int surfaceSize;
 
 public:
 	SurfaceAtlas();
 
 	void addSurface(SurfaceInfo *si);
+	void buildPendingSplats(JobSystem *jobSystem);
 	float getCoordStep() const;
 
 private:
@@ -13,6 +13,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <set>
 
 #include "core_data.h"
 #include "config.h"
@@ -40,12 +41,41 @@ namespace Glest{ namespace Game{
 // 	class UnitUpdater
 // =====================================================
 
-time_t UnitRangeCellsLookupItem::lastDebug = 0;
+// The range queries used to scan every cell in range column by column and
+// the fields of each cell in order. The unit grid hits are sorted by the
+// same keys so the enemy lists, and the targets picked from them, keep
+// their order.
+static bool compareUnitCellHitByPos(const UnitCellHit &hit1, const UnitCellHit &hit2) {
+	if(hit1.pos.x != hit2.pos.x) {
+		return hit1.pos.x < hit2.pos.x;
+	}
+	if(hit1.pos.y != hit2.pos.y) {
+		return hit1.pos.y < hit2.pos.y;
+	}
+	return hit1.field < hit2.field;
+}
+
+static bool compareUnitCellHitByField(const UnitCellHit &hit1, const UnitCellHit &hit2) {
+	if(hit1.field != hit2.field) {
+		return hit1.field < hit2.field;
+	}
+	if(hit1.pos.x != hit2.pos.x) {
+		return hit1.pos.x < hit2.pos.x;
+	}
+	return hit1.pos.y < hit2.pos.y;
+}
+
+static inline bool isCellInRange(const Vec2f &floatCenter, const Vec2i &pos, int range) {
+#ifdef USE_STREFLOP
+	return streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float)pos.x, (float)pos.y)))) <= (range+1);
+#else
+	return floor(floatCenter.dist(Vec2f((float)pos.x, (float)pos.y))) <= (range+1);
+#endif
+}
 
 // ===================== PUBLIC ========================
 
-UnitUpdater::UnitUpdater() : mutexAttackWarnings(new Mutex(CODE_AT_LINE)),
-		mutexUnitRangeCellsLookupItemCache(new Mutex(CODE_AT_LINE)) {
+UnitUpdater::UnitUpdater() : mutexAttackWarnings(new Mutex(CODE_AT_LINE)) {
     this->game= NULL;
 	this->gui= NULL;
 	this->gameCamera= NULL;
@@ -54,7 +84,6 @@ UnitUpdater::UnitUpdater() : mutexAttackWarnings(new Mutex(CODE_AT_LINE)),
 	this->console= NULL;
 	this->scriptManager= NULL;
 	this->pathFinder = NULL;
-	//UnitRangeCellsLookupItemCacheTimerCount = 0;
 	attackWarnRange=0;
 }
 
@@ -69,7 +98,6 @@ void UnitUpdater::init(Game *game){
 	this->scriptManager= game->getScriptManager();
 	this->pathFinder = NULL;
 	attackWarnRange=Config::getInstance().getFloat("AttackWarnRange","50.0");
-	//UnitRangeCellsLookupItemCacheTimerCount = 0;
 
 	switch(this->game->getGameSettings()->getPathFinderType()) {
 		case pfBasic:
@@ -93,9 +121,13 @@ void UnitUpdater::removeUnitPrecache(Unit *unit) {
 	}
 }
 
-UnitUpdater::~UnitUpdater() {
-	//UnitRangeCellsLookupItemCache.clear();
+void UnitUpdater::preparePathFinderFrame() {
+	if(pathFinder != NULL) {
+		pathFinder->prepareFrame();
+	}
+}
 
+UnitUpdater::~UnitUpdater() {
 	delete pathFinder;
 	pathFinder = NULL;
 
@@ -110,9 +142,6 @@ UnitUpdater::~UnitUpdater() {
 
 	delete mutexAttackWarnings;
 	mutexAttackWarnings = NULL;
-
-	delete mutexUnitRangeCellsLookupItemCache;
-	mutexUnitRangeCellsLookupItemCache = NULL;
 }
 
 // ==================== progress skills ====================
@@ -305,7 +334,7 @@ bool UnitUpdater::updateUnit(Unit *unit) {
 
 			//play water sound
 			if(map->getCell(unit->getPos())->getHeight() < map->getWaterLevel() && unit->getCurrField() == fLand) {
-				if(Config::getInstance().getBool("DisableWaterSounds","false") == false) {
+				if(CachedConfig::disableWaterSounds.get() == false) {
 					soundRenderer.playFx(
 						CoreData::getInstance().getWaterSound(),
 						unit->getCurrMidHeightVector(),
@@ -1820,7 +1849,7 @@ void UnitUpdater::updateHarvest(Unit *unit, int frameIndex) {
 							//if resource exausted, then delete it and stop
 							if (sc->decAmount(1)) {
 								//const ResourceType *rt = r->getType();
-								sc->deleteResource();
+								map->deleteResource(Map::toSurfCoords(unitTargetPos));
 								world->removeResourceTargetFromCache(unitTargetPos);
 
 								switch(this->game->getGameSettings()->getPathFinderType()) {
@@ -2834,84 +2863,68 @@ bool UnitUpdater::attackableOnRange(Unit *unit, Unit **rangedPtr, const AttackSk
 	return unitOnRange(unit, range, rangedPtr, ast, evalMode);
 }
 
-bool UnitUpdater::findCachedCellsEnemies(Vec2i center, int range, int size, vector<Unit*> &enemies,
-										 const AttackSkillType *ast, const Unit *unit,
-										 const Unit *commandTarget) {
-	bool result = false;
-	MutexSafeWrapper safeMutex(mutexUnitRangeCellsLookupItemCache,string(__FILE__) + "_" + intToStr(__LINE__));
-	std::map<Vec2i, std::map<int, std::map<int, UnitRangeCellsLookupItem > > >::iterator iterFind = UnitRangeCellsLookupItemCache.find(center);
-
-	if(iterFind != UnitRangeCellsLookupItemCache.end()) {
-		std::map<int, std::map<int, UnitRangeCellsLookupItem > >::iterator iterFind3 = iterFind->second.find(size);
-		if(iterFind3 != iterFind->second.end()) {
-			std::map<int, UnitRangeCellsLookupItem>::iterator iterFind4 = iterFind3->second.find(range);
-			if(iterFind4 != iterFind3->second.end()) {
-				result = true;
-
-				std::vector<Cell *> &cellList = iterFind4->second.rangeCellList;
-				for(int idx = 0; idx < (int)cellList.size(); ++idx) {
-					Cell *cell = cellList[idx];
-
-					findEnemiesForCell(ast,cell,unit,commandTarget,enemies);
-				}
-			}
+//appends the living enemies of the unit (or its command target) standing on
+//cells in range
+void UnitUpdater::findEnemiesInRange(const Unit *unit, const Vec2i &center, int size, int range,
+									 const AttackSkillType *ast, const Unit *commandTarget,
+									 vector<Unit*> &enemies) const {
+	Vec2f floatCenter = unit->getFloatCenteredPos();
+	Vec2i topLeft = center - Vec2i(range);
+	Vec2i bottomRight = center + Vec2i(range + size - 1);
+
+	vector<UnitCellHit> hits;
+	for(int teamIndex = 0; teamIndex < UnitGrid::teamCount; ++teamIndex) {
+		// our own team only matters if it holds the command target
+		if(teamIndex == unit->getTeam() &&
+			(commandTarget == NULL || commandTarget->getTeam() != teamIndex)) {
+			continue;
 		}
+		map->findUnitCells(teamIndex, topLeft, bottomRight, hits);
 	}
+	std::sort(hits.begin(), hits.end(), compareUnitCellHitByPos);
 
-	return result;
-}
-
-void UnitUpdater::findEnemiesForCell(const AttackSkillType *ast, Cell *cell, const Unit *unit,
-									 const Unit *commandTarget,vector<Unit*> &enemies) {
-	//all fields
-	for(int k = 0; k < fieldCount; k++) {
-		Field f= static_cast<Field>(k);
-
-		//check field
-		if((ast == NULL || ast->getAttackField(f))) {
-			Unit *possibleEnemy = cell->getUnit(f);
+	for(unsigned int index = 0; index < hits.size(); ++index) {
+		const UnitCellHit &hit = hits[index];
+		//check range and field
+		if(isCellInRange(floatCenter, hit.pos, range) == false ||
+			(ast != NULL && ast->getAttackField(static_cast<Field>(hit.field)) == false)) {
+			continue;
+		}
 
-			//check enemy
-			if(possibleEnemy != NULL && possibleEnemy->isAlive()) {
-				if((unit->isAlly(possibleEnemy) == false && commandTarget == NULL) ||
-					commandTarget == possibleEnemy) {
+		//check enemy
+		Unit *possibleEnemy = hit.unit;
+		if(possibleEnemy->isAlive()) {
+			if((unit->isAlly(possibleEnemy) == false && commandTarget == NULL) ||
+				commandTarget == possibleEnemy) {
 
-					enemies.push_back(possibleEnemy);
-				}
+				enemies.push_back(possibleEnemy);
 			}
 		}
 	}
 }
 
 void UnitUpdater::findEnemiesForCell(const Vec2i pos, int size, int sightRange, const Faction *faction, vector<Unit*> &enemies, bool attackersOnly) const {
-	//all fields
-	for(int k = 0; k < fieldCount; k++) {
-		Field f= static_cast<Field>(k);
-
-		for(int i = pos.x - sightRange; i < pos.x + size + sightRange; ++i) {
-			for(int j = pos.y - sightRange; j < pos.y + size + sightRange; ++j) {
-				Vec2i testPos(i,j);
-				if( map->isInside(testPos) &&
-						map->isInsideSurface(map->toSurfCoords(testPos))) {
-					Cell *cell = map->getCell(testPos);
-					//check field
-					Unit *possibleEnemy = cell->getUnit(f);
-
-					//check enemy
-					if(possibleEnemy != NULL && possibleEnemy->isAlive()) {
-						if(faction->getTeam() != possibleEnemy->getTeam()) {
-							if(attackersOnly == true) {
-								if(possibleEnemy->getType()->hasCommandClass(ccAttack) || possibleEnemy->getType()->hasCommandClass(ccAttackStopped)) {
-									enemies.push_back(possibleEnemy);
-								}
-							}
-							else {
-								enemies.push_back(possibleEnemy);
-							}
-						}
-					}
+	vector<UnitCellHit> hits;
+	for(int teamIndex = 0; teamIndex < UnitGrid::teamCount; ++teamIndex) {
+		if(teamIndex != faction->getTeam()) {
+			map->findUnitCells(teamIndex, pos - Vec2i(sightRange), pos + Vec2i(size + sightRange - 1), hits);
+		}
+	}
+	std::sort(hits.begin(), hits.end(), compareUnitCellHitByField);
+
+	for(unsigned int index = 0; index < hits.size(); ++index) {
+		Unit *possibleEnemy = hits[index].unit;
+
+		//check enemy
+		if(possibleEnemy->isAlive()) {
+			if(attackersOnly == true) {
+				if(possibleEnemy->getType()->hasCommandClass(ccAttack) || possibleEnemy->getType()->hasCommandClass(ccAttackStopped)) {
+					enemies.push_back(possibleEnemy);
 				}
 			}
+			else {
+				enemies.push_back(possibleEnemy);
+			}
 		}
 	}
 }
@@ -2936,39 +2949,9 @@ bool UnitUpdater::unitOnRange(Unit *unit, int range, Unit **rangedPtr,
 	//aux vars
 	int size 			= unit->getType()->getSize();
 	Vec2i center 		= unit->getPos();
-	Vec2f floatCenter	= unit->getFloatCenteredPos();
 
-	//bool foundInCache = true;
-	if(findCachedCellsEnemies(center,range,size,enemies,ast,
-							  unit,commandTarget) == false) {
-
-		//foundInCache = false;
-		//nearby cells
-		UnitRangeCellsLookupItem cacheItem;
-		for(int i = center.x - range; i < center.x + range + size; ++i) {
-			for(int j = center.y - range; j < center.y + range + size; ++j) {
-				//cells inside map and in range
-#ifdef USE_STREFLOP
-				if(map->isInside(i, j) && streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float)i, (float)j)))) <= (range+1)){
-#else
-				if(map->isInside(i, j) && floor(floatCenter.dist(Vec2f((float)i, (float)j))) <= (range+1)){
-#endif
-					Cell *cell = map->getCell(i,j);
-					findEnemiesForCell(ast,cell,unit,commandTarget,enemies);
-
-					cacheItem.rangeCellList.push_back(cell);
-				}
-			}
-		}
-
-
-		// Ok update our caches with the latest info
-		if(cacheItem.rangeCellList.empty() == false) {
-			MutexSafeWrapper safeMutex(mutexUnitRangeCellsLookupItemCache,string(__FILE__) + "_" + intToStr(__LINE__));
-
-			UnitRangeCellsLookupItemCache[center][size][range] = cacheItem;
-		}
-	}
+	//nearby units
+	findEnemiesInRange(unit,center,size,range,ast,commandTarget,enemies);
 
 	//attack enemies that can attack first
 	float distToUnit= -1;
@@ -3218,38 +3201,9 @@ vector<Unit*> UnitUpdater::enemyUnitsOnRange(const Unit *unit,const AttackSkillT
 	//aux vars
 	int size 			= unit->getType()->getSize();
 	Vec2i center 		= unit->getPosNotThreadSafe();
-	Vec2f floatCenter	= unit->getFloatCenteredPos();
-
-	//bool foundInCache = true;
-	if(findCachedCellsEnemies(center,range,size,enemies,ast,
-							  unit,commandTarget) == false) {
 
-		//foundInCache = false;
-		//nearby cells
-		UnitRangeCellsLookupItem cacheItem;
-		for(int i = center.x - range; i < center.x + range + size; ++i) {
-			for(int j = center.y - range; j < center.y + range + size; ++j) {
-				//cells inside map and in range
-#ifdef USE_STREFLOP
-				if(map->isInside(i, j) && streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float)i, (float)j)))) <= (range+1)){
-#else
-				if(map->isInside(i, j) && floor(floatCenter.dist(Vec2f((float)i, (float)j))) <= (range+1)){
-#endif
-					Cell *cell = map->getCell(i,j);
-					findEnemiesForCell(ast,cell,unit,commandTarget,enemies);
-
-					cacheItem.rangeCellList.push_back(cell);
-				}
-			}
-		}
-
-		// Ok update our caches with the latest info
-		if(cacheItem.rangeCellList.empty() == false) {
-			MutexSafeWrapper safeMutex(mutexUnitRangeCellsLookupItemCache,string(__FILE__) + "_" + intToStr(__LINE__));
-
-			UnitRangeCellsLookupItemCache[center][size][range] = cacheItem;
-		}
-	}
+	//nearby units
+	findEnemiesInRange(unit,center,size,range,ast,commandTarget,enemies);
 
 	}
 	catch(const exception &ex) {
@@ -3271,36 +3225,6 @@ vector<Unit*> UnitUpdater::enemyUnitsOnRange(const Unit *unit,const AttackSkillT
 }
 
 
-void UnitUpdater::findUnitsForCell(Cell *cell, vector<Unit*> &units) {
-	//all fields
-	if(cell != NULL) {
-		for(int k = 0; k < fieldCount; k++) {
-			Field f= static_cast<Field>(k);
-
-			//check field
-			Unit *cellUnit = cell->getUnit(f);
-
-			if(cellUnit != NULL && cellUnit->isAlive()) {
-				// check if unit already is in list
-				bool found = false;
-				//printf("---- search for cellUnit=%d\n",cellUnit->getId());
-				for (unsigned int i = 0; i < units.size(); ++i) {
-					Unit *unitInList = units[i];
-					//printf("compare unitInList=%d cellUnit=%d\n",unitInList->getId(),cellUnit->getId());
-					if (unitInList->getId() == cellUnit->getId()){
-						found=true;
-						break;
-					}
-				}
-				if(found==false){
-					//printf(">>> adding cellUnit=%d\n",cellUnit->getId());
-					units.push_back(cellUnit);
-				}
-			}
-		}
-	}
-}
-
 vector<Unit*> UnitUpdater::findUnitsInRange(const Unit *unit, int radius) {
 	int range = radius;
 	vector<Unit*> units;
@@ -3310,58 +3234,24 @@ vector<Unit*> UnitUpdater::findUnitsInRange(const Unit *unit, int radius) {
 	Vec2i center 		= unit->getPosNotThreadSafe();
 	Vec2f floatCenter	= unit->getFloatCenteredPos();
 
-	//nearby cells
-	//UnitRangeCellsLookupItem cacheItem;
-	for(int i = center.x - range; i < center.x + range + size; ++i) {
-		for(int j = center.y - range; j < center.y + range + size; ++j) {
-			//cells inside map and in range
-#ifdef USE_STREFLOP
-			if(map->isInside(i, j) && streflop::floor(static_cast<streflop::Simple>(floatCenter.dist(Vec2f((float)i, (float)j)))) <= (range+1)){
-#else
-			if(map->isInside(i, j) && floor(floatCenter.dist(Vec2f((float)i, (float)j))) <= (range+1)){
-#endif
-				Cell *cell = map->getCell(i,j);
-				findUnitsForCell(cell,units);
-			}
-		}
+	//nearby units of all teams
+	vector<UnitCellHit> hits;
+	for(int teamIndex = 0; teamIndex < UnitGrid::teamCount; ++teamIndex) {
+		map->findUnitCells(teamIndex, center - Vec2i(range), center + Vec2i(range + size - 1), hits);
 	}
+	std::sort(hits.begin(), hits.end(), compareUnitCellHitByPos);
 
-	return units;
-}
-
-string UnitUpdater::getUnitRangeCellsLookupItemCacheStats() {
-	string result = "";
-
-	int posCount = 0;
-	int sizeCount = 0;
-	int rangeCount = 0;
-	int rangeCountCellCount = 0;
-
-	MutexSafeWrapper safeMutex(mutexUnitRangeCellsLookupItemCache,string(__FILE__) + "_" + intToStr(__LINE__));
-	for(std::map<Vec2i, std::map<int, std::map<int, UnitRangeCellsLookupItem > > >::iterator iterMap1 = UnitRangeCellsLookupItemCache.begin();
-		iterMap1 != UnitRangeCellsLookupItemCache.end(); ++iterMap1) {
-		posCount++;
-
-		for(std::map<int, std::map<int, UnitRangeCellsLookupItem > >::iterator iterMap2 = iterMap1->second.begin();
-			iterMap2 != iterMap1->second.end(); ++iterMap2) {
-			sizeCount++;
-
-			for(std::map<int, UnitRangeCellsLookupItem>::iterator iterMap3 = iterMap2->second.begin();
-				iterMap3 != iterMap2->second.end(); ++iterMap3) {
-				rangeCount++;
-
-				rangeCountCellCount += (int)iterMap3->second.rangeCellList.size();
-			}
+	std::set<int> foundUnitIds;
+	for(unsigned int index = 0; index < hits.size(); ++index) {
+		const UnitCellHit &hit = hits[index];
+		if(isCellInRange(floatCenter, hit.pos, range) == true &&
+			hit.unit->isAlive() == true &&
+			foundUnitIds.insert(hit.unit->getId()).second == true) {
+			units.push_back(hit.unit);
 		}
 	}
 
-	uint64 totalBytes = rangeCountCellCount * sizeof(Cell *);
-	totalBytes /= 1000;
-
-	char szBuf[8096]="";
-	snprintf(szBuf,8096,"pos [%d] size [%d] range [%d][%d] total KB: %s",posCount,sizeCount,rangeCount,rangeCountCellCount,formatNumber(totalBytes).c_str());
-	result = szBuf;
-	return result;
+	return units;
 }
 
 void UnitUpdater::saveGame(XmlNode *rootNode) {
@@ -44,15 +44,6 @@ class PathFinder;
 class ParticleDamager;
 class Cell;
 
-class UnitRangeCellsLookupItem {
-public:
-
-	//int UnitRangeCellsLookupItemCacheTimerCountIndex;
-	std::vector<Cell *> rangeCellList;
-
-	static time_t lastDebug;
-};
-
 class AttackWarningData {
 public:
 	Vec2f attackPosition;
@@ -84,17 +75,9 @@ private:
 	float attackWarnRange;
 	AttackWarnings attackWarnings;
 
-	Mutex *mutexUnitRangeCellsLookupItemCache;
-	std::map<Vec2i, std::map<int, std::map<int, UnitRangeCellsLookupItem > > > UnitRangeCellsLookupItemCache;
-	//std::map<int,ExploredCellsLookupKey> ExploredCellsLookupItemCacheTimer;
-	//int UnitRangeCellsLookupItemCacheTimerCount;
-
-	bool findCachedCellsEnemies(Vec2i center, int range,
-								int size, vector<Unit*> &enemies,
-								const AttackSkillType *ast, const Unit *unit,
-								const Unit *commandTarget);
-	void findEnemiesForCell(const AttackSkillType *ast, Cell *cell, const Unit *unit,
-							const Unit *commandTarget,vector<Unit*> &enemies);
+	void findEnemiesInRange(const Unit *unit, const Vec2i &center, int size, int range,
+							const AttackSkillType *ast, const Unit *commandTarget,
+							vector<Unit*> &enemies) const;
 
 public:
 	UnitUpdater();
@@ -121,6 +104,7 @@ public:
 
 	void clearUnitPrecache(Unit *unit);
 	void removeUnitPrecache(Unit *unit);
+	void preparePathFinderFrame();
 
 	inline unsigned int getAttackWarningCount() const { return (unsigned int)attackWarnings.size(); }
 	std::pair<bool,Unit *> unitBeingAttacked(const Unit *unit);
@@ -130,8 +114,6 @@ public:
 
 	vector<Unit*> findUnitsInRange(const Unit *unit, int radius);
 
-	string getUnitRangeCellsLookupItemCacheStats();
-
 	void saveGame(XmlNode *rootNode);
 	void loadGame(const XmlNode *rootNode);
 
@@ -161,7 +143,6 @@ private:
 	void SwapActiveCommandState(Unit *unit, CommandStateType commandStateType,
 								const CommandType *commandType,
 								int originalValue,int newValue);
-	void findUnitsForCell(Cell *cell, vector<Unit*> &units);
 
 };
 
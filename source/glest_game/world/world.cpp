@@ -82,6 +82,9 @@ World::World() : mutexFactionNextUnitId(new Mutex(CODE_AT_LINE)) {
 	loadWorldNode = NULL;
 	cacheFowAlphaTexture = false;
 	cacheFowAlphaTextureFogOfWarValue = false;
+	fowVisibilityCounted = false;
+
+	jobSystem = new JobSystem(config.getInt("JobSystemThreadCount","-1"));
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 }
@@ -143,6 +146,9 @@ World::~World() {
 
 	cleanup();
 
+	delete jobSystem;
+	jobSystem = NULL;
+
 	delete mutexFactionNextUnitId;
 	mutexFactionNextUnitId = NULL;
 
@@ -163,6 +169,7 @@ void World::endScenario() {
 	fogOfWarSkillTypeValue = -1;
 	cacheFowAlphaTexture = false;
 	cacheFowAlphaTextureFogOfWarValue = false;
+	fowVisibilityCounted = false;
 
 	map.end();
 
@@ -202,6 +209,7 @@ void World::end(){
 	map.end();
 	cacheFowAlphaTexture = false;
 	cacheFowAlphaTextureFogOfWarValue = false;
+	fowVisibilityCounted = false;
 
 	//stats will be deleted by BattleEnd
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
@@ -574,7 +582,7 @@ void World::updateAllTilesetObjects() {
 }
 
 void World::updateAllFactionUnits() {
-	bool showPerfStats = Config::getInstance().getBool("ShowPerfStats","false");
+	bool showPerfStats = CachedConfig::showPerfStats.get();
 	Chrono chronoPerf;
 	if(showPerfStats) chronoPerf.start();
 	char perfBuf[8096]="";
@@ -614,10 +622,13 @@ void World::updateAllFactionUnits() {
 		perfList.push_back(perfBuf);
 	}
 
+	// Refresh shared pathfinder data while no faction thread is running
+	unitUpdater.preparePathFinderFrame();
+
 	Chrono chrono;
 	chrono.start();
 
-	const bool newThreadManager = Config::getInstance().getBool("EnableNewThreadManager","false");
+	const bool newThreadManager = CachedConfig::enableNewThreadManager.get();
 	if(newThreadManager == true) {
 		masterController.signalSlaves(&frameCount);
 		bool slavesCompleted = masterController.waitTillSlavesTrigger(20000);
@@ -631,38 +642,21 @@ void World::updateAllFactionUnits() {
 
 	}
 	else {
-		// Signal the faction threads to do any pre-processing
+		// Run the faction pre-processing as jobs, this thread helps out and
+		// then blocks until every faction is done
+		std::vector<FactionUnitCommandJob> factionJobs;
+		factionJobs.reserve(factionCount);
 		for(int i = 0; i < factionCount; ++i) {
 			Faction *faction = getFaction(i);
-			faction->signalWorkerThread(frameCount);
-		}
-
-		if(showPerfStats) {
-			sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
-			perfList.push_back(perfBuf);
-		}
-
-		Chrono chrono;
-		chrono.start();
-
-		const int MAX_FACTION_THREAD_WAIT_MILLISECONDS = 20000;
-		for(;chrono.getMillis() < MAX_FACTION_THREAD_WAIT_MILLISECONDS;) {
-			bool workThreadsFinished = true;
-			for(int i = 0; i < factionCount; ++i) {
-				Faction *faction = getFaction(i);
-				if(faction->isWorkerThreadSignalCompleted(frameCount) == false) {
-					workThreadsFinished = false;
-					break;
-				}
+			if(faction->getThreadedUnitCommandUpdates() == true) {
+				factionJobs.push_back(FactionUnitCommandJob(faction,frameCount));
 			}
-			if(workThreadsFinished == true) {
-				break;
-			}
-			// WARNING... Sleep in here causes the server to lag a bit
-			//if(chrono.getMillis() % 5 == 0) {
-			//	sleep(0);
-			//}
 		}
+		std::vector<Job *> jobList;
+		for(unsigned int i = 0; i < factionJobs.size(); ++i) {
+			jobList.push_back(&factionJobs[i]);
+		}
+		jobSystem->run(jobList);
 
 		if(showPerfStats) {
 			sprintf(perfBuf,"In [%s::%s] Line: %d took msecs: " MG_I64_SPECIFIER "\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__,chronoPerf.getMillis());
@@ -832,7 +826,7 @@ void World::update() {
 
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",extractFileFromDirectoryPath(__FILE__).c_str(),__FUNCTION__,__LINE__);
 
-	bool showPerfStats = Config::getInstance().getBool("ShowPerfStats","false");
+	bool showPerfStats = CachedConfig::showPerfStats.get();
 	Chrono chronoPerf;
 	char perfBuf[8096]="";
 	std::vector<string> perfList;
@@ -970,7 +964,7 @@ bool World::canTickWorld() const {
 }
 
 void World::tick() {
-	bool showPerfStats = Config::getInstance().getBool("ShowPerfStats","false");
+	bool showPerfStats = CachedConfig::showPerfStats.get();
 	Chrono chronoPerf;
 	char perfBuf[8096]="";
 	std::vector<string> perfList;
@@ -2026,6 +2020,7 @@ void World::initSplattedTextures() {
 			sc00->setSurfaceTexture(texture);
 		}
 	}
+	tileset.buildSplattedSurfaces(jobSystem);
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d]\n",__FILE__,__FUNCTION__,__LINE__);
 }
 
@@ -2087,7 +2082,7 @@ void World::initFactionTypes(GameSettings *gs) {
 		}
 	}
 
-	if(Config::getInstance().getBool("EnableNewThreadManager","false") == true) {
+	if(CachedConfig::enableNewThreadManager.get() == true) {
 		std::vector<SlaveThreadControllerInterface *> slaveThreadList;
 		for(unsigned int i = 0; i < factions.size(); ++i) {
 			Faction *faction = factions[i];
@@ -2342,15 +2337,78 @@ void World::initMap() {
 }
 
 void World::exploreCells(int teamIndex, ExploredCellsLookupItem &exploredCellsCache) {
-	std::vector<SurfaceCell*> &cellList = exploredCellsCache.exploredCellList;
-	for (int idx2 = 0; idx2 < (int)cellList.size(); ++idx2) {
-		SurfaceCell* sc = cellList[idx2];
-		sc->setExplored(teamIndex, true);
+	VisibilityPlanes *planes = map.getVisibilityPlanes();
+
+	const std::vector<SurfaceCellSpan> &exploredList = exploredCellsCache.exploredSpanList;
+	for (int idx2 = 0; idx2 < (int)exploredList.size(); ++idx2) {
+		const SurfaceCellSpan &span = exploredList[idx2];
+		planes->setExploredSpan(teamIndex, span.y, span.x1, span.x2);
 	}
-	cellList = exploredCellsCache.visibleCellList;
-	for (int idx2 = 0; idx2 < (int)cellList.size(); ++idx2) {
-		SurfaceCell* sc = cellList[idx2];
-		sc->setVisible(teamIndex, true);
+	// counted visibility is applied by the unit through updateVisibleCellCounts
+	if(fowVisibilityCounted == false) {
+		const std::vector<SurfaceCellSpan> &visibleList = exploredCellsCache.visibleSpanList;
+		for (int idx2 = 0; idx2 < (int)visibleList.size(); ++idx2) {
+			const SurfaceCellSpan &span = visibleList[idx2];
+			planes->setVisibleSpan(teamIndex, span.y, span.x1, span.x2);
+		}
+	}
+}
+
+// Moves a unit's contribution to the visibility counts from its old sight
+// footprint to the new one, rows present in both only apply the difference
+void World::updateVisibleCellCounts(int oldTeamIndex, const std::vector<SurfaceCellSpan> &oldSpans,
+									int newTeamIndex, const std::vector<SurfaceCellSpan> &newSpans) {
+	VisibilityPlanes *planes = map.getVisibilityPlanes();
+
+	if(oldTeamIndex != newTeamIndex) {
+		for(unsigned int index = 0; oldTeamIndex >= 0 && index < oldSpans.size(); ++index) {
+			planes->removeVisibleSpan(oldTeamIndex, oldSpans[index].y, oldSpans[index].x1, oldSpans[index].x2);
+		}
+		for(unsigned int index = 0; newTeamIndex >= 0 && index < newSpans.size(); ++index) {
+			planes->addVisibleSpan(newTeamIndex, newSpans[index].y, newSpans[index].x1, newSpans[index].x2);
+		}
+		return;
+	}
+	if(newTeamIndex < 0) {
+		return;
+	}
+
+	// both lists are sorted by row
+	unsigned int oldIndex = 0;
+	unsigned int newIndex = 0;
+	while(oldIndex < oldSpans.size() || newIndex < newSpans.size()) {
+		if(newIndex >= newSpans.size() ||
+			(oldIndex < oldSpans.size() && oldSpans[oldIndex].y < newSpans[newIndex].y)) {
+			const SurfaceCellSpan &span = oldSpans[oldIndex++];
+			planes->removeVisibleSpan(newTeamIndex, span.y, span.x1, span.x2);
+		}
+		else if(oldIndex >= oldSpans.size() || newSpans[newIndex].y < oldSpans[oldIndex].y) {
+			const SurfaceCellSpan &span = newSpans[newIndex++];
+			planes->addVisibleSpan(newTeamIndex, span.y, span.x1, span.x2);
+		}
+		else {
+			const SurfaceCellSpan &oldSpan = oldSpans[oldIndex++];
+			const SurfaceCellSpan &newSpan = newSpans[newIndex++];
+			int y = newSpan.y;
+
+			if(newSpan.x2 < oldSpan.x1 || newSpan.x1 > oldSpan.x2) {
+				planes->addVisibleSpan(newTeamIndex, y, newSpan.x1, newSpan.x2);
+				planes->removeVisibleSpan(newTeamIndex, y, oldSpan.x1, oldSpan.x2);
+				continue;
+			}
+			if(newSpan.x1 < oldSpan.x1) {
+				planes->addVisibleSpan(newTeamIndex, y, newSpan.x1, oldSpan.x1 - 1);
+			}
+			if(newSpan.x2 > oldSpan.x2) {
+				planes->addVisibleSpan(newTeamIndex, y, oldSpan.x2 + 1, newSpan.x2);
+			}
+			if(oldSpan.x1 < newSpan.x1) {
+				planes->removeVisibleSpan(newTeamIndex, y, oldSpan.x1, newSpan.x1 - 1);
+			}
+			if(oldSpan.x2 > newSpan.x2) {
+				planes->removeVisibleSpan(newTeamIndex, y, newSpan.x2 + 1, oldSpan.x2);
+			}
+		}
 	}
 }
 
@@ -2417,14 +2475,21 @@ ExploredCellsLookupItem World::exploreCells(const Vec2i &newPos, int sightRange,
 	Vec2i newSurfPos= Map::toSurfCoords(newPos);
 	int surfSightRange= sightRange / Map::cellScale+1;
 
-	// Explore, this code is quite expensive when we have lots of units
+	// Explore, this code is quite expensive when we have lots of units.
+	// The sight area is a disc so each surface row is covered by a single
+	// run of cells, those runs are stamped into the visibility bit planes.
 	ExploredCellsLookupItem exploredCellsCache;
-	exploredCellsCache.exploredCellList.reserve(surfSightRange + indirectSightRange * 4);
-	exploredCellsCache.visibleCellList.reserve(surfSightRange + indirectSightRange * 4);
+	exploredCellsCache.exploredSpanList.reserve((surfSightRange + indirectSightRange) * 2 + 3);
+	exploredCellsCache.visibleSpanList.reserve(surfSightRange * 2 + 1);
 
 	//int loopCount = 0;
-    for(int i = -surfSightRange - indirectSightRange -1; i <= surfSightRange + indirectSightRange +1; ++i) {
-        for(int j = -surfSightRange - indirectSightRange -1; j <= surfSightRange + indirectSightRange +1; ++j) {
+    for(int j = -surfSightRange - indirectSightRange -1; j <= surfSightRange + indirectSightRange +1; ++j) {
+    	int exploredX1 = -1;
+    	int exploredX2 = -1;
+    	int visibleX1 = -1;
+    	int visibleX2 = -1;
+
+        for(int i = -surfSightRange - indirectSightRange -1; i <= surfSightRange + indirectSightRange +1; ++i) {
         	//loopCount++;
         	Vec2i currRelPos= Vec2i(i, j);
             Vec2i currPos= newSurfPos + currRelPos;
@@ -2453,21 +2518,37 @@ ExploredCellsLookupItem World::exploreCells(const Vec2i &newPos, int sightRange,
 				}
 
 				if(updateExplored) {
-                    sc->setExplored(teamIndex, true);
-                    exploredCellsCache.exploredCellList.push_back(sc);
+					if(exploredX1 < 0) {
+						exploredX1 = currPos.x;
+					}
+					exploredX2 = currPos.x;
 				}
 				//visible
 				if(updateVisible) {
-					sc->setVisible(teamIndex, true);
-					exploredCellsCache.visibleCellList.push_back(sc);
+					if(visibleX1 < 0) {
+						visibleX1 = currPos.x;
+					}
+					visibleX2 = currPos.x;
 				}
             }
         }
+
+        int surfRow = newSurfPos.y + j;
+        if(exploredX1 >= 0) {
+        	map.getVisibilityPlanes()->setExploredSpan(teamIndex, surfRow, exploredX1, exploredX2);
+        	exploredCellsCache.exploredSpanList.push_back(SurfaceCellSpan(surfRow, exploredX1, exploredX2));
+        }
+        if(visibleX1 >= 0) {
+        	if(fowVisibilityCounted == false) {
+        		map.getVisibilityPlanes()->setVisibleSpan(teamIndex, surfRow, visibleX1, visibleX2);
+        	}
+        	exploredCellsCache.visibleSpanList.push_back(SurfaceCellSpan(surfRow, visibleX1, visibleX2));
+        }
     }
 
     // Ok update our caches with the latest info for this position, sight and team
     if(MaxExploredCellsLookupItemCache > 0) {
-		if(exploredCellsCache.exploredCellList.empty() == false || exploredCellsCache.visibleCellList.empty() == false) {
+		if(exploredCellsCache.exploredSpanList.empty() == false || exploredCellsCache.visibleSpanList.empty() == false) {
 			exploredCellsCache.ExploredCellsLookupItemCacheTimerCountIndex = ExploredCellsLookupItemCacheTimerCount++;
 			ExploredCellsLookupItemCache[newPos][sightRange] = exploredCellsCache;
 
@@ -2564,6 +2645,17 @@ void World::computeFow() {
 	}
 	int resetFowAlphaFactionCount = 0;
 
+	// With fog of war visibility is kept as per unit counts that are only
+	// updated for units whose sight footprint changed. They are rebuilt
+	// from scratch when fog of war is switched on or a game was loaded.
+	bool rebuildVisibilityCounts = (fogOfWar == true && fowVisibilityCounted == false);
+	fowVisibilityCounted = fogOfWar;
+
+	bool teamVisibilityReset[VisibilityPlanes::teamCount];
+	for(int teamIndex = 0; teamIndex < VisibilityPlanes::teamCount; ++teamIndex) {
+		teamVisibilityReset[teamIndex] = false;
+	}
+
 	for(int factionIndex = 0; factionIndex < GameConstants::maxPlayers + GameConstants::specialFactions; ++factionIndex) {
 		if(factionIndex >= getFactionCount()) {
 			continue;
@@ -2574,12 +2666,14 @@ void World::computeFow() {
 //			++indexTeamFaction) {
 
 		// If fog of war enabled set cell visible to false and later set those close to units to true
-		if(fogOfWar) {
-			for(int indexSurfaceW = 0; indexSurfaceW < map.getSurfaceW(); ++indexSurfaceW) {
-				for(int indexSurfaceH = 0; indexSurfaceH < map.getSurfaceH(); ++indexSurfaceH) {
-					// set all cells to not visible
-					map.getSurfaceCell(indexSurfaceW, indexSurfaceH)->setVisible(faction->getTeam(), false);
-				}
+		if(rebuildVisibilityCounts == true) {
+			if(teamVisibilityReset[faction->getTeam()] == false) {
+				// set all cells to not visible, a team shares one plane so only once
+				map.getVisibilityPlanes()->resetVisible(faction->getTeam());
+				teamVisibilityReset[faction->getTeam()] = true;
+			}
+			for(int unitIndex = 0; unitIndex < faction->getUnitCount(); ++unitIndex) {
+				faction->getUnit(unitIndex)->clearVisibleCellCounts();
 			}
 		}
 
@@ -2876,13 +2970,13 @@ string World::getExploredCellsLookupItemCacheStats() {
 			iterMap2 != iterMap1->second.end(); ++iterMap2) {
 			sightCount++;
 
-			exploredCellCount += (int)iterMap2->second.exploredCellList.size();
-			visibleCellCount += (int)iterMap2->second.visibleCellList.size();
+			exploredCellCount += (int)iterMap2->second.exploredSpanList.size();
+			visibleCellCount += (int)iterMap2->second.visibleSpanList.size();
 		}
 	}
 
-	uint64 totalBytes = exploredCellCount * sizeof(SurfaceCell *);
-	totalBytes += visibleCellCount * sizeof(SurfaceCell *);
+	uint64 totalBytes = exploredCellCount * sizeof(SurfaceCellSpan);
+	totalBytes += visibleCellCount * sizeof(SurfaceCellSpan);
 
 	totalBytes /= 1000;
 
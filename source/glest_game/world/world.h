@@ -132,6 +132,8 @@ private:
 	const XmlNode *loadWorldNode;
 
 	MasterSlaveThreadController masterController;
+	// runs the per faction and per AI work of a frame
+	JobSystem *jobSystem;
 
 	bool originalGameFogOfWar;
 	std::map<int,std::pair<const Unit *,const FogOfWarSkillType *> > mapFogOfWarUnitList;
@@ -142,6 +144,9 @@ private:
 	bool cacheFowAlphaTexture;
 	bool cacheFowAlphaTextureFogOfWarValue;
 
+	// true while the visible planes are driven by per unit counts
+	bool fowVisibilityCounted;
+
 	std::map<int, std::map<std::string, Resource > > TeamResources;
 
 public:
@@ -299,9 +304,13 @@ public:
 
 	ExploredCellsLookupItem exploreCells(const Vec2i &newPos, int sightRange, int teamIndex, Unit *unit);
 	void exploreCells(int teamIndex,ExploredCellsLookupItem &exploredCellsCache);
+	bool isFowVisibilityCounted() const { return fowVisibilityCounted; }
+	void updateVisibleCellCounts(int oldTeamIndex, const std::vector<SurfaceCellSpan> &oldSpans,
+								 int newTeamIndex, const std::vector<SurfaceCellSpan> &newSpans);
 	bool showWorldForPlayer(int factionIndex, bool excludeFogOfWarCheck=false) const;
 
 	inline UnitUpdater * getUnitUpdater() { return &unitUpdater; }
+	inline JobSystem * getJobSystem() { return jobSystem; }
 
 	void playStaticVideo(const string &playVideo);
 	void playStreamingVideo(const string &playVideo);
@@ -15,16 +15,55 @@
 #include "vec.h"
 #include "model.h"
 #include <map>
+#include <vector>
+#include "lookup_cache.h"
+#include "thread.h"
 #include "leak_dumper.h"
 
+using std::vector;
+using Shared::Util::LookupCache;
+using Shared::Platform::Mutex;
+using Shared::Platform::int64;
+
 namespace Shared{ namespace Graphics{
 
 // =====================================================
 //	class InterpolationData
+//
+///	Interpolated vertices and normals of an animated mesh. The position
+///	inside a key frame pair is rounded to one of interpolationSteps steps
+///	and the results are kept in a small per mesh cache, so units showing
+///	the same model at about the same point of an animation (in the same or
+///	a later frame) reuse the frame instead of interpolating it again.
+///	All meshes share one byte budget: once it is used up a mesh recycles
+///	its own least recently used entry instead of adding another one.
 // =====================================================
 
 class InterpolationData{
+public:
+	static const int interpolationSteps;
+	static const int maxCacheEntries;
+	static const int maxCacheBytes;
+
 private:
+	class CacheEntry {
+	public:
+		CacheEntry() {
+			key= 0;
+			lastUsed= 0;
+			vertices= NULL;
+			normals= NULL;
+			hasVertices= false;
+			hasNormals= false;
+		}
+		uint64 key;
+		uint32 lastUsed;
+		Vec3f *vertices;
+		Vec3f *normals;
+		bool hasVertices;
+		bool hasNormals;
+	};
+
 	const Mesh *mesh;
 
 	Vec3f *vertices;
@@ -32,18 +71,38 @@ private:
 
 	int raw_frame_ofs;
 
+	vector<CacheEntry> cache;
+	int64 cacheBytes;
+	LookupCache<int> cacheIndex;
+	uint32 useCounter;
+	uint32 cacheHits;
+	uint32 cacheMisses;
+
 	static bool enableInterpolation;
+	static int64 maxTotalCacheBytes;
+	static int64 totalCacheBytes;
+	static Mutex totalCacheBytesAccessor;
 	
-	void update(const Vec3f* src, Vec3f* &dest, float t, bool cycle);
+	static bool reserveCacheBytes(int64 bytes, bool force);
+	bool getFrames(float t, bool cycle, uint32 &prevFrame, uint32 &nextFrame, int &step) const;
+	CacheEntry & getCacheEntry(uint64 key);
+	void update(float t, bool cycle, bool updateVertices, bool updateNormals);
+	static void interpolate(const Vec3f *prev, const Vec3f *next, Vec3f *dest, uint32 count, float t);
 
 public:
 	InterpolationData(const Mesh *mesh);
 	~InterpolationData();
 
 	static void setEnableInterpolation(bool enabled) { enableInterpolation = enabled; }
+	static void setMaxTotalCacheBytes(int64 bytes);
+	static int64 getMaxTotalCacheBytes();
+	static int64 getTotalCacheBytes();
 
 	const Vec3f *getVertices() const	{return !vertices || !enableInterpolation? mesh->getVertices()+raw_frame_ofs: vertices;}
 	const Vec3f *getNormals() const		{return !normals || !enableInterpolation? mesh->getNormals()+raw_frame_ofs: normals;}
+	uint32 getCacheHits() const			{return cacheHits;}
+	uint32 getCacheMisses() const		{return cacheMisses;}
+	int getCacheEntryCount() const		{return (int)cache.size();}
 	
 	void update(float t, bool cycle);
 	void updateVertices(float t, bool cycle);
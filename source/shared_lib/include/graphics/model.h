@@ -124,6 +124,7 @@ public:
 	void setNormals(Vec3f *data, uint32 count);
 	void setTexCoords(Vec2f *data, uint32 count);
 	void setIndices(uint32 *data, uint32 count);
+	void setFrameCount(uint32 count);
 
 	//material
 	const Vec3f &getDiffuseColor() const	{return diffuseColor;}
@@ -14,6 +14,8 @@
 
 #include "model.h"
 #include <vector>
+#include <map>
+#include <set>
 #include "leak_dumper.h"
 
 using namespace std;
@@ -24,6 +26,10 @@ class TextureManager;
 
 // =====================================================
 //	class ModelManager
+//
+///	Creates models on request and shares one instance per file. Every
+///	newModel takes a reference that endModel gives back; the model is
+///	deleted with its last reference or when the manager ends
 // =====================================================
 
 class ModelManager{
@@ -34,6 +40,14 @@ protected:
 	ModelContainer models;
 	TextureManager *textureManager;
 
+	map<string, Model *> modelsByPath;
+	map<Model *, int> referenceCounts;
+	// files read while loading each model, reported again when it is shared
+	map<Model *, vector<string> > modelFiles;
+
+	static string getModelKey(const string &path, bool deletePixMapAfterLoad);
+	void removeModel(Model *model);
+
 public:
 	ModelManager();
 	virtual ~ModelManager();
@@ -45,6 +59,9 @@ public:
 	void endModel(Model *model,bool mustExistInList=false);
 	void endLastModel(bool mustExistInList=false);
 
+	void releaseReferences();
+	void collectTextures(set<Texture *> &textures) const;
+
 	void setTextureManager(TextureManager *textureManager)	{this->textureManager= textureManager;}
 };
 
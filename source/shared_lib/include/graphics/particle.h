@@ -21,10 +21,13 @@
 #include "xml_parser.h"
 #include "leak_dumper.h"
 #include "interpolation.h"
+#include "thread.h"
 
 using std::list;
 using Shared::Util::RandomGen;
 using Shared::Xml::XmlNode;
+using Shared::Platform::Mutex;
+using Shared::Platform::MasterSlaveThreadController;
 
 namespace Shared{ namespace Graphics{
 
@@ -38,6 +41,7 @@ class SplashParticleSystem;
 class ParticleRenderer;
 class ModelRenderer;
 class Model;
+class ParticleUpdateThread;
 
 // =====================================================
 //	class Particle
@@ -75,6 +79,83 @@ public:
 	void loadGame(const XmlNode *rootNode);
 };
 
+// =====================================================
+//	class ParticleBuffer
+//
+///	Particles of a system stored as one array per attribute, so the update
+///	kernels and the renderer only walk the attributes they actually use.
+// =====================================================
+
+class ParticleBuffer {
+public:
+	std::vector<Vec3f> pos;
+	std::vector<Vec3f> lastPos;
+	std::vector<Vec3f> speed;
+	std::vector<float> speedUpRelative;
+	std::vector<Vec3f> speedUpConstant;
+	std::vector<Vec3f> accel;
+	std::vector<Vec4f> color;
+	std::vector<float> size;
+	std::vector<int> energy;
+
+public:
+	int getCount() const	{return (int)energy.size();}
+
+	void resize(int count);
+	void clear();
+
+	// copies every attribute of particle src into slot dst
+	inline void move(int dst, int src) {
+		pos[dst]= pos[src];
+		lastPos[dst]= lastPos[src];
+		speed[dst]= speed[src];
+		speedUpRelative[dst]= speedUpRelative[src];
+		speedUpConstant[dst]= speedUpConstant[src];
+		accel[dst]= accel[src];
+		color[dst]= color[src];
+		size[dst]= size[src];
+		energy[dst]= energy[src];
+	}
+
+	void load(int index, Particle &p) const;
+	void store(int index, const Particle &p);
+};
+
+// =====================================================
+//	class ParticleRef
+//
+///	References to the attributes of one particle, either a slot of a
+///	ParticleBuffer or a standalone Particle, so the same update kernel
+///	serves both.
+// =====================================================
+
+class ParticleRef {
+public:
+	Vec3f &pos;
+	Vec3f &lastPos;
+	Vec3f &speed;
+	float &speedUpRelative;
+	Vec3f &speedUpConstant;
+	Vec3f &accel;
+	Vec4f &color;
+	float &size;
+	int &energy;
+
+public:
+	ParticleRef(ParticleBuffer &buffer, int index) :
+		pos(buffer.pos[index]), lastPos(buffer.lastPos[index]),
+		speed(buffer.speed[index]), speedUpRelative(buffer.speedUpRelative[index]),
+		speedUpConstant(buffer.speedUpConstant[index]), accel(buffer.accel[index]),
+		color(buffer.color[index]), size(buffer.size[index]),
+		energy(buffer.energy[index]) {
+	}
+	explicit ParticleRef(Particle &p) :
+		pos(p.pos), lastPos(p.lastPos), speed(p.speed),
+		speedUpRelative(p.speedUpRelative), speedUpConstant(p.speedUpConstant),
+		accel(p.accel), color(p.color), size(p.size), energy(p.energy) {
+	}
+};
+
 // =====================================================
 //	class ParticleObserver
 // =====================================================
@@ -95,6 +176,52 @@ public:
 };
 
 
+// =====================================================
+//	class ParticleEventQueue
+//
+///	Observer and owner callbacks raised while particle systems are updated
+///	on worker threads. They are run afterwards on the thread that owns the
+///	ParticleManager, ordered by the list position of the system that was
+///	being updated, so every client runs them in the same order.
+// =====================================================
+
+class ParticleEventQueue {
+private:
+	class Event {
+	public:
+		Event() {
+			order= 0;
+			particleSystem= NULL;
+			particleObserver= NULL;
+		}
+		int order;
+		ParticleSystem *particleSystem;
+		ParticleObserver *particleObserver;	// NULL for owner log lines
+		string info;
+	};
+
+	vector<Event> events;
+	Mutex *mutex;
+	bool running;
+
+public:
+	ParticleEventQueue();
+	~ParticleEventQueue();
+
+	void addObserverUpdate(int order, ParticleSystem *particleSystem, ParticleObserver *particleObserver);
+	void addOwnerLog(int order, ParticleSystem *particleSystem, const string &info);
+	void cancel(ParticleSystem *particleSystem);
+	void run();
+	bool isEmpty() const	{return events.empty();}
+
+private:
+	ParticleEventQueue(const ParticleEventQueue &obj);
+	ParticleEventQueue &operator=(const ParticleEventQueue &obj);
+
+	void runEvent(const Event &event);
+	static bool compareEventOrder(const Event &event1, const Event &event2);
+};
+
 class ParticleSystemTypeInterface {
 public:
 
@@ -139,7 +266,7 @@ enum ParticleSystemType {
 
 protected:
 	
-	std::vector<Particle> particles;
+	ParticleBuffer particles;
 	RandomGen random;
 
 	BlendMode blendMode;
@@ -174,6 +301,11 @@ protected:
 	ParticleObserver *particleObserver;
 	ParticleOwner *particleOwner;
 
+	// set while the manager updates this system off the main thread
+	ParticleEventQueue *eventQueue;
+	int eventOrder;
+	bool cleanupPending;
+
 public:
 	//conmstructor and destructor
 	ParticleSystem(int particleCount);
@@ -189,8 +321,7 @@ public:
 	BlendMode getBlendMode() const				{return blendMode;}
 	Texture *getTexture() const					{return texture;}
 	Vec3f getPos() const						{return pos;}
-	Particle *getParticle(int i)				{return &particles[i];}
-	const Particle *getParticle(int i) const	{return &particles[i];}
+	const ParticleBuffer &getParticles() const	{return particles;}
 	int getAliveParticleCount() const			{return aliveParticleCount;}
 	bool getActive() const						{return active;}
 	virtual bool getVisible() const				{return visible;}
@@ -232,6 +363,10 @@ public:
 	virtual ParticleOwner * getParticleOwner() { return this->particleOwner;}
 	virtual void callParticleOwnerEnd(ParticleSystem *particleSystem);
 
+	virtual void setEventQueue(ParticleEventQueue *eventQueue, int eventOrder);
+	bool getCleanupPending() const				{return cleanupPending;}
+	void setCleanupPending(bool value)			{cleanupPending= value;}
+
 	//children
 	virtual int getChildCount() { return 0; }
 	virtual ParticleSystem* getChild(int i);
@@ -245,13 +380,15 @@ public:
 
 protected:
 	//protected
-	Particle *createParticle();
-	void killParticle(Particle *p);
+	int createParticle();
+	void killParticle(int index);
+	void notifyObserver();
+	void logParticleInfo(const string &info);
+	void updateParticle(ParticleRef p);
 
 	//virtual protected
 	virtual void initParticle(Particle *p, int particleIndex);
-	virtual void updateParticle(Particle *p);
-	virtual bool deathTest(Particle *p);
+	virtual void updateParticles();
 };
 
 // =====================================================
@@ -270,7 +407,8 @@ public:
 
 	//virtual
 	virtual void initParticle(Particle *p, int particleIndex);
-	virtual void updateParticle(Particle *p);
+	virtual void updateParticles();
+	void updateParticle(ParticleRef p);
 
 	//set params
 	void setRadius(float radius);
@@ -404,7 +542,8 @@ public:
 
 	//virtual
 	virtual void initParticle(Particle *p, int particleIndex);
-	virtual void updateParticle(Particle *p);
+	virtual void updateParticles();
+	void updateParticle(ParticleRef p);
 	virtual void update();
 	virtual bool getVisible() const;
 	virtual void fade();
@@ -473,7 +612,7 @@ public:
 	virtual void render(ParticleRenderer *pr, ModelRenderer *mr);
 
 	virtual void initParticle(Particle *p, int particleIndex);
-	virtual bool deathTest(Particle *p);
+	virtual void updateParticles();
 
 	void setRadius(float radius);
 	void setWind(float windAngle, float windSpeed);
@@ -498,7 +637,7 @@ public:
 	virtual ParticleSystemType getParticleSystemType() const { return pst_SnowParticleSystem;}
 
 	virtual void initParticle(Particle *p, int particleIndex);
-	virtual bool deathTest(Particle *p);
+	virtual void updateParticles();
 
 	void setRadius(float radius);
 	void setWind(float windAngle, float windSpeed);
@@ -522,8 +661,6 @@ protected:
 public:
 	AttackParticleSystem(int particleCount);
 
-	virtual ParticleSystemType getParticleSystemType() const { return pst_ProjectileParticleSystem;}
-
 	void setSizeNoEnergy(float sizeNoEnergy)	{this->sizeNoEnergy= sizeNoEnergy;}
 	void setGravity(float gravity)				{this->gravity= gravity;}
 	
@@ -577,13 +714,16 @@ public:
 	ProjectileParticleSystem(int particleCount= 1000);
 	virtual ~ProjectileParticleSystem();
 
-	virtual ParticleSystemType getParticleSystemType() const { return pst_SplashParticleSystem;}
+	virtual ParticleSystemType getParticleSystemType() const { return pst_ProjectileParticleSystem;}
 
 	void link(SplashParticleSystem *particleSystem);
+	SplashParticleSystem *getNextParticleSystem() const	{return nextParticleSystem;}
 	
 	virtual void update();
+	virtual void setEventQueue(ParticleEventQueue *eventQueue, int eventOrder);
 	virtual void initParticle(Particle *p, int particleIndex);
-	virtual void updateParticle(Particle *p);
+	virtual void updateParticles();
+	void updateParticle(ParticleRef p);
 	
 	void setTrajectory(Trajectory trajectory)				{this->trajectory= trajectory;}
 	void setTrajectorySpeed(float trajectorySpeed)			{this->trajectorySpeed= trajectorySpeed;}
@@ -624,10 +764,15 @@ private:
 public:
 	SplashParticleSystem(int particleCount= 1000);
 	virtual ~SplashParticleSystem();
+
+	virtual ParticleSystemType getParticleSystemType() const { return pst_SplashParticleSystem;}
+
+	ProjectileParticleSystem *getPrevParticleSystem() const	{return prevParticleSystem;}
 	
 	virtual void update();
 	virtual void initParticle(Particle *p, int particleIndex);
-	virtual void updateParticle(Particle *p);
+	virtual void updateParticles();
+	void updateParticle(ParticleRef p);
 	
 	virtual void initParticleSystem();
 
@@ -651,12 +796,32 @@ public:
 
 class ParticleManager {
 private:
+	friend class ParticleUpdateThread;
+
+	static const int maxUpdateThreads;
+	static const int minSystemsPerBatch;
+
 	vector<ParticleSystem *> particleSystems;
 
+	// Systems linked as parent/child or projectile/splash change each other
+	// while updating, so each group is updated by one thread in list order
+	vector<vector<int> > updateGroups;
+	int updateGroupCount;
+	int updateBatchSize;
+	int nextUpdateGroup;
+	string updateError;
+	ParticleEventQueue updateEvents;
+
+	vector<ParticleUpdateThread *> updateThreads;
+	MasterSlaveThreadController *updateController;
+	Mutex *updateMutex;
+
 public:
 	ParticleManager();
 	~ParticleManager();
 	void update(int renderFps=-1);
+	void setUpdateThreadCount(int threadCount);
+	int getUpdateThreadCount() const	{return (int)updateThreads.size();}
 	void render(ParticleRenderer *pr, ModelRenderer *mr) const;	
 	void manage(ParticleSystem *ps);
 	void end();
@@ -667,6 +832,17 @@ public:
 	bool validateParticleSystemStillExists(ParticleSystem * particleSystem) const;
 	void removeParticleSystemsForParticleOwner(ParticleOwner * particleOwner);
 	bool hasActiveParticleSystem(ParticleSystem::ParticleSystemType type) const;
+
+private:
+	ParticleManager(const ParticleManager &obj);
+	ParticleManager &operator=(const ParticleManager &obj);
+
+	static ParticleSystem * getUpdateRoot(ParticleSystem *ps);
+	void buildUpdateGroups();
+	bool takeUpdateBatch(int &firstGroup, int &lastGroup);
+	void runUpdateBatches();
+	void updateGroup(int groupIndex);
+	void stopUpdateThreads();
 }; 
 
 }}//end namespace
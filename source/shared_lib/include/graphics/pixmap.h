@@ -16,6 +16,7 @@
 #include "vec.h"
 #include "data_types.h"
 #include <map>
+#include <vector>
 #include "checksum.h"
 #include "leak_dumper.h"
 
@@ -216,6 +217,39 @@ public:
 	Checksum * getCRC() { return &crc; }
 };
 
+// =====================================================
+//	class SplatWeights
+//
+///	Per pixel blend weights of the four corners used by Pixmap2D::splat.
+///	They only depend on the pixmap size, so one table can be shared by
+///	every splat of that size, also from several threads at once.
+// =====================================================
+
+class SplatWeights {
+public:
+	class Weight {
+	public:
+		float leftUp;
+		float rightUp;
+		float leftDown;
+		float rightDown;
+		float scale;
+	};
+
+private:
+	int w;
+	int h;
+	// row major
+	std::vector<Weight> weights;
+
+public:
+	SplatWeights(int w, int h);
+
+	int getW() const								{return w;}
+	int getH() const								{return h;}
+	const Weight &getWeight(int x, int y) const		{return weights[w*y+x];}
+};
+
 // =====================================================
 //	class Pixmap2D
 // =====================================================
@@ -289,6 +323,7 @@ public:
 
 	//operations
 	void splat(const Pixmap2D *leftUp, const Pixmap2D *rightUp, const Pixmap2D *leftDown, const Pixmap2D *rightDown); 
+	void splat(const Pixmap2D *leftUp, const Pixmap2D *rightUp, const Pixmap2D *leftDown, const Pixmap2D *rightDown, const SplatWeights &weights);
 	void lerp(float t, const Pixmap2D *pixmap1, const Pixmap2D *pixmap2);
 	void copy(const Pixmap2D *sourcePixmap);
 	void subCopy(int x, int y, const Pixmap2D *sourcePixmap);
@@ -13,10 +13,14 @@
 #define _SHARED_GRAPHICS_TEXTUREMANAGER_H_
 
 #include <vector>
+#include <map>
+#include <set>
 #include "texture.h"
 #include "leak_dumper.h"
 
 using std::vector;
+using std::map;
+using std::set;
 
 namespace Shared{ namespace Graphics{
 
@@ -30,6 +34,16 @@ class TextureManager{
 	
 protected:
 	TextureContainer textures;
+
+	// textures get their path from load() right after creation, so new
+	// textures wait in unindexedTextures until the next lookup indexes them.
+	// Textures that still have no path then are generated ones and are not
+	// indexed, later textures with an indexed path wait in duplicateTextures
+	// until the indexed one is removed
+	map<string, Texture *> texturesByPath;
+	map<Texture *, string> indexedPaths;
+	TextureContainer unindexedTextures;
+	TextureContainer duplicateTextures;
 	
 	Texture::Filter textureFilter;
 	int maxAnisotropy;
@@ -45,6 +59,7 @@ public:
 	void initTexture(Texture *texture);
 	void endTexture(Texture *texture,bool mustExistInList=false);
 	void endLastTexture(bool mustExistInList=false);
+	void endTextures(const set<Texture *> &endList);
 	void reinitTextures();
 
 	Texture::Filter getTextureFilter() const {return textureFilter;}
@@ -57,6 +72,13 @@ public:
 	TextureCube *newTextureCube();
 
 	const TextureContainer &getTextures() const {return textures;}
+
+private:
+	void addTexture(Texture *texture);
+	void removeTexture(Texture *texture);
+	void indexTexture(Texture *texture, const string &path);
+	void unindexTexture(Texture *texture);
+	void indexTextures();
 };
 
 
@@ -65,6 +65,13 @@ public:
 	void beginCall(string functionName);
 	void endCall();
 
+	// Functions looked up once and kept in the lua registry. getFunctionRef
+	// returns noFunctionRef when the global is not a function
+	static const int noFunctionRef;
+	int getFunctionRef(const string &functionName);
+	void releaseFunctionRef(int functionRef);
+	void beginCall(int functionRef, const string &functionName);
+
 	int runCode(const string code);
 	void setSandboxWrapperFunctionName(string name);
 	void setSandboxCode(string code);
@@ -0,0 +1,111 @@
+// ==============================================================
+//	This file is part of Glest Shared Library (www.glest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_PLATFORMCOMMON_JOBSYSTEM_H_
+#define _SHARED_PLATFORMCOMMON_JOBSYSTEM_H_
+
+#include "base_thread.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include "leak_dumper.h"
+
+using namespace std;
+
+namespace Shared { namespace PlatformCommon {
+
+// =====================================================
+//	class Job
+//
+///	A unit of work handed to the JobSystem
+// =====================================================
+
+class Job {
+public:
+	virtual ~Job() {}
+	virtual void run() = 0;
+};
+
+class JobSystem;
+
+// =====================================================
+//	class JobWorkerThread
+// =====================================================
+
+class JobWorkerThread : public BaseThread {
+private:
+	JobSystem *jobSystem;
+	int queueIndex;
+
+public:
+	JobWorkerThread(JobSystem *jobSystem, int queueIndex);
+	virtual void execute();
+};
+
+// =====================================================
+//	class JobSystem
+//
+///	Runs batches of independent jobs on a fixed set of worker threads.
+///	Every worker and the calling thread own a job queue. run() deals the
+///	jobs out over the queues in submission order. An owner takes jobs from
+///	the back of its own queue and an idle thread steals from the front of
+///	the others, so one long job does not hold up the rest of the batch.
+///	The caller works on the batch too and then blocks until the last job
+///	has finished. Jobs of one batch must not depend on each other, which
+///	keeps the outcome independent of the thread that ran each job.
+// =====================================================
+
+class JobSystem {
+public:
+	static const int maxWorkerThreads;
+
+private:
+	class JobQueue {
+	public:
+		JobQueue();
+		~JobQueue();
+
+		Mutex *mutex;
+		std::deque<Job *> jobs;
+	};
+
+	// queue 0 belongs to the thread calling run()
+	std::vector<JobQueue *> queues;
+	std::vector<JobWorkerThread *> workers;
+
+	Semaphore *jobsAvailable;
+	Semaphore *batchCompleted;
+	Mutex *batchMutex;
+	int pendingJobCount;
+	string batchError;
+	Mutex *runMutex;
+
+	Job * takeJob(int queueIndex);
+	void runJob(Job *job);
+
+	JobSystem(const JobSystem &obj);
+	JobSystem &operator=(const JobSystem &obj);
+
+	friend class JobWorkerThread;
+	bool runPendingJob(int queueIndex);
+
+public:
+	explicit JobSystem(int workerThreadCount=-1);
+	~JobSystem();
+
+	int getWorkerThreadCount() const { return (int)workers.size(); }
+
+	void run(const std::vector<Job *> &jobs);
+};
+
+}}//end namespace
+
+#endif
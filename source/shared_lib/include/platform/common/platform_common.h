@@ -245,6 +245,8 @@ bool removeFile(string file);
 bool renameFile(string oldFile, string newFile);
 void removeFolder(const string &path);
 off_t getFileSize(string filename);
+// peak resident memory of this process in bytes, 0 if unknown
+int64 getPeakMemoryUsage();
 bool searchAndReplaceTextInFile(string fileName, string findText, string replaceText, bool simulateOnly);
 void copyFileTo(string fromFileName, string toFileName);
 
@@ -166,6 +166,7 @@ public:
 
 	static void setIntfTypes(std::vector<string> intfTypes) { Socket::intfTypes = intfTypes; }
 	static bool disableNagle;
+	static const int maxSendBufferCount = 8;
 	static int DEFAULT_SOCKET_SENDBUF_SIZE;
 	static int DEFAULT_SOCKET_RECVBUF_SIZE;
 
@@ -187,6 +188,9 @@ public:
 
 	int getDataToRead(bool wantImmediateReply=false);
 	int send(const void *data, int dataSize);
+	// Gathers up to maxSendBufferCount buffers into a single send call so a
+	// message header and its payload never need to be copied together
+	int send(const void * const *dataList, const int *dataSizeList, int dataCount);
 	int receive(void *data, int dataSize, bool tryReceiveUntilDataSizeMet);
 	int peek(void *data, int dataSize, bool mustGetData=true,int *pLastSocketError=NULL);
 
@@ -227,6 +231,57 @@ public:
 	void Restore();
 };
 
+// =====================================================
+//	class SocketPoller
+//
+///	Waits until one of a set of sockets becomes readable. On Linux the set
+///	lives in an epoll instance and wakeup() writes to an eventfd, so the
+///	waiting thread returns as soon as data arrives or another thread wants
+///	it to stop waiting (quit, new work) instead of polling with sleeps.
+///	Other platforms fall back to select() in short slices and check for a
+///	pending wakeup between slices.
+// =====================================================
+class SocketPoller {
+public:
+	static const int maxEventsPerWait;
+	static const int fallbackWaitSliceMilliseconds;
+
+private:
+#ifdef __linux__
+	int epollHandle;
+	int wakeupHandle;
+#endif
+	Mutex *mutexSockets;
+	std::vector<PLATFORM_SOCKET> sockets;
+	bool wakeupPending;
+
+public:
+	SocketPoller();
+	~SocketPoller();
+
+	// true when wait() blocks on epoll, false when it falls back to select()
+	// slices and callers are better off with a single select() of their own
+	static bool isEventDriven();
+
+	void addSocket(PLATFORM_SOCKET socket);
+	void removeSocket(PLATFORM_SOCKET socket);
+	void clearSockets();
+	int getSocketCount();
+
+	// Blocks for up to waitMilliseconds (-1 waits until data or a wakeup).
+	// Returns true when at least one socket is readable, those are added
+	// to readySockets if it is not NULL.
+	bool wait(int waitMilliseconds, std::vector<PLATFORM_SOCKET> *readySockets=NULL);
+	void wakeup();
+
+private:
+	SocketPoller(const SocketPoller &obj);
+	SocketPoller &operator=(const SocketPoller &obj);
+
+	bool takeWakeup();
+	static void throwPollerException(const string &call);
+};
+
 class BroadCastClientSocketThread : public BaseThread
 {
 private:
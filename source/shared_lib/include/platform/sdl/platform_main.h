@@ -28,6 +28,7 @@ const char  *GAME_ARGS[] = {
 	"--autostart-lastgame",
 	"--load-saved-game",
 	"--auto-test",
+	"--benchmark-replay",
 	"--connect",
 	"--connecthost",
 	"--starthost",
@@ -112,6 +113,7 @@ enum GAME_ARG_TYPE {
 	GAME_ARG_AUTOSTART_LASTGAME,
 	GAME_ARG_AUTOSTART_LAST_SAVED_GAME,
 	GAME_ARG_AUTO_TEST,
+	GAME_ARG_BENCHMARK_REPLAY,
 	GAME_ARG_CONNECT,
 	GAME_ARG_CLIENT,
 	GAME_ARG_SERVER,
@@ -222,6 +224,12 @@ void printParameterHelp(const char *argv0, bool foundInvalidArgs) {
 	printf("\n\n                     \tafter the game is finished or the time runs out. If z is");
 	printf("\n\n                     \tnot specified (or is empty) then auto test continues to cycle.");
 
+	printf("\n\n%s=x  \tReplays the saved game x headless and as fast as possible.",GAME_ARGS[GAME_ARG_BENCHMARK_REPLAY]);
+	printf("\n\n                     \tThe saved game must have a matching .replay command file");
+	printf("\n\n                     \t(recorded with SaveCommandsForReplay enabled). When the");
+	printf("\n\n                     \treplay ends the frame rate, subsystem times, peak memory");
+	printf("\n\n                     \tand final faction checksums are printed and the game exits.");
+
 	printf("\n\n%s=x:y  \t\tAuto connect to host server at IP or hostname x using",GAME_ARGS[GAME_ARG_CONNECT]);
 	printf("\n\n                     \t    port y. Shortcut version of using %s and %s.",GAME_ARGS[GAME_ARG_CLIENT],GAME_ARGS[GAME_ARG_USE_PORTS]);
 	printf("\n\n                     \t*NOTE: to automatically connect to the first LAN host you may");
@@ -25,10 +25,29 @@ namespace Shared{ namespace Util{
 
 // =====================================================
 //	class Checksum
+//
+///	CRC32 of data and files. File checksums are kept in a cache that is
+///	saved in the CRC cache folder, an entry is only reused while the size
+///	and modification time of the file are unchanged.
 // =====================================================
 
 class Checksum {
+public:
+	static const int fileBlockSize;
+
 private:
+	class FileCacheEntry {
+	public:
+		FileCacheEntry() {
+			size = 0;
+			modTime = 0;
+			crc = 0;
+		}
+		int64	size;
+		int64	modTime;
+		uint32	crc;
+	};
+
 	uint32	sum;
 	int32	r;
     int32	c1;
@@ -36,11 +55,18 @@ private:
 	std::map<string,uint32> fileList;
 
 	static Mutex fileListCacheSynchAccessor;
-	static std::map<string,uint32> fileListCache;
+	static std::map<string,FileCacheEntry> fileListCache;
+	static bool fileListCacheLoaded;
+	static bool fileListCacheChanged;
 
 	void addSum(uint32 value);
 	bool addFileToSum(const string &path);
 
+	static bool getFileStats(const string &path, int64 &size, int64 &modTime);
+	static string getFileCacheFileName();
+	static void loadFileCache();
+	static void saveFileCache();
+
 public:
 	Checksum();
 
@@ -58,6 +84,7 @@ public:
 	void addFile(const string &path);
 
 	static void removeFileFromCache(const string file);
+	static void saveFileCacheIfChanged();
 	static void clearFileCache();
 };
 
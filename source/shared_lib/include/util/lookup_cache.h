@@ -0,0 +1,136 @@
+// ==============================================================
+//	This file is part of Glest Shared Library (www.glest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_UTIL_LOOKUPCACHE_H_
+#define _SHARED_UTIL_LOOKUPCACHE_H_
+
+#include <vector>
+#include "data_types.h"
+#include "leak_dumper.h"
+
+using Shared::Platform::uint32;
+using Shared::Platform::uint64;
+
+namespace Shared { namespace Util {
+
+// =====================================================
+//	class LookupCache
+//
+///	Fixed size open addressing hash table mapping packed 64 bit keys to
+///	values. Every slot remembers the generation it was written in and slots
+///	from an older generation count as empty, so nextGeneration() drops the
+///	whole cache without touching memory. Probing is bounded: when no free
+///	slot is found the oldest candidate (the home slot) is overwritten, so
+///	the memory used never grows past the capacity given at construction.
+// =====================================================
+
+template<typename T>
+class LookupCache {
+public:
+	static const int maxProbeCount = 8;
+
+private:
+	class Slot {
+	public:
+		Slot() {
+			key = 0;
+			generation = 0;
+		}
+		uint64 key;
+		uint32 generation;
+		T value;
+	};
+
+	std::vector<Slot> slots;
+	uint32 mask;
+	uint32 generation;
+
+public:
+	explicit LookupCache(int capacity=4096) {
+		mask = 0;
+		generation = 1;
+		setCapacity(capacity);
+	}
+
+	// capacity is rounded up to a power of two, the cache is emptied
+	void setCapacity(int capacity) {
+		uint32 size = 1;
+		while(size < (uint32)capacity && size < 0x40000000) {
+			size <<= 1;
+		}
+		slots.clear();
+		slots.resize(size);
+		mask = size - 1;
+		generation = 1;
+	}
+
+	int getCapacity() const		{ return (int)slots.size(); }
+	uint32 getGeneration() const	{ return generation; }
+
+	void nextGeneration() {
+		++generation;
+		if(generation == 0) {
+			// wrapped around, stale stamps could look current again
+			for(unsigned int index = 0; index < slots.size(); ++index) {
+				slots[index].generation = 0;
+			}
+			generation = 1;
+		}
+	}
+
+	void clear() {
+		nextGeneration();
+	}
+
+	bool find(uint64 key, T &value) const {
+		uint32 index = hash(key) & mask;
+		for(int probe = 0; probe < maxProbeCount; ++probe) {
+			const Slot &slot = slots[(index + probe) & mask];
+			if(slot.generation != generation) {
+				return false;
+			}
+			if(slot.key == key) {
+				value = slot.value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void insert(uint64 key, const T &value) {
+		uint32 index = hash(key) & mask;
+		for(int probe = 0; probe < maxProbeCount; ++probe) {
+			Slot &slot = slots[(index + probe) & mask];
+			if(slot.generation != generation || slot.key == key) {
+				slot.key = key;
+				slot.generation = generation;
+				slot.value = value;
+				return;
+			}
+		}
+		Slot &slot = slots[index];
+		slot.key = key;
+		slot.value = value;
+	}
+
+	static inline uint32 hash(uint64 key) {
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		key *= 0xc4ceb9fe1a85ec53ULL;
+		key ^= key >> 33;
+		return (uint32)key;
+	}
+};
+
+}}//end namespace
+
+#endif
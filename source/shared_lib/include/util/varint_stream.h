@@ -0,0 +1,183 @@
+// ==============================================================
+//	This file is part of Glest Shared Library (www.glest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#ifndef _SHARED_UTIL_VARINTSTREAM_H_
+#define _SHARED_UTIL_VARINTSTREAM_H_
+
+#include <vector>
+#include <cstring>
+#include "data_types.h"
+#include "leak_dumper.h"
+
+using Shared::Platform::int8;
+using Shared::Platform::uint8;
+using Shared::Platform::int32;
+using Shared::Platform::uint32;
+using Shared::Platform::int64;
+using Shared::Platform::uint64;
+
+namespace Shared { namespace Util {
+
+// =====================================================
+//	class VarintWriter
+//
+///	Appends values to a growable byte buffer in a byte order independent
+///	form. Unsigned values are written 7 bits per byte (LEB128), signed values
+///	are zigzag mapped first so small negative numbers stay short too. Fixed
+///	size values are always written little endian.
+// =====================================================
+
+class VarintWriter {
+private:
+	std::vector<unsigned char> buffer;
+
+public:
+	VarintWriter() {
+	}
+
+	void clear()							{ buffer.clear(); }
+	void reserve(int size)					{ buffer.reserve(size); }
+	int getSize() const						{ return (int)buffer.size(); }
+	const unsigned char * getData() const	{ return (buffer.empty() == true ? NULL : &buffer[0]); }
+
+	void writeByte(uint8 value) {
+		buffer.push_back(value);
+	}
+
+	void writeFixed32(uint32 value) {
+		for(int index = 0; index < 4; ++index) {
+			buffer.push_back((unsigned char)(value >> (index * 8)));
+		}
+	}
+
+	void writeUnsigned(uint64 value) {
+		while(value >= 0x80) {
+			buffer.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back((unsigned char)value);
+	}
+
+	void writeSigned(int64 value) {
+		writeUnsigned(zigzagEncode(value));
+	}
+
+	void writeBytes(const void *data, int size) {
+		if(size > 0) {
+			const unsigned char *bytes = (const unsigned char *)data;
+			buffer.insert(buffer.end(), bytes, bytes + size);
+		}
+	}
+
+	static inline uint64 zigzagEncode(int64 value) {
+		return ((uint64)value << 1) ^ (uint64)(value >> 63);
+	}
+	static inline int64 zigzagDecode(uint64 value) {
+		return (int64)(value >> 1) ^ -(int64)(value & 1);
+	}
+};
+
+// =====================================================
+//	class VarintReader
+//
+///	Reads values written by VarintWriter from a caller owned buffer. The
+///	read methods return false once the data is exhausted or malformed and
+///	the reader stays failed from then on, so a whole record can be decoded
+///	before checking isFailed() once.
+// =====================================================
+
+class VarintReader {
+public:
+	static const int maxUnsignedSize = 10;
+
+private:
+	const unsigned char *data;
+	int size;
+	int position;
+	bool failed;
+
+public:
+	VarintReader(const unsigned char *data, int size) {
+		this->data = data;
+		this->size = size;
+		this->position = 0;
+		this->failed = false;
+	}
+
+	int getPosition() const		{ return position; }
+	int getRemaining() const	{ return size - position; }
+	bool isAtEnd() const		{ return position >= size; }
+	bool isFailed() const		{ return failed; }
+
+	bool readByte(uint8 &value) {
+		if(failed == true || position >= size) {
+			failed = true;
+			return false;
+		}
+		value = data[position++];
+		return true;
+	}
+
+	bool readFixed32(uint32 &value) {
+		if(failed == true || size - position < 4) {
+			failed = true;
+			return false;
+		}
+		value = 0;
+		for(int index = 0; index < 4; ++index) {
+			value |= (uint32)data[position++] << (index * 8);
+		}
+		return true;
+	}
+
+	bool readUnsigned(uint64 &value) {
+		value = 0;
+		for(int index = 0; index < maxUnsignedSize; ++index) {
+			if(failed == true || position >= size) {
+				failed = true;
+				return false;
+			}
+			unsigned char byte = data[position++];
+			value |= (uint64)(byte & 0x7f) << (index * 7);
+			if((byte & 0x80) == 0) {
+				return true;
+			}
+		}
+		// more than 64 bits worth of continuation bytes
+		failed = true;
+		return false;
+	}
+
+	bool readSigned(int64 &value) {
+		uint64 encoded = 0;
+		if(readUnsigned(encoded) == false) {
+			return false;
+		}
+		value = VarintWriter::zigzagDecode(encoded);
+		return true;
+	}
+
+	bool readBytes(void *target, int count) {
+		if(failed == true || count < 0 || size - position < count) {
+			failed = true;
+			return false;
+		}
+		if(count > 0) {
+			memcpy(target, &data[position], count);
+			position += count;
+		}
+		return true;
+	}
+};
+
+}}//end namespace
+
+#endif
@@ -116,6 +116,7 @@ private:
 private:
 	XmlIoRapid();
 	void init();
+	void buildDocument(xml_document<> &doc, const XmlNode *node);
 
 public:
 	static XmlIoRapid &getInstance();
@@ -126,6 +127,8 @@ public:
 
 	XmlNode *load(const string &path, const std::map<string,string> &mapTagReplacementValues,bool noValidation=false,bool skipStackTrace=false,bool skipUpdatePathClimbingParts=false);
 	void save(const string &path, const XmlNode *node);
+	// compact (unindented) document text, the same content save() writes
+	string saveToString(const XmlNode *node);
 };
 
 // =====================================================
@@ -152,6 +155,7 @@ public:
 	void init(const string &name);
 	void load(const string &path, const std::map<string,string> &mapTagReplacementValues, bool noValidation=false,bool skipStackCheck=false,bool skipStackTrace=false);
 	void save(const string &path);
+	string saveToString();
 
 	XmlNode *getRootNode() const	{return rootNode;}
 };
@@ -216,6 +220,9 @@ public:
 
 // =====================================================
 //	class XmlAttribute
+//
+///	Tags are replaced while the attribute is built, the replacement map is
+///	only borrowed from the caller and not kept per attribute.
 // =====================================================
 
 class XmlAttribute {
@@ -224,7 +231,6 @@ private:
 	string name;
 	bool skipRestrictionCheck;
 	bool usesCommondata;
-	std::map<string,string> mapTagReplacementValues;
 
 private:
 	XmlAttribute(XmlAttribute&);
@@ -242,7 +248,7 @@ public:
 	XmlAttribute(const string &name, const string &value, const std::map<string,string> &mapTagReplacementValues);
 
 public:
-	const string getName() const	{return name;}
+	const string &getName() const	{return name;}
 	const string getValue(string prefixValue="", bool trimValueWithStartingSlash=false) const;
 
 	bool getBoolValue() const;
@@ -31,8 +31,14 @@ namespace Shared{ namespace Graphics{
 // =====================================================
 
 bool InterpolationData::enableInterpolation = true;
-
-InterpolationData::InterpolationData(const Mesh *mesh) {
+const int InterpolationData::interpolationSteps = 16;
+const int InterpolationData::maxCacheEntries = 48;
+const int InterpolationData::maxCacheBytes = 512 * 1024;
+int64 InterpolationData::maxTotalCacheBytes = 32 * 1024 * 1024;
+int64 InterpolationData::totalCacheBytes = 0;
+Mutex InterpolationData::totalCacheBytesAccessor;
+
+InterpolationData::InterpolationData(const Mesh *mesh) : cacheIndex(maxCacheEntries * 2) {
 	if(GlobalStaticFlags::getIsNonGraphicalModeEnabled() == true) {
 		throw megaglest_runtime_error("Loading graphics in headless server mode not allowed!");
 	}
@@ -41,31 +47,69 @@ InterpolationData::InterpolationData(const Mesh *mesh) {
 	normals= NULL;
 	
 	raw_frame_ofs = 0;
+	cacheBytes = 0;
+	useCounter = 0;
+	cacheHits = 0;
+	cacheMisses = 0;
 	
 	this->mesh= mesh;
 }
 
 InterpolationData::~InterpolationData(){
-	delete [] vertices;
+	for(unsigned int i = 0; i < cache.size(); ++i) {
+		delete [] cache[i].vertices;
+		cache[i].vertices = NULL;
+		delete [] cache[i].normals;
+		cache[i].normals = NULL;
+	}
+	cache.clear();
 	vertices=NULL;
-	delete [] normals;
 	normals=NULL;
+
+	MutexSafeWrapper safeMutex(&totalCacheBytesAccessor);
+	totalCacheBytes -= cacheBytes;
+	cacheBytes = 0;
+}
+
+void InterpolationData::setMaxTotalCacheBytes(int64 bytes) {
+	MutexSafeWrapper safeMutex(&totalCacheBytesAccessor);
+	maxTotalCacheBytes = bytes;
+}
+
+int64 InterpolationData::getMaxTotalCacheBytes() {
+	MutexSafeWrapper safeMutex(&totalCacheBytesAccessor);
+	return maxTotalCacheBytes;
+}
+
+int64 InterpolationData::getTotalCacheBytes() {
+	MutexSafeWrapper safeMutex(&totalCacheBytesAccessor);
+	return totalCacheBytes;
+}
+
+// Takes bytes from the budget shared by all meshes, force is used for the
+// first entry of a mesh which it needs to render at all
+bool InterpolationData::reserveCacheBytes(int64 bytes, bool force) {
+	MutexSafeWrapper safeMutex(&totalCacheBytesAccessor);
+	if(force == false && totalCacheBytes + bytes > maxTotalCacheBytes) {
+		return false;
+	}
+	totalCacheBytes += bytes;
+	return true;
 }
 
 void InterpolationData::update(float t, bool cycle){
-	updateVertices(t, cycle);
-	updateNormals(t, cycle);
+	update(t, cycle, true, true);
 }
 
 void InterpolationData::updateVertices(float t, bool cycle) {
-	update(mesh->getVertices(), vertices, t, cycle);
+	update(t, cycle, true, false);
 }
 
 void InterpolationData::updateNormals(float t, bool cycle) {
-	update(mesh->getNormals(), normals, t, cycle);
+	update(t, cycle, false, true);
 }
 
-void InterpolationData::update(const Vec3f* src, Vec3f* &dest, float t, bool cycle) {
+bool InterpolationData::getFrames(float t, bool cycle, uint32 &prevFrame, uint32 &nextFrame, int &step) const {
 
 	if(t <0.0f || t>1.0f) {
 		printf("ERROR t = [%f] for cycle [%d] f [%d] v [%d]\n",t,cycle,mesh->getFrameCount(),mesh->getVertexCount());
@@ -78,43 +122,126 @@ void InterpolationData::update(const Vec3f* src, Vec3f* &dest, float t, bool cyc
 	}
 
 	uint32 frameCount= mesh->getFrameCount();
-	uint32 vertexCount= mesh->getVertexCount();
+	if(frameCount <= 1) {
+		return false;
+	}
 
-	if(frameCount > 1) {
-		//misc vars
-		uint32 prevFrame;
-		uint32 nextFrame;
-		float localT;
+	float localT;
+	if(cycle == true) {
+		prevFrame= min<uint32>(static_cast<uint32>(t*frameCount), frameCount-1);
+		nextFrame= (prevFrame+1) % frameCount;
+		localT= t*frameCount - prevFrame;
+	}
+	else {
+		prevFrame= min<uint32> (static_cast<uint32> (t * (frameCount-1)), frameCount - 2);
+		nextFrame= min(prevFrame + 1, frameCount - 1);
+		localT= t * (frameCount-1) - prevFrame;
+		//printf(" prevFrame=%d nextFrame=%d localT=%f\n",prevFrame,nextFrame,localT);
+	}
 
-		if(cycle == true) {
-			prevFrame= min<uint32>(static_cast<uint32>(t*frameCount), frameCount-1);
-			nextFrame= (prevFrame+1) % frameCount;
-			localT= t*frameCount - prevFrame;
-		}
-		else {
-			prevFrame= min<uint32> (static_cast<uint32> (t * (frameCount-1)), frameCount - 2);
-			nextFrame= min(prevFrame + 1, frameCount - 1);
-			localT= t * (frameCount-1) - prevFrame;
-			//printf(" prevFrame=%d nextFrame=%d localT=%f\n",prevFrame,nextFrame,localT);
+	//assertions
+	assert(prevFrame<frameCount);
+	assert(nextFrame<frameCount);
+
+	step= static_cast<int>(localT * interpolationSteps + 0.5f);
+	step= max(0, min(step, interpolationSteps));
+	return true;
+}
+
+// Returns the entry for key, recycling the least recently used one (or
+// adding one while the mesh and global size limits allow) when it is not
+// cached yet
+InterpolationData::CacheEntry & InterpolationData::getCacheEntry(uint64 key) {
+	++useCounter;
+
+	int index = -1;
+	if(cacheIndex.find(key, index) == true && index < (int)cache.size() &&
+		cache[index].key == key && (cache[index].hasVertices || cache[index].hasNormals)) {
+		cacheHits++;
+		cache[index].lastUsed = useCounter;
+		return cache[index];
+	}
+	cacheMisses++;
+
+	uint32 vertexCount = mesh->getVertexCount();
+	int entryBytes = max<int>(1, vertexCount * sizeof(Vec3f) * 2);
+	int entryLimit = max(2, min(maxCacheEntries, maxCacheBytes / entryBytes));
+	if((int)cache.size() < entryLimit &&
+		reserveCacheBytes(entryBytes, cache.empty()) == true) {
+		cacheBytes += entryBytes;
+		cache.push_back(CacheEntry());
+		index = (int)cache.size() - 1;
+	}
+	else {
+		index = 0;
+		for(unsigned int i = 1; i < cache.size(); ++i) {
+			if(cache[i].lastUsed < cache[index].lastUsed) {
+				index = i;
+			}
 		}
+	}
+
+	CacheEntry &entry = cache[index];
+	entry.key = key;
+	entry.lastUsed = useCounter;
+	entry.hasVertices = false;
+	entry.hasNormals = false;
+	cacheIndex.insert(key, index);
+	return entry;
+}
+
+void InterpolationData::update(float t, bool cycle, bool updateVertices, bool updateNormals) {
+	uint32 prevFrame = 0;
+	uint32 nextFrame = 0;
+	int step = 0;
+	if(getFrames(t, cycle, prevFrame, nextFrame, step) == false) {
+		return;
+	}
 
-		uint32 prevFrameBase= prevFrame*vertexCount;
-		uint32 nextFrameBase= nextFrame*vertexCount;
+	uint32 vertexCount= mesh->getVertexCount();
+	uint32 prevFrameBase= prevFrame*vertexCount;
+	uint32 nextFrameBase= nextFrame*vertexCount;
+
+	if(enableInterpolation == false) {
+		raw_frame_ofs = prevFrameBase;
+		return;
+	}
 
-		//assertions
-		assert(prevFrame<frameCount);
-		assert(nextFrame<frameCount);
-		
-		if(enableInterpolation) {
-			if(!dest) { // not previously allocated
-			      dest = new Vec3f[vertexCount];
+	uint64 key = (static_cast<uint64>(prevFrame) << 40) | (static_cast<uint64>(nextFrame) << 16) | static_cast<uint64>(step);
+	CacheEntry &entry = getCacheEntry(key);
+	float localT = static_cast<float>(step) / interpolationSteps;
+
+	if(updateVertices == true) {
+		if(entry.hasVertices == false) {
+			if(entry.vertices == NULL) { // not previously allocated
+				entry.vertices = new Vec3f[vertexCount];
 			}
-			for(uint32 j=0; j<vertexCount; ++j){
-				dest[j]= src[prevFrameBase+j].lerp(localT, src[nextFrameBase+j]);
+			interpolate(mesh->getVertices() + prevFrameBase, mesh->getVertices() + nextFrameBase, entry.vertices, vertexCount, localT);
+			entry.hasVertices = true;
+		}
+		vertices = entry.vertices;
+	}
+	if(updateNormals == true) {
+		if(entry.hasNormals == false) {
+			if(entry.normals == NULL) {
+				entry.normals = new Vec3f[vertexCount];
 			}
-		} else {
-			raw_frame_ofs = prevFrameBase;
+			interpolate(mesh->getNormals() + prevFrameBase, mesh->getNormals() + nextFrameBase, entry.normals, vertexCount, localT);
+			entry.hasNormals = true;
 		}
+		normals = entry.normals;
+	}
+}
+
+// Same result as Vec3f::lerp, written over the flat float arrays so the
+// compiler can vectorize the loop
+void InterpolationData::interpolate(const Vec3f *prev, const Vec3f *next, Vec3f *dest, uint32 count, float t) {
+	const float *src1 = &prev[0].x;
+	const float *src2 = &next[0].x;
+	float *out = &dest[0].x;
+	const uint32 floatCount = count * 3;
+	for(uint32 i = 0; i < floatCount; ++i) {
+		out[i] = src1[i] + (src2[i] - src1[i]) * t;
 	}
 }
 
@@ -1473,6 +1473,10 @@ void Mesh::setIndices(uint32 *data, uint32 count) {
 	this->indexCount = count;
 }
 
+void Mesh::setFrameCount(uint32 count) {
+	this->frameCount = count;
+}
+
 void Mesh::copyInto(Mesh *dest, bool ignoreInterpolationData,
 								bool destinationOwnsTextures) {
 
@@ -40,12 +40,84 @@ ModelManager::~ModelManager(){
 	end();
 }
 
+string ModelManager::getModelKey(const string &path, bool deletePixMapAfterLoad) {
+	return (deletePixMapAfterLoad == true ? "1:" : "0:") + path;
+}
+
 Model *ModelManager::newModel(const string &path,bool deletePixMapAfterLoad,std::map<string,vector<pair<string, string> > > *loadedFileList, string *sourceLoader){
-	Model *model= GraphicsInterface::getInstance().getFactory()->newModel(path,textureManager,deletePixMapAfterLoad,loadedFileList,sourceLoader);
+	const string key = getModelKey(path,deletePixMapAfterLoad);
+	map<string, Model *>::iterator iterFind = modelsByPath.find(key);
+	if(iterFind != modelsByPath.end()) {
+		Model *model = iterFind->second;
+		referenceCounts[model]++;
+
+		if(loadedFileList) {
+			string loader = (sourceLoader != NULL ? *sourceLoader : "");
+			const vector<string> &files = modelFiles[model];
+			for(unsigned int i = 0; i < files.size(); ++i) {
+				(*loadedFileList)[files[i]].push_back(make_pair(loader,loader));
+			}
+		}
+		return model;
+	}
+
+	std::map<string,vector<pair<string, string> > > modelFileList;
+	Model *model= GraphicsInterface::getInstance().getFactory()->newModel(path,textureManager,deletePixMapAfterLoad,&modelFileList,sourceLoader);
 	models.push_back(model);
+	modelsByPath[key] = model;
+	referenceCounts[model] = 1;
+
+	vector<string> &files = modelFiles[model];
+	for(std::map<string,vector<pair<string, string> > >::iterator iterMap = modelFileList.begin();
+		iterMap != modelFileList.end(); ++iterMap) {
+		files.push_back(iterMap->first);
+		if(loadedFileList) {
+			vector<pair<string, string> > &loaders = (*loadedFileList)[iterMap->first];
+			loaders.insert(loaders.end(),iterMap->second.begin(),iterMap->second.end());
+		}
+	}
 	return model;
 }
 
+void ModelManager::removeModel(Model *model) {
+	for(map<string, Model *>::iterator iterMap = modelsByPath.begin();
+		iterMap != modelsByPath.end(); ++iterMap) {
+		if(iterMap->second == model) {
+			modelsByPath.erase(iterMap);
+			break;
+		}
+	}
+	referenceCounts.erase(model);
+	modelFiles.erase(model);
+}
+
+// Forgets who uses the models but keeps them loaded, so the next newModel
+// of the same file shares the existing instance again
+void ModelManager::releaseReferences() {
+	for(map<Model *, int>::iterator iterMap = referenceCounts.begin();
+		iterMap != referenceCounts.end(); ++iterMap) {
+		iterMap->second = 0;
+	}
+}
+
+void ModelManager::collectTextures(set<Texture *> &textures) const {
+	for(size_t i=0; i<models.size(); ++i){
+		const Model *model = models[i];
+		if(model == NULL) {
+			continue;
+		}
+		for(uint32 meshIndex = 0; meshIndex < model->getMeshCount(); ++meshIndex) {
+			const Mesh *mesh = model->getMesh(meshIndex);
+			for(int textureIndex = 0; textureIndex < meshTextureCount; ++textureIndex) {
+				const Texture2D *texture = mesh->getTexture(textureIndex);
+				if(texture != NULL) {
+					textures.insert(const_cast<Texture2D *>(texture));
+				}
+			}
+		}
+	}
+}
+
 void ModelManager::init(){
 	for(size_t i=0; i<models.size(); ++i){
 		if(models[i] != NULL) {
@@ -63,10 +135,18 @@ void ModelManager::end(){
 		}
 	}
 	models.clear();
+	modelsByPath.clear();
+	referenceCounts.clear();
+	modelFiles.clear();
 }
 
 void ModelManager::endModel(Model *model,bool mustExistInList) {
 	if(model != NULL) {
+		map<Model *, int>::iterator iterCount = referenceCounts.find(model);
+		if(iterCount != referenceCounts.end() && --iterCount->second > 0) {
+			return;
+		}
+
 		bool found = false;
 		for(unsigned int idx = 0; idx < models.size(); idx++) {
 			Model *curModel = models[idx];
@@ -80,6 +160,7 @@ void ModelManager::endModel(Model *model,bool mustExistInList) {
 		if(found == false && mustExistInList == true) {
 			throw std::runtime_error("found == false in endModel");
 		}
+		removeModel(model);
 
 		model->end();
 		delete model;
@@ -93,6 +174,7 @@ void ModelManager::endLastModel(bool mustExistInList) {
 		size_t index = models.size()-1;
 		Model *curModel = models[index];
 		models.erase(models.begin() + index);
+		removeModel(curModel);
 
 		curModel->end();
 		delete curModel;
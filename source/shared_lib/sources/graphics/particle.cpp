@@ -24,6 +24,8 @@
 #include "model.h"
 #include "texture.h"
 #include "platform_util.h"
+#include "base_thread.h"
+#include <SDL_cpuinfo.h>
 #include "leak_dumper.h"
 
 using namespace std;
@@ -40,6 +42,148 @@ namespace Graphics {
 const bool checkMemory = false;
 static map<void *,int> memoryObjectList;
 
+// =====================================================
+//	class ParticleBuffer
+// =====================================================
+
+void ParticleBuffer::resize(int count) {
+	pos.resize(count);
+	lastPos.resize(count);
+	speed.resize(count);
+	speedUpRelative.resize(count, 0.0f);
+	speedUpConstant.resize(count);
+	accel.resize(count);
+	color.resize(count);
+	size.resize(count, 0.0f);
+	energy.resize(count, 0);
+}
+
+void ParticleBuffer::clear() {
+	pos.clear();
+	lastPos.clear();
+	speed.clear();
+	speedUpRelative.clear();
+	speedUpConstant.clear();
+	accel.clear();
+	color.clear();
+	size.clear();
+	energy.clear();
+}
+
+void ParticleBuffer::load(int index, Particle &p) const {
+	p.pos= pos[index];
+	p.lastPos= lastPos[index];
+	p.speed= speed[index];
+	p.speedUpRelative= speedUpRelative[index];
+	p.speedUpConstant= speedUpConstant[index];
+	p.accel= accel[index];
+	p.color= color[index];
+	p.size= size[index];
+	p.energy= energy[index];
+}
+
+void ParticleBuffer::store(int index, const Particle &p) {
+	pos[index]= p.pos;
+	lastPos[index]= p.lastPos;
+	speed[index]= p.speed;
+	speedUpRelative[index]= p.speedUpRelative;
+	speedUpConstant[index]= p.speedUpConstant;
+	accel[index]= p.accel;
+	color[index]= p.color;
+	size[index]= p.size;
+	energy[index]= p.energy;
+}
+
+// =====================================================
+//	class ParticleEventQueue
+// =====================================================
+
+ParticleEventQueue::ParticleEventQueue() {
+	mutex= new Mutex(CODE_AT_LINE);
+	running= false;
+}
+
+ParticleEventQueue::~ParticleEventQueue() {
+	for(unsigned int i= 0; i < events.size(); ++i) {
+		delete events[i].particleObserver;
+	}
+	events.clear();
+	delete mutex;
+	mutex= NULL;
+}
+
+void ParticleEventQueue::addObserverUpdate(int order, ParticleSystem *particleSystem, ParticleObserver *particleObserver) {
+	Event event;
+	event.order= order;
+	event.particleSystem= particleSystem;
+	event.particleObserver= particleObserver;
+	if(running == true) {
+		runEvent(event);
+		return;
+	}
+	MutexSafeWrapper safeMutex(mutex,CODE_AT_LINE);
+	events.push_back(event);
+}
+
+void ParticleEventQueue::addOwnerLog(int order, ParticleSystem *particleSystem, const string &info) {
+	Event event;
+	event.order= order;
+	event.particleSystem= particleSystem;
+	event.info= info;
+	if(running == true) {
+		runEvent(event);
+		return;
+	}
+	MutexSafeWrapper safeMutex(mutex,CODE_AT_LINE);
+	events.push_back(event);
+}
+
+// The system is being deleted, its pending callbacks are dropped the same
+// way its observer would have been deleted with it
+void ParticleEventQueue::cancel(ParticleSystem *particleSystem) {
+	MutexSafeWrapper safeMutex(mutex,CODE_AT_LINE);
+	for(unsigned int i= 0; i < events.size(); ++i) {
+		Event &event= events[i];
+		if(event.particleSystem == particleSystem) {
+			delete event.particleObserver;
+			event.particleObserver= NULL;
+			event.particleSystem= NULL;
+		}
+	}
+}
+
+bool ParticleEventQueue::compareEventOrder(const Event &event1, const Event &event2) {
+	return event1.order < event2.order;
+}
+
+// Only called while no worker thread is updating, callbacks may delete
+// particle systems (cancelling their events) or raise new ones, which then
+// run straight away
+void ParticleEventQueue::run() {
+	std::stable_sort(events.begin(),events.end(),compareEventOrder);
+
+	running= true;
+	for(unsigned int i= 0; i < events.size(); ++i) {
+		Event event= events[i];
+		events[i].particleObserver= NULL;
+		runEvent(event);
+	}
+	running= false;
+	events.clear();
+}
+
+void ParticleEventQueue::runEvent(const Event &event) {
+	if(event.particleSystem == NULL) {
+		return;
+	}
+	if(event.particleObserver != NULL) {
+		event.particleObserver->update(event.particleSystem);
+	}
+	else if(event.particleSystem->getParticleOwner() != NULL) {
+		event.particleSystem->getParticleOwner()->logParticleInfo(event.info);
+	}
+}
+
 void Particle::saveGame(XmlNode *rootNode) {
 	std::map<string,string> mapTagReplacements;
 	XmlNode *particleNode = rootNode->addChild("Particle");
@@ -114,6 +258,9 @@ ParticleSystem::ParticleSystem(int particleCount) {
 	//vars
 	texture= NULL;
 	particleObserver= NULL;
+	eventQueue= NULL;
+	eventOrder= 0;
+	cleanupPending= false;
 
 	//params
 	this->particleCount= particleCount;
@@ -148,6 +295,11 @@ ParticleSystem::~ParticleSystem() {
 	//delete [] particles;
 	particles.clear();
 
+	if(eventQueue != NULL) {
+		eventQueue->cancel(this);
+		eventQueue= NULL;
+	}
+
 	delete particleObserver;
 	particleObserver = NULL;
 }
@@ -157,6 +309,39 @@ void ParticleSystem::callParticleOwnerEnd(ParticleSystem *particleSystem) {
 		this->particleOwner->end(particleSystem);
 	}
 }
+
+void ParticleSystem::setEventQueue(ParticleEventQueue *eventQueue, int eventOrder) {
+	this->eventQueue= eventQueue;
+	this->eventOrder= eventOrder;
+	for(int i=getChildCount()-1; i>=0; i--) {
+		getChild(i)->setEventQueue(eventQueue, eventOrder);
+	}
+}
+
+// Hands the observer its one update, queued when running on a worker thread
+void ParticleSystem::notifyObserver() {
+	if(particleObserver != NULL) {
+		ParticleObserver *observer= particleObserver;
+		particleObserver= NULL;
+		if(eventQueue != NULL) {
+			eventQueue->addObserverUpdate(eventOrder, this, observer);
+		}
+		else {
+			observer->update(this);
+		}
+	}
+}
+
+void ParticleSystem::logParticleInfo(const string &info) {
+	if(particleOwner != NULL) {
+		if(eventQueue != NULL) {
+			eventQueue->addOwnerLog(eventOrder, this, info);
+		}
+		else {
+			particleOwner->logParticleInfo(info);
+		}
+	}
+}
 Checksum ParticleSystem::getCRC() {
 	Checksum crcForParticleSystem;
 
@@ -199,34 +384,26 @@ Checksum ParticleSystem::getCRC() {
 
 //updates all living particles and creates new ones
 void ParticleSystem::update() {
-	if(aliveParticleCount > (int) particles.size()) {
-		throw megaglest_runtime_error("aliveParticleCount >= particles.size()");
+	if(aliveParticleCount > particles.getCount()) {
+		throw megaglest_runtime_error("aliveParticleCount >= particles.getCount()");
 	}
     if(particleSystemStartDelay > 0) {
     	particleSystemStartDelay--;
     }
     else if(state != sPause) {
-		for(int i= 0; i < aliveParticleCount; ++i) {
-			updateParticle(&particles[i]);
-
-			if(deathTest(&particles[i])) {
-
-				//kill the particle
-				killParticle(&particles[i]);
-
-				//maintain alive particles at front of the array
-				if(aliveParticleCount > 0) {
-					particles[i]= particles[aliveParticleCount];
-				}
-			}
-		}
+		updateParticles();
 
 		if(state != ParticleSystem::sFade) {
 			emissionState= emissionState + emissionRate;
 			int emissionIntValue= (int) emissionState;
 			for(int i= 0; i < emissionIntValue; i++){
-				Particle *p= createParticle();
-				initParticle(p, i);
+				// particles are set up one at a time, the slot keeps whatever
+				// attributes initParticle does not overwrite
+				int index= createParticle();
+				Particle p;
+				particles.load(index, p);
+				initParticle(&p, i);
+				particles.store(index, p);
 			}
 			emissionState = emissionState - (float) emissionIntValue;
 			emissionState = truncateDecimal<float>(emissionState,6);
@@ -335,7 +512,7 @@ void ParticleSystem::setVisible(bool visible){
 string ParticleSystem::toString() const {
 	string result = "ParticleSystem ";
 
-	result += "particles = " + intToStr(particles.size());
+	result += "particles = " + intToStr(particles.getCount());
 
 //	for(unsigned int i = 0; i < particles.size(); ++i) {
 //		Particle &particle = particles[i];
@@ -564,10 +741,7 @@ void ParticleSystem::fade(){
 
 	state= sFade;
 	if(alreadyFading == false) {
-		if(particleObserver != NULL){
-			particleObserver->update(this);
-			particleObserver=NULL;
-		}
+		notifyObserver();
 		for(int i=getChildCount()-1; i>=0; i--) {
 			getChild(i)->fade();
 		}
@@ -583,25 +757,26 @@ int ParticleSystem::isEmpty() const {
 
 // if there is one dead particle it returns it else, return the particle with 
 // less energy
-Particle * ParticleSystem::createParticle() {
+int ParticleSystem::createParticle() {
 
 	//if any dead particles
 	if(aliveParticleCount < particleCount) {
 		++aliveParticleCount;
-		return &particles[aliveParticleCount - 1];
+		return aliveParticleCount - 1;
 	}
 
 	//if not
-	int minEnergy= particles[0].energy;
+	const int *energy= &particles.energy[0];
+	int minEnergy= energy[0];
 	int minEnergyParticle= 0;
 
 	for(int i= 0; i < particleCount; ++i){
-		if(particles[i].energy < minEnergy){
-			minEnergy= particles[i].energy;
+		if(energy[i] < minEnergy){
+			minEnergy= energy[i];
 			minEnergyParticle= i;
 		}
 	}
-	return &particles[minEnergyParticle];
+	return minEnergyParticle;
 }
 
 void ParticleSystem::initParticle(Particle *p, int particleIndex) {
@@ -615,19 +790,30 @@ void ParticleSystem::initParticle(Particle *p, int particleIndex) {
 	p->energy= maxParticleEnergy + random.randRange(-varParticleEnergy, varParticleEnergy);
 }
 
-void ParticleSystem::updateParticle(Particle *p) {
-	p->lastPos= p->pos;
-	p->pos= p->pos + p->speed;
-	p->speed= p->speed + p->accel;
-	p->energy--;
+inline void ParticleSystem::updateParticle(ParticleRef p) {
+	p.lastPos= p.pos;
+	p.pos= p.pos + p.speed;
+	p.speed= p.speed + p.accel;
+	p.energy--;
 }
 
-bool ParticleSystem::deathTest(Particle *p) {
-	return p->energy <= 0;
+// Runs the kernel over every living particle. Dead particles are replaced
+// by the last living one, which is then not updated again this frame.
+void ParticleSystem::updateParticles() {
+	for(int i= 0; i < aliveParticleCount; ++i) {
+		updateParticle(ParticleRef(particles, i));
+		if(particles.energy[i] <= 0) {
+			killParticle(i);
+		}
+	}
 }
 
-void ParticleSystem::killParticle(Particle *p) {
+//maintain alive particles at front of the array
+void ParticleSystem::killParticle(int index) {
 	aliveParticleCount--;
+	if(aliveParticleCount > 0) {
+		particles.move(index, aliveParticleCount);
+	}
 }
 
 void ParticleSystem::setFactionColor(Vec3f factionColor){
@@ -697,25 +883,34 @@ void FireParticleSystem::initParticle(Particle *p, int particleIndex){
 
 }
 
-void FireParticleSystem::updateParticle(Particle *p){
-	p->lastPos= p->pos;
-	p->pos= p->pos + p->speed;
-	p->energy--;
+inline void FireParticleSystem::updateParticle(ParticleRef p){
+	p.lastPos= p.pos;
+	p.pos= p.pos + p.speed;
+	p.energy--;
 
-	if(p->color.x > 0.0f)
-		p->color.x*= 0.98f;
-	if(p->color.y > 0.0f)
-		p->color.y*= 0.98f;
-	if(p->color.w > 0.0f)
-		p->color.w*= 0.98f;
+	if(p.color.x > 0.0f)
+		p.color.x*= 0.98f;
+	if(p.color.y > 0.0f)
+		p.color.y*= 0.98f;
+	if(p.color.w > 0.0f)
+		p.color.w*= 0.98f;
 
-	p->speed.x*= 1.001f;
-	p->speed.x = truncateDecimal<float>(p->speed.x,6);
-	p->speed.y = truncateDecimal<float>(p->speed.y,6);
-	p->speed.z = truncateDecimal<float>(p->speed.z,6);
+	p.speed.x*= 1.001f;
+	p.speed.x = truncateDecimal<float>(p.speed.x,6);
+	p.speed.y = truncateDecimal<float>(p.speed.y,6);
+	p.speed.z = truncateDecimal<float>(p.speed.z,6);
 
 }
 
+void FireParticleSystem::updateParticles() {
+	for(int i= 0; i < aliveParticleCount; ++i) {
+		updateParticle(ParticleRef(particles, i));
+		if(particles.energy[i] <= 0) {
+			killParticle(i);
+		}
+	}
+}
+
 string FireParticleSystem::toString() const {
 	string result = ParticleSystem::toString();
 
@@ -1265,11 +1460,11 @@ void UnitParticleSystem::update(){
 	ParticleSystem::update();
 }
 
-void UnitParticleSystem::updateParticle(Particle *p){
+inline void UnitParticleSystem::updateParticle(ParticleRef p){
 	float energyRatio;
 	if(alternations > 0){
 		int interval= (maxParticleEnergy / alternations);
-		float moduloValue= (float)((int)(static_cast<float> (p->energy)) % interval);
+		float moduloValue= (float)((int)(static_cast<float> (p.energy)) % interval);
 		float floatInterval=static_cast<float> (interval);
 
 		if(moduloValue < floatInterval / 2.0f){
@@ -1281,70 +1476,79 @@ void UnitParticleSystem::updateParticle(Particle *p){
 		energyRatio= clamp(energyRatio, 0.f, 1.f);
 	}
 	else{
-		energyRatio= clamp(static_cast<float> (p->energy) / static_cast<float> (maxParticleEnergy), 0.f, 1.f);
+		energyRatio= clamp(static_cast<float> (p.energy) / static_cast<float> (maxParticleEnergy), 0.f, 1.f);
 	}
 
 	energyRatio = truncateDecimal<float>(energyRatio,6);
 
-	p->lastPos += p->speed;
-	p->lastPos.x = truncateDecimal<float>(p->lastPos.x,6);
-	p->lastPos.y = truncateDecimal<float>(p->lastPos.y,6);
-	p->lastPos.z = truncateDecimal<float>(p->lastPos.z,6);
+	p.lastPos += p.speed;
+	p.lastPos.x = truncateDecimal<float>(p.lastPos.x,6);
+	p.lastPos.y = truncateDecimal<float>(p.lastPos.y,6);
+	p.lastPos.z = truncateDecimal<float>(p.lastPos.z,6);
 
-	p->pos += p->speed;
-	p->pos.x = truncateDecimal<float>(p->pos.x,6);
-	p->pos.y = truncateDecimal<float>(p->pos.y,6);
-	p->pos.z = truncateDecimal<float>(p->pos.z,6);
+	p.pos += p.speed;
+	p.pos.x = truncateDecimal<float>(p.pos.x,6);
+	p.pos.y = truncateDecimal<float>(p.pos.y,6);
+	p.pos.z = truncateDecimal<float>(p.pos.z,6);
 
 	if(fixed) {
-		p->lastPos += fixedAddition;
-		p->lastPos.x = truncateDecimal<float>(p->lastPos.x,6);
-		p->lastPos.y = truncateDecimal<float>(p->lastPos.y,6);
-		p->lastPos.z = truncateDecimal<float>(p->lastPos.z,6);
-
-		p->pos += fixedAddition;
-		p->pos.x = truncateDecimal<float>(p->pos.x,6);
-		p->pos.y = truncateDecimal<float>(p->pos.y,6);
-		p->pos.z = truncateDecimal<float>(p->pos.z,6);
-	}
-	p->speed += p->accel;
-	p->speed += p->speedUpConstant;
-	p->speed=p->speed*(1+p->speedUpRelative);
-	p->speed.x = truncateDecimal<float>(p->speed.x,6);
-	p->speed.y = truncateDecimal<float>(p->speed.y,6);
-	p->speed.z = truncateDecimal<float>(p->speed.z,6);
-
-	p->color= color * energyRatio + colorNoEnergy * (1.0f - energyRatio);
+		p.lastPos += fixedAddition;
+		p.lastPos.x = truncateDecimal<float>(p.lastPos.x,6);
+		p.lastPos.y = truncateDecimal<float>(p.lastPos.y,6);
+		p.lastPos.z = truncateDecimal<float>(p.lastPos.z,6);
+
+		p.pos += fixedAddition;
+		p.pos.x = truncateDecimal<float>(p.pos.x,6);
+		p.pos.y = truncateDecimal<float>(p.pos.y,6);
+		p.pos.z = truncateDecimal<float>(p.pos.z,6);
+	}
+	p.speed += p.accel;
+	p.speed += p.speedUpConstant;
+	p.speed=p.speed*(1+p.speedUpRelative);
+	p.speed.x = truncateDecimal<float>(p.speed.x,6);
+	p.speed.y = truncateDecimal<float>(p.speed.y,6);
+	p.speed.z = truncateDecimal<float>(p.speed.z,6);
+
+	p.color= color * energyRatio + colorNoEnergy * (1.0f - energyRatio);
 	if(isDaylightAffected==true) {
-		p->color.x=p->color.x*lightColor.x;
-		p->color.y=p->color.y*lightColor.y;
-		p->color.z=p->color.z*lightColor.z;
+		p.color.x=p.color.x*lightColor.x;
+		p.color.y=p.color.y*lightColor.y;
+		p.color.z=p.color.z*lightColor.z;
 	}
-	p->size= particleSize * energyRatio + sizeNoEnergy * (1.0f - energyRatio);
-	p->size = truncateDecimal<float>(p->size,6);
+	p.size= particleSize * energyRatio + sizeNoEnergy * (1.0f - energyRatio);
+	p.size = truncateDecimal<float>(p.size,6);
 
 	if(state == ParticleSystem::sFade || staticParticleCount < 1){
-		p->energy--;
+		p.energy--;
 	}
 	else{
 		if(maxParticleEnergy > 2){
 			if(energyUp){
-				p->energy++;
+				p.energy++;
 			}
 			else{
-				p->energy--;
+				p.energy--;
 			}
 
-			if(p->energy == 1){
+			if(p.energy == 1){
 				energyUp= true;
 			}
-			if(p->energy == maxParticleEnergy){
+			if(p.energy == maxParticleEnergy){
 				energyUp= false;
 			}
 		}
 	}
 }
 
+void UnitParticleSystem::updateParticles() {
+	for(int i= 0; i < aliveParticleCount; ++i) {
+		updateParticle(ParticleRef(particles, i));
+		if(particles.energy[i] <= 0) {
+			killParticle(i);
+		}
+	}
+}
+
 // ================= SET PARAMS ====================
 
 void UnitParticleSystem::setWind(float windAngle, float windSpeed){
@@ -1588,8 +1792,13 @@ void RainParticleSystem::initParticle(Particle *p, int particleIndex){
 	p->speed.z = truncateDecimal<float>(p->speed.z,6);
 }
 
-bool RainParticleSystem::deathTest(Particle *p){
-	return p->pos.y < 0;
+void RainParticleSystem::updateParticles(){
+	for(int i= 0; i < aliveParticleCount; ++i) {
+		ParticleSystem::updateParticle(ParticleRef(particles, i));
+		if(particles.pos[i].y < 0) {
+			killParticle(i);
+		}
+	}
 }
 
 void RainParticleSystem::setRadius(float radius) {
@@ -1667,8 +1876,13 @@ void SnowParticleSystem::initParticle(Particle *p, int particleIndex){
 	p->speed.z = truncateDecimal<float>(p->speed.z,6);
 }
 
-bool SnowParticleSystem::deathTest(Particle *p){
-	return p->pos.y < 0;
+void SnowParticleSystem::updateParticles(){
+	for(int i= 0; i < aliveParticleCount; ++i) {
+		ParticleSystem::updateParticle(ParticleRef(particles, i));
+		if(particles.pos[i].y < 0) {
+			killParticle(i);
+		}
+	}
 }
 
 void SnowParticleSystem::setRadius(float radius){
@@ -1796,6 +2010,13 @@ void ProjectileParticleSystem::link(SplashParticleSystem *particleSystem){
 	nextParticleSystem->prevParticleSystem= this;
 }
 
+void ProjectileParticleSystem::setEventQueue(ParticleEventQueue *eventQueue, int eventOrder) {
+	AttackParticleSystem::setEventQueue(eventQueue, eventOrder);
+	if(nextParticleSystem != NULL) {
+		nextParticleSystem->setEventQueue(eventQueue, eventOrder);
+	}
+}
+
 void ProjectileParticleSystem::update(){
 	//printf("Projectile particle system updating...\n");
 	if(state == sPlay){
@@ -1888,17 +2109,14 @@ void ProjectileParticleSystem::update(){
 		if(this->particleOwner != NULL) {
 			char szBuf[8096]="";
 			snprintf(szBuf,8095,"LINE: %d arriveDestinationDistance = %f",__LINE__,arriveDestinationDistance);
-			this->particleOwner->logParticleInfo(szBuf);
+			logParticleInfo(szBuf);
 		}
 
 		if(arriveDestinationDistance < 0.5f) {
 			fade();
 			model= NULL;
 
-			if(particleObserver != NULL){
-				particleObserver->update(this);
-				particleObserver=NULL;
-			}
+			notifyObserver();
 
 			if(nextParticleSystem != NULL){
 				nextParticleSystem->setVisible(getVisible());
@@ -1947,32 +2165,41 @@ void ProjectileParticleSystem::initParticle(Particle *p, int particleIndex){
 	p->accel.y = truncateDecimal<float>(p->accel.y,6);
 	p->accel.z = truncateDecimal<float>(p->accel.z,6);
 
-	updateParticle(p);
+	updateParticle(ParticleRef(*p));
 }
 
-void ProjectileParticleSystem::updateParticle(Particle *p){
-	float energyRatio= clamp(static_cast<float> (p->energy) / maxParticleEnergy, 0.f, 1.f);
+inline void ProjectileParticleSystem::updateParticle(ParticleRef p){
+	float energyRatio= clamp(static_cast<float> (p.energy) / maxParticleEnergy, 0.f, 1.f);
 	energyRatio = truncateDecimal<float>(energyRatio,6);
 
-	p->lastPos += p->speed;
-	p->lastPos.x = truncateDecimal<float>(p->lastPos.x,6);
-	p->lastPos.y = truncateDecimal<float>(p->lastPos.y,6);
-	p->lastPos.z = truncateDecimal<float>(p->lastPos.z,6);
+	p.lastPos += p.speed;
+	p.lastPos.x = truncateDecimal<float>(p.lastPos.x,6);
+	p.lastPos.y = truncateDecimal<float>(p.lastPos.y,6);
+	p.lastPos.z = truncateDecimal<float>(p.lastPos.z,6);
 
-	p->pos += p->speed;
-	p->pos.x = truncateDecimal<float>(p->pos.x,6);
-	p->pos.y = truncateDecimal<float>(p->pos.y,6);
-	p->pos.z = truncateDecimal<float>(p->pos.z,6);
+	p.pos += p.speed;
+	p.pos.x = truncateDecimal<float>(p.pos.x,6);
+	p.pos.y = truncateDecimal<float>(p.pos.y,6);
+	p.pos.z = truncateDecimal<float>(p.pos.z,6);
 
-	p->speed += p->accel;
-	p->speed.x = truncateDecimal<float>(p->speed.x,6);
-	p->speed.y = truncateDecimal<float>(p->speed.y,6);
-	p->speed.z = truncateDecimal<float>(p->speed.z,6);
+	p.speed += p.accel;
+	p.speed.x = truncateDecimal<float>(p.speed.x,6);
+	p.speed.y = truncateDecimal<float>(p.speed.y,6);
+	p.speed.z = truncateDecimal<float>(p.speed.z,6);
 
-	p->color= color * energyRatio + colorNoEnergy * (1.0f - energyRatio);
-	p->size = particleSize * energyRatio + sizeNoEnergy * (1.0f - energyRatio);
-	p->size = truncateDecimal<float>(p->size,6);
-	p->energy--;
+	p.color= color * energyRatio + colorNoEnergy * (1.0f - energyRatio);
+	p.size = particleSize * energyRatio + sizeNoEnergy * (1.0f - energyRatio);
+	p.size = truncateDecimal<float>(p.size,6);
+	p.energy--;
+}
+
+void ProjectileParticleSystem::updateParticles() {
+	for(int i= 0; i < aliveParticleCount; ++i) {
+		updateParticle(ParticleRef(particles, i));
+		if(particles.energy[i] <= 0) {
+			killParticle(i);
+		}
+	}
 }
 
 void ProjectileParticleSystem::setPath(Vec3f startPos, Vec3f endPos) {
@@ -2228,7 +2455,7 @@ void SplashParticleSystem::update() {
 		if(this->particleOwner != NULL) {
 			char szBuf[8096]="";
 			snprintf(szBuf,8095,"LINE: %d emissionRate = %f",__LINE__,emissionRate);
-			this->particleOwner->logParticleInfo(szBuf);
+			logParticleInfo(szBuf);
 		}
 
 		if(emissionRate < 0.0f) {//otherwise this system lives forever!
@@ -2270,26 +2497,35 @@ void SplashParticleSystem::initParticle(Particle *p, int particleIndex){
 	p->speedUpConstant= Vec3f(speedUpConstant)*p->speed;
 }
 
-void SplashParticleSystem::updateParticle(Particle *p){
-	float energyRatio= clamp(static_cast<float> (p->energy) / maxParticleEnergy, 0.f, 1.f);
+inline void SplashParticleSystem::updateParticle(ParticleRef p){
+	float energyRatio= clamp(static_cast<float> (p.energy) / maxParticleEnergy, 0.f, 1.f);
 
-	p->lastPos= p->pos;
-	p->pos= p->pos + p->speed;
-	p->pos.x = truncateDecimal<float>(p->pos.x,6);
-	p->pos.y = truncateDecimal<float>(p->pos.y,6);
-	p->pos.z = truncateDecimal<float>(p->pos.z,6);
+	p.lastPos= p.pos;
+	p.pos= p.pos + p.speed;
+	p.pos.x = truncateDecimal<float>(p.pos.x,6);
+	p.pos.y = truncateDecimal<float>(p.pos.y,6);
+	p.pos.z = truncateDecimal<float>(p.pos.z,6);
 
-	p->speed += p->speedUpConstant;
-	p->speed=p->speed*(1+p->speedUpRelative);
-	p->speed= p->speed + p->accel;
-	p->speed.x = truncateDecimal<float>(p->speed.x,6);
-	p->speed.y = truncateDecimal<float>(p->speed.y,6);
-	p->speed.z = truncateDecimal<float>(p->speed.z,6);
+	p.speed += p.speedUpConstant;
+	p.speed=p.speed*(1+p.speedUpRelative);
+	p.speed= p.speed + p.accel;
+	p.speed.x = truncateDecimal<float>(p.speed.x,6);
+	p.speed.y = truncateDecimal<float>(p.speed.y,6);
+	p.speed.z = truncateDecimal<float>(p.speed.z,6);
 
-	p->energy--;
-	p->color= color * energyRatio + colorNoEnergy * (1.0f - energyRatio);
-	p->size= particleSize * energyRatio + sizeNoEnergy * (1.0f - energyRatio);
-	p->size = truncateDecimal<float>(p->size,6);
+	p.energy--;
+	p.color= color * energyRatio + colorNoEnergy * (1.0f - energyRatio);
+	p.size= particleSize * energyRatio + sizeNoEnergy * (1.0f - energyRatio);
+	p.size = truncateDecimal<float>(p.size,6);
+}
+
+void SplashParticleSystem::updateParticles() {
+	for(int i= 0; i < aliveParticleCount; ++i) {
+		updateParticle(ParticleRef(particles, i));
+		if(particles.energy[i] <= 0) {
+			killParticle(i);
+		}
+	}
 }
 
 void SplashParticleSystem::saveGame(XmlNode *rootNode) {
@@ -2377,11 +2613,105 @@ string SplashParticleSystem::toString() const {
 //  ParticleManager
 // ===========================================================================
 
+// Updates batches of particle system groups handed out by the manager
+class ParticleUpdateThread : public BaseThread, public SlaveThreadControllerInterface {
+private:
+	ParticleManager *manager;
+	Semaphore semTaskSignalled;
+	MasterSlaveThreadController *masterController;
+
+public:
+	explicit ParticleUpdateThread(ParticleManager *manager) : BaseThread() {
+		this->manager= manager;
+		this->masterController= NULL;
+		setUniqueID(string(__FILE__) + "_ParticleUpdateThread");
+	}
+
+	virtual void setQuitStatus(bool value) {
+		BaseThread::setQuitStatus(value);
+		if(value == true) {
+			semTaskSignalled.signal();
+		}
+	}
+
+	virtual void setMasterController(MasterSlaveThreadController *master) { masterController= master; }
+	virtual void signalSlave(void *userdata) { semTaskSignalled.signal(); }
+
+	virtual void execute() {
+		RunningStatusSafeWrapper runningStatus(this);
+		for(;;) {
+			if(getQuitStatus() == true) {
+				break;
+			}
+			semTaskSignalled.waitTillSignalled();
+			if(getQuitStatus() == true) {
+				break;
+			}
+
+			MasterSlaveThreadControllerSafeWrapper safeMasterController(masterController,20000);
+			ExecutingTaskSafeWrapper safeExecutingTask(this);
+			manager->runUpdateBatches();
+		}
+	}
+};
+
+const int ParticleManager::maxUpdateThreads= 8;
+const int ParticleManager::minSystemsPerBatch= 16;
+
 ParticleManager::ParticleManager() {
+	updateGroupCount= 0;
+	updateBatchSize= 1;
+	nextUpdateGroup= 0;
+	updateController= NULL;
+	updateMutex= new Mutex(CODE_AT_LINE);
 }
 
 ParticleManager::~ParticleManager() {
+	stopUpdateThreads();
 	end();
+	delete updateMutex;
+	updateMutex= NULL;
+}
+
+// threadCount < 0 picks one thread per extra core. With 0 threads the
+// same grouped update runs on the calling thread, so the outcome never
+// depends on the number of threads
+void ParticleManager::setUpdateThreadCount(int threadCount) {
+	if(threadCount < 0) {
+		threadCount= SDL_GetCPUCount() - 1;
+	}
+	threadCount= max(0, min(threadCount, maxUpdateThreads));
+	if(threadCount == (int)updateThreads.size()) {
+		return;
+	}
+
+	stopUpdateThreads();
+	if(threadCount > 0) {
+		std::vector<SlaveThreadControllerInterface *> slaveThreadList;
+		for(int i= 0; i < threadCount; ++i) {
+			ParticleUpdateThread *thread= new ParticleUpdateThread(this);
+			updateThreads.push_back(thread);
+			slaveThreadList.push_back(thread);
+			thread->start();
+		}
+		updateController= new MasterSlaveThreadController(slaveThreadList);
+	}
+}
+
+void ParticleManager::stopUpdateThreads() {
+	if(updateController != NULL) {
+		updateController->clearSlaves();
+	}
+	for(unsigned int i= 0; i < updateThreads.size(); ++i) {
+		ParticleUpdateThread *thread= updateThreads[i];
+		thread->signalQuit();
+		if(thread->shutdownAndWait() == true) {
+			delete thread;
+		}
+	}
+	updateThreads.clear();
+	delete updateController;
+	updateController= NULL;
 }
 
 void ParticleManager::render(ParticleRenderer *pr, ModelRenderer *mr) const{
@@ -2406,8 +2736,9 @@ bool ParticleManager::hasActiveParticleSystem(ParticleSystem::ParticleSystemType
 			//currentParticleCount+= ps->getAliveParticleCount();
 
 			bool showParticle= true;
-			if(dynamic_cast<UnitParticleSystem *> (ps) != NULL ||
-			   dynamic_cast<FireParticleSystem *> (ps) != NULL) {
+			ParticleSystem::ParticleSystemType psType= ps->getParticleSystemType();
+			if(psType == ParticleSystem::pst_UnitParticleSystem ||
+			   psType == ParticleSystem::pst_FireParticleSystem) {
 				showParticle= ps->getVisible() || (ps->getState() == ParticleSystem::sFade);
 			}
 			if(showParticle == true){
@@ -2425,6 +2756,11 @@ bool ParticleManager::hasActiveParticleSystem(ParticleSystem::ParticleSystemType
 	return result;
 }
 
+// Systems are updated in groups: a system together with its parent and
+// child systems and the projectile/splash pair it belongs to. Groups only
+// change their own members, so they are spread over the update threads.
+// Observer and owner callbacks are queued while the groups update and run
+// afterwards on this thread in list order, followed by the cleanup.
 void ParticleManager::update(int renderFps){
 	Chrono chrono;
 	if(SystemFlags::getSystemSettingType(SystemFlags::debugPerformance).enabled) chrono.start();
@@ -2432,22 +2768,34 @@ void ParticleManager::update(int renderFps){
 	size_t particleSystemCount= particleSystems.size();
 	int currentParticleCount= 0;
 
+	buildUpdateGroups();
+	updateError= "";
+
+	if(updateController != NULL && updateGroupCount > updateBatchSize) {
+		updateController->signalSlaves(NULL);
+		runUpdateBatches();
+		if(updateController->waitTillSlavesTrigger(20000) == false) {
+			throw megaglest_runtime_error("Particle update threads did not finish in time");
+		}
+	}
+	else {
+		runUpdateBatches();
+	}
+	if(updateError != "") {
+		throw megaglest_runtime_error(updateError);
+	}
+
+	updateEvents.run();
+
 	vector<ParticleSystem *> cleanupParticleSystemsList;
 	for(unsigned int i= 0; i < particleSystems.size(); i++){
 		ParticleSystem *ps= particleSystems[i];
 		if(ps != NULL) {
+			ps->setEventQueue(NULL, 0);
 			currentParticleCount+= ps->getAliveParticleCount();
-
-			bool showParticle= true;
-			if( dynamic_cast<UnitParticleSystem *> (ps) != NULL ||
-				dynamic_cast<FireParticleSystem *> (ps) != NULL) {
-				showParticle = ps->getVisible() || (ps->getState() == ParticleSystem::sFade);
-			}
-			if(showParticle == true){
-				ps->update();
-				if(ps->isEmpty() && ps->getState() == ParticleSystem::sFade) {
-					cleanupParticleSystemsList.push_back(ps);
-				}
+			if(ps->getCleanupPending() == true) {
+				ps->setCleanupPending(false);
+				cleanupParticleSystemsList.push_back(ps);
 			}
 		}
 	}
@@ -2458,6 +2806,105 @@ void ParticleManager::update(int renderFps){
 		SystemFlags::OutputDebug(SystemFlags::debugPerformance,"In [%s::%s] Line: %d took msecs: %lld, particleSystemCount = %d, currentParticleCount = %d\n",__FILE__,__FUNCTION__,__LINE__,chrono.getMillis(),particleSystemCount,currentParticleCount);
 }
 
+ParticleSystem * ParticleManager::getUpdateRoot(ParticleSystem *ps) {
+	for(;;) {
+		ParticleSystem *parent= NULL;
+		switch(ps->getParticleSystemType()) {
+			case ParticleSystem::pst_UnitParticleSystem:
+				parent= static_cast<UnitParticleSystem *>(ps)->getParent();
+				break;
+			case ParticleSystem::pst_SplashParticleSystem:
+				parent= static_cast<SplashParticleSystem *>(ps)->getPrevParticleSystem();
+				break;
+			default:
+				break;
+		}
+		if(parent == NULL) {
+			return ps;
+		}
+		ps= parent;
+	}
+}
+
+void ParticleManager::buildUpdateGroups() {
+	std::map<ParticleSystem *,int> groupByRoot;
+	updateGroupCount= 0;
+	for(unsigned int i= 0; i < particleSystems.size(); i++){
+		ParticleSystem *ps= particleSystems[i];
+		if(ps == NULL) {
+			continue;
+		}
+		int groupIndex= updateGroupCount;
+		std::pair<std::map<ParticleSystem *,int>::iterator,bool> inserted=
+				groupByRoot.insert(std::make_pair(getUpdateRoot(ps),groupIndex));
+		if(inserted.second == true) {
+			if(updateGroupCount >= (int)updateGroups.size()) {
+				updateGroups.push_back(vector<int>());
+			}
+			updateGroups[updateGroupCount].clear();
+			updateGroupCount++;
+		}
+		else {
+			groupIndex= inserted.first->second;
+		}
+		updateGroups[groupIndex].push_back(i);
+	}
+
+	int threadCount= (int)updateThreads.size() + 1;
+	updateBatchSize= max(minSystemsPerBatch, updateGroupCount / (threadCount * 4));
+	nextUpdateGroup= 0;
+}
+
+bool ParticleManager::takeUpdateBatch(int &firstGroup, int &lastGroup) {
+	MutexSafeWrapper safeMutex(updateMutex,CODE_AT_LINE);
+	if(nextUpdateGroup >= updateGroupCount || updateError != "") {
+		return false;
+	}
+	firstGroup= nextUpdateGroup;
+	lastGroup= min(updateGroupCount, nextUpdateGroup + updateBatchSize);
+	nextUpdateGroup= lastGroup;
+	return true;
+}
+
+void ParticleManager::runUpdateBatches() {
+	try {
+		int firstGroup= 0;
+		int lastGroup= 0;
+		while(takeUpdateBatch(firstGroup, lastGroup) == true) {
+			for(int i= firstGroup; i < lastGroup; ++i) {
+				updateGroup(i);
+			}
+		}
+	}
+	catch(const exception &ex) {
+		MutexSafeWrapper safeMutex(updateMutex,CODE_AT_LINE);
+		if(updateError == "") {
+			updateError= ex.what();
+		}
+	}
+}
+
+void ParticleManager::updateGroup(int groupIndex) {
+	const vector<int> &group= updateGroups[groupIndex];
+	for(unsigned int i= 0; i < group.size(); ++i) {
+		ParticleSystem *ps= particleSystems[group[i]];
+		ps->setEventQueue(&updateEvents, group[i]);
+
+		bool showParticle= true;
+		ParticleSystem::ParticleSystemType psType= ps->getParticleSystemType();
+		if(psType == ParticleSystem::pst_UnitParticleSystem ||
+		   psType == ParticleSystem::pst_FireParticleSystem) {
+			showParticle = ps->getVisible() || (ps->getState() == ParticleSystem::sFade);
+		}
+		if(showParticle == true){
+			ps->update();
+			if(ps->isEmpty() && ps->getState() == ParticleSystem::sFade) {
+				ps->setCleanupPending(true);
+			}
+		}
+	}
+}
+
 bool ParticleManager::validateParticleSystemStillExists(ParticleSystem * particleSystem) const{
 	int index= findParticleSystems(particleSystem, this->particleSystems);
 	return (index >= 0);
@@ -1298,20 +1298,18 @@ float splatDist(Vec2i a, Vec2i b){
 	return (max(abs(a.x-b.x),abs(a.y- b.y)) + 3.f*a.dist(b))/4.f;
 }
 
-void Pixmap2D::splat(const Pixmap2D *leftUp, const Pixmap2D *rightUp, const Pixmap2D *leftDown, const Pixmap2D *rightDown){
-
-	RandomGen random;
+// =====================================================
+//	class SplatWeights
+// =====================================================
 
-	assert(components==3 || components==4);
+SplatWeights::SplatWeights(int w, int h) {
+	this->w= w;
+	this->h= h;
+	weights.resize(w*h);
 
-	if(
-		!doDimensionsAgree(leftUp) ||
-		!doDimensionsAgree(rightUp) ||
-		!doDimensionsAgree(leftDown) ||
-		!doDimensionsAgree(rightDown))
-	{
-		throw megaglest_runtime_error("Pixmap2D::splat: pixmap dimensions don't agree");
-	}
+	// The random weights are drawn column by column from a fresh generator,
+	// keep that order so splats look exactly as before
+	RandomGen random;
 
 	for(int i=0; i<w; ++i){
 		for(int j=0; j<h; ++j){
@@ -1331,21 +1329,73 @@ void Pixmap2D::splat(const Pixmap2D *leftUp, const Pixmap2D *rightUp, const Pixm
 			distRd	= std::pow(distRd, powFactor);
 			avg		= std::pow(avg, powFactor);
 
-			float lu= distLu>avg? 0: ((avg-distLu))*random.randRange(0.5f, 1.0f);
-			float ru= distRu>avg? 0: ((avg-distRu))*random.randRange(0.5f, 1.0f);
-			float ld= distLd>avg? 0: ((avg-distLd))*random.randRange(0.5f, 1.0f);
-			float rd= distRd>avg? 0: ((avg-distRd))*random.randRange(0.5f, 1.0f);
+			Weight &weight= weights[w*j+i];
+			weight.leftUp= distLu>avg? 0: ((avg-distLu))*random.randRange(0.5f, 1.0f);
+			weight.rightUp= distRu>avg? 0: ((avg-distRu))*random.randRange(0.5f, 1.0f);
+			weight.leftDown= distLd>avg? 0: ((avg-distLd))*random.randRange(0.5f, 1.0f);
+			weight.rightDown= distRd>avg? 0: ((avg-distRd))*random.randRange(0.5f, 1.0f);
+
+			float total= weight.leftUp+weight.rightUp+weight.leftDown+weight.rightDown;
+			weight.scale= 1.0f/total;
+		}
+	}
+}
+
+// =====================================================
+//	class Pixmap2D
+// =====================================================
+
+void Pixmap2D::splat(const Pixmap2D *leftUp, const Pixmap2D *rightUp, const Pixmap2D *leftDown, const Pixmap2D *rightDown){
+	SplatWeights weights(w, h);
+	splat(leftUp, rightUp, leftDown, rightDown, weights);
+}
 
-			float total= lu+ru+ld+rd;
+void Pixmap2D::splat(const Pixmap2D *leftUp, const Pixmap2D *rightUp, const Pixmap2D *leftDown, const Pixmap2D *rightDown, const SplatWeights &weights){
 
-			Vec4f pix= (leftUp->getPixel4f(i, j)*lu+
-				rightUp->getPixel4f(i, j)*ru+
-				leftDown->getPixel4f(i, j)*ld+
-				rightDown->getPixel4f(i, j)*rd)*(1.0f/total);
+	assert(components==3 || components==4);
 
-			setPixel(i, j, pix);
+	if(
+		!doDimensionsAgree(leftUp) ||
+		!doDimensionsAgree(rightUp) ||
+		!doDimensionsAgree(leftDown) ||
+		!doDimensionsAgree(rightDown))
+	{
+		throw megaglest_runtime_error("Pixmap2D::splat: pixmap dimensions don't agree");
+	}
+	if(weights.getW() != w || weights.getH() != h) {
+		throw megaglest_runtime_error("Pixmap2D::splat: splat weights dimensions don't agree");
+	}
+
+	const Pixmap2D *sources[4]= { leftUp, rightUp, leftDown, rightDown };
+	const int channelCount= min(components, 4);
+
+	// Row major straight over the pixel arrays. A channel the source does
+	// not have counts as 0, like in getPixel4f
+	float source[4][4];
+	for(int j=0; j<h; ++j){
+		for(int i=0; i<w; ++i){
+			const SplatWeights::Weight &weight= weights.getWeight(i, j);
+			const int pixelIndex= w*j+i;
+
+			for(int sourceIndex=0; sourceIndex<4; ++sourceIndex){
+				const Pixmap2D *pixmap= sources[sourceIndex];
+				const uint8 *sourcePixel= &pixmap->pixels[pixelIndex*pixmap->components];
+				for(int channel=0; channel<4; ++channel){
+					source[sourceIndex][channel]= channel<pixmap->components? sourcePixel[channel] / 255.f: 0.f;
+				}
+			}
+
+			uint8 *targetPixel= &pixels[pixelIndex*components];
+			for(int channel=0; channel<channelCount; ++channel){
+				float value= (source[0][channel]*weight.leftUp+
+					source[1][channel]*weight.rightUp+
+					source[2][channel]*weight.leftDown+
+					source[3][channel]*weight.rightDown)*weight.scale;
+				targetPixel[channel]= static_cast<uint8>(value * 255.f);
+			}
 		}
 	}
+	CalculatePixelsCRC(pixels,getPixelByteCount(), crc);
 }
 
 void Pixmap2D::lerp(float t, const Pixmap2D *pixmap1, const Pixmap2D *pixmap2){
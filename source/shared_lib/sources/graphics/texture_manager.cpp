@@ -13,6 +13,7 @@
 
 #include <cstdlib>
 #include <stdexcept>
+#include <algorithm>
 
 #include "graphics_interface.h"
 #include "graphics_factory.h"
@@ -64,6 +65,7 @@ void TextureManager::endTexture(Texture *texture,bool mustExistInList) {
 		if(found == false && mustExistInList == true) {
 			throw std::runtime_error("found == false in endTexture");
 		}
+		removeTexture(texture);
 		texture->end();
 		delete texture;
 	}
@@ -76,6 +78,7 @@ void TextureManager::endLastTexture(bool mustExistInList) {
 		int index = (int)textures.size()-1;
 		Texture *curTexture = textures[index];
 		textures.erase(textures.begin() + index);
+		removeTexture(curTexture);
 
 		curTexture->end();
 		delete curTexture;
@@ -85,6 +88,25 @@ void TextureManager::endLastTexture(bool mustExistInList) {
 	}
 }
 
+void TextureManager::endTextures(const set<Texture *> &endList) {
+	if(endList.empty() == true) {
+		return;
+	}
+	TextureContainer keptTextures;
+	for(unsigned int i = 0; i < textures.size(); ++i) {
+		Texture *texture = textures[i];
+		if(endList.find(texture) == endList.end()) {
+			keptTextures.push_back(texture);
+		}
+		else if(texture != NULL) {
+			removeTexture(texture);
+			texture->end();
+			delete texture;
+		}
+	}
+	textures.swap(keptTextures);
+}
+
 void TextureManager::init(bool forceInit) {
 	for(unsigned int i=0; i<textures.size(); ++i){
 		Texture *texture = textures[i];
@@ -109,6 +131,10 @@ void TextureManager::end(){
 		}
 	}
 	textures.clear();
+	texturesByPath.clear();
+	indexedPaths.clear();
+	unindexedTextures.clear();
+	duplicateTextures.clear();
 }
 
 void TextureManager::setFilter(Texture::Filter textureFilter){
@@ -119,32 +145,102 @@ void TextureManager::setMaxAnisotropy(int maxAnisotropy){
 	this->maxAnisotropy= maxAnisotropy;
 }
 
+void TextureManager::addTexture(Texture *texture) {
+	textures.push_back(texture);
+	unindexedTextures.push_back(texture);
+}
+
+void TextureManager::removeTexture(Texture *texture) {
+	unindexTexture(texture);
+	unindexedTextures.erase(std::remove(unindexedTextures.begin(), unindexedTextures.end(), texture),
+							unindexedTextures.end());
+	duplicateTextures.erase(std::remove(duplicateTextures.begin(), duplicateTextures.end(), texture),
+							duplicateTextures.end());
+}
+
+void TextureManager::indexTexture(Texture *texture, const string &path) {
+	// the first texture loaded from a path wins, like the old linear search
+	if(texturesByPath.find(path) != texturesByPath.end()) {
+		duplicateTextures.push_back(texture);
+	}
+	else {
+		texturesByPath[path] = texture;
+		indexedPaths[texture] = path;
+	}
+}
+
+void TextureManager::unindexTexture(Texture *texture) {
+	map<Texture *, string>::iterator iterPath = indexedPaths.find(texture);
+	if(iterPath == indexedPaths.end()) {
+		return;
+	}
+	string path = iterPath->second;
+	texturesByPath.erase(path);
+	indexedPaths.erase(iterPath);
+
+	// the next texture loaded from the same path takes its place
+	for(unsigned int i = 0; i < duplicateTextures.size(); ++i) {
+		Texture *duplicate = duplicateTextures[i];
+		if(duplicate != texture && duplicate->getPath() == path) {
+			duplicateTextures.erase(duplicateTextures.begin() + i);
+			texturesByPath[path] = duplicate;
+			indexedPaths[duplicate] = path;
+			break;
+		}
+	}
+}
+
+void TextureManager::indexTextures() {
+	for(unsigned int i = 0; i < unindexedTextures.size(); ++i) {
+		Texture *texture = unindexedTextures[i];
+		string path = texture->getPath();
+		if(path != "") {
+			indexTexture(texture, path);
+		}
+	}
+	unindexedTextures.clear();
+}
+
 Texture *TextureManager::getTexture(const string &path){
-	for(unsigned int i=0; i<textures.size(); ++i){
-		if(textures[i]->getPath()==path){
-			return textures[i];
+	map<string, Texture *>::iterator iterFind = texturesByPath.find(path);
+	if(iterFind != texturesByPath.end()) {
+		Texture *texture = iterFind->second;
+		if(texture->getPath() == path) {
+			return texture;
 		}
+		// reloaded from another file since it was indexed
+		unindexTexture(texture);
+		string newPath = texture->getPath();
+		if(newPath != "") {
+			indexTexture(texture, newPath);
+		}
+	}
+
+	indexTextures();
+	iterFind = texturesByPath.find(path);
+	if(iterFind != texturesByPath.end()) {
+		return iterFind->second;
 	}
 	return NULL;
 }
 
 Texture1D *TextureManager::newTexture1D(){
 	Texture1D *texture1D= GraphicsInterface::getInstance().getFactory()->newTexture1D();
-	textures.push_back(texture1D);
+	addTexture(texture1D);
 
 	return texture1D;
 }
 
 Texture2D *TextureManager::newTexture2D(){
 	Texture2D *texture2D= GraphicsInterface::getInstance().getFactory()->newTexture2D();
-	textures.push_back(texture2D);
+	addTexture(texture2D);
 
 	return texture2D;
 }
 
 Texture3D *TextureManager::newTexture3D(){
 	Texture3D *texture3D= GraphicsInterface::getInstance().getFactory()->newTexture3D();
-	textures.push_back(texture3D);
+	addTexture(texture3D);
 
 	return texture3D;
 }
@@ -152,7 +248,7 @@ Texture3D *TextureManager::newTexture3D(){
 
 TextureCube *TextureManager::newTextureCube(){
 	TextureCube *textureCube= GraphicsInterface::getInstance().getFactory()->newTextureCube();
-	textures.push_back(textureCube);
+	addTexture(textureCube);
 
 	return textureCube;
 }
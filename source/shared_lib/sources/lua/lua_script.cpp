@@ -47,6 +47,7 @@ public:
 
 bool LuaScript::disableSandbox = false;
 bool LuaScript::debugModeEnabled = false;
+const int LuaScript::noFunctionRef = LUA_NOREF;
 
 LuaScript::LuaScript() {
 	Lua_STREFLOP_Wrapper streflopWrapper;
@@ -608,6 +609,38 @@ void LuaScript::beginCall(string functionName) {
 	argumentCount= 0;
 }
 
+int LuaScript::getFunctionRef(const string &functionName) {
+	Lua_STREFLOP_Wrapper streflopWrapper;
+
+	lua_getglobal(luaState, functionName.c_str());
+	if(lua_isfunction(luaState,lua_gettop(luaState)) == false) {
+		lua_pop(luaState, 1);
+		return noFunctionRef;
+	}
+	return luaL_ref(luaState, LUA_REGISTRYINDEX);
+}
+
+void LuaScript::releaseFunctionRef(int functionRef) {
+	Lua_STREFLOP_Wrapper streflopWrapper;
+
+	if(functionRef != noFunctionRef) {
+		luaL_unref(luaState, LUA_REGISTRYINDEX, functionRef);
+	}
+}
+
+void LuaScript::beginCall(int functionRef, const string &functionName) {
+	Lua_STREFLOP_Wrapper streflopWrapper;
+
+	currentLuaFunction = functionName;
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugLUA).enabled) SystemFlags::OutputDebug(SystemFlags::debugLUA,"In [%s::%s Line: %d] functionName [%s]\n",__FILE__,__FUNCTION__,__LINE__,functionName.c_str());
+
+	lua_rawgeti(luaState, LUA_REGISTRYINDEX, functionRef);
+
+	currentLuaFunctionIsValid = lua_isfunction(luaState,lua_gettop(luaState));
+	argumentCount= 0;
+}
+
 void LuaScript::endCall() {
 	Lua_STREFLOP_Wrapper streflopWrapper;
 
@@ -0,0 +1,221 @@
+// ==============================================================
+//	This file is part of Glest Shared Library (www.glest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include "job_system.h"
+#include "platform_common.h"
+#include "util.h"
+#include "platform_util.h"
+#include <algorithm>
+#include "leak_dumper.h"
+
+using namespace Shared::Util;
+
+namespace Shared { namespace PlatformCommon {
+
+// =====================================================
+//	class JobWorkerThread
+// =====================================================
+
+JobWorkerThread::JobWorkerThread(JobSystem *jobSystem, int queueIndex) : BaseThread() {
+	this->jobSystem = jobSystem;
+	this->queueIndex = queueIndex;
+	uniqueID = "JobWorkerThread";
+}
+
+void JobWorkerThread::execute() {
+	RunningStatusSafeWrapper runningStatus(this);
+	for(;;) {
+		if(getQuitStatus() == true) {
+			break;
+		}
+
+		jobSystem->jobsAvailable->waitTillSignalled();
+
+		if(getQuitStatus() == true) {
+			break;
+		}
+
+		ExecutingTaskSafeWrapper safeExecutingTask(this);
+		for(;jobSystem->runPendingJob(queueIndex) == true;) {
+		}
+	}
+}
+
+// =====================================================
+//	class JobSystem
+// =====================================================
+
+const int JobSystem::maxWorkerThreads = 16;
+
+JobSystem::JobQueue::JobQueue() {
+	mutex = new Mutex(CODE_AT_LINE);
+}
+
+JobSystem::JobQueue::~JobQueue() {
+	delete mutex;
+	mutex = NULL;
+}
+
+// workerThreadCount < 0 picks one thread per extra core. With 0 threads
+// the jobs simply run in order on the calling thread
+JobSystem::JobSystem(int workerThreadCount) {
+	if(workerThreadCount < 0) {
+		workerThreadCount = SDL_GetCPUCount() - 1;
+	}
+	workerThreadCount = max(0, min(workerThreadCount, maxWorkerThreads));
+
+	jobsAvailable = new Semaphore();
+	batchCompleted = new Semaphore();
+	batchMutex = new Mutex(CODE_AT_LINE);
+	runMutex = new Mutex(CODE_AT_LINE);
+	pendingJobCount = 0;
+
+	queues.push_back(new JobQueue());
+	for(int index = 0; index < workerThreadCount; ++index) {
+		queues.push_back(new JobQueue());
+
+		JobWorkerThread *worker = new JobWorkerThread(this, index + 1);
+		workers.push_back(worker);
+		worker->start();
+	}
+}
+
+JobSystem::~JobSystem() {
+	for(unsigned int index = 0; index < workers.size(); ++index) {
+		workers[index]->signalQuit();
+	}
+	for(unsigned int index = 0; index < workers.size(); ++index) {
+		jobsAvailable->signal();
+	}
+	for(unsigned int index = 0; index < workers.size(); ++index) {
+		JobWorkerThread *worker = workers[index];
+		if(worker->shutdownAndWait() == true) {
+			delete worker;
+		}
+		else {
+			worker->setDeleteSelfOnExecutionDone(true);
+		}
+	}
+	workers.clear();
+
+	for(unsigned int index = 0; index < queues.size(); ++index) {
+		delete queues[index];
+	}
+	queues.clear();
+
+	delete jobsAvailable;
+	jobsAvailable = NULL;
+	delete batchCompleted;
+	batchCompleted = NULL;
+	delete batchMutex;
+	batchMutex = NULL;
+	delete runMutex;
+	runMutex = NULL;
+}
+
+Job * JobSystem::takeJob(int queueIndex) {
+	JobQueue *ownQueue = queues[queueIndex];
+	MutexSafeWrapper safeMutex(ownQueue->mutex,CODE_AT_LINE);
+	if(ownQueue->jobs.empty() == false) {
+		Job *job = ownQueue->jobs.back();
+		ownQueue->jobs.pop_back();
+		return job;
+	}
+	safeMutex.ReleaseLock();
+
+	int queueCount = (int)queues.size();
+	for(int offset = 1; offset < queueCount; ++offset) {
+		JobQueue *victim = queues[(queueIndex + offset) % queueCount];
+		MutexSafeWrapper safeVictimMutex(victim->mutex,CODE_AT_LINE);
+		if(victim->jobs.empty() == false) {
+			Job *job = victim->jobs.front();
+			victim->jobs.pop_front();
+			return job;
+		}
+	}
+	return NULL;
+}
+
+void JobSystem::runJob(Job *job) {
+	string error = "";
+	try {
+		job->run();
+	}
+	catch(const exception &ex) {
+		error = ex.what();
+	}
+	catch(...) {
+		error = "Unknown error in job";
+	}
+
+	MutexSafeWrapper safeMutex(batchMutex,CODE_AT_LINE);
+	if(error != "" && batchError == "") {
+		batchError = error;
+	}
+	--pendingJobCount;
+	if(pendingJobCount == 0) {
+		batchCompleted->signal();
+	}
+}
+
+bool JobSystem::runPendingJob(int queueIndex) {
+	Job *job = takeJob(queueIndex);
+	if(job == NULL) {
+		return false;
+	}
+	runJob(job);
+	return true;
+}
+
+void JobSystem::run(const std::vector<Job *> &jobs) {
+	if(jobs.empty() == true) {
+		return;
+	}
+	if(workers.empty() == true) {
+		for(unsigned int index = 0; index < jobs.size(); ++index) {
+			jobs[index]->run();
+		}
+		return;
+	}
+
+	MutexSafeWrapper safeRunMutex(runMutex,CODE_AT_LINE);
+
+	MutexSafeWrapper safeMutex(batchMutex,CODE_AT_LINE);
+	pendingJobCount = (int)jobs.size();
+	batchError = "";
+	safeMutex.ReleaseLock();
+
+	int queueCount = (int)queues.size();
+	for(unsigned int index = 0; index < jobs.size(); ++index) {
+		JobQueue *queue = queues[index % queueCount];
+		MutexSafeWrapper safeQueueMutex(queue->mutex,CODE_AT_LINE);
+		queue->jobs.push_back(jobs[index]);
+	}
+
+	int wakeCount = min((int)jobs.size(), (int)workers.size());
+	for(int index = 0; index < wakeCount; ++index) {
+		jobsAvailable->signal();
+	}
+
+	for(;runPendingJob(0) == true;) {
+	}
+	batchCompleted->waitTillSignalled();
+
+	safeMutex.Lock();
+	string error = batchError;
+	safeMutex.ReleaseLock();
+
+	if(error != "") {
+		throw megaglest_runtime_error(error);
+	}
+}
+
+}}//end namespace
@@ -22,11 +22,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <direct.h>
+#include <psapi.h>
 
 #else
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
 #endif
@@ -1997,6 +1999,26 @@ off_t getFileSize(string filename) {
   return 0;
 }
 
+int64 getPeakMemoryUsage() {
+#ifdef WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) != 0) {
+		return (int64)counters.PeakWorkingSetSize;
+	}
+#else
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+		return (int64)usage.ru_maxrss;
+#else
+		// reported in kilobytes everywhere except OS X
+		return (int64)usage.ru_maxrss * 1024;
+#endif
+	}
+#endif
+	return 0;
+}
+
 string executable_path(const string &exeName, bool includeExeNameInPath) {
 	string value = "";
 #ifdef _WIN32
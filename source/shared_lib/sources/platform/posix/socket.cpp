@@ -45,12 +45,18 @@
   #include <unistd.h>
   #include <stdlib.h>
   #include <sys/socket.h>
+  #include <sys/uio.h>
   #include <netdb.h>
   #include <netinet/in.h>
   #include <net/if.h>
   #include <netinet/tcp.h>
 #endif
 
+#ifdef __linux__
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+#endif
+
 
 #include <string.h>
 #include <sys/stat.h>
@@ -1458,6 +1464,86 @@ int Socket::send(const void *data, int dataSize) {
 	return static_cast<int>(bytesSent);
 }
 
+int Socket::send(const void * const *dataList, const int *dataSizeList, int dataCount) {
+	int dataSize = 0;
+	for(int index = 0; index < dataCount; ++index) {
+		dataSize += dataSizeList[index];
+	}
+	if(dataSize <= 0) {
+		return 0;
+	}
+
+	int bytesSent = -1;
+	if(dataCount <= maxSendBufferCount && isSocketValid() == true) {
+		errno = 0;
+
+		MutexSafeWrapper safeMutex(dataSynchAccessorWrite,CODE_AT_LINE);
+		if(isSocketValid() == true)	{
+#ifdef WIN32
+			WSABUF buffers[maxSendBufferCount];
+			for(int index = 0; index < dataCount; ++index) {
+				buffers[index].buf = (char *)dataList[index];
+				buffers[index].len = dataSizeList[index];
+			}
+			DWORD sentCount = 0;
+			if(WSASend(sock, buffers, dataCount, &sentCount, 0, NULL, NULL) == 0) {
+				bytesSent = (int)sentCount;
+			}
+#else
+			struct iovec buffers[maxSendBufferCount];
+			for(int index = 0; index < dataCount; ++index) {
+				buffers[index].iov_base = (void *)dataList[index];
+				buffers[index].iov_len = dataSizeList[index];
+			}
+			struct msghdr message;
+			memset(&message,0,sizeof(message));
+			message.msg_iov = buffers;
+			message.msg_iovlen = dataCount;
+#ifdef __APPLE__
+			bytesSent = (int)::sendmsg(sock, &message, SO_NOSIGPIPE);
+#else
+			bytesSent = (int)::sendmsg(sock, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
+#endif
+		}
+		safeMutex.ReleaseLock();
+
+		if(bytesSent == dataSize) {
+			return bytesSent;
+		}
+		int lastSocketError = getLastSocketError();
+		if(bytesSent < 0 && lastSocketError != PLATFORM_SOCKET_TRY_AGAIN) {
+			if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] ERROR WRITING SOCKET DATA, err = %d error = %s dataSize = %d\n",__FILE__,__FUNCTION__,__LINE__,bytesSent,getLastSocketErrorFormattedText(&lastSocketError).c_str(),dataSize);
+
+			disconnectSocket();
+
+			if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"[%s::%s Line: %d] DISCONNECTED SOCKET error while sending socket data, bytesSent = %d, error = %s\n",__FILE__,__FUNCTION__,__LINE__,bytesSent,getLastSocketErrorFormattedText(&lastSocketError).c_str());
+			return bytesSent;
+		}
+	}
+
+	// The socket buffer is full (or too many buffers were given): hand
+	// whatever was not sent yet to the single buffer send, which knows
+	// how to wait until the socket is writable again
+	int alreadySent = max(bytesSent,0);
+	std::vector<char> remaining;
+	remaining.reserve(dataSize - alreadySent);
+	int offset = 0;
+	for(int index = 0; index < dataCount; ++index) {
+		const char *data = (const char *)dataList[index];
+		int size = dataSizeList[index];
+		int skip = min(max(alreadySent - offset,0),size);
+		remaining.insert(remaining.end(),data + skip,data + size);
+		offset += size;
+	}
+
+	int result = send(&remaining[0], (int)remaining.size());
+	if(result < 0) {
+		return (alreadySent > 0 ? alreadySent : result);
+	}
+	return alreadySent + result;
+}
+
 int Socket::receive(void *data, int dataSize, bool tryReceiveUntilDataSizeMet) {
 	ssize_t bytesReceived = 0;
 
@@ -1967,6 +2053,233 @@ void Socket::throwException(string str){
 	throw megaglest_runtime_error(msg);
 }
 
+// ===============================================
+//	class SocketPoller
+// ===============================================
+
+const int SocketPoller::maxEventsPerWait				= 16;
+const int SocketPoller::fallbackWaitSliceMilliseconds	= 5;
+
+SocketPoller::SocketPoller() {
+	mutexSockets = new Mutex(CODE_AT_LINE);
+	wakeupPending = false;
+
+#ifdef __linux__
+	epollHandle = epoll_create1(EPOLL_CLOEXEC);
+	if(epollHandle < 0) {
+		throwPollerException("epoll_create1");
+	}
+	wakeupHandle = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(wakeupHandle < 0) {
+		::close(epollHandle);
+		throwPollerException("eventfd");
+	}
+
+	struct epoll_event event;
+	memset(&event,0,sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = wakeupHandle;
+	if(epoll_ctl(epollHandle, EPOLL_CTL_ADD, wakeupHandle, &event) != 0) {
+		::close(wakeupHandle);
+		::close(epollHandle);
+		throwPollerException("epoll_ctl");
+	}
+#endif
+}
+
+SocketPoller::~SocketPoller() {
+#ifdef __linux__
+	::close(wakeupHandle);
+	::close(epollHandle);
+#endif
+	delete mutexSockets;
+	mutexSockets = NULL;
+}
+
+void SocketPoller::throwPollerException(const string &call) {
+	char szBuf[8096]="";
+	snprintf(szBuf,8096,"In [%s::%s Line: %d] %s failed, error = %s",__FILE__,__FUNCTION__,__LINE__,call.c_str(),Socket::getLastSocketErrorFormattedText().c_str());
+	throw megaglest_runtime_error(szBuf);
+}
+
+bool SocketPoller::isEventDriven() {
+#ifdef __linux__
+	return true;
+#else
+	return false;
+#endif
+}
+
+void SocketPoller::addSocket(PLATFORM_SOCKET socket) {
+	if(Socket::isSocketValid(&socket) == false) {
+		return;
+	}
+	MutexSafeWrapper safeMutex(mutexSockets,CODE_AT_LINE);
+	bool alreadyListed = (std::find(sockets.begin(),sockets.end(),socket) != sockets.end());
+#ifdef __linux__
+	// A listed descriptor is added again: if it was closed and the number
+	// reused by a new connection the kernel already dropped it from the set
+	struct epoll_event event;
+	memset(&event,0,sizeof(event));
+	// level triggered so a partially read message keeps the socket ready
+	event.events = EPOLLIN | EPOLLRDHUP;
+	event.data.fd = socket;
+	if(epoll_ctl(epollHandle, EPOLL_CTL_ADD, socket, &event) != 0 && errno != EEXIST) {
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] epoll_ctl ADD failed for socket = %d, error = %s\n",__FILE__,__FUNCTION__,__LINE__,socket,Socket::getLastSocketErrorFormattedText().c_str());
+		return;
+	}
+#endif
+	if(alreadyListed == false) {
+		sockets.push_back(socket);
+	}
+}
+
+void SocketPoller::removeSocket(PLATFORM_SOCKET socket) {
+	MutexSafeWrapper safeMutex(mutexSockets,CODE_AT_LINE);
+	std::vector<PLATFORM_SOCKET>::iterator iterFind = std::find(sockets.begin(),sockets.end(),socket);
+	if(iterFind == sockets.end()) {
+		return;
+	}
+	sockets.erase(iterFind);
+#ifdef __linux__
+	// fails harmlessly when the socket was already closed, the kernel
+	// drops closed descriptors from the set by itself
+	struct epoll_event event;
+	memset(&event,0,sizeof(event));
+	epoll_ctl(epollHandle, EPOLL_CTL_DEL, socket, &event);
+#endif
+}
+
+void SocketPoller::clearSockets() {
+	MutexSafeWrapper safeMutex(mutexSockets,CODE_AT_LINE);
+#ifdef __linux__
+	for(unsigned int index = 0; index < sockets.size(); ++index) {
+		struct epoll_event event;
+		memset(&event,0,sizeof(event));
+		epoll_ctl(epollHandle, EPOLL_CTL_DEL, sockets[index], &event);
+	}
+#endif
+	sockets.clear();
+}
+
+int SocketPoller::getSocketCount() {
+	MutexSafeWrapper safeMutex(mutexSockets,CODE_AT_LINE);
+	return (int)sockets.size();
+}
+
+void SocketPoller::wakeup() {
+#ifdef __linux__
+	uint64_t value = 1;
+	if(::write(wakeupHandle, &value, sizeof(value)) < 0) {
+		// EAGAIN means the counter is already non zero, so a wakeup is pending
+	}
+#else
+	MutexSafeWrapper safeMutex(mutexSockets,CODE_AT_LINE);
+	wakeupPending = true;
+#endif
+}
+
+bool SocketPoller::takeWakeup() {
+#ifdef __linux__
+	uint64_t value = 0;
+	return (::read(wakeupHandle, &value, sizeof(value)) == (ssize_t)sizeof(value));
+#else
+	MutexSafeWrapper safeMutex(mutexSockets,CODE_AT_LINE);
+	bool result = wakeupPending;
+	wakeupPending = false;
+	return result;
+#endif
+}
+
+bool SocketPoller::wait(int waitMilliseconds, std::vector<PLATFORM_SOCKET> *readySockets) {
+	bool result = false;
+
+#ifdef __linux__
+	struct epoll_event events[maxEventsPerWait];
+	int eventCount = 0;
+	do {
+		eventCount = epoll_wait(epollHandle, events, maxEventsPerWait, waitMilliseconds);
+	} while(eventCount < 0 && errno == EINTR);
+
+	if(eventCount < 0) {
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] epoll_wait failed, error = %s\n",__FILE__,__FUNCTION__,__LINE__,Socket::getLastSocketErrorFormattedText().c_str());
+		return false;
+	}
+	for(int index = 0; index < eventCount; ++index) {
+		if(events[index].data.fd == wakeupHandle) {
+			takeWakeup();
+			continue;
+		}
+		// errors and hang ups count as readable so the reader notices them
+		result = true;
+		if(readySockets != NULL) {
+			readySockets->push_back(events[index].data.fd);
+		}
+	}
+#else
+	Chrono chrono(true);
+	for(;;) {
+		if(takeWakeup() == true) {
+			break;
+		}
+
+		MutexSafeWrapper safeMutex(mutexSockets,CODE_AT_LINE);
+		std::vector<PLATFORM_SOCKET> socketList = sockets;
+		safeMutex.ReleaseLock();
+
+		int sliceMilliseconds = fallbackWaitSliceMilliseconds;
+		if(waitMilliseconds >= 0) {
+			int remainingMilliseconds = waitMilliseconds - (int)chrono.getMillis();
+			if(remainingMilliseconds < sliceMilliseconds) {
+				sliceMilliseconds = max(remainingMilliseconds,0);
+			}
+		}
+
+		if(socketList.empty() == true) {
+			if(sliceMilliseconds > 0) {
+				sleep(sliceMilliseconds);
+			}
+		}
+		else {
+			fd_set rfds;
+			FD_ZERO(&rfds);
+			PLATFORM_SOCKET imaxsocket = 0;
+			for(unsigned int index = 0; index < socketList.size(); ++index) {
+				FD_SET(socketList[index], &rfds);
+				imaxsocket = max(socketList[index],imaxsocket);
+			}
+
+			struct timeval tv;
+			tv.tv_sec = sliceMilliseconds / 1000;
+			tv.tv_usec = (sliceMilliseconds % 1000) * 1000;
+
+			int retval = select((int)imaxsocket + 1, &rfds, NULL, NULL, &tv);
+			if(retval < 0) {
+				if(SystemFlags::getSystemSettingType(SystemFlags::debugNetwork).enabled) SystemFlags::OutputDebug(SystemFlags::debugNetwork,"In [%s::%s Line: %d] select failed, error = %s\n",__FILE__,__FUNCTION__,__LINE__,Socket::getLastSocketErrorFormattedText().c_str());
+				break;
+			}
+			else if(retval > 0) {
+				for(unsigned int index = 0; index < socketList.size(); ++index) {
+					if(FD_ISSET(socketList[index], &rfds)) {
+						result = true;
+						if(readySockets != NULL) {
+							readySockets->push_back(socketList[index]);
+						}
+					}
+				}
+				break;
+			}
+		}
+
+		if(waitMilliseconds >= 0 && chrono.getMillis() >= waitMilliseconds) {
+			break;
+		}
+	}
+#endif
+
+	return result;
+}
+
 // ===============================================
 //	class ClientSocket
 // ===============================================
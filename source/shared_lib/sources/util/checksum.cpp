@@ -37,8 +37,12 @@ namespace Shared{ namespace Util{
 //	class Checksum
 // =====================================================
 
+const int Checksum::fileBlockSize = 1024 * 1024;
+
 Mutex Checksum::fileListCacheSynchAccessor;
-std::map<string,uint32> Checksum::fileListCache;
+std::map<string,Checksum::FileCacheEntry> Checksum::fileListCache;
+bool Checksum::fileListCacheLoaded = false;
+bool Checksum::fileListCacheChanged = false;
 
 unsigned int crc_table[256] =
 {
@@ -76,6 +80,27 @@ unsigned int crc_table[256] =
 	0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94, 0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
+// Tables for processing 8 bytes per step (slicing by 8), the first one is
+// crc_table and table n gives the crc of a byte followed by n zero bytes
+class CRCSliceTables {
+public:
+	unsigned int table[8][256];
+
+	CRCSliceTables() {
+		for(int index = 0; index < 256; ++index) {
+			table[0][index] = crc_table[index];
+		}
+		for(int index = 0; index < 256; ++index) {
+			for(int slice = 1; slice < 8; ++slice) {
+				unsigned int value = table[slice-1][index];
+				table[slice][index] = (value >> 8) ^ crc_table[value & 0xff];
+			}
+		}
+	}
+};
+
+static CRCSliceTables crcSliceTables;
+
 Checksum::Checksum() {
 	sum= 0;
 	r= 55665;
@@ -101,7 +126,18 @@ uint32 Checksum::addByte(const char value) {
 
 uint32 Checksum::addBytes(const void *_data, size_t _size) {
 	const unsigned char *rVal = reinterpret_cast<const unsigned char *>(_data);
+	const unsigned int (*table)[256] = crcSliceTables.table;
 	sum = ~sum;
+	while (_size >= 8) {
+		uint32 low = sum ^ (rVal[0] | (rVal[1] << 8) | (rVal[2] << 16) | ((uint32)rVal[3] << 24));
+		uint32 high = rVal[4] | (rVal[5] << 8) | (rVal[6] << 16) | ((uint32)rVal[7] << 24);
+		sum = 	table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^
+				table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+				table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^
+				table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+		rVal += 8;
+		_size -= 8;
+	}
 	while (_size--) {
 		sum = (sum >> 8) ^ crc_table[*rVal++ ^ (sum & 0xff)];
 	}
@@ -174,192 +210,263 @@ void Checksum::addFile(const string &path) {
 	}
 }
 
-bool Checksum::addFileToSum(const string &path) {
-
-// OLD SLOW FILE I/O
-/*
-	FILE* file= fopen(path.c_str(), "rb");
-	if(file!=NULL){
-
-		addString(lastFile(path));
+// Bytes that need a closer look while stripping XML formatting
+static bool isXMLFormattingByte(unsigned char value) {
+	return (value == ' ' || value == '\t' || value == '\n' || value == '\r' || value == '<');
+}
 
-		while(!feof(file)){
-			int8 byte= 0;
+class XMLFormattingFilter {
+private:
+	bool xmlFormattingByte[256];
+	bool inCommentTag;
 
-			size_t readBytes = fread(&byte, 1, 1, file);
-			addByte(byte);
+public:
+	XMLFormattingFilter() {
+		for(int index = 0; index < 256; ++index) {
+			xmlFormattingByte[index] = isXMLFormattingByte((unsigned char)index);
 		}
+		inCommentTag = false;
 	}
-	else
-	{
-		throw megaglest_runtime_error("Can not open file: " + path);
-	}
-	fclose(file);
-*/
-
-
-
-/*
-   const double MAX_CRC_FILESIZE = 100000000;
-   int fd=0;
-   size_t bytes_read, bytes_expected = MAX_CRC_FILESIZE * sizeof(int8);
-   int8 *data=0;
-   const char *infile = path.c_str();
-
-   if ((fd = open(infile,O_RDONLY)) < 0)
-	   throw megaglest_runtime_error("Can not open file: " + path);
 
-   if ((data = (int8 *)malloc(bytes_expected)) == NULL)
-	   throw megaglest_runtime_error("malloc failed, Can not open file: " + path);
-
-   bytes_read = read(fd, data, bytes_expected);
+	// Copies the bytes of data[start..end) that are not XML formatting to
+	// output and returns how many were copied. baseOffset is the file offset
+	// of data[0] and fileSize is only known (>= 0) once the end was read.
+	// Two bytes before start and four after end must be readable unless they
+	// are outside the file.
+	size_t filter(const char *data, size_t start, size_t end, int64 baseOffset,
+					int64 fileSize, char *output) {
+		const unsigned char *buf = reinterpret_cast<const unsigned char *>(data);
+		size_t outputSize = 0;
+		size_t i = start;
+		while(i < end) {
+			if(inCommentTag == true) {
+				const void *found = memchr(&buf[i], '>', end - i);
+				if(found == NULL) {
+					i = end;
+					break;
+				}
+				i = (const unsigned char *)found - buf;
+				if(baseOffset + (int64)i >= 3 && buf[i-1] == '-' && buf[i-2] == '-') {
+					inCommentTag = false;
+				}
+				++i;
+				continue;
+			}
 
-   //if (bytes_read != bytes_expected)
-   //   throw megaglest_runtime_error("read failed, Can not open file: " + path);
+			// copy everything up to the next byte of interest in one go
+			size_t runStart = i;
+			while(i < end && xmlFormattingByte[buf[i]] == false) {
+				++i;
+			}
+			if(i > runStart) {
+				memcpy(&output[outputSize], &buf[runStart], i - runStart);
+				outputSize += i - runStart;
+			}
+			if(i >= end) {
+				break;
+			}
 
-   for(int i = 0; i < bytes_read; i++) {
-		addByte(data[i]);
-   }
-   free(data);
-*/
+			if(buf[i] == '<') {
+				if((fileSize < 0 || baseOffset + (int64)i + 4 < fileSize) &&
+					buf[i+1] == '!' && buf[i+2] == '-' && buf[i+3] == '-') {
+					inCommentTag = true;
+				}
+				else {
+					output[outputSize++] = buf[i];
+				}
+			}
+			++i;
+		}
+		return outputSize;
+	}
+};
 
-    bool fileExists = false;
+bool Checksum::addFileToSum(const string &path) {
+	bool fileExists = false;
 
-/*
 #ifdef WIN32
-	FILE* file= _wfopen(utf8_decode(path).c_str(), L"rb");
+	FILE *fp = _wfopen(utf8_decode(path).c_str(), L"rb");
 #else
-	FILE* file= fopen(path.c_str(), "rb");
+	FILE *fp = fopen(path.c_str(), "rb");
 #endif
-	if(file != NULL) {
-        fileExists = true;
+	if(fp != NULL) {
+		fileExists = true;
 		addString(lastFile(path));
 
 		bool isXMLFile = (EndsWith(path, ".xml") == true);
-		bool inCommentTag=false;
-		char buf[4096]="";  // Should be large enough.
-		int bufSize = sizeof buf;
-		while(!feof(file)) {
-			//int8 byte= 0;
-
-			//size_t readBytes = fread(&byte, 1, 1, file);
-			memset(buf,0,bufSize);
-			if(fgets(buf, bufSize, file) != NULL) {
-				//addByte(byte);
-			    for(int i = 0; i < bufSize && buf[i] != 0; i++) {
-			    	// Ignore Spaces in XML files as they are
-			    	// ONLY for formatting
-			    	if(isXMLFile == true) {
-			    		if(inCommentTag == true) {
-			    			if(buf[i] == '>' && i >= 3 && buf[i-1] == '-' && buf[i-2] == '-') {
-			    				inCommentTag = false;
-			    				//printf("TURNING OFF comment TAG, i = %d [%c]",i,buf[i]);
-			    			}
-			    			else {
-			    				//printf("SKIPPING XML comment character, i = %d [%c]",i,buf[i]);
-			    			}
-			    			continue;
-			    		}
-			    		//else if(buf[i] == '-' && i >= 4 && buf[i-1] == '-' && buf[i-2] == '!' && buf[i-3] == '<') {
-			    		else if(buf[i] == '<' && i+4 < bufSize && buf[i+1] == '!' && buf[i+2] == '-' && buf[i+3] == '-') {
-		    				inCommentTag = true;
-		    				//printf("TURNING ON comment TAG, i = %d [%c]",i,buf[i]);
-		    				continue;
-			    		}
-			    		else if(buf[i] == ' ' || buf[i] == '\t' || buf[i] == '\n' || buf[i] == '\r') {
-			    			//printf("SKIPPING special character, i = %d [%c]",i,buf[i]);
-			    			continue;
-			    	    }
-			    	}
-			 		addByte(buf[i]);
-			    }
+
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] path [%s], isXMLFile = %d\n",__FILE__,__FUNCTION__,__LINE__,path.c_str(),isXMLFile);
+
+		if(isXMLFile == true) {
+			// Ignore Spaces and comments in XML files as they are
+			// ONLY for formatting. The last bytes of a block are kept
+			// back until the next one is read, a comment start looks
+			// four bytes ahead and a comment end two bytes back.
+			const size_t historySize = 2;
+			const size_t lookAheadSize = 4;
+			std::vector<char> buf(historySize + fileBlockSize + lookAheadSize);
+			std::vector<char> output(buf.size());
+			XMLFormattingFilter xmlFilter;
+
+			int64 baseOffset = 0;
+			size_t used = 0;
+			size_t next = 0;
+			for(;;) {
+				size_t keepFrom = (next >= historySize ? next - historySize : 0);
+				if(keepFrom > 0) {
+					memmove(&buf[0], &buf[keepFrom], used - keepFrom);
+					used -= keepFrom;
+					next -= keepFrom;
+					baseOffset += keepFrom;
+				}
+
+				size_t wanted = buf.size() - used;
+				size_t readBytes = fread(&buf[used], 1, wanted, fp);
+				used += readBytes;
+				bool endOfFile = (readBytes < wanted);
+
+				size_t end = used;
+				int64 fileSize = -1;
+				if(endOfFile == true) {
+					fileSize = baseOffset + (int64)used;
+				}
+				else {
+					end = used - lookAheadSize;
+				}
+
+				size_t outputSize = xmlFilter.filter(&buf[0], next, end, baseOffset, fileSize, &output[0]);
+				if(outputSize > 0) {
+					addBytes(&output[0], outputSize);
+				}
+				next = end;
+
+				if(endOfFile == true) {
+					break;
+				}
 			}
 		}
+		else {
+			std::vector<char> buf(fileBlockSize);
+			for(;;) {
+				size_t readBytes = fread(&buf[0], 1, buf.size(), fp);
+				if(readBytes > 0) {
+					addBytes(&buf[0], readBytes);
+				}
+				if(readBytes < buf.size()) {
+					break;
+				}
+			}
+		}
+
+		fclose(fp);
+
+		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] path [%s], sum = %u\n",__FILE__,__FUNCTION__,__LINE__,path.c_str(),sum);
 	}
-	else {
-		throw megaglest_runtime_error("Can not open file: " + path);
-	}
-	fclose(file);
-*/
 
-#if defined(WIN32) && !defined(__MINGW32__)
-	wstring wstr = utf8_decode(path);
-	FILE *fp = _wfopen(wstr.c_str(), L"rb");
-	ifstream ifs(fp);
+	return fileExists;
+}
+
+bool Checksum::getFileStats(const string &path, int64 &size, int64 &modTime) {
+#ifdef WIN32
+  #if defined(__MINGW32__)
+	struct _stat stbuf;
+  #else
+	struct _stat64i32 stbuf;
+  #endif
+	if(_wstat(utf8_decode(path).c_str(), &stbuf) != -1) {
 #else
-    ifstream ifs(path.c_str());
+	struct stat stbuf;
+	if(stat(path.c_str(), &stbuf) != -1) {
 #endif
+		size = stbuf.st_size;
+		modTime = stbuf.st_mtime;
+		return true;
+	}
+	return false;
+}
 
-    if (ifs) {
-        fileExists = true;
-		addString(lastFile(path));
-
-		bool isXMLFile = (EndsWith(path, ".xml") == true);
+string Checksum::getFileCacheFileName() {
+	string crcCachePath = getCRCCacheFilePath();
+	if(crcCachePath == "") {
+		return "";
+	}
+	return crcCachePath + "CRC_CACHE_FILES";
+}
 
-		// Determine the file length
-		ifs.seekg(0, ios::end);
-		std::streamoff size=ifs.tellg();
-		ifs.seekg(0, ios::beg);
+// Each line holds: crc size modTime path
+void Checksum::loadFileCache() {
+	fileListCacheLoaded = true;
+	fileListCacheChanged = false;
 
-		unsigned int bufSize = (unsigned int)size / sizeof(char);
-		// Create a vector to store the data
-		std::vector<char> buf(bufSize);
-		// Load the data
-		ifs.read((char*)&buf[0], buf.size());
+	string cacheFile = getFileCacheFileName();
+	if(cacheFile == "" || fileExists(cacheFile) == false) {
+		return;
+	}
 
-		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] buf.size() = %d, path [%s], isXMLFile = %d\n",__FILE__,__FUNCTION__,__LINE__,buf.size(), path.c_str(),isXMLFile);
+#ifdef WIN32
+	FILE *fp = _wfopen(utf8_decode(cacheFile).c_str(), L"r");
+#else
+	FILE *fp = fopen(cacheFile.c_str(), "r");
+#endif
+	if(fp == NULL) {
+		return;
+	}
 
-		if(isXMLFile == true) {
-			bool inCommentTag=false;
-			for(std::size_t i = 0; i < buf.size(); ++i) {
-				// Ignore Spaces in XML files as they are
-				// ONLY for formatting
-				//if(isXMLFile == true) {
-					if(inCommentTag == true) {
-						if(buf[i] == '>' && i >= 3 && buf[i-1] == '-' && buf[i-2] == '-') {
-							inCommentTag = false;
-							//printf("TURNING OFF comment TAG, i = %d [%c]",i,buf[i]);
-							if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] i = %d\n",__FILE__,__FUNCTION__,__LINE__,i);
-						}
-						else {
-							//printf("SKIPPING XML comment character, i = %d [%c]",i,buf[i]);
-							if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] i = %d\n",__FILE__,__FUNCTION__,__LINE__,i);
-						}
-						continue;
-					}
-					//else if(buf[i] == '-' && i >= 4 && buf[i-1] == '-' && buf[i-2] == '!' && buf[i-3] == '<') {
-					else if(buf[i] == '<' && i+4 < bufSize && buf[i+1] == '!' && buf[i+2] == '-' && buf[i+3] == '-') {
-						inCommentTag = true;
-						//printf("TURNING ON comment TAG, i = %d [%c]",i,buf[i]);
-						if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] i = %d\n",__FILE__,__FUNCTION__,__LINE__,i);
-						continue;
-					}
-					else if(buf[i] == ' ' || buf[i] == '\t' || buf[i] == '\n' || buf[i] == '\r') {
-						//printf("SKIPPING special character, i = %d [%c]",i,buf[i]);
-						if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] i = %d\n",__FILE__,__FUNCTION__,__LINE__,i);
-						continue;
-					}
-				//}
-				uint32 cipher = addByte(buf[i]);
-
-				if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] %d / %d, cipher = %u\n",__FILE__,__FUNCTION__,__LINE__,i,buf.size(), cipher);
-			}
+	char line[8096]="";
+	while(fgets(line, sizeof(line), fp) != NULL) {
+		unsigned int crc = 0;
+		long long int size = 0;
+		long long int modTime = 0;
+		int pathOffset = 0;
+		if(sscanf(line, "%u %lld %lld %n", &crc, &size, &modTime, &pathOffset) < 3 || pathOffset <= 0) {
+			continue;
 		}
-		else {
-			uint32 cipher = addBytes(&buf[0],buf.size());
-			if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] %d, cipher = %u\n",__FILE__,__FUNCTION__,__LINE__,buf.size(), cipher);
+		string path = line + pathOffset;
+		while(path.empty() == false && (path[path.size()-1] == '\n' || path[path.size()-1] == '\r')) {
+			path.erase(path.size()-1);
+		}
+		if(path == "") {
+			continue;
 		}
 
-		// Close the file
-		ifs.close();
-    }
-#if defined(WIN32) && !defined(__MINGW32__)
-	if(fp) {
-		fclose(fp);
+		FileCacheEntry &entry = fileListCache[path];
+		entry.crc = crc;
+		entry.size = size;
+		entry.modTime = modTime;
+	}
+	fclose(fp);
+
+	if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] loaded %d file CRCs from [%s]\n",__FILE__,__FUNCTION__,__LINE__,(int)fileListCache.size(),cacheFile.c_str());
+}
+
+void Checksum::saveFileCache() {
+	string cacheFile = getFileCacheFileName();
+	if(cacheFile == "") {
+		fileListCacheChanged = false;
+		return;
 	}
+
+	// Write a new file first so a crash never leaves a half written cache
+	string tempCacheFile = cacheFile + ".tmp";
+#ifdef WIN32
+	FILE *fp = _wfopen(utf8_decode(tempCacheFile).c_str(), L"w");
+#else
+	FILE *fp = fopen(tempCacheFile.c_str(), "w");
 #endif
+	if(fp == NULL) {
+		return;
+	}
+	for(std::map<string,FileCacheEntry>::iterator iterMap = fileListCache.begin();
+		iterMap != fileListCache.end(); ++iterMap) {
+		fprintf(fp, "%u %lld %lld %s\n", iterMap->second.crc,
+				(long long int)iterMap->second.size, (long long int)iterMap->second.modTime,
+				iterMap->first.c_str());
+	}
+	fclose(fp);
 
-    return fileExists;
+	removeFile(cacheFile);
+	renameFile(tempCacheFile, cacheFile);
+	fileListCacheChanged = false;
 }
 
 uint32 Checksum::getSum() {
@@ -370,23 +477,46 @@ uint32 Checksum::getSum() {
 		Checksum newResult;
 
 		{
+		MutexSafeWrapper safeMutexSocketDestructorFlag(&Checksum::fileListCacheSynchAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
+		if(Checksum::fileListCacheLoaded == false) {
+			Checksum::loadFileCache();
+		}
+		safeMutexSocketDestructorFlag.ReleaseLock(true);
 
 		for(std::map<string,uint32>::iterator iterMap = fileList.begin();
 			iterMap != fileList.end(); ++iterMap) {
 
-			MutexSafeWrapper safeMutexSocketDestructorFlag(&Checksum::fileListCacheSynchAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
-			if(Checksum::fileListCache.find(iterMap->first) == Checksum::fileListCache.end()) {
-				Checksum fileResult;
-				//bool fileAddedOk = fileResult.addFileToSum(iterMap->first);
-				fileResult.addFileToSum(iterMap->first);
-				Checksum::fileListCache[iterMap->first] = fileResult.getSum();
-				//printf("fileAddedOk = %d for file [%s] CRC [%d]\n",fileAddedOk,iterMap->first.c_str(),Checksum::fileListCache[iterMap->first]);
+			int64 size = 0;
+			int64 modTime = 0;
+			bool haveStats = getFileStats(iterMap->first, size, modTime);
+
+			safeMutexSocketDestructorFlag.Lock();
+			std::map<string,FileCacheEntry>::iterator iterFind = Checksum::fileListCache.find(iterMap->first);
+			if(iterFind != Checksum::fileListCache.end() && haveStats == true &&
+				iterFind->second.size == size && iterFind->second.modTime == modTime) {
+				newResult.addSum(iterFind->second.crc);
+				safeMutexSocketDestructorFlag.ReleaseLock(true);
+				continue;
 			}
-			else {
-				//printf("Getting checksum from CACHE for file [%s] CRC [%d]\n",iterMap->first.c_str(),Checksum::fileListCache[iterMap->first]);
+			safeMutexSocketDestructorFlag.ReleaseLock(true);
+
+			Checksum fileResult;
+			//bool fileAddedOk = fileResult.addFileToSum(iterMap->first);
+			fileResult.addFileToSum(iterMap->first);
+			uint32 crc = fileResult.getSum();
+			newResult.addSum(crc);
+
+			safeMutexSocketDestructorFlag.Lock();
+			FileCacheEntry &entry = Checksum::fileListCache[iterMap->first];
+			entry.crc = crc;
+			entry.size = size;
+			entry.modTime = modTime;
+			if(haveStats == true) {
+				Checksum::fileListCacheChanged = true;
 			}
-			newResult.addSum(Checksum::fileListCache[iterMap->first]);
+			safeMutexSocketDestructorFlag.ReleaseLock(true);
 		}
+
 		}
 
 		if(SystemFlags::getSystemSettingType(SystemFlags::debugSystem).enabled) SystemFlags::OutputDebug(SystemFlags::debugSystem,"In [%s::%s Line: %d] fileList.size() = %d\n",__FILE__,__FUNCTION__,__LINE__,fileList.size());
@@ -421,12 +551,29 @@ void Checksum::removeFileFromCache(const string file) {
 	MutexSafeWrapper safeMutexSocketDestructorFlag(&Checksum::fileListCacheSynchAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
     if(Checksum::fileListCache.find(file) != Checksum::fileListCache.end()) {
         Checksum::fileListCache.erase(file);
+        Checksum::fileListCacheChanged = true;
     }
 }
 
+// getSum() only marks the cache as changed, callers save it once after a
+// batch of checksums (the CRC precache) instead of after every file list
+void Checksum::saveFileCacheIfChanged() {
+	MutexSafeWrapper safeMutexSocketDestructorFlag(&Checksum::fileListCacheSynchAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
+	if(Checksum::fileListCacheChanged == true) {
+		Checksum::saveFileCache();
+	}
+}
+
+// Only drops what is held in memory, the saved cache is read again on the
+// next use and its entries are still checked against size and mod time.
 void Checksum::clearFileCache() {
 	MutexSafeWrapper safeMutexSocketDestructorFlag(&Checksum::fileListCacheSynchAccessor,string(__FILE__) + "_" + intToStr(__LINE__));
+	if(Checksum::fileListCacheChanged == true) {
+		Checksum::saveFileCache();
+	}
     Checksum::fileListCache.clear();
+    Checksum::fileListCacheLoaded = false;
+    Checksum::fileListCacheChanged = false;
 }
 
 }}//end namespace
@@ -444,35 +444,47 @@ XmlNode *XmlIoRapid::load(const string &path, const std::map<string,string> &map
 	return rootNode;
 }
 
-void XmlIoRapid::save(const string &path, const XmlNode *node){
-	try {
-		if(node == NULL) {
-			throw megaglest_runtime_error("node == NULL during save!");
-		}
+void XmlIoRapid::buildDocument(xml_document<> &doc, const XmlNode *node) {
+	if(node == NULL) {
+		throw megaglest_runtime_error("node == NULL during save!");
+	}
 
-		xml_document<> doc;
+	// xml declaration
+	xml_node<>* decl = doc.allocate_node(node_declaration);
+	decl->append_attribute(doc.allocate_attribute(doc.allocate_string("version"), doc.allocate_string("1.0")));
+	decl->append_attribute(doc.allocate_attribute(doc.allocate_string("encoding"), doc.allocate_string("utf-8")));
+	decl->append_attribute(doc.allocate_attribute(doc.allocate_string("standalone"), doc.allocate_string("no")));
+	doc.append_node(decl);
 
-		// xml declaration
-		xml_node<>* decl = doc.allocate_node(node_declaration);
-		decl->append_attribute(doc.allocate_attribute(doc.allocate_string("version"), doc.allocate_string("1.0")));
-		decl->append_attribute(doc.allocate_attribute(doc.allocate_string("encoding"), doc.allocate_string("utf-8")));
-		decl->append_attribute(doc.allocate_attribute(doc.allocate_string("standalone"), doc.allocate_string("no")));
-		doc.append_node(decl);
+	// root node
+	xml_node<>* root = doc.allocate_node(node_element, doc.allocate_string(node->getName().c_str()));
+	for(unsigned int i = 0; i < node->getAttributeCount() ; ++i){
+		XmlAttribute *attr = node->getAttribute(i);
+		root->append_attribute(doc.allocate_attribute(
+				doc.allocate_string(attr->getName().c_str()),
+				doc.allocate_string(attr->getValue("",false).c_str())));
+	}
+	doc.append_node(root);
 
-		// root node
-		xml_node<>* root = doc.allocate_node(node_element, doc.allocate_string(node->getName().c_str()));
-		for(unsigned int i = 0; i < node->getAttributeCount() ; ++i){
-			XmlAttribute *attr = node->getAttribute(i);
-			root->append_attribute(doc.allocate_attribute(
-					doc.allocate_string(attr->getName().c_str()),
-					doc.allocate_string(attr->getValue("",false).c_str())));
-		}
-		doc.append_node(root);
+	// child nodes
+	for(unsigned int i = 0; i < node->getChildCount(); ++i) {
+		root->append_node(node->getChild(i)->buildElement(&doc));
+	}
+}
 
-		// child nodes
-		for(unsigned int i = 0; i < node->getChildCount(); ++i) {
-			root->append_node(node->getChild(i)->buildElement(&doc));
-		}
+string XmlIoRapid::saveToString(const XmlNode *node) {
+	xml_document<> doc;
+	buildDocument(doc, node);
+
+	string result;
+	print(std::back_inserter(result), doc, print_no_indenting);
+	return result;
+}
+
+void XmlIoRapid::save(const string &path, const XmlNode *node){
+	try {
+		xml_document<> doc;
+		buildDocument(doc, node);
 
 //		std::string xml_as_string;
 //		// watch for name collisions here, print() is a very common function name!
@@ -598,6 +610,10 @@ void XmlTree::save(const string &path) {
 	}
 }
 
+string XmlTree::saveToString() {
+	return XmlIoRapid::getInstance().saveToString(rootNode);
+}
+
 void XmlTree::clearRootNode() {
 	if(this->skipStackCheck == false) {
 		LoadStack &loadStack = CacheManager::getCachedItem<LoadStack>(loadStackCacheName);
@@ -978,13 +994,12 @@ XmlAttribute::XmlAttribute(DOMNode *attribute, const std::map<string,string> &ma
 
 	skipRestrictionCheck 			= false;
 	usesCommondata 					= false;
-	this->mapTagReplacementValues 	= mapTagReplacementValues;
 	char str[strSize]				= "";
 
 	XMLString::transcode(attribute->getNodeValue(), str, strSize-1);
 	value= str;
 	usesCommondata = ((value.find("$COMMONDATAPATH") != string::npos) || (value.find("%%COMMONDATAPATH%%") != string::npos));
-	skipRestrictionCheck = Properties::applyTagsToValue(this->value,&this->mapTagReplacementValues);
+	skipRestrictionCheck = Properties::applyTagsToValue(this->value,&mapTagReplacementValues);
 
 	XMLString::transcode(attribute->getNodeName(), str, strSize-1);
 	name= str;
@@ -999,31 +1014,25 @@ XmlAttribute::XmlAttribute(xml_attribute<> *attribute, const std::map<string,str
 
 	skipRestrictionCheck 			= false;
 	usesCommondata 					= false;
-	if(mapTagReplacementValues.size() > 0) {
-		this->mapTagReplacementValues 	= mapTagReplacementValues;
-	}
 	//char str[strSize]				= "";
 
 	//XMLString::transcode(attribute->getNodeValue(), str, strSize-1);
-	value= attribute->value();
+	value.assign(attribute->value(), attribute->value_size());
 	usesCommondata = ((value.find("$COMMONDATAPATH") != string::npos) || (value.find("%%COMMONDATAPATH%%") != string::npos));
-	skipRestrictionCheck = Properties::applyTagsToValue(this->value,&this->mapTagReplacementValues);
+	skipRestrictionCheck = Properties::applyTagsToValue(this->value,&mapTagReplacementValues);
 
 	//XMLString::transcode(attribute->getNodeName(), str, strSize-1);
-	name= attribute->name();
+	name.assign(attribute->name(), attribute->name_size());
 }
 
 XmlAttribute::XmlAttribute(const string &name, const string &value, const std::map<string,string> &mapTagReplacementValues) {
 	skipRestrictionCheck 			= false;
 	usesCommondata 					= false;
-	if(mapTagReplacementValues.size() > 0) {
-		this->mapTagReplacementValues 	= mapTagReplacementValues;
-	}
 	this->name						= name;
 	this->value						= value;
 
 	usesCommondata = ((value.find("$COMMONDATAPATH") != string::npos) || (value.find("%%COMMONDATAPATH%%") != string::npos));
-	skipRestrictionCheck = Properties::applyTagsToValue(this->value,&this->mapTagReplacementValues);
+	skipRestrictionCheck = Properties::applyTagsToValue(this->value,&mapTagReplacementValues);
 }
 
 bool XmlAttribute::getBoolValue() const {
@@ -0,0 +1,99 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstring>
+#include "network_message.h"
+#include "network_protocol.h"
+
+using namespace Glest::Game;
+
+//
+// Tests for the command list protocol carried by NetworkMessageIntro
+//
+class NetworkMessageTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( NetworkMessageTest );
+
+	CPPUNIT_TEST( test_old_intro_decodes_to_fixed_size );
+	CPPUNIT_TEST( test_old_build_reads_new_platform_name );
+	CPPUNIT_TEST( test_unknown_protocol_falls_back );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+	// size and packed format of the platform name in the intro
+	static const int platformSize = 60;
+	typedef NetworkString<platformSize> PlatformString;
+
+	// sent as raw Data struct (NetworkMessage::useOldProtocol)
+	static void sendRaw(PlatformString &source, PlatformString &dest) {
+		memcpy(dest.getBuffer(), source.getBuffer(), platformSize);
+		dest.nullTerminate();
+	}
+
+	// sent with pack() / unpack() like NetworkMessageIntro::packMessage()
+	static void sendPacked(PlatformString &source, PlatformString &dest) {
+		unsigned char buf[platformSize * 2];
+		memset(buf, 0, sizeof(buf));
+		pack(buf, "60s", source.getBuffer());
+		unpack(buf, "60s", dest.getBuffer());
+		dest.nullTerminate();
+	}
+
+public:
+
+	void test_old_intro_decodes_to_fixed_size() {
+		// what builds before the protocol byte put in the intro
+		PlatformString oldPlatform;
+		oldPlatform = "Linux-64bit";
+
+		PlatformString rawPlatform;
+		sendRaw(oldPlatform, rawPlatform);
+		CPPUNIT_ASSERT_EQUAL( nclpFixedSize, NetworkMessageIntro::toCommandListProtocol(rawPlatform.getSpareValue()) );
+
+		PlatformString packedPlatform;
+		sendPacked(oldPlatform, packedPlatform);
+		CPPUNIT_ASSERT_EQUAL( nclpFixedSize, NetworkMessageIntro::toCommandListProtocol(packedPlatform.getSpareValue()) );
+		CPPUNIT_ASSERT_EQUAL( string("Linux-64bit"), packedPlatform.getString() );
+	}
+
+	void test_old_build_reads_new_platform_name() {
+		PlatformString newPlatform;
+		newPlatform = "Linux-64bit";
+		newPlatform.setSpareValue(nclpVarint);
+
+		// an older build only reads the string up to its terminating zero
+		PlatformString rawPlatform;
+		sendRaw(newPlatform, rawPlatform);
+		CPPUNIT_ASSERT_EQUAL( string("Linux-64bit"), rawPlatform.getString() );
+		CPPUNIT_ASSERT_EQUAL( nclpVarint, NetworkMessageIntro::toCommandListProtocol(rawPlatform.getSpareValue()) );
+
+		PlatformString packedPlatform;
+		sendPacked(newPlatform, packedPlatform);
+		CPPUNIT_ASSERT_EQUAL( string("Linux-64bit"), packedPlatform.getString() );
+		CPPUNIT_ASSERT_EQUAL( nclpVarint, NetworkMessageIntro::toCommandListProtocol(packedPlatform.getSpareValue()) );
+	}
+
+	void test_unknown_protocol_falls_back() {
+		CPPUNIT_ASSERT_EQUAL( static_cast<NetworkCommandListProtocol>(nclpCount - 1), NetworkMessageIntro::toCommandListProtocol(nclpCount + 3) );
+		CPPUNIT_ASSERT_EQUAL( nclpFixedSize, NetworkMessageIntro::toCommandListProtocol(-1) );
+
+		// a name that fills the buffer leaves no room for the value
+		PlatformString longPlatform;
+		longPlatform = string(platformSize, 'x');
+		longPlatform.setSpareValue(nclpVarint);
+		CPPUNIT_ASSERT_EQUAL( (int8)0, longPlatform.getSpareValue() );
+	}
+};
+
+// Suite registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( NetworkMessageTest );
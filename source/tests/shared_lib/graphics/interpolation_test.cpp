@@ -0,0 +1,138 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "interpolation.h"
+#include "model.h"
+
+using namespace Shared::Graphics;
+
+//
+// Tests for the key frame cache of InterpolationData
+//
+class InterpolationTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( InterpolationTest );
+
+	CPPUNIT_TEST( test_repeated_frame_is_a_cache_hit );
+	CPPUNIT_TEST( test_cache_stays_within_global_budget );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+	static const uint32 frameCount = 3;
+
+	int64 savedMaxTotalCacheBytes;
+
+	// vertex v of frame f is at (f * 10 + v, v, -f) and has the same normal
+	static void initMesh(Mesh &mesh, uint32 vertexCount) {
+		Vec3f *vertices = new Vec3f[frameCount * vertexCount];
+		Vec3f *normals = new Vec3f[frameCount * vertexCount];
+		for(uint32 frame = 0; frame < frameCount; ++frame) {
+			for(uint32 vertex = 0; vertex < vertexCount; ++vertex) {
+				Vec3f value((float)(frame * 10 + vertex), (float)vertex, -(float)frame);
+				vertices[frame * vertexCount + vertex] = value;
+				normals[frame * vertexCount + vertex] = value;
+			}
+		}
+		mesh.setVertices(vertices, vertexCount);
+		mesh.setNormals(normals, vertexCount);
+		mesh.setFrameCount(frameCount);
+	}
+
+	// t of step between the first and the second frame of a cycle
+	static float getStepTime(int step) {
+		return (float)step / (InterpolationData::interpolationSteps * frameCount);
+	}
+
+	static void assertFirstFrameStep(const InterpolationData &data, uint32 vertexCount, int step) {
+		float localT = (float)step / InterpolationData::interpolationSteps;
+		for(uint32 vertex = 0; vertex < vertexCount; ++vertex) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( vertex + 10.0f * localT, data.getVertices()[vertex].x, 0.0001f );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( (float)vertex, data.getVertices()[vertex].y, 0.0001f );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( -localT, data.getNormals()[vertex].z, 0.0001f );
+		}
+	}
+
+public:
+
+	void setUp() {
+		savedMaxTotalCacheBytes = InterpolationData::getMaxTotalCacheBytes();
+	}
+
+	void tearDown() {
+		InterpolationData::setMaxTotalCacheBytes(savedMaxTotalCacheBytes);
+	}
+
+	void test_repeated_frame_is_a_cache_hit() {
+		const uint32 vertexCount = 4;
+		Mesh mesh;
+		initMesh(mesh, vertexCount);
+
+		InterpolationData *data = new InterpolationData(&mesh);
+		data->update(getStepTime(8), true);
+		CPPUNIT_ASSERT_EQUAL( (uint32)0, data->getCacheHits() );
+		CPPUNIT_ASSERT_EQUAL( (uint32)1, data->getCacheMisses() );
+		assertFirstFrameStep(*data, vertexCount, 8);
+
+		data->update(getStepTime(4), true);
+		data->update(getStepTime(8), true);
+		CPPUNIT_ASSERT_EQUAL( (uint32)1, data->getCacheHits() );
+		CPPUNIT_ASSERT_EQUAL( (uint32)2, data->getCacheMisses() );
+		CPPUNIT_ASSERT_EQUAL( 2, data->getCacheEntryCount() );
+		assertFirstFrameStep(*data, vertexCount, 8);
+
+		delete data;
+	}
+
+	void test_cache_stays_within_global_budget() {
+		const uint32 vertexCount = 1024;
+		const int64 entryBytes = vertexCount * sizeof(Vec3f) * 2;
+		Mesh mesh;
+		initMesh(mesh, vertexCount);
+
+		const int64 bytesBefore = InterpolationData::getTotalCacheBytes();
+		InterpolationData::setMaxTotalCacheBytes(bytesBefore + 4 * entryBytes);
+
+		InterpolationData *first = new InterpolationData(&mesh);
+		InterpolationData *second = new InterpolationData(&mesh);
+		for(int step = 0; step < InterpolationData::interpolationSteps; ++step) {
+			first->update(getStepTime(step), true);
+			assertFirstFrameStep(*first, vertexCount, step);
+		}
+		CPPUNIT_ASSERT_EQUAL( 4, first->getCacheEntryCount() );
+		CPPUNIT_ASSERT_EQUAL( bytesBefore + 4 * entryBytes, InterpolationData::getTotalCacheBytes() );
+
+		// with the budget used up a mesh still gets the one entry it needs to
+		// render and recycles it for every other frame
+		for(int step = 0; step < InterpolationData::interpolationSteps; ++step) {
+			second->update(getStepTime(step), true);
+			assertFirstFrameStep(*second, vertexCount, step);
+		}
+		CPPUNIT_ASSERT_EQUAL( 1, second->getCacheEntryCount() );
+		CPPUNIT_ASSERT_EQUAL( bytesBefore + 5 * entryBytes, InterpolationData::getTotalCacheBytes() );
+
+		// evicted frames are interpolated again, recent ones are hits
+		uint32 hits = first->getCacheHits();
+		first->update(getStepTime(InterpolationData::interpolationSteps - 1), true);
+		CPPUNIT_ASSERT_EQUAL( hits + 1, first->getCacheHits() );
+		first->update(getStepTime(0), true);
+		CPPUNIT_ASSERT_EQUAL( hits + 1, first->getCacheHits() );
+		assertFirstFrameStep(*first, vertexCount, 0);
+
+		delete first;
+		delete second;
+		CPPUNIT_ASSERT_EQUAL( bytesBefore, InterpolationData::getTotalCacheBytes() );
+	}
+};
+
+// Suite registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( InterpolationTest );
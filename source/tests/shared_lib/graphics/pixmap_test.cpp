@@ -0,0 +1,170 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include "pixmap.h"
+#include "randomgen.h"
+
+using namespace Shared::Graphics;
+using Shared::Util::RandomGen;
+
+//
+// Tests for Pixmap2D::splat
+//
+class PixmapTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( PixmapTest );
+
+	CPPUNIT_TEST( test_splat_of_equal_sources_keeps_color );
+	CPPUNIT_TEST( test_splat_corner_uses_its_source );
+	CPPUNIT_TEST( test_splat_matches_per_pixel_kernel );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+	static const int size = 32;
+
+	static void fill(Pixmap2D &pixmap, uint8 red, uint8 green, uint8 blue) {
+		pixmap.init(size, size, 3);
+		uint8 *pixels = pixmap.getPixels();
+		for(int index = 0; index < size * size; ++index) {
+			pixels[index * 3 + 0] = red;
+			pixels[index * 3 + 1] = green;
+			pixels[index * 3 + 2] = blue;
+		}
+	}
+
+	// a different value in every pixel and channel of every source
+	static void fillPattern(Pixmap2D &pixmap, int w, int h, int components, int seed) {
+		pixmap.init(w, h, components);
+		uint8 *pixels = pixmap.getPixels();
+		for(int y = 0; y < h; ++y) {
+			for(int x = 0; x < w; ++x) {
+				for(int channel = 0; channel < components; ++channel) {
+					pixels[(w * y + x) * components + channel] = (uint8)((x * 37 + y * 11 + channel * 71 + seed * 53 + x * y) & 0xFF);
+				}
+			}
+		}
+	}
+
+	static float referenceSplatDist(Vec2i a, Vec2i b) {
+		return (std::max(abs(a.x-b.x),abs(a.y- b.y)) + 3.f*a.dist(b))/4.f;
+	}
+
+	// Pixmap2D::splat as it was before the weights were shared, it draws its
+	// random weights per pixel while it blends
+	static void referenceSplat(Pixmap2D &target, const Pixmap2D *leftUp, const Pixmap2D *rightUp, const Pixmap2D *leftDown, const Pixmap2D *rightDown) {
+		RandomGen random;
+		const int w = target.getW();
+		const int h = target.getH();
+
+		for(int i=0; i<w; ++i){
+			for(int j=0; j<h; ++j){
+
+				float avg= (w+h)/2.f;
+
+				float distLu= referenceSplatDist(Vec2i(i, j), Vec2i(0, 0));
+				float distRu= referenceSplatDist(Vec2i(i, j), Vec2i(w, 0));
+				float distLd= referenceSplatDist(Vec2i(i, j), Vec2i(0, h));
+				float distRd= referenceSplatDist(Vec2i(i, j), Vec2i(w, h));
+
+				const float powFactor= 2.0f;
+
+				distLu	= std::pow(distLu, powFactor);
+				distRu	= std::pow(distRu, powFactor);
+				distLd	= std::pow(distLd, powFactor);
+				distRd	= std::pow(distRd, powFactor);
+				avg		= std::pow(avg, powFactor);
+
+				float lu= distLu>avg? 0: ((avg-distLu))*random.randRange(0.5f, 1.0f);
+				float ru= distRu>avg? 0: ((avg-distRu))*random.randRange(0.5f, 1.0f);
+				float ld= distLd>avg? 0: ((avg-distLd))*random.randRange(0.5f, 1.0f);
+				float rd= distRd>avg? 0: ((avg-distRd))*random.randRange(0.5f, 1.0f);
+
+				float total= lu+ru+ld+rd;
+
+				Vec4f pix= (leftUp->getPixel4f(i, j)*lu+
+					rightUp->getPixel4f(i, j)*ru+
+					leftDown->getPixel4f(i, j)*ld+
+					rightDown->getPixel4f(i, j)*rd)*(1.0f/total);
+
+				target.setPixel(i, j, pix);
+			}
+		}
+	}
+
+	static void assertSplatMatchesReference(int w, int h, int components, int sourceComponents) {
+		Pixmap2D leftUp, rightUp, leftDown, rightDown;
+		fillPattern(leftUp, w, h, components, 1);
+		fillPattern(rightUp, w, h, components, 2);
+		fillPattern(leftDown, w, h, sourceComponents, 3);
+		fillPattern(rightDown, w, h, components, 4);
+
+		Pixmap2D reference(w, h, components);
+		referenceSplat(reference, &leftUp, &rightUp, &leftDown, &rightDown);
+
+		Pixmap2D single(w, h, components);
+		single.splat(&leftUp, &rightUp, &leftDown, &rightDown);
+		CPPUNIT_ASSERT_EQUAL( 0, memcmp(reference.getPixels(), single.getPixels(), w * h * components) );
+
+		// the same table used twice gives the same result both times
+		SplatWeights weights(w, h);
+		for(int pass = 0; pass < 2; ++pass) {
+			Pixmap2D shared(w, h, components);
+			shared.splat(&leftUp, &rightUp, &leftDown, &rightDown, weights);
+			CPPUNIT_ASSERT_EQUAL( 0, memcmp(reference.getPixels(), shared.getPixels(), w * h * components) );
+		}
+	}
+
+public:
+
+	void test_splat_of_equal_sources_keeps_color() {
+		Pixmap2D source;
+		fill(source, 200, 100, 50);
+
+		Pixmap2D result(size, size, 3);
+		result.splat(&source, &source, &source, &source);
+
+		const uint8 expected[] = { 200, 100, 50 };
+		for(int index = 0; index < size * size * 3; ++index) {
+			CPPUNIT_ASSERT( abs(result.getPixels()[index] - expected[index % 3]) <= 1 );
+		}
+	}
+
+	void test_splat_corner_uses_its_source() {
+		Pixmap2D red;
+		Pixmap2D black;
+		fill(red, 255, 0, 0);
+		fill(black, 0, 0, 0);
+
+		Pixmap2D result(size, size, 3);
+		result.splat(&red, &black, &black, &black);
+
+		uint8 pixel[3];
+		result.getPixel(0, 0, pixel);
+		CPPUNIT_ASSERT( pixel[0] >= 254 );
+		result.getPixel(size - 1, size - 1, pixel);
+		CPPUNIT_ASSERT( pixel[0] <= 1 );
+	}
+
+	void test_splat_matches_per_pixel_kernel() {
+		assertSplatMatchesReference(size, size, 3, 3);
+		// not square so swapped coordinates show, one source without alpha
+		assertSplatMatchesReference(24, 40, 4, 3);
+	}
+};
+
+// Suite registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( PixmapTest );
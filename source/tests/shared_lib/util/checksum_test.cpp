@@ -0,0 +1,120 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "checksum.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace Shared::Util;
+
+//
+// Tests for Checksum
+//
+class ChecksumTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( ChecksumTest );
+
+	CPPUNIT_TEST( test_crc32_check_value );
+	CPPUNIT_TEST( test_add_bytes_matches_add_byte );
+	CPPUNIT_TEST( test_xml_formatting_is_ignored );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+	string tempPath;
+
+	static string getTempFilePath(const string &fileName) {
+#ifdef WIN32
+		const char *tempDir = getenv("TEMP");
+		const char *defaultTempDir = ".";
+#else
+		const char *tempDir = getenv("TMPDIR");
+		const char *defaultTempDir = "/tmp";
+#endif
+		string path = (tempDir != NULL && tempDir[0] != '\0' ? tempDir : defaultTempDir);
+		if(path[path.size() - 1] != '/' && path[path.size() - 1] != '\\') {
+			path += "/";
+		}
+		return path + fileName;
+	}
+
+	void writeFile(const string &path, const string &data) {
+		FILE *fp = fopen(path.c_str(), "wb");
+		CPPUNIT_ASSERT( fp != NULL );
+		fwrite(data.c_str(), 1, data.size(), fp);
+		fclose(fp);
+	}
+
+	uint32 getFileSum(const string &path) {
+		Checksum checksum;
+		checksum.addFile(path);
+		return checksum.getSum();
+	}
+
+public:
+
+	void setUp() {
+		tempPath = getTempFilePath("megaglest_checksum_test.xml");
+	}
+
+	void tearDown() {
+		Checksum::removeFileFromCache(tempPath);
+		remove(tempPath.c_str());
+	}
+
+	void test_crc32_check_value() {
+		Checksum checksum;
+		checksum.addString("123456789");
+		CPPUNIT_ASSERT_EQUAL( (uint32)0xCBF43926, checksum.getSum() );
+
+		Checksum checksumBytes;
+		CPPUNIT_ASSERT_EQUAL( (uint32)0xCBF43926, checksumBytes.addBytes("123456789", 9) );
+	}
+
+	void test_add_bytes_matches_add_byte() {
+		std::vector<char> data(1000);
+		for(unsigned int index = 0; index < data.size(); ++index) {
+			data[index] = (char)(index * 7 + index / 13);
+		}
+
+		// every length so the tail after the 8 byte steps is covered too
+		for(unsigned int size = 0; size < 64; ++size) {
+			Checksum checksumByte;
+			for(unsigned int index = 0; index < size; ++index) {
+				checksumByte.addByte(data[index]);
+			}
+			Checksum checksumBytes;
+			checksumBytes.addBytes(&data[0], size);
+			CPPUNIT_ASSERT_EQUAL( checksumByte.getSum(), checksumBytes.getSum() );
+		}
+	}
+
+	void test_xml_formatting_is_ignored() {
+		const string &path = tempPath;
+
+		writeFile(path, "<unit><size value=\"1\"/></unit>");
+		uint32 compactSum = getFileSum(path);
+
+		// different size so the cached value for the path is not reused
+		writeFile(path, "<!-- comment -->\n<unit>\n\t<size value=\"1\"/>\r\n</unit>\n");
+		uint32 formattedSum = getFileSum(path);
+		CPPUNIT_ASSERT_EQUAL( compactSum, formattedSum );
+
+		writeFile(path, "<unit><size value=\"2\"/></unit>");
+		uint32 changedSum = getFileSum(path);
+		CPPUNIT_ASSERT( compactSum != changedSum );
+	}
+};
+
+// Suite registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( ChecksumTest );
@@ -0,0 +1,96 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "lookup_cache.h"
+
+using namespace Shared::Util;
+
+//
+// Tests for LookupCache
+//
+class LookupCacheTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( LookupCacheTest );
+
+	CPPUNIT_TEST( test_capacity_rounding );
+	CPPUNIT_TEST( test_insert_find );
+	CPPUNIT_TEST( test_next_generation_clears );
+	CPPUNIT_TEST( test_capacity_is_bounded );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+public:
+
+	void test_capacity_rounding() {
+		LookupCache<int> cache(1000);
+		CPPUNIT_ASSERT_EQUAL( 1024, cache.getCapacity() );
+	}
+
+	void test_insert_find() {
+		LookupCache<int> cache(64);
+		int value = 0;
+		CPPUNIT_ASSERT_EQUAL( false, cache.find(42, value) );
+
+		cache.insert(42, 7);
+		cache.insert(0, 3);
+		CPPUNIT_ASSERT_EQUAL( true, cache.find(42, value) );
+		CPPUNIT_ASSERT_EQUAL( 7, value );
+		CPPUNIT_ASSERT_EQUAL( true, cache.find(0, value) );
+		CPPUNIT_ASSERT_EQUAL( 3, value );
+
+		cache.insert(42, 9);
+		CPPUNIT_ASSERT_EQUAL( true, cache.find(42, value) );
+		CPPUNIT_ASSERT_EQUAL( 9, value );
+	}
+
+	void test_next_generation_clears() {
+		LookupCache<bool> cache(64);
+		cache.insert(1, true);
+		cache.nextGeneration();
+
+		bool value = false;
+		CPPUNIT_ASSERT_EQUAL( false, cache.find(1, value) );
+
+		cache.insert(1, false);
+		CPPUNIT_ASSERT_EQUAL( true, cache.find(1, value) );
+		CPPUNIT_ASSERT_EQUAL( false, value );
+	}
+
+	void test_capacity_is_bounded() {
+		LookupCache<uint64> cache(16);
+		for(uint64 key = 0; key < 1000; ++key) {
+			cache.insert(key, key * 2);
+		}
+		CPPUNIT_ASSERT_EQUAL( 16, cache.getCapacity() );
+
+		// whatever survived must still map to the right value
+		int found = 0;
+		for(uint64 key = 0; key < 1000; ++key) {
+			uint64 value = 0;
+			if(cache.find(key, value) == true) {
+				CPPUNIT_ASSERT_EQUAL( key * 2, value );
+				++found;
+			}
+		}
+		CPPUNIT_ASSERT( found > 0 );
+		CPPUNIT_ASSERT( found <= 16 );
+
+		// the most recent insert always wins its slot
+		uint64 value = 0;
+		CPPUNIT_ASSERT_EQUAL( true, cache.find(999, value) );
+		CPPUNIT_ASSERT_EQUAL( (uint64)1998, value );
+	}
+};
+
+// Suite registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( LookupCacheTest );
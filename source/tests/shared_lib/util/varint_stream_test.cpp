@@ -0,0 +1,108 @@
+// ==============================================================
+//	This file is part of MegaGlest Unit Tests (www.megaglest.org)
+//
+//	Copyright (C) 2001-2010 Martiño Figueroa and others
+//
+//	You can redistribute this code and/or modify it under
+//	the terms of the GNU General Public License as published
+//	by the Free Software Foundation; either version 2 of the
+//	License, or (at your option) any later version
+// ==============================================================
+
+#include <cppunit/extensions/HelperMacros.h>
+#include "varint_stream.h"
+
+using namespace Shared::Util;
+
+//
+// Tests for VarintWriter / VarintReader
+//
+class VarintStreamTest : public CppUnit::TestFixture {
+	// Register the suite of tests for this fixture
+	CPPUNIT_TEST_SUITE( VarintStreamTest );
+
+	CPPUNIT_TEST( test_small_values_use_one_byte );
+	CPPUNIT_TEST( test_round_trip );
+	CPPUNIT_TEST( test_fixed32_is_little_endian );
+	CPPUNIT_TEST( test_truncated_input_fails );
+
+	CPPUNIT_TEST_SUITE_END();
+	// End of Fixture registration
+
+public:
+
+	void test_small_values_use_one_byte() {
+		VarintWriter writer;
+		writer.writeUnsigned(127);
+		writer.writeSigned(-1);
+		writer.writeSigned(63);
+		CPPUNIT_ASSERT_EQUAL( 3, writer.getSize() );
+
+		writer.writeUnsigned(128);
+		CPPUNIT_ASSERT_EQUAL( 5, writer.getSize() );
+	}
+
+	void test_round_trip() {
+		const int64 values[] = { 0, 1, -1, 300, -300, 2147483647LL, -2147483647LL - 1,
+								 9223372036854775807LL, -9223372036854775807LL - 1 };
+		const int valueCount = sizeof(values) / sizeof(values[0]);
+
+		VarintWriter writer;
+		for(int index = 0; index < valueCount; ++index) {
+			writer.writeSigned(values[index]);
+		}
+		writer.writeUnsigned(0xffffffffffffffffULL);
+		writer.writeByte(0xab);
+
+		VarintReader reader(writer.getData(), writer.getSize());
+		for(int index = 0; index < valueCount; ++index) {
+			int64 value = 0;
+			CPPUNIT_ASSERT_EQUAL( true, reader.readSigned(value) );
+			CPPUNIT_ASSERT_EQUAL( values[index], value );
+		}
+		uint64 largest = 0;
+		CPPUNIT_ASSERT_EQUAL( true, reader.readUnsigned(largest) );
+		CPPUNIT_ASSERT_EQUAL( 0xffffffffffffffffULL, largest );
+
+		uint8 byte = 0;
+		CPPUNIT_ASSERT_EQUAL( true, reader.readByte(byte) );
+		CPPUNIT_ASSERT_EQUAL( (uint8)0xab, byte );
+		CPPUNIT_ASSERT_EQUAL( true, reader.isAtEnd() );
+		CPPUNIT_ASSERT_EQUAL( false, reader.isFailed() );
+	}
+
+	void test_fixed32_is_little_endian() {
+		VarintWriter writer;
+		writer.writeFixed32(0x04030201);
+		CPPUNIT_ASSERT_EQUAL( 4, writer.getSize() );
+		for(int index = 0; index < 4; ++index) {
+			CPPUNIT_ASSERT_EQUAL( index + 1, (int)writer.getData()[index] );
+		}
+
+		VarintReader reader(writer.getData(), writer.getSize());
+		uint32 value = 0;
+		CPPUNIT_ASSERT_EQUAL( true, reader.readFixed32(value) );
+		CPPUNIT_ASSERT_EQUAL( (uint32)0x04030201, value );
+	}
+
+	void test_truncated_input_fails() {
+		VarintWriter writer;
+		writer.writeUnsigned(1000000);
+
+		VarintReader reader(writer.getData(), writer.getSize() - 1);
+		uint64 value = 0;
+		CPPUNIT_ASSERT_EQUAL( false, reader.readUnsigned(value) );
+		CPPUNIT_ASSERT_EQUAL( true, reader.isFailed() );
+
+		// stays failed even if later reads would fit
+		uint8 byte = 0;
+		CPPUNIT_ASSERT_EQUAL( false, reader.readByte(byte) );
+
+		const unsigned char overlong[] = { 0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x80,0x01 };
+		VarintReader overlongReader(overlong, sizeof(overlong));
+		CPPUNIT_ASSERT_EQUAL( false, overlongReader.readUnsigned(value) );
+	}
+};
+
+// Suite registrations
+CPPUNIT_TEST_SUITE_REGISTRATION( VarintStreamTest );
@@ -171,6 +171,7 @@ class XmlIoRapidTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_EXCEPTION( test_load_file_malformed_content,  megaglest_runtime_error );
 	CPPUNIT_TEST_EXCEPTION( test_save_file_null_node,  megaglest_runtime_error );
 	CPPUNIT_TEST(test_save_file_valid_node );
+	CPPUNIT_TEST(test_save_to_string_valid_node );
 
 	CPPUNIT_TEST_SUITE_END();
 	// End of Fixture registration
@@ -230,6 +231,19 @@ public:
 
 		delete rootNode;
 	}
+
+	void test_save_to_string_valid_node() {
+		const string test_filename_load = "xml_test_save_string_valid.xml";
+		createValidXMLTestFile(test_filename_load);
+		SafeRemoveTestFile deleteFile(test_filename_load);
+
+		XmlNode *rootNode = XmlIoRapid::getInstance().load(test_filename_load, std::map<string,string>());
+		string xmlText = XmlIoRapid::getInstance().saveToString(rootNode);
+		delete rootNode;
+
+		CPPUNIT_ASSERT_EQUAL( (size_t)0, xmlText.find("<?xml") );
+		CPPUNIT_ASSERT( xmlText.find("<menu") != string::npos );
+	}
 };
 
 //
@@ -469,6 +483,14 @@ public:
 		CPPUNIT_ASSERT_EQUAL( attribute1, node.getAttribute("some-attribute") );
 		CPPUNIT_ASSERT_EQUAL( string("some-attribute"), node.getAttribute(0)->getName() );
 		CPPUNIT_ASSERT_EQUAL( true, node.hasAttribute("some-attribute") );
+
+		// tags are applied when the attribute is built, the map is not kept
+		{
+			std::map<string,string> mapTags;
+			mapTags["{TESTPATH}"] = "data";
+			node.addAttribute("tagged-attribute", "{TESTPATH}/file.xml", mapTags);
+		}
+		CPPUNIT_ASSERT_EQUAL( string("data/file.xml"), node.getAttribute("tagged-attribute")->getValue() );
 	}
 
 };